@@ -0,0 +1,1427 @@
+//
+// bench.m
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+// Usage: bench <benchmark> <input file> [iterations]
+//    or: make suite
+//
+// Each benchmark should be run in a separate process,
+// because the peak RSS is only meaningful per process.
+//
+// Some benchmarks prepare their input from the contents of the file
+// before measuring anything, e.g. the transform benchmarks run on an
+// immutable canonical tree, so that they don't include parsing.
+//
+// The count-names benchmark prints how many strings are created for the
+// names of elements, attributes and entities, compared to the number of
+// names, i.e. the number of strings that would be created without interning.
+//
+// The parse-lazy benchmark parses the input into a lazy tree, and then
+// follows the first element child of each element down to a leaf, like a
+// consumer that only needs a single path; compare it with parse-dom.
+//
+// The count-memory benchmark prints the number of bytes and heap blocks
+// allocated per node of the canonical tree, with the reading options that
+// affect memory use (SCIXMLCanonicalNode objects and no-copy strings).
+// Blocks can only be counted on Apple platforms; elsewhere they read 0.
+// Attribute-heavy documents show the effect of no-copy strings best.
+//
+// The write benchmarks serialize the canonical tree of the input,
+// into memory or into /dev/null through a file descriptor. The -direct
+// variants use the direct writer instead of xmlTextWriter, and the
+// -indented ones indent the output with two spaces.
+// The write-natural benchmarks serialize the input in natural format,
+// made of the canonical tree by keeping only the elements and their text.
+// write-natural canonicalizes it first, write-natural-direct doesn't.
+//
+// The transform-concurrent benchmark compacts using the number of threads
+// given by the SCIBENCH_THREADS environment variable (all active processors
+// by default); 'make scaling INPUT=<file>' runs it with 1 to 16 threads.
+//
+// The parse-attributes and parse-numbers benchmarks ignore the contents of
+// the input file. Each iteration runs the attribute transform of an attribute
+// parser on a million attributes, so the time per iteration is per million
+// attributes. parse-numbers only has values of the numeric parser types,
+// and parse-dates only has dates, in each of the formats of the Date type.
+//
+// The compact-metrics benchmark runs compact-fused with a metrics delegate
+// installed, so that comparing the two shows the cost of recording metrics.
+//
+// The parse-base64 benchmark decodes a 16 MiB attachment, encoded in lines
+// of 76 characters, per iteration, using the Base64 parser type; the input
+// file is ignored.
+//
+// The parse-escapes benchmark runs the four escaping and unescaping parser
+// types like parse-attributes, on values with something to escape every few
+// bytes; parse-escapes-clean has values of the same lengths with nothing to
+// escape, which are returned as they are.
+//
+// The parse-projection benchmark only builds the elements at the paths given
+// by the SCIBENCH_PROJECTION environment variable, a comma-separated list of
+// slash-separated paths, which by default selects three fields of the records
+// of the 'mixed' shape of the corpus.
+//
+// The load-snapshot benchmark loads a snapshot of the canonical tree of the
+// input, checking it against the input, and then follows the first path like
+// parse-lazy; compare it with parse-dom and parse-lazy. The size of the
+// snapshot is printed before the results.
+//
+// The -small benchmarks parse (and compact, with the compiled transform)
+// each element child of the root of the input as a document of its own,
+// one after the other, which shows the cost of setting up a parse. The
+// number of documents is printed before the results, so that documents
+// per second can be computed from the time per iteration.
+//
+// The record streaming benchmarks split the document into records at the
+// path given by the SCIBENCH_RECORD_PATH environment variable, which is a
+// slash-separated list of element names, 'root/record' by default.
+// records-file streams them from the input file instead of from memory.
+//
+// The write-string, write-stream and write-file benchmarks serialize the
+// canonical tree like write-data, but into a string, an output stream to
+// /dev/null and /dev/null as a file, respectively. write-records writes the
+// children of the root element one by one, as records, to /dev/null.
+// The write-natural- benchmarks do the same in natural format, and the
+// write-compacted ones serialize the semi-canonical dictionary made of the
+// natural format with the canonicalizing transform for natural dictionaries.
+//
+// The transform- benchmarks named after a built-in compacting transform run
+// that transform alone; the comment and member filters are not implemented yet.
+// The child flattening and member parser transforms only work on trees
+// compacted by the transforms preceding them in the basic compacting
+// transform, so their input is compacted by those beforehand, like the input
+// of transform-basic, and all of them get it without comments. Children are
+// grouped into arrays if their name occurs more than once in the same parent.
+// The parser transforms use the numeric and date type maps, whose names are
+// used by the 'values' shape of the corpus.
+//
+// 'make suite' generates the synthetic corpus (see generate.c), then runs
+// the benchmarks that measure something on each of its documents.
+// If the SCIBENCH_JSON environment variable is set, each benchmark appends
+// its results as a line of JSON to the file it names. Nodes per second are
+// computed from the elements, text, CDATA sections, comments and entity
+// references of the input file, even for benchmarks that ignore it.
+// Allocations are counted by wrapping malloc(), which is only possible
+// with glibc; elsewhere, they are not reported, and they are null in JSON.
+//
+
+#import <fcntl.h>
+#import <time.h>
+#import <unistd.h>
+#import <sys/resource.h>
+
+#ifdef __APPLE__
+#import <malloc/malloc.h>
+#else
+#import <malloc.h>
+#endif
+
+#import <libxml/parser.h>
+#import <libxml/xmlreader.h>
+
+#import "SCIXMLSerialization.h"
+#import "SCIXMLTreeBuilder.h"
+#import "SCIXMLUtils.h"
+
+
+typedef BOOL (^SCIBenchmark)(id input);
+typedef id _Nullable (^SCIBenchPreparation)(NSData *data);
+
+
+// The input file, for the benchmarks that read it themselves
+static NSString *SCIBenchInputPath = nil;
+
+#ifdef __GLIBC__
+#define SCIBENCH_COUNTS_ALLOCATIONS 1
+
+// The allocator of glibc, called by the wrappers below, which replace the
+// allocation functions of the whole process, including those of libxml2
+// and the Objective-C runtime. Memory is still freed by glibc's free().
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *pointer, size_t size);
+
+static size_t SCIBenchAllocations = 0;
+
+void *malloc(size_t size) {
+    __atomic_fetch_add(&SCIBenchAllocations, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    __atomic_fetch_add(&SCIBenchAllocations, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size) {
+    __atomic_fetch_add(&SCIBenchAllocations, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(pointer, size);
+}
+#endif
+
+
+// The transform benchmarks call the compaction core directly
+@interface SCIXMLSerialization (SCIBench)
+
++ (id _Nullable)compactDictionary:(NSDictionary *)canonical
+                    withTransform:(id <SCIXMLCompactingTransform>)transform
+                            error:(NSError *__autoreleasing *)error;
+
+@end
+
+
+// Keeps the metrics of the last call
+@interface SCIBenchMetricsCollector : NSObject <SCIXMLMetricsDelegate>
+
+@property (nonatomic, strong, nullable) SCIXMLMetrics *lastMetrics;
+
+@end
+
+@implementation SCIBenchMetricsCollector
+
+- (void)serializationDidFinishWithMetrics:(SCIXMLMetrics *)metrics {
+    self.lastMetrics = metrics;
+}
+
+@end
+
+// The delegate is not retained by SCIXMLSerialization
+static SCIBenchMetricsCollector *SCIBenchMetricsCollectorInstance = nil;
+
+// Installs the collector, enabling metrics for the rest of the process
+static SCIBenchMetricsCollector *SCIBenchInstallMetricsCollector(void) {
+    if (SCIBenchMetricsCollectorInstance == nil) {
+        SCIBenchMetricsCollectorInstance = [SCIBenchMetricsCollector new];
+        SCIXMLSerialization.metricsDelegate = SCIBenchMetricsCollectorInstance;
+    }
+    return SCIBenchMetricsCollectorInstance;
+}
+
+
+static double SCIBenchTime(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double SCIBenchPeakRSSMegabytes(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0); // in bytes
+#else
+    return usage.ru_maxrss / 1024.0; // in kilobytes
+#endif
+}
+
+typedef struct {
+    size_t bytes;
+    size_t blocks;
+} SCIBenchHeapUsage;
+
+static SCIBenchHeapUsage SCIBenchHeapInUse(void) {
+#ifdef __APPLE__
+    malloc_statistics_t stats;
+    malloc_zone_statistics(NULL, &stats);
+    return (SCIBenchHeapUsage){ stats.size_in_use, stats.blocks_in_use };
+#else
+    return (SCIBenchHeapUsage){ mallinfo2().uordblks, 0 };
+#endif
+}
+
+static NSUInteger SCIBenchCountNodes(NSDictionary *node) {
+    NSUInteger count = 1;
+
+    for (NSDictionary *child in node[SCIXMLNodeKeyChildren]) {
+        count += SCIBenchCountNodes(child);
+    }
+
+    return count;
+}
+
+// Counts nodes while streaming the file, so that it works with any size
+static NSNumber *_Nullable SCIBenchCountInputNodes(NSString *path) {
+    xmlTextReader *reader = xmlReaderForFile(
+        path.fileSystemRepresentation,
+        NULL,
+        XML_PARSE_NOENT | XML_PARSE_NONET | XML_PARSE_NOBLANKS | XML_PARSE_HUGE
+    );
+
+    if (reader == NULL) {
+        return nil;
+    }
+
+    NSUInteger count = 0;
+    int status;
+
+    while ((status = xmlTextReaderRead(reader)) == 1) {
+        switch (xmlTextReaderNodeType(reader)) {
+        case XML_READER_TYPE_ELEMENT:
+        case XML_READER_TYPE_TEXT:
+        case XML_READER_TYPE_CDATA:
+        case XML_READER_TYPE_COMMENT:
+        case XML_READER_TYPE_ENTITY_REFERENCE:
+            count++;
+            break;
+        default:
+            break;
+        }
+    }
+
+    xmlFreeTextReader(reader);
+
+    return status == 0 ? @(count) : nil;
+}
+
+// Appends the results to the file named by SCIBENCH_JSON, if any
+static BOOL SCIBenchWriteJSON(NSDictionary<NSString *, id> *results) {
+    const char *path = getenv("SCIBENCH_JSON");
+
+    if (path == NULL) {
+        return YES;
+    }
+
+    NSError *error = nil;
+    NSData *json = [NSJSONSerialization dataWithJSONObject:results options:kNilOptions error:&error];
+
+    if (json == nil) {
+        NSLog(@"could not serialize results: %@", error);
+        return NO;
+    }
+
+    FILE *file = fopen(path, "a");
+
+    if (file == NULL) {
+        fprintf(stderr, "could not open '%s'\n", path);
+        return NO;
+    }
+
+    BOOL success = fwrite(json.bytes, 1, json.length, file) == json.length && fputc('\n', file) != EOF;
+    success = fclose(file) == 0 && success;
+
+    return success;
+}
+
+static BOOL SCIBenchCheck(id result, NSError *error) {
+    if (result == nil) {
+        NSLog(@"benchmark failed: %@", error);
+        return NO;
+    }
+    return YES;
+}
+
+// Compacts any document, even one with repeated child elements
+static NSArray<id <SCIXMLCompactingTransform>> *SCIBenchCompactingTransforms(void) {
+    return @[
+        SCIXMLCompactingTransform.attributeFlatteningTransform,
+        SCIXMLCompactingTransform.elementTypeFilterTransform,
+        SCIXMLCompactingTransform.textNodeFlatteningTransform,
+        [SCIXMLCompactingTransform attributeParserTransformWithTypeMap:@{}
+                                                              fallback:SCIXMLParserTypeIdentity],
+        [SCIXMLCompactingTransform memberParserTransformWithTypeMap:@{}
+                                                           fallback:SCIXMLParserTypeIdentity],
+    ];
+}
+
+// The same transforms, nested in closures
+static id <SCIXMLCompactingTransform> SCIBenchCompactingTransform(void) {
+    return [SCIXMLCompactingTransform combineTransforms:SCIBenchCompactingTransforms()
+                             conflictResolutionStrategy:SCIXMLTransformCombinationConflictResolutionStrategyCompose];
+}
+
+// The same transforms, compiled
+static id <SCIXMLCompactingTransform> SCIBenchCompiledCompactingTransform(void) {
+    return [SCIXMLCompiledCompactingTransform compiledTransformWithTransforms:SCIBenchCompactingTransforms()];
+}
+
+// An immutable copy of a tree, so that compacting it doesn't modify it
+static id _Nullable SCIBenchImmutableCopy(id tree) {
+    NSError *error = nil;
+    NSData *plist = [NSPropertyListSerialization dataWithPropertyList:tree
+                                                               format:NSPropertyListBinaryFormat_v1_0
+                                                              options:0
+                                                                error:&error];
+    if (plist == nil) {
+        NSLog(@"could not copy tree: %@", error);
+        return nil;
+    }
+
+    return [NSPropertyListSerialization propertyListWithData:plist
+                                                     options:NSPropertyListImmutable
+                                                      format:NULL
+                                                       error:&error];
+}
+
+static id _Nullable SCIBenchImmutableCanonicalTree(NSData *data) {
+    NSError *error = nil;
+    NSDictionary *tree = [SCIXMLSerialization canonicalDictionaryWithXMLData:data error:&error];
+
+    if (tree == nil) {
+        NSLog(@"could not parse input: %@", error);
+        return nil;
+    }
+
+    return SCIBenchImmutableCopy(tree);
+}
+
+// Compacts an immutable canonical tree, then copies the result
+static id _Nullable SCIBenchImmutableCompactedTree(NSDictionary *tree, NSArray<id <SCIXMLCompactingTransform>> *transforms) {
+    NSError *error = nil;
+    id transform = [SCIXMLCompactingTransform combineTransforms:transforms
+                                     conflictResolutionStrategy:SCIXMLTransformCombinationConflictResolutionStrategyCompose];
+    id compacted = [SCIXMLSerialization compactDictionary:tree withTransform:transform error:&error];
+
+    if (compacted == nil) {
+        NSLog(@"could not compact input: %@", error);
+        return nil;
+    }
+
+    return SCIBenchImmutableCopy(compacted);
+}
+
+// The names of children that occur more than once in the same parent,
+// for each parent name
+static void SCIBenchCollectRepeatedChildNames(NSDictionary *node, NSMutableDictionary<NSString *, NSMutableSet *> *names) {
+    NSCountedSet<NSString *> *childNames = [NSCountedSet new];
+
+    for (NSDictionary *child in node[SCIXMLNodeKeyChildren]) {
+        if ([child[SCIXMLNodeKeyType] isEqualToString:SCIXMLNodeTypeElement]) {
+            [childNames addObject:child[SCIXMLNodeKeyName]];
+            SCIBenchCollectRepeatedChildNames(child, names);
+        }
+    }
+
+    for (NSString *childName in childNames) {
+        if ([childNames countForObject:childName] < 2) {
+            continue;
+        }
+
+        NSString *name = node[SCIXMLNodeKeyName];
+
+        if (names[name] == nil) {
+            names[name] = [NSMutableSet new];
+        }
+
+        [names[name] addObject:childName];
+    }
+}
+
+static NSDictionary<NSString *, NSArray<NSString *> *> *SCIBenchGroupingMap(NSDictionary *tree) {
+    NSMutableDictionary<NSString *, NSMutableSet *> *names = [NSMutableDictionary new];
+    NSMutableDictionary<NSString *, NSArray<NSString *> *> *groupingMap = [NSMutableDictionary new];
+
+    SCIBenchCollectRepeatedChildNames(tree, names);
+
+    for (NSString *name in names) {
+        groupingMap[name] = names[name].allObjects;
+    }
+
+    return groupingMap;
+}
+
+// Removes comments, which the child flattening transform doesn't support,
+// since the comment filter transform is not implemented yet
+static id <SCIXMLCompactingTransform> SCIBenchCommentRemovingTransform(void) {
+    SCIXMLCompactingTransform *transform = [SCIXMLCompactingTransform new];
+    transform.nodeTypes = [NSSet setWithObject:SCIXMLNodeTypeElement];
+
+    transform.nodeTransform = ^id (NSDictionary *node) {
+        NSArray *children = node[SCIXMLNodeKeyChildren];
+        NSIndexSet *comments = [children indexesOfObjectsPassingTest:^BOOL (id child, NSUInteger index, BOOL *stop) {
+            return [child isKindOfClass:NSDictionary.class] && [child[SCIXMLNodeKeyType] isEqual:SCIXMLNodeTypeComment];
+        }];
+
+        if (comments.count == 0) {
+            return node;
+        }
+
+        NSMutableDictionary *mutableNode = [node mutableCopy];
+        NSMutableArray *mutableChildren = [children mutableCopy];
+        [mutableChildren removeObjectsAtIndexes:comments];
+        mutableNode[SCIXMLNodeKeyChildren] = mutableChildren;
+
+        return mutableNode;
+    };
+
+    return transform;
+}
+
+// The transforms preceding child flattening in the basic compacting
+// transform, after removing comments
+static NSArray<id <SCIXMLCompactingTransform>> *SCIBenchChildFlatteningPrerequisites(void) {
+    return @[
+        SCIBenchCommentRemovingTransform(),
+        SCIXMLCompactingTransform.attributeFlatteningTransform,
+        SCIXMLCompactingTransform.elementTypeFilterTransform,
+        SCIXMLCompactingTransform.textNodeFlatteningTransform,
+    ];
+}
+
+// The input of the child flattening transform and of the basic compacting
+// transform: the tree to compact and the grouping map
+static id _Nullable SCIBenchGroupingInput(NSData *data, NSArray<id <SCIXMLCompactingTransform>> *transforms) {
+    NSDictionary *tree = SCIBenchImmutableCanonicalTree(data);
+    NSDictionary *compacted = tree ? SCIBenchImmutableCompactedTree(tree, transforms) : nil;
+    return compacted ? @[ compacted, SCIBenchGroupingMap(tree) ] : nil;
+}
+
+// A tree compacted up to the member parser in the basic compacting transform
+static id _Nullable SCIBenchMemberInput(NSData *data) {
+    NSDictionary *tree = SCIBenchImmutableCanonicalTree(data);
+
+    if (tree == nil) {
+        return nil;
+    }
+
+    NSArray *transforms = [SCIBenchChildFlatteningPrerequisites() arrayByAddingObject:
+                           [SCIXMLCompactingTransform childFlatteningTransformWithGroupingMap:SCIBenchGroupingMap(tree)]];
+
+    return SCIBenchImmutableCompactedTree(tree, transforms);
+}
+
+// The natural format of a canonical element: elements containing only text
+// become strings, others an array of single-key dictionaries, with the
+// attributes, if any, under the temporary keys. Other nodes are dropped,
+// and so is text mixed with elements.
+static id SCIBenchNaturalChild(NSDictionary *element) {
+    NSDictionary *attributes = element[SCIXMLNodeKeyAttributes];
+    NSMutableArray *children = [NSMutableArray new];
+    NSMutableString *text = [NSMutableString new];
+
+    for (NSDictionary *child in element[SCIXMLNodeKeyChildren]) {
+        NSString *type = child[SCIXMLNodeKeyType];
+
+        if ([type isEqualToString:SCIXMLNodeTypeElement]) {
+            [children addObject:@{ child[SCIXMLNodeKeyName]: SCIBenchNaturalChild(child) }];
+        } else if ([type isEqualToString:SCIXMLNodeTypeText]) {
+            [text appendString:child[SCIXMLNodeKeyText]];
+        }
+    }
+
+    id content = children.count > 0 ? children : text;
+
+    if (attributes.count == 0) {
+        return content;
+    }
+
+    return @{ SCIXMLTempKeyAttrs: attributes, SCIXMLTempKeyChild: content };
+}
+
+static id _Nullable SCIBenchNaturalDictionary(NSData *data) {
+    NSDictionary *tree = SCIBenchImmutableCanonicalTree(data);
+    return tree ? @{ tree[SCIXMLNodeKeyName]: SCIBenchNaturalChild(tree) } : nil;
+}
+
+// Each element child of the root, as a document of its own, like the
+// payloads of a service that handles many small requests
+static id _Nullable SCIBenchSmallDocuments(NSData *data) {
+    NSDictionary *tree = SCIBenchImmutableCanonicalTree(data);
+    NSMutableArray<NSData *> *documents = [NSMutableArray new];
+    NSUInteger length = 0;
+
+    for (NSDictionary *child in tree[SCIXMLNodeKeyChildren]) {
+        if ([child[SCIXMLNodeKeyType] isEqual:SCIXMLNodeTypeElement] == NO) {
+            continue;
+        }
+
+        NSError *error = nil;
+        NSData *document = [SCIXMLSerialization xmlDataWithCanonicalDictionary:child indentation:nil error:&error];
+
+        if (document == nil) {
+            NSLog(@"could not serialize document: %@", error);
+            return nil;
+        }
+
+        [documents addObject:document];
+        length += document.length;
+    }
+
+    if (documents.count == 0) {
+        NSLog(@"the root element has no element children");
+        return nil;
+    }
+
+    printf("%lu documents of %lu bytes on average per iteration\n",
+           (unsigned long)documents.count,
+           (unsigned long)(length / documents.count));
+
+    return documents;
+}
+
+// A snapshot of the canonical tree of the input, in a temporary file
+static id _Nullable SCIBenchSnapshot(NSData *data) {
+    NSDictionary *tree = SCIBenchImmutableCanonicalTree(data);
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"scibench.snapshot"];
+    NSError *error = nil;
+
+    if (tree == nil) {
+        return nil;
+    }
+
+    if ([SCIXMLSerialization writeSnapshotOfObject:tree
+                                           xmlData:data
+                                     configuration:@"canonical"
+                                            toFile:path
+                                             error:&error] == NO) {
+        NSLog(@"could not write snapshot: %@", error);
+        return nil;
+    }
+
+    NSDictionary *attributes = [NSFileManager.defaultManager attributesOfItemAtPath:path error:NULL];
+    printf("snapshot of %llu bytes\n", attributes.fileSize);
+
+    return @{ @"path": path, @"xml": data };
+}
+
+static id _Nullable SCIBenchSemiCanonicalDictionary(NSData *data) {
+    NSDictionary *natural = SCIBenchNaturalDictionary(data);
+    NSError *error = nil;
+
+    if (natural == nil) {
+        return nil;
+    }
+
+    NSDictionary *semiCanonical = [SCIXMLCanonicalizingTransform semiCanonicalDictionaryWithNaturalDictionary:natural
+                                                                                                        error:&error];
+    if (semiCanonical == nil) {
+        NSLog(@"could not prepare input: %@", error);
+    }
+
+    return semiCanonical;
+}
+
+// Name-value pairs for the attribute parser benchmarks
+static NSArray<NSDictionary *> *SCIBenchAttributes(NSDictionary<NSString *, NSString *> *valuesByName) {
+    NSArray<NSString *> *names = valuesByName.allKeys;
+    NSMutableArray<NSDictionary *> *attributes = [NSMutableArray new];
+
+    for (NSUInteger i = 0; i < 1000; i++) {
+        NSString *name = names[i % names.count];
+
+        [attributes addObject:@{
+            SCIXMLAttributeTransformKeyName:  name,
+            SCIXMLAttributeTransformKeyValue: valuesByName[name],
+        }];
+    }
+
+    return attributes;
+}
+
+// Parsed as numbers, booleans, floating-point numbers and by a custom block,
+// and unknown names that fall back to the identity transform
+static NSDictionary *SCIBenchMixedTypeMap(void) {
+    return @{
+        @"id":      SCIXMLParserTypeDecimal,
+        @"enabled": SCIXMLParserTypeBool,
+        @"ratio":   SCIXMLParserTypeFloating,
+        @"label":   ^id _Nullable (NSString *name, id value) { return value; },
+    };
+}
+
+static NSDictionary<NSString *, NSString *> *SCIBenchMixedValues(void) {
+    return @{ @"id": @"12345", @"enabled": @"true", @"ratio": @"0.25", @"label": @"abc", @"unknown": @"xyz" };
+}
+
+// Every numeric type, as found in e.g. a feed of measurements
+static NSDictionary *SCIBenchNumericTypeMap(void) {
+    return @{
+        @"count":    SCIXMLParserTypeDecimal,
+        @"serial":   SCIXMLParserTypeDecimal,
+        @"mask":     SCIXMLParserTypeHex,
+        @"flags":    SCIXMLParserTypeBinary,
+        @"mode":     SCIXMLParserTypeOctal,
+        @"id":       SCIXMLParserTypeInteger,
+        @"offset":   SCIXMLParserTypeInteger,
+        @"price":    SCIXMLParserTypeFloating,
+        @"quantity": SCIXMLParserTypeNumber,
+        @"delta":    SCIXMLParserTypeNumber,
+    };
+}
+
+static NSDictionary<NSString *, NSString *> *SCIBenchNumericValues(void) {
+    return @{
+        @"count":    @"1234567",
+        @"serial":   @"18446744073709551000",
+        @"mask":     @"0xDEADBEEF",
+        @"flags":    @"0b101101",
+        @"mode":     @"0o755",
+        @"id":       @"0x7f",
+        @"offset":   @"-42",
+        @"price":    @"1234.5678",
+        @"quantity": @"42",
+        @"delta":    @"-3.25e-2",
+    };
+}
+
+// One value for each of the formats of the Date parser type
+static NSDictionary *SCIBenchDateTypeMap(void) {
+    return @{
+        @"created":   SCIXMLParserTypeDate,
+        @"modified":  SCIXMLParserTypeDate,
+        @"published": SCIXMLParserTypeDate,
+        @"expires":   SCIXMLParserTypeDate,
+    };
+}
+
+static NSDictionary<NSString *, NSString *> *SCIBenchDateValues(void) {
+    return @{
+        @"created":   @"2026-10-17T08:30:15.250+02:00",
+        @"modified":  @"2026-10-17T08:30:15.5",
+        @"published": @"2026-10-17T08:30:15Z",
+        @"expires":   @"2027-01-01T00:00:00",
+    };
+}
+
+// Both of the above, for parsing documents
+static NSDictionary *SCIBenchValueTypeMap(void) {
+    NSMutableDictionary *typeMap = [SCIBenchNumericTypeMap() mutableCopy];
+    [typeMap addEntriesFromDictionary:SCIBenchDateTypeMap()];
+    return typeMap;
+}
+
+// Random bytes, always the same ones
+static NSData *SCIBenchRandomData(NSUInteger length) {
+    NSMutableData *data = [NSMutableData dataWithLength:length];
+    uint8_t *bytes = data.mutableBytes;
+
+    srandom(1);
+
+    for (NSUInteger i = 0; i < length; i++) {
+        bytes[i] = random();
+    }
+
+    return data;
+}
+
+// A 16 MiB attachment, in lines of 76 characters, as it is usually embedded
+static NSString *SCIBenchBase64Attachment(void) {
+    return [SCIBenchRandomData(16 * 1024 * 1024) base64EncodedStringWithOptions:NSDataBase64Encoding76CharacterLineLength
+                                                                                 | NSDataBase64EncodingEndLineWithLineFeed];
+}
+
+// Source code, messages and markup, in both escaped and unescaped form,
+// so that every escaping parser type has something to escape or unescape
+static NSDictionary *SCIBenchEscapeTypeMap(void) {
+    return @{
+        @"format":  SCIXMLParserTypeUnescapeC,
+        @"literal": SCIXMLParserTypeEscapeC,
+        @"markup":  SCIXMLParserTypeUnescapeXML,
+        @"snippet": SCIXMLParserTypeEscapeXML,
+    };
+}
+
+static NSString *SCIBenchRepeat(NSString *string, NSUInteger count) {
+    NSMutableString *repeated = [NSMutableString stringWithCapacity:string.length * count];
+
+    for (NSUInteger i = 0; i < count; i++) {
+        [repeated appendString:string];
+    }
+
+    return repeated;
+}
+
+// Values with an escape sequence or a character to be escaped every few bytes
+static NSDictionary<NSString *, NSString *> *SCIBenchEscapeValues(void) {
+    return @{
+        @"format":  SCIBenchRepeat(@"\\\"%s\\\"\\t=\\\\t%d\\n\\u00e9\\x41\\101 ", 8),
+        @"literal": SCIBenchRepeat(@"\"%s\"\t=\\t%d\ncafé\r\n", 8),
+        @"markup":  SCIBenchRepeat(@"&lt;a href=&quot;x&amp;y&quot;&gt;&#233;&#x41;&lt;/a&gt; ", 4),
+        @"snippet": SCIBenchRepeat(@"<a href=\"x&y\">é&lt;</a>\r\n", 8),
+    };
+}
+
+// Values of the same lengths without anything to escape or unescape,
+// which the escaping parser types return as they are
+static NSDictionary<NSString *, NSString *> *SCIBenchCleanEscapeValues(void) {
+    NSMutableDictionary<NSString *, NSString *> *values = [NSMutableDictionary new];
+
+    [SCIBenchEscapeValues() enumerateKeysAndObjectsUsingBlock:^(NSString *name, NSString *value, BOOL *stop) {
+        values[name] = [SCIBenchRepeat(@"The quick brown fox jumps over the lazy dog, café. ", 8) substringToIndex:value.length];
+    }];
+
+    return values;
+}
+
+// Runs the attribute transform on a million attributes
+static BOOL SCIBenchParseAttributes(NSArray<NSDictionary *> *attributes, NSDictionary *typeMap) {
+    id <SCIXMLCompactingTransform> transform = [SCIXMLCompactingTransform attributeParserTransformWithTypeMap:typeMap
+                                                                                                     fallback:SCIXMLParserTypeIdentity];
+    id _Nullable (^attributeTransform)(id) = transform.attributeTransform;
+
+    for (NSUInteger i = 0; i < 1000000 / attributes.count; i++) {
+        @autoreleasepool {
+            for (NSDictionary *nameValuePair in attributes) {
+                id value = attributeTransform(nameValuePair);
+
+                if ([value isKindOfClass:NSError.class]) {
+                    return SCIBenchCheck(nil, value);
+                }
+            }
+        }
+    }
+
+    return YES;
+}
+
+static BOOL SCIBenchCompact(NSDictionary *tree, id <SCIXMLCompactingTransform> transform) {
+    NSError *error = nil;
+    id result = [SCIXMLSerialization compactDictionary:tree withTransform:transform error:&error];
+    return SCIBenchCheck(result, error);
+}
+
+static NSUInteger SCIBenchThreads(void) {
+    const char *threads = getenv("SCIBENCH_THREADS");
+    return threads ? strtoul(threads, NULL, 10) : 0;
+}
+
+static NSArray<NSString *> *SCIBenchProjectionPaths(void) {
+    const char *paths = getenv("SCIBENCH_PROJECTION");
+    return [@(paths ?: "root/record/customer,root/record/created,root/record/total") componentsSeparatedByString:@","];
+}
+
+static NSArray<NSString *> *SCIBenchRecordPath(void) {
+    const char *path = getenv("SCIBENCH_RECORD_PATH");
+    return [@(path ?: "root/record") componentsSeparatedByString:@"/"];
+}
+
+// Follows the first element child of each element down to a leaf, reading
+// the attributes on the way, like a consumer looking up a single path.
+// Returns the number of elements visited.
+static NSUInteger SCIBenchTouchFirstPath(NSDictionary *root) {
+    NSUInteger count = 0;
+    NSDictionary *node = root;
+
+    while (node) {
+        // Reading the attributes of a lazy node creates them
+        NSDictionary *attributes = node[SCIXMLNodeKeyAttributes];
+        count += attributes != nil;
+
+        NSDictionary *next = nil;
+
+        for (NSDictionary *child in node[SCIXMLNodeKeyChildren]) {
+            if ([child[SCIXMLNodeKeyType] isEqual:SCIXMLNodeTypeElement]) {
+                next = child;
+                break;
+            }
+        }
+
+        node = next;
+    }
+
+    return count;
+}
+
+static NSDictionary<NSString *, SCIBenchPreparation> *SCIBenchPreparations(void) {
+    return @{
+        @"transform-nested":   ^id _Nullable (NSData *data) { return SCIBenchImmutableCanonicalTree(data); },
+        @"transform-compiled": ^id _Nullable (NSData *data) { return SCIBenchImmutableCanonicalTree(data); },
+        @"transform-concurrent": ^id _Nullable (NSData *data) { return SCIBenchImmutableCanonicalTree(data); },
+        @"parse-attributes":     ^id _Nullable (NSData *data) { return SCIBenchAttributes(SCIBenchMixedValues()); },
+        @"parse-numbers":        ^id _Nullable (NSData *data) { return SCIBenchAttributes(SCIBenchNumericValues()); },
+        @"parse-dates":          ^id _Nullable (NSData *data) { return SCIBenchAttributes(SCIBenchDateValues()); },
+        @"parse-base64":         ^id _Nullable (NSData *data) { return SCIBenchBase64Attachment(); },
+        @"parse-escapes":        ^id _Nullable (NSData *data) { return SCIBenchAttributes(SCIBenchEscapeValues()); },
+        @"parse-escapes-clean":  ^id _Nullable (NSData *data) { return SCIBenchAttributes(SCIBenchCleanEscapeValues()); },
+        @"write-data":         ^id _Nullable (NSData *data) { return SCIBenchImmutableCanonicalTree(data); },
+        @"write-fd":           ^id _Nullable (NSData *data) { return SCIBenchImmutableCanonicalTree(data); },
+        @"write-data-indented":        ^id _Nullable (NSData *data) { return SCIBenchImmutableCanonicalTree(data); },
+        @"write-data-direct":          ^id _Nullable (NSData *data) { return SCIBenchImmutableCanonicalTree(data); },
+        @"write-data-direct-indented": ^id _Nullable (NSData *data) { return SCIBenchImmutableCanonicalTree(data); },
+        @"write-natural":              ^id _Nullable (NSData *data) { return SCIBenchNaturalDictionary(data); },
+        @"write-natural-direct":       ^id _Nullable (NSData *data) { return SCIBenchNaturalDictionary(data); },
+        @"parse-small":    ^id _Nullable (NSData *data) { return SCIBenchSmallDocuments(data); },
+        @"compact-small":  ^id _Nullable (NSData *data) { return SCIBenchSmallDocuments(data); },
+        @"load-snapshot":  ^id _Nullable (NSData *data) { return SCIBenchSnapshot(data); },
+        @"parse-string":   ^id _Nullable (NSData *data) { return [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding]; },
+        @"compact-string": ^id _Nullable (NSData *data) { return [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding]; },
+        @"records-file":   ^id _Nullable (NSData *data) { return SCIBenchInputPath; },
+        @"write-string":           ^id _Nullable (NSData *data) { return SCIBenchImmutableCanonicalTree(data); },
+        @"write-string-direct":    ^id _Nullable (NSData *data) { return SCIBenchImmutableCanonicalTree(data); },
+        @"write-stream":           ^id _Nullable (NSData *data) { return SCIBenchImmutableCanonicalTree(data); },
+        @"write-file":             ^id _Nullable (NSData *data) { return SCIBenchImmutableCanonicalTree(data); },
+        @"write-records":          ^id _Nullable (NSData *data) { return SCIBenchImmutableCanonicalTree(data); },
+        @"write-natural-string":   ^id _Nullable (NSData *data) { return SCIBenchNaturalDictionary(data); },
+        @"write-natural-stream":   ^id _Nullable (NSData *data) { return SCIBenchNaturalDictionary(data); },
+        @"write-compacted":        ^id _Nullable (NSData *data) { return SCIBenchSemiCanonicalDictionary(data); },
+        @"write-compacted-string": ^id _Nullable (NSData *data) { return SCIBenchSemiCanonicalDictionary(data); },
+        @"write-compacted-stream": ^id _Nullable (NSData *data) { return SCIBenchSemiCanonicalDictionary(data); },
+        @"transform-attribute-flattening": ^id _Nullable (NSData *data) { return SCIBenchImmutableCanonicalTree(data); },
+        @"transform-element-type-filter":  ^id _Nullable (NSData *data) { return SCIBenchImmutableCanonicalTree(data); },
+        @"transform-text-node-flattening": ^id _Nullable (NSData *data) { return SCIBenchImmutableCanonicalTree(data); },
+        @"transform-attribute-parser":     ^id _Nullable (NSData *data) { return SCIBenchImmutableCanonicalTree(data); },
+        @"transform-attribute-filter":     ^id _Nullable (NSData *data) { return SCIBenchImmutableCanonicalTree(data); },
+        @"transform-member-parser":        ^id _Nullable (NSData *data) { return SCIBenchMemberInput(data); },
+        @"transform-child-flattening":     ^id _Nullable (NSData *data) {
+            return SCIBenchGroupingInput(data, SCIBenchChildFlatteningPrerequisites());
+        },
+        @"transform-basic":                ^id _Nullable (NSData *data) {
+            return SCIBenchGroupingInput(data, @[ SCIBenchCommentRemovingTransform() ]);
+        },
+    };
+}
+
+static NSDictionary<NSString *, SCIBenchmark> *SCIBenchmarks(void) {
+    return @{
+        @"parse-dom": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization canonicalDictionaryWithXMLData:input
+                                                                    options:SCIXMLReadingOptionsUseDocumentTree
+                                                                      error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"parse-sax": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization canonicalDictionaryWithXMLData:input
+                                                                    options:SCIXMLReadingOptionsNone
+                                                                      error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"compact-dom": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization compactedObjectWithXMLData:input
+                                                    compactingTransform:SCIBenchCompactingTransform()
+                                                                options:SCIXMLReadingOptionsUseDocumentTree
+                                                                  error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"compact-fused": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization compactedObjectWithXMLData:input
+                                                    compactingTransform:SCIBenchCompactingTransform()
+                                                                options:SCIXMLReadingOptionsNone
+                                                                  error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"parse-string": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization canonicalDictionaryWithXMLString:input error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"compact-string": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization compactedObjectWithXMLString:input
+                                                      compactingTransform:SCIBenchCompactingTransform()
+                                                                    error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"parse-nodes": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization canonicalDictionaryWithXMLData:input
+                                                                    options:SCIXMLReadingOptionsCanonicalNodeClass
+                                                                      error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"compact-nodes": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization compactedObjectWithXMLData:input
+                                                    compactingTransform:SCIBenchCompactingTransform()
+                                                                options:SCIXMLReadingOptionsCanonicalNodeClass
+                                                                  error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"parse-nocopy": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization canonicalDictionaryWithXMLData:input
+                                                                    options:SCIXMLReadingOptionsNoCopyStrings
+                                                                      error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"parse-dom-nocopy": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization canonicalDictionaryWithXMLData:input
+                                                                    options:SCIXMLReadingOptionsUseDocumentTree
+                                                                          | SCIXMLReadingOptionsNoCopyStrings
+                                                                      error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"parse-lazy": ^BOOL(id input) {
+            NSError *error = nil;
+            NSDictionary *result = [SCIXMLSerialization canonicalDictionaryWithXMLData:input
+                                                                               options:SCIXMLReadingOptionsLazyTree
+                                                                                 error:&error];
+            return SCIBenchCheck(result, error) && SCIBenchTouchFirstPath(result) > 0;
+        },
+        @"load-snapshot": ^BOOL(NSDictionary *input) {
+            NSError *error = nil;
+            NSDictionary *result = [SCIXMLSerialization objectWithSnapshotFile:input[@"path"]
+                                                                       xmlData:input[@"xml"]
+                                                                 configuration:@"canonical"
+                                                                         error:&error];
+            return SCIBenchCheck(result, error) && SCIBenchTouchFirstPath(result) > 0;
+        },
+        @"parse-projection": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization canonicalDictionaryWithXMLData:input
+                                                                 projection:[SCIXMLProjection projectionKeepingPaths:SCIBenchProjectionPaths()]
+                                                                    options:SCIXMLReadingOptionsNone
+                                                                      error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"parse-small": ^BOOL(NSArray<NSData *> *input) {
+            for (NSData *document in input) {
+                NSError *error = nil;
+                id result = [SCIXMLSerialization canonicalDictionaryWithXMLData:document error:&error];
+
+                if (SCIBenchCheck(result, error) == NO) {
+                    return NO;
+                }
+            }
+            return YES;
+        },
+        @"compact-small": ^BOOL(NSArray<NSData *> *input) {
+            id <SCIXMLCompactingTransform> transform = SCIBenchCompiledCompactingTransform();
+
+            for (NSData *document in input) {
+                NSError *error = nil;
+                id result = [SCIXMLSerialization compactedObjectWithXMLData:document
+                                                        compactingTransform:transform
+                                                                      error:&error];
+
+                if (SCIBenchCheck(result, error) == NO) {
+                    return NO;
+                }
+            }
+            return YES;
+        },
+        @"count-memory": ^BOOL(id input) {
+            NSArray<NSArray *> *configurations = @[
+                @[@"dictionaries", @(SCIXMLReadingOptionsNone)],
+                @[@"canonical nodes", @(SCIXMLReadingOptionsCanonicalNodeClass)],
+                @[@"no-copy strings", @(SCIXMLReadingOptionsNoCopyStrings)],
+                @[@"both", @(SCIXMLReadingOptionsCanonicalNodeClass | SCIXMLReadingOptionsNoCopyStrings)],
+            ];
+
+            for (NSArray *configuration in configurations) {
+                NSString *label = configuration[0];
+                SCIXMLReadingOptions options = [configuration[1] unsignedIntegerValue];
+                NSError *error = nil;
+
+                @autoreleasepool {
+                    SCIBenchHeapUsage before = SCIBenchHeapInUse();
+                    NSDictionary *tree = [SCIXMLSerialization canonicalDictionaryWithXMLData:input
+                                                                                     options:options
+                                                                                       error:&error];
+                    SCIBenchHeapUsage after = SCIBenchHeapInUse();
+
+                    if (tree == nil) {
+                        return SCIBenchCheck(nil, error);
+                    }
+
+                    NSUInteger count = SCIBenchCountNodes(tree);
+
+                    printf(
+                        "%s: %lu nodes, %.1f bytes/node, %.2f blocks/node\n",
+                        label.UTF8String,
+                        (unsigned long)count,
+                        (double)(after.bytes - before.bytes) / count,
+                        (double)(after.blocks - before.blocks) / count
+                    );
+                }
+            }
+            return YES;
+        },
+        @"count-names": ^BOOL(id input) {
+            xmlParserCtxt *parser = xmlNewParserCtxt();
+
+            if (parser == NULL) {
+                return NO;
+            }
+
+            SCIXMLTreeBuilder *builder = [SCIXMLTreeBuilder new];
+            [builder attachToParser:parser];
+
+            xmlDoc *doc = xmlCtxtReadMemory(
+                parser,
+                [input bytes],
+                (int)[input length],
+                "",
+                "UTF-8",
+                XML_PARSE_NOENT | XML_PARSE_NONET | XML_PARSE_NOBLANKS | XML_PARSE_HUGE
+            );
+
+            BOOL success = doc != NULL && builder.root != nil;
+
+            if (success) {
+                printf(
+                    "%lu names, %lu name strings created\n",
+                    (unsigned long)builder.nameTable.lookupCount,
+                    (unsigned long)builder.nameTable.stringCount
+                );
+            }
+
+            xmlFreeDoc(doc);
+            xmlFreeParserCtxt(parser);
+
+            return SCIBenchCheck(success ? builder.root : nil, builder.error);
+        },
+        @"records": ^BOOL(id input) {
+            NSError *error = nil;
+            __block NSUInteger count = 0;
+            BOOL success = [SCIXMLSerialization enumerateRecordsWithXMLStream:[NSInputStream inputStreamWithData:input]
+                                                                   recordPath:SCIBenchRecordPath()
+                                                          compactingTransform:SCIBenchCompactingTransform()
+                                                                   usingBlock:^(id record, BOOL *stop) {
+                count++;
+            }
+                                                                        error:&error];
+            return SCIBenchCheck(success ? @(count) : nil, error);
+        },
+        @"records-file": ^BOOL(id input) {
+            NSError *error = nil;
+            __block NSUInteger count = 0;
+            BOOL success = [SCIXMLSerialization enumerateRecordsWithContentsOfFile:input
+                                                                        recordPath:SCIBenchRecordPath()
+                                                               compactingTransform:SCIBenchCompactingTransform()
+                                                                        usingBlock:^(id record, BOOL *stop) {
+                count++;
+            }
+                                                                             error:&error];
+            return SCIBenchCheck(success ? @(count) : nil, error);
+        },
+        @"transform-nested": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization compactDictionary:input
+                                                 withTransform:SCIBenchCompactingTransform()
+                                                         error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"transform-compiled": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization compactDictionary:input
+                                                 withTransform:SCIBenchCompiledCompactingTransform()
+                                                         error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"transform-attribute-flattening": ^BOOL(id input) {
+            return SCIBenchCompact(input, SCIXMLCompactingTransform.attributeFlatteningTransform);
+        },
+        @"transform-element-type-filter": ^BOOL(id input) {
+            return SCIBenchCompact(input, SCIXMLCompactingTransform.elementTypeFilterTransform);
+        },
+        @"transform-text-node-flattening": ^BOOL(id input) {
+            return SCIBenchCompact(input, SCIXMLCompactingTransform.textNodeFlatteningTransform);
+        },
+        @"transform-child-flattening": ^BOOL(NSArray *input) {
+            return SCIBenchCompact(input[0], [SCIXMLCompactingTransform childFlatteningTransformWithGroupingMap:input[1]]);
+        },
+        @"transform-basic": ^BOOL(NSArray *input) {
+            id <SCIXMLCompactingTransform> transform =
+                [SCIXMLCompactingTransform basicCompactingTransformWithChildFlatteningGroupingMap:input[1]
+                                                                           attributeParserTypeMap:SCIBenchValueTypeMap()
+                                                                          attributeParserFallback:SCIXMLParserTypeIdentity
+                                                                              memberParserTypeMap:SCIBenchValueTypeMap()
+                                                                             memberParserFallback:SCIXMLParserTypeIdentity];
+            return SCIBenchCompact(input[0], transform);
+        },
+        @"transform-attribute-parser": ^BOOL(id input) {
+            return SCIBenchCompact(input, [SCIXMLCompactingTransform attributeParserTransformWithTypeMap:SCIBenchValueTypeMap()
+                                                                                                fallback:SCIXMLParserTypeIdentity]);
+        },
+        @"transform-member-parser": ^BOOL(id input) {
+            return SCIBenchCompact(input, [SCIXMLCompactingTransform memberParserTransformWithTypeMap:SCIBenchValueTypeMap()
+                                                                                             fallback:SCIXMLParserTypeIdentity]);
+        },
+        @"transform-attribute-filter": ^BOOL(id input) {
+            return SCIBenchCompact(input, [SCIXMLCompactingTransform attributeFilterTransformWithBlacklist:@[ @"id" ]]);
+        },
+        @"parse-attributes": ^BOOL(id input) {
+            return SCIBenchParseAttributes(input, SCIBenchMixedTypeMap());
+        },
+        @"parse-numbers": ^BOOL(id input) {
+            return SCIBenchParseAttributes(input, SCIBenchNumericTypeMap());
+        },
+        @"parse-dates": ^BOOL(id input) {
+            return SCIBenchParseAttributes(input, SCIBenchDateTypeMap());
+        },
+        @"parse-base64": ^BOOL(NSString *input) {
+            id <SCIXMLCompactingTransform> transform = [SCIXMLCompactingTransform attributeParserTransformWithTypeMap:@{}
+                                                                                                             fallback:SCIXMLParserTypeBase64];
+            id value = transform.attributeTransform(@{
+                SCIXMLAttributeTransformKeyName:  @"attachment",
+                SCIXMLAttributeTransformKeyValue: input,
+            });
+
+            return SCIBenchCheck([value isKindOfClass:NSError.class] ? nil : value, value);
+        },
+        @"parse-escapes": ^BOOL(id input) {
+            return SCIBenchParseAttributes(input, SCIBenchEscapeTypeMap());
+        },
+        @"parse-escapes-clean": ^BOOL(id input) {
+            return SCIBenchParseAttributes(input, SCIBenchEscapeTypeMap());
+        },
+        @"transform-concurrent": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization compactedObjectWithCanonicalDictionary:input
+                                                                compactingTransform:SCIBenchCompiledCompactingTransform()
+                                                                 maximumConcurrency:SCIBenchThreads()
+                                                                              error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"write-data": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization xmlDataWithCanonicalDictionary:input
+                                                                indentation:nil
+                                                                      error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"write-fd": ^BOOL(id input) {
+            NSError *error = nil;
+            int fd = open("/dev/null", O_WRONLY);
+
+            if (fd < 0) {
+                return NO;
+            }
+
+            BOOL success = [SCIXMLSerialization writeCanonicalDictionary:input
+                                                        toFileDescriptor:fd
+                                                             indentation:nil
+                                                                   error:&error];
+            close(fd);
+
+            return SCIBenchCheck(success ? input : nil, error);
+        },
+        @"write-data-indented": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization xmlDataWithCanonicalDictionary:input
+                                                                indentation:@"  "
+                                                                      error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"write-data-direct": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization xmlDataWithCanonicalDictionary:input
+                                                                indentation:nil
+                                                                    options:SCIXMLWritingOptionsDirectWriter
+                                                                      error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"write-data-direct-indented": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization xmlDataWithCanonicalDictionary:input
+                                                                indentation:@"  "
+                                                                    options:SCIXMLWritingOptionsDirectWriter
+                                                                      error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"write-natural": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization xmlDataWithNaturalDictionary:input
+                                                              indentation:nil
+                                                                  options:SCIXMLWritingOptionsNone
+                                                                    error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"write-natural-direct": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization xmlDataWithNaturalDictionary:input
+                                                              indentation:nil
+                                                                  options:SCIXMLWritingOptionsDirectWriter
+                                                                    error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"write-string": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization xmlStringWithCanonicalDictionary:input
+                                                                  indentation:nil
+                                                                        error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"write-string-direct": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization xmlStringWithCanonicalDictionary:input
+                                                                  indentation:nil
+                                                                      options:SCIXMLWritingOptionsDirectWriter
+                                                                        error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"write-stream": ^BOOL(id input) {
+            NSError *error = nil;
+            BOOL success = [SCIXMLSerialization writeCanonicalDictionary:input
+                                                             toXMLStream:[NSOutputStream outputStreamToFileAtPath:@"/dev/null" append:NO]
+                                                             indentation:nil
+                                                                   error:&error];
+            return SCIBenchCheck(success ? input : nil, error);
+        },
+        @"write-file": ^BOOL(id input) {
+            NSError *error = nil;
+            BOOL success = [SCIXMLSerialization writeCanonicalDictionary:input
+                                                                  toFile:@"/dev/null"
+                                                             indentation:nil
+                                                                   error:&error];
+            return SCIBenchCheck(success ? input : nil, error);
+        },
+        @"write-records": ^BOOL(id input) {
+            NSError *error = nil;
+            NSEnumerator *records = [input[SCIXMLNodeKeyChildren] objectEnumerator];
+            BOOL success = [SCIXMLSerialization writeRecordsToXMLStream:[NSOutputStream outputStreamToFileAtPath:@"/dev/null" append:NO]
+                                                        rootElementName:input[SCIXMLNodeKeyName]
+                                                             attributes:input[SCIXMLNodeKeyAttributes]
+                                                canonicalizingTransform:nil
+                                                            indentation:nil
+                                                             usingBlock:^id _Nullable {
+                return records.nextObject;
+            }
+                                                                  error:&error];
+            return SCIBenchCheck(success ? input : nil, error);
+        },
+        @"write-natural-string": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization xmlStringWithNaturalDictionary:input
+                                                                indentation:nil
+                                                                      error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"write-natural-stream": ^BOOL(id input) {
+            NSError *error = nil;
+            BOOL success = [SCIXMLSerialization writeNaturalDictionary:input
+                                                           toXMLStream:[NSOutputStream outputStreamToFileAtPath:@"/dev/null" append:NO]
+                                                           indentation:nil
+                                                                 error:&error];
+            return SCIBenchCheck(success ? input : nil, error);
+        },
+        @"write-compacted": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization xmlDataWithCompactedObject:input
+                                                canonicalizingTransform:SCIXMLCanonicalizingTransform.transformForCanonicalizingNaturalDictionary
+                                                            indentation:nil
+                                                                  error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"write-compacted-string": ^BOOL(id input) {
+            NSError *error = nil;
+            id result = [SCIXMLSerialization xmlStringWithCompactedObject:input
+                                                  canonicalizingTransform:SCIXMLCanonicalizingTransform.transformForCanonicalizingNaturalDictionary
+                                                              indentation:nil
+                                                                    error:&error];
+            return SCIBenchCheck(result, error);
+        },
+        @"write-compacted-stream": ^BOOL(id input) {
+            NSError *error = nil;
+            BOOL success = [SCIXMLSerialization writeCompactedObject:input
+                                             canonicalizingTransform:SCIXMLCanonicalizingTransform.transformForCanonicalizingNaturalDictionary
+                                                         toXMLStream:[NSOutputStream outputStreamToFileAtPath:@"/dev/null" append:NO]
+                                                         indentation:nil
+                                                               error:&error];
+            return SCIBenchCheck(success ? input : nil, error);
+        },
+        @"compact-metrics": ^BOOL(id input) {
+            SCIBenchInstallMetricsCollector();
+
+            NSError *error = nil;
+            id result = [SCIXMLSerialization compactedObjectWithXMLData:input
+                                                    compactingTransform:SCIBenchCompactingTransform()
+                                                                options:SCIXMLReadingOptionsNone
+                                                                  error:&error];
+            return SCIBenchCheck(result, error);
+        },
+    };
+}
+
+
+int main(int argc, char *argv[])
+{
+    @autoreleasepool {
+        if (argc < 3) {
+            fprintf(stderr, "usage: %s <benchmark> <input file> [iterations]\n", argv[0]);
+            fprintf(stderr, "benchmarks: %s\n", [SCIBenchmarks().allKeys componentsJoinedByString:@", "].UTF8String);
+            return 1;
+        }
+
+        NSString *name = @(argv[1]);
+        SCIBenchmark benchmark = SCIBenchmarks()[name];
+
+        if (benchmark == nil) {
+            fprintf(stderr, "unknown benchmark '%s'\n", argv[1]);
+            return 1;
+        }
+
+        // Mapped, so that the streaming benchmarks don't read it into memory
+        SCIBenchInputPath = @(argv[2]);
+        NSData *data = [NSData dataWithContentsOfFile:SCIBenchInputPath options:NSDataReadingMappedIfSafe error:NULL];
+
+        if (data == nil) {
+            fprintf(stderr, "could not read '%s'\n", argv[2]);
+            return 1;
+        }
+
+        SCIBenchPreparation preparation = SCIBenchPreparations()[name];
+        id input = preparation ? preparation(data) : data;
+
+        if (input == nil) {
+            return 1;
+        }
+
+        int iterations = argc > 3 ? atoi(argv[3]) : 1;
+
+        if (iterations < 1) {
+            fprintf(stderr, "invalid number of iterations '%s'\n", argv[3]);
+            return 1;
+        }
+
+#ifdef SCIBENCH_COUNTS_ALLOCATIONS
+        size_t allocationsBefore = __atomic_load_n(&SCIBenchAllocations, __ATOMIC_RELAXED);
+#endif
+        double start = SCIBenchTime();
+
+        for (int i = 0; i < iterations; i++) {
+            @autoreleasepool {
+                if (benchmark(input) == NO) {
+                    return 1;
+                }
+            }
+        }
+
+        double elapsed = (SCIBenchTime() - start) / iterations;
+        double peakRSS = SCIBenchPeakRSSMegabytes();
+        id allocations = NSNull.null;
+
+#ifdef SCIBENCH_COUNTS_ALLOCATIONS
+        size_t allocationsAfter = __atomic_load_n(&SCIBenchAllocations, __ATOMIC_RELAXED);
+        allocations = @((double)(allocationsAfter - allocationsBefore) / iterations);
+#endif
+
+        NSNumber *nodes = SCIBenchCountInputNodes(SCIBenchInputPath);
+        id nodesPerSecond = nodes ? @(nodes.doubleValue / elapsed) : NSNull.null;
+
+        printf(
+            "%s: %d iteration(s), %.3f ms/iteration, %.2f MB/s, %.0f nodes/s, peak RSS %.1f MB",
+            argv[1],
+            iterations,
+            elapsed * 1e3,
+            data.length / elapsed / (1024.0 * 1024.0),
+            nodes ? nodes.doubleValue / elapsed : 0.0,
+            peakRSS
+        );
+
+        if (allocations != NSNull.null) {
+            printf(", %.0f allocations/iteration", [allocations doubleValue]);
+        }
+
+        printf("\n");
+
+        BOOL written = SCIBenchWriteJSON(@{
+            @"benchmark":                 name,
+            @"input":                     SCIBenchInputPath,
+            @"bytes":                     @(data.length),
+            @"nodes":                     nodes ?: NSNull.null,
+            @"iterations":                @(iterations),
+            @"ms_per_iteration":          @(elapsed * 1e3),
+            @"mb_per_second":             @(data.length / elapsed / (1024.0 * 1024.0)),
+            @"nodes_per_second":          nodesPerSecond,
+            @"allocations_per_iteration": allocations,
+            @"peak_rss_mb":               @(peakRSS),
+        });
+
+        if (written == NO) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,262 @@
+//
+// generate.c
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+// Usage: generate <shape> <megabytes>
+//
+// Writes a synthetic XML document of about the given size to standard output,
+// for the benchmarks. The document is always the same for the same arguments.
+// Every shape is a 'root' element containing 'record' elements, so that the
+// record streaming benchmarks work with their default record path:
+//
+//   deep:       each record is a chain of nested elements, 100 levels deep
+//   wide:       records are empty elements with a single attribute
+//   attributes: records have 8 to 24 attributes, some with entities
+//   text:       records contain paragraphs of text, some with entities or
+//               in CDATA sections, and there are comments between records
+//   values:     records have numeric attributes and date children, named as
+//               in the numeric and date type maps of the benchmarks
+//   records:    records as found in a typical export, for the streaming
+//               benchmarks; meant to be generated at 1 GB
+//
+// No element has both text and element children, and no attribute has the
+// name of a sibling element, so the child flattening transform works on every
+// shape, once comments are removed.
+//
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+
+static uint64_t state = 0x9E3779B97F4A7C15;
+static unsigned long long written = 0;
+
+// xorshift64*, so that the output doesn't depend on the C library
+static uint64_t generate_random(void) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1D;
+}
+
+static unsigned generate_uniform(unsigned bound) {
+    return (unsigned)(generate_random() % bound);
+}
+
+// Counts the bytes written, since standard output may be a pipe
+static void emit(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vprintf(format, args);
+    va_end(args);
+
+    if (length > 0) {
+        written += length;
+    }
+}
+
+static const char *const words[] = {
+    "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit",
+    "sed", "do", "eiusmod", "tempor", "incididunt", "ut", "labore", "et", "dolore",
+    "magna", "aliqua", "enim", "ad", "minim", "veniam", "quis", "nostrud",
+    "exercitation", "ullamco", "laboris", "nisi", "aliquip", "ex", "ea", "commodo",
+    "consequat", "árvíztűrő", "tükörfúrógép", "&amp;", "&lt;", "&gt;", "&quot;", "&#x263A;",
+};
+
+static const unsigned word_count = sizeof words / sizeof words[0];
+
+// Entities are only used in text where they are allowed, i.e. not in CDATA
+static void generate_words(unsigned count, int allow_entities) {
+    for (unsigned i = 0; i < count; i++) {
+        const char *word = words[generate_uniform(allow_entities ? word_count : word_count - 5)];
+        emit(i > 0 ? " %s" : "%s", word);
+    }
+}
+
+static void generate_date(void) {
+    emit(
+        "%04u-%02u-%02uT%02u:%02u:%02u",
+        1970 + generate_uniform(100),
+        1 + generate_uniform(12),
+        1 + generate_uniform(28),
+        generate_uniform(24),
+        generate_uniform(60),
+        generate_uniform(60)
+    );
+
+    // The formats of the Date parser type
+    switch (generate_uniform(4)) {
+    case 0:
+        break;
+    case 1:
+        emit("Z");
+        break;
+    case 2:
+        emit(".%03u", generate_uniform(1000));
+        break;
+    default:
+        emit(".%03u%c%02u:%02u", generate_uniform(1000), "+-"[generate_uniform(2)], generate_uniform(15), 15 * generate_uniform(4));
+        break;
+    }
+}
+
+static void generate_deep(unsigned long record) {
+    emit("<record id=\"%lu\">", record);
+
+    for (unsigned level = 0; level < 100; level++) {
+        emit("<level depth=\"%u\">", level);
+    }
+
+    generate_words(1 + generate_uniform(4), 1);
+
+    for (unsigned level = 0; level < 100; level++) {
+        emit("</level>");
+    }
+
+    emit("</record>\n");
+}
+
+static void generate_wide(unsigned long record) {
+    emit("<record id=\"%lu\"/>\n", record);
+}
+
+static void generate_attributes(unsigned long record) {
+    unsigned count = 8 + generate_uniform(17);
+
+    emit("<record id=\"%lu\"", record);
+
+    for (unsigned i = 0; i < count; i++) {
+        emit(" attribute%u=\"", i);
+        generate_words(1 + generate_uniform(3), 1);
+        emit("\"");
+    }
+
+    emit("/>\n");
+}
+
+static void generate_text(unsigned long record) {
+    unsigned count = 1 + generate_uniform(4);
+
+    if (record % 16 == 0) {
+        emit("<!-- ");
+        generate_words(8, 0);
+        emit(" -->\n");
+    }
+
+    emit("<record id=\"%lu\">", record);
+
+    for (unsigned i = 0; i < count; i++) {
+        if (generate_uniform(8) == 0) {
+            emit("<paragraph><![CDATA[");
+            generate_words(20 + generate_uniform(100), 0);
+            emit("]]></paragraph>");
+        } else {
+            emit("<paragraph>");
+            generate_words(20 + generate_uniform(100), 1);
+            emit("</paragraph>");
+        }
+    }
+
+    emit("</record>\n");
+}
+
+static void generate_values(unsigned long record) {
+    emit(
+        "<record"
+        " count=\"%u\""
+        " serial=\"%llu\""
+        " mask=\"0x%08X\""
+        " flags=\"0b%u%u%u%u%u%u\""
+        " mode=\"0o%o\""
+        " id=\"0x%lx\""
+        " offset=\"-%u\""
+        " price=\"%u.%04u\""
+        " quantity=\"%u\""
+        " delta=\"-%u.%02ue-%u\">",
+        generate_uniform(10000000),
+        (unsigned long long)(generate_random() >> 1),
+        (unsigned)generate_random(),
+        generate_uniform(2), generate_uniform(2), generate_uniform(2),
+        generate_uniform(2), generate_uniform(2), generate_uniform(2),
+        generate_uniform(01000),
+        record,
+        generate_uniform(1000),
+        generate_uniform(10000), generate_uniform(10000),
+        generate_uniform(1000),
+        generate_uniform(10), generate_uniform(100), generate_uniform(10)
+    );
+
+    static const char *const dates[] = { "created", "modified", "published", "expires" };
+
+    for (unsigned i = 0; i < 4; i++) {
+        emit("<%s>", dates[i]);
+        generate_date();
+        emit("</%s>", dates[i]);
+    }
+
+    emit("</record>\n");
+}
+
+static void generate_record(unsigned long record) {
+    emit("<record id=\"%lu\" type=\"%s\">", record, record % 3 ? "order" : "refund");
+    emit("<customer>");
+    generate_words(2, 1);
+    emit("</customer><created>");
+    generate_date();
+    emit("</created><total>%u.%02u</total><items>", generate_uniform(100000), generate_uniform(100));
+
+    for (unsigned i = 0, count = 1 + generate_uniform(5); i < count; i++) {
+        emit("<item sku=\"%08u\" quantity=\"%u\">", generate_uniform(100000000), 1 + generate_uniform(10));
+        generate_words(1 + generate_uniform(6), 1);
+        emit("</item>");
+    }
+
+    emit("</items></record>\n");
+}
+
+int main(int argc, char *argv[]) {
+    static const struct {
+        const char *name;
+        void (*generate)(unsigned long);
+    } shapes[] = {
+        { "deep",       generate_deep       },
+        { "wide",       generate_wide       },
+        { "attributes", generate_attributes },
+        { "text",       generate_text       },
+        { "values",     generate_values     },
+        { "records",    generate_record     },
+    };
+
+    void (*generate)(unsigned long) = NULL;
+
+    for (size_t i = 0; argc == 3 && i < sizeof shapes / sizeof shapes[0]; i++) {
+        if (strcmp(argv[1], shapes[i].name) == 0) {
+            generate = shapes[i].generate;
+        }
+    }
+
+    if (generate == NULL) {
+        fprintf(stderr, "usage: %s <deep|wide|attributes|text|values|records> <megabytes>\n", argv[0]);
+        return 1;
+    }
+
+    unsigned long long size = strtoull(argv[2], NULL, 10) * 1024 * 1024;
+
+    emit("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<root>\n");
+
+    for (unsigned long record = 0; written < size; record++) {
+        generate(record);
+    }
+
+    emit("</root>\n");
+
+    return ferror(stdout) != 0 || fflush(stdout) != 0;
+}
@@ -22,6 +22,9 @@ typedef NS_ENUM(NSUInteger, SCIXMLErrorCode) {
     SCIXMLErrorCodeMalformedTree     = 5, // malformed tree, cannot serialize or compactify
     SCIXMLErrorCodeNotUTF8Encoded    = 6, // input data is not in UTF-8
     SCIXMLErrorCodeUnimplemented     = 7, // feature, node type, etc. not yet implemented
+    SCIXMLErrorCodeReadFailed        = 8, // error in actually reading the XML data
+    SCIXMLErrorCodeMalformedSnapshot = 9, // not a snapshot, a truncated one, or one with a corrupt header
+    SCIXMLErrorCodeStaleSnapshot     = 10, // snapshot of another version, XML or configuration
 };
 
 
@@ -0,0 +1,32 @@
+//
+// SCIXMLCanonicalNode.h
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <Foundation/Foundation.h>
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+// A mutable dictionary specialized for canonical nodes. The values for the
+// canonical keys (type, name, children, attributes and text) are stored in
+// fixed slots instead of a hash table, and they are looked up by comparing
+// the key with the SCIXMLNodeKey* constants, which is mostly a pointer
+// comparison. Any other key is stored in an ordinary dictionary, which is
+// only allocated when the first such key is set, e.g. by a transform.
+//
+// Since it's a real NSMutableDictionary, it can be used wherever a canonical
+// dictionary is expected: subscripting, KVC, enumeration, equality and
+// copying work as usual.
+@interface SCIXMLCanonicalNode : NSMutableDictionary
+
++ (instancetype)nodeWithType:(NSString *)type;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,204 @@
+//
+// SCIXMLCanonicalNode.m
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <stdlib.h>
+
+#import "SCIXMLCanonicalNode.h"
+#import "SCIXMLSerialization.h"
+
+
+// Indices of the fixed slots
+typedef NS_ENUM(NSUInteger, SCIXMLCanonicalNodeSlot) {
+    SCIXMLCanonicalNodeSlotType,
+    SCIXMLCanonicalNodeSlotName,
+    SCIXMLCanonicalNodeSlotChildren,
+    SCIXMLCanonicalNodeSlotAttributes,
+    SCIXMLCanonicalNodeSlotText,
+    SCIXMLCanonicalNodeSlotCount, // also means 'not a canonical key'
+};
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SCIXMLCanonicalNode () {
+    id _Nullable _slots[SCIXMLCanonicalNodeSlotCount];
+
+    // Keys other than the canonical ones; lazily allocated
+    NSMutableDictionary *_Nullable _otherEntries;
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+
+static NSString *SCIXMLCanonicalNodeKeyForSlot(SCIXMLCanonicalNodeSlot slot) {
+    switch (slot) {
+    case SCIXMLCanonicalNodeSlotType:       return SCIXMLNodeKeyType;
+    case SCIXMLCanonicalNodeSlotName:       return SCIXMLNodeKeyName;
+    case SCIXMLCanonicalNodeSlotChildren:   return SCIXMLNodeKeyChildren;
+    case SCIXMLCanonicalNodeSlotAttributes: return SCIXMLNodeKeyAttributes;
+    case SCIXMLCanonicalNodeSlotText:       return SCIXMLNodeKeyText;
+    default:                                abort();
+    }
+}
+
+static SCIXMLCanonicalNodeSlot SCIXMLCanonicalNodeSlotForKey(id key) {
+    // Keys are almost always the constants themselves
+    for (SCIXMLCanonicalNodeSlot slot = 0; slot < SCIXMLCanonicalNodeSlotCount; slot++) {
+        if (key == SCIXMLCanonicalNodeKeyForSlot(slot)) {
+            return slot;
+        }
+    }
+
+    if ([key isKindOfClass:NSString.class] == NO) {
+        return SCIXMLCanonicalNodeSlotCount;
+    }
+
+    for (SCIXMLCanonicalNodeSlot slot = 0; slot < SCIXMLCanonicalNodeSlotCount; slot++) {
+        if ([key isEqualToString:SCIXMLCanonicalNodeKeyForSlot(slot)]) {
+            return slot;
+        }
+    }
+
+    return SCIXMLCanonicalNodeSlotCount;
+}
+
+
+@implementation SCIXMLCanonicalNode
+
++ (instancetype)nodeWithType:(NSString *)type {
+    NSParameterAssert(type);
+
+    SCIXMLCanonicalNode *node = [self new];
+    node->_slots[SCIXMLCanonicalNodeSlotType] = type;
+    return node;
+}
+
+#pragma mark - Initializers required by NSMutableDictionary
+
+- (instancetype)init {
+    return [super init];
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)numItems {
+    return [self init];
+}
+
+- (instancetype)initWithObjects:(const id _Nonnull [_Nullable])objects
+                        forKeys:(const id <NSCopying> _Nonnull [_Nullable])keys
+                          count:(NSUInteger)count {
+
+    self = [self init];
+    if (self) {
+        for (NSUInteger i = 0; i < count; i++) {
+            [self setObject:objects[i] forKey:keys[i]];
+        }
+    }
+    return self;
+}
+
+- (instancetype _Nullable)initWithCoder:(NSCoder *)coder {
+    NSDictionary *dictionary = [[NSDictionary alloc] initWithCoder:coder];
+
+    if (dictionary == nil) {
+        return nil;
+    }
+
+    self = [self init];
+    if (self) {
+        [self addEntriesFromDictionary:dictionary];
+    }
+    return self;
+}
+
+#pragma mark - NSDictionary primitives
+
+- (NSUInteger)count {
+    NSUInteger count = _otherEntries.count;
+
+    for (SCIXMLCanonicalNodeSlot slot = 0; slot < SCIXMLCanonicalNodeSlotCount; slot++) {
+        count += _slots[slot] != nil;
+    }
+
+    return count;
+}
+
+- (id _Nullable)objectForKey:(id)key {
+    SCIXMLCanonicalNodeSlot slot = SCIXMLCanonicalNodeSlotForKey(key);
+
+    if (slot < SCIXMLCanonicalNodeSlotCount) {
+        return _slots[slot];
+    }
+
+    return _otherEntries[key];
+}
+
+- (id _Nullable)objectForKeyedSubscript:(id)key {
+    return [self objectForKey:key];
+}
+
+- (NSEnumerator *)keyEnumerator {
+    NSMutableArray *keys = [NSMutableArray arrayWithCapacity:self.count];
+
+    for (SCIXMLCanonicalNodeSlot slot = 0; slot < SCIXMLCanonicalNodeSlotCount; slot++) {
+        if (_slots[slot]) {
+            [keys addObject:SCIXMLCanonicalNodeKeyForSlot(slot)];
+        }
+    }
+
+    if (_otherEntries) {
+        [keys addObjectsFromArray:_otherEntries.allKeys];
+    }
+
+    return keys.objectEnumerator;
+}
+
+#pragma mark - NSMutableDictionary primitives
+
+- (void)setObject:(id)object forKey:(id <NSCopying>)key {
+    NSParameterAssert(object);
+    NSParameterAssert(key);
+
+    SCIXMLCanonicalNodeSlot slot = SCIXMLCanonicalNodeSlotForKey(key);
+
+    if (slot < SCIXMLCanonicalNodeSlotCount) {
+        _slots[slot] = object;
+        return;
+    }
+
+    if (_otherEntries == nil) {
+        _otherEntries = [NSMutableDictionary new];
+    }
+
+    _otherEntries[key] = object;
+}
+
+- (void)setObject:(id _Nullable)object forKeyedSubscript:(id <NSCopying>)key {
+    if (object) {
+        [self setObject:object forKey:key];
+    } else {
+        [self removeObjectForKey:key];
+    }
+}
+
+- (void)removeObjectForKey:(id)key {
+    NSParameterAssert(key);
+
+    SCIXMLCanonicalNodeSlot slot = SCIXMLCanonicalNodeSlotForKey(key);
+
+    if (slot < SCIXMLCanonicalNodeSlotCount) {
+        _slots[slot] = nil;
+    } else {
+        [_otherEntries removeObjectForKey:key];
+    }
+}
+
+@end
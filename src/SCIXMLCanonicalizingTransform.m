@@ -89,13 +89,14 @@ NSString *const SCIXMLTmpTypeTextNode        = @"textNode";
 
 + (id <SCIXMLCanonicalizingTransform>)transformForCanonicalizingNaturalDictionary {
 
-    id typeProvider = ^NSString *(id object, NSError *__autoreleasing *error) {
-        NSDictionary *typeMap = @{
-            SCIXMLTmpTypeBranchElement: SCIXMLNodeTypeElement,
-            SCIXMLTmpTypeLeafElement:   SCIXMLNodeTypeElement,
-            SCIXMLTmpTypeTextNode:      SCIXMLNodeTypeText,
-        };
+    // Created once, not on every call of the type provider
+    NSDictionary *typeMap = @{
+        SCIXMLTmpTypeBranchElement: SCIXMLNodeTypeElement,
+        SCIXMLTmpTypeLeafElement:   SCIXMLNodeTypeElement,
+        SCIXMLTmpTypeTextNode:      SCIXMLNodeTypeText,
+    };
 
+    id typeProvider = ^NSString *(id object, NSError *__autoreleasing *error) {
         NSString *tmpType = object[SCIXMLTempKeyType];
         NSString *xmlType = typeMap[tmpType];
 
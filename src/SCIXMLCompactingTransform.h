@@ -77,6 +77,16 @@ typedef NS_ENUM(NSUInteger, SCIXMLTransformCombinationConflictResolutionStrategy
     SCIXMLTransformCombinationConflictResolutionStrategyCompose,
 };
 
+// The kinds of sub-transforms, in the order of their application
+typedef NS_ENUM(NSUInteger, SCIXMLSubtransformKind) {
+    SCIXMLSubtransformKindType,
+    SCIXMLSubtransformKindName,
+    SCIXMLSubtransformKindText,
+    SCIXMLSubtransformKindAttribute,
+    SCIXMLSubtransformKindNode,
+    SCIXMLSubtransformKindCount,
+};
+
 
 NS_ASSUME_NONNULL_BEGIN
 @interface SCIXMLCompactingTransform : NSObject <SCIXMLCompactingTransform>
@@ -95,12 +105,40 @@ NS_ASSUME_NONNULL_BEGIN
 //   4. attributeTransform
 //   5. nodeTransform
 //
+// With concurrent compaction, sub-transforms are called on several threads at
+// the same time, for nodes of different subtrees. They must therefore not modify
+// shared state without synchronization, nor depend on the order in which
+// unrelated nodes are compacted. They may only modify the node passed to them
+// and its already compacted children. All transforms provided by this class,
+// and those combined or compiled from them, satisfy these requirements.
+//
 @property (nonatomic, copy, nullable) id _Nullable (^typeTransform)(id);
 @property (nonatomic, copy, nullable) id _Nullable (^nameTransform)(id);
 @property (nonatomic, copy, nullable) id _Nullable (^textTransform)(id);
 @property (nonatomic, copy, nullable) id _Nullable (^attributeTransform)(id);
 @property (nonatomic, copy, nullable) id           (^nodeTransform)(id);
 
+// The types of canonical nodes (e.g. SCIXMLNodeTypeElement) that the sub-transforms
+// are concerned with. Declaring them is a promise that the sub-transforms leave nodes
+// of any other type unchanged, so that a compiled transform can skip calling them.
+// The type of a node is the one it has before any sub-transform has been applied to it.
+// If nil (the default), the sub-transforms are relevant to nodes of all types.
+@property (nonatomic, copy, nullable) NSSet<NSString *> *nodeTypes;
+
+// Names of elements, attributes or members that the sub-transforms look up,
+// e.g. the keys of a type map. When the transform is used while parsing,
+// the occurrences of these names in the document are represented by these
+// very string objects, so that looking them up in collections keyed by them
+// succeeds by pointer comparison. Purely an optimization; may be nil.
+@property (nonatomic, copy, nullable) NSSet<NSString *> *referencedNames;
+
+// The name under which the time spent in the sub-transforms is reported to
+// the metrics delegate of SCIXMLSerialization (see SCIXMLMetrics), e.g.
+// @"childFlattening". Set by the factory methods of the built-in transforms;
+// nil by default, and for combined transforms. Compiled transforms report
+// each of their parts under its own name.
+@property (nonatomic, copy, nullable) NSString *metricsName;
+
 // Designated initializer.
 // Note: -init just calls this with all nil sub-transforms,
 // so -init and +new result in essentially an (inefficient) identity transform.
@@ -113,6 +151,7 @@ NS_ASSUME_NONNULL_BEGIN
 // Combines two transforms. When the conflict resolution strategy is 'Compose',
 // the returned transform is equivalent with (lhs o rhs),
 // i.e. the right-hand-side is applied first.
+// The node types and the referenced names of the result are the union of those of the operands.
 + (id <SCIXMLCompactingTransform>)combineTransform:(id <SCIXMLCompactingTransform>)lhs
                                      withTransform:(id <SCIXMLCompactingTransform>)rhs
                         conflictResolutionStrategy:(SCIXMLTransformCombinationConflictResolutionStrategy)strategy;
@@ -140,6 +179,7 @@ NS_ASSUME_NONNULL_BEGIN
 // transform, the element type filtering transform, the text node flattening transform,
 // the child flattening transform with the specified grouping map and the member parser
 // transform with the specified type map and fallback, in this order.
+// The returned transform is compiled (see SCIXMLCompiledCompactingTransform).
 + (instancetype)basicCompactingTransformWithChildFlatteningGroupingMap:(NSDictionary<NSString *, NSArray<NSString *> *> *_Nullable)groupingMap
                                                 attributeParserTypeMap:(NSDictionary<NSString *, id> *_Nullable)attributeParserTypeMap
                                                attributeParserFallback:(id _Nullable)attributeParserFallback
@@ -234,9 +274,12 @@ NS_ASSUME_NONNULL_BEGIN
 //   Floating:    base-10 floating-point number, as parsed by strtod(); error if unparseable
 //   Number:      Integer or Floating
 //   EscapeC:     escape the string as if it were written as a C string literal
-//   UnescapeC:   inverse of EscapeC
+//                (named escapes for \a\b\f\n\r\t\v, octal for other control characters)
+//   UnescapeC:   inverse of EscapeC; also accepts \x, \u and \U escapes;
+//                error if an escape is invalid or the result is not valid UTF-8
 //   EscapeXML:   escape the string as if it were to be placed inside an XML text element
-//   UnescapeXML: inverse of EscapeXML
+//   UnescapeXML: inverse of EscapeXML; accepts the predefined entities and character references;
+//                error on any other entity or invalid reference
 //   Timestamp:   Time stamp since midnight 01/01/1970 UTC, as integer or double,
 //                converted to an instance of NSDate;
 //                an error is returned if the string is unparseable
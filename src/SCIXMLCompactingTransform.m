@@ -9,9 +9,9 @@
 //
 
 #import <stdbool.h>
-#import <objc/runtime.h>
 
 #import "SCIXMLCompactingTransform.h"
+#import "SCIXMLCompiledCompactingTransform.h"
 #import "SCIXMLSerialization.h"
 #import "SCIXMLUtils.h"
 #import "NSObject+SCIXMLSerialization.h"
@@ -44,6 +44,27 @@ NSString *const SCIXMLParserTypeURL              = @"URL";
 
 
 NS_ASSUME_NONNULL_BEGIN
+
+typedef id _Nullable (^SCIXMLSubtransform)(id);
+
+static SCIXMLSubtransform _Nullable SCIXMLCombineSubtransforms(
+    SCIXMLSubtransform _Nullable lhsSubtransform,
+    SCIXMLSubtransform _Nullable rhsSubtransform,
+    SCIXMLTransformCombinationConflictResolutionStrategy strategy
+);
+
+static NSSet<NSString *> *_Nullable SCIXMLNodeTypesOfTransform(id <SCIXMLCompactingTransform> transform);
+
+static NSSet<NSString *> *_Nullable SCIXMLCombineNodeTypes(
+    id <SCIXMLCompactingTransform> lhs,
+    id <SCIXMLCompactingTransform> rhs
+);
+
+static NSSet<NSString *> *_Nullable SCIXMLCombineReferencedNames(
+    id <SCIXMLCompactingTransform> lhs,
+    id <SCIXMLCompactingTransform> rhs
+);
+
 @interface SCIXMLCompactingTransform ()
 
 + (instancetype)attributeFilterTransformWithNameList:(NSArray<NSString *> *)nameList
@@ -52,9 +73,9 @@ NS_ASSUME_NONNULL_BEGIN
 + (NSDictionary<NSString *, id _Nullable (^)(NSString *, id)> *)parserSubtransforms;
 + (NSDictionary<NSString *, id _Nullable (^)(NSString *, id)> *)unsafeLoadParserSubtransforms;
 
-+ (id _Nullable (^)(NSString *, id))parserSubtransformWithTypeMap:(NSDictionary<NSString *, id> *)typeMap
-                                                             name:(NSString *)name
-                                                         fallback:(id)fallback;
++ (NSDictionary<NSString *, id _Nullable (^)(NSString *, id)> *)parserSubtransformsWithTypeMap:(NSDictionary<NSString *, id> *)typeMap;
+
++ (id _Nullable (^)(NSString *, id))parserSubtransformWithNameOrBlock:(id)subtransformNameOrBlock;
 
 @end
 NS_ASSUME_NONNULL_END
@@ -71,50 +92,17 @@ NS_ASSUME_NONNULL_END
     NSParameterAssert(lhs);
     NSParameterAssert(rhs);
 
-    SCIXMLCompactingTransform *transform = [SCIXMLCompactingTransform new];
-
-    // enumerate all properties of the compacting transform protocol
-    unsigned n = 0;
-    objc_property_t *props = protocol_copyPropertyList(@protocol(SCIXMLCompactingTransform), &n);
-
-    for (unsigned i = 0; i < n; i++) {
-        const char *c_name = property_getName(props[i]);
-        NSString *name = @(c_name);
-
-        id _Nullable (^lhsSubtransform)(id) = [lhs valueForKey:name];
-        id _Nullable (^rhsSubtransform)(id) = [rhs valueForKey:name];
-        id _Nullable (^newSubtransform)(id) = nil;
-
-        // If both transforms have the given subtransform, there's a conflict.
-        if (lhsSubtransform && rhsSubtransform) {
-            switch (strategy) {
-            case SCIXMLTransformCombinationConflictResolutionStrategyUseLeft: {
-                newSubtransform = lhsSubtransform;
-                break;
-            }
-            case SCIXMLTransformCombinationConflictResolutionStrategyUseRight: {
-                newSubtransform = rhsSubtransform;
-                break;
-            }
-            case SCIXMLTransformCombinationConflictResolutionStrategyCompose: {
-                newSubtransform = ^id _Nullable(id value) {
-                    NSObject *tmp = rhsSubtransform(value);
-                    return tmp == nil || tmp.sci_isError ? tmp : lhsSubtransform(tmp);
-                };
-                break;
-            }
-            default:
-                NSAssert(NO, @"invalid conflict resolution strategy");
-                break;
-            }
-        } else {
-            newSubtransform = lhsSubtransform ?: rhsSubtransform;
-        }
-
-        [transform setValue:newSubtransform forKey:name];
-    }
+    // Each kind of sub-transform is combined separately.
+    // The result is never a compiled transform, even if the operands are.
+    SCIXMLCompactingTransform *transform = [SCIXMLCompactingTransform
+        transformWithTypeTransform:SCIXMLCombineSubtransforms(lhs.typeTransform,      rhs.typeTransform,      strategy)
+                     nameTransform:SCIXMLCombineSubtransforms(lhs.nameTransform,      rhs.nameTransform,      strategy)
+                     textTransform:SCIXMLCombineSubtransforms(lhs.textTransform,      rhs.textTransform,      strategy)
+                attributeTransform:SCIXMLCombineSubtransforms(lhs.attributeTransform, rhs.attributeTransform, strategy)
+                     nodeTransform:SCIXMLCombineSubtransforms(lhs.nodeTransform,      rhs.nodeTransform,      strategy)];
 
-    free(props);
+    transform.nodeTypes = SCIXMLCombineNodeTypes(lhs, rhs);
+    transform.referencedNames = SCIXMLCombineReferencedNames(lhs, rhs);
 
     return transform;
 }
@@ -139,11 +127,15 @@ NS_ASSUME_NONNULL_END
 #pragma mark - NSCopying
 
 - (instancetype)copyWithZone:(NSZone *)zone {
-    return [self.class transformWithTypeTransform:self.typeTransform
-                                    nameTransform:self.nameTransform
-                                    textTransform:self.textTransform
-                               attributeTransform:self.attributeTransform
-                                    nodeTransform:self.nodeTransform];
+    SCIXMLCompactingTransform *copy = [self.class transformWithTypeTransform:self.typeTransform
+                                                               nameTransform:self.nameTransform
+                                                               textTransform:self.textTransform
+                                                          attributeTransform:self.attributeTransform
+                                                               nodeTransform:self.nodeTransform];
+    copy.nodeTypes = self.nodeTypes;
+    copy.referencedNames = self.referencedNames;
+    copy.metricsName = self.metricsName;
+    return copy;
 }
 
 #pragma mark - Convenience factory methods
@@ -178,13 +170,14 @@ NS_ASSUME_NONNULL_END
                                       fallback:memberParserFallback ?: SCIXMLParserTypeIdentity],
     ];
 
-    return [SCIXMLCompactingTransform combineTransforms:transforms
-                             conflictResolutionStrategy:SCIXMLTransformCombinationConflictResolutionStrategyCompose];
+    return [SCIXMLCompiledCompactingTransform compiledTransformWithTransforms:transforms];
 }
 
 
 + (instancetype)attributeFlatteningTransform {
-    id <SCIXMLCompactingTransform> transform = [self new];
+    SCIXMLCompactingTransform *transform = [self new];
+    transform.nodeTypes = [NSSet setWithObject:SCIXMLNodeTypeElement];
+    transform.metricsName = @"attributeFlattening";
 
     transform.nodeTransform = ^id (NSDictionary *immutableNode) {
         // the node must be a dictionary...
@@ -233,6 +226,17 @@ NS_ASSUME_NONNULL_END
 + (instancetype)childFlatteningTransformWithGroupingMap:(NSDictionary<NSString *, NSArray<NSString *> *> *_Nullable)groupingMap {
 
     SCIXMLCompactingTransform *transform = [self new];
+    transform.nodeTypes = [NSSet setWithObject:SCIXMLNodeTypeElement];
+
+    // Parent names are looked up in the grouping map, and children by their names
+    NSMutableSet<NSString *> *referencedNames = [NSMutableSet setWithArray:groupingMap.allKeys ?: @[]];
+
+    for (NSArray<NSString *> *childNames in groupingMap.objectEnumerator) {
+        [referencedNames addObjectsFromArray:childNames];
+    }
+
+    transform.referencedNames = referencedNames;
+    transform.metricsName = @"childFlattening";
 
     transform.nodeTransform = ^id (NSDictionary *immutableNode) {
         if (immutableNode.sci_isDictionary == NO) {
@@ -349,6 +353,8 @@ NS_ASSUME_NONNULL_END
 
 + (instancetype)textNodeFlatteningTransform {
     SCIXMLCompactingTransform *transform = [self new];
+    transform.nodeTypes = [NSSet setWithObjects:SCIXMLNodeTypeText, SCIXMLNodeTypeCDATA, nil];
+    transform.metricsName = @"textNodeFlattening";
 
     transform.nodeTransform = ^id (NSDictionary *node) {
         if (node.sci_isDictionary == NO) {
@@ -377,6 +383,8 @@ NS_ASSUME_NONNULL_END
 
 + (instancetype)elementTypeFilterTransform {
     SCIXMLCompactingTransform *transform = [self new];
+    transform.nodeTypes = [NSSet setWithObject:SCIXMLNodeTypeElement];
+    transform.metricsName = @"elementTypeFilter";
 
     transform.typeTransform = ^id _Nullable (id type) {
         return [type isEqual:SCIXMLNodeTypeElement] ? nil : type;
@@ -391,7 +399,15 @@ NS_ASSUME_NONNULL_END
     NSParameterAssert(typeMap);
     NSParameterAssert(fallback);
 
+    // Resolve the type map once, instead of for every attribute
+    NSDictionary<NSString *, id _Nullable (^)(NSString *, id)> *subtransforms = [self parserSubtransformsWithTypeMap:typeMap];
+    id _Nullable (^fallbackSubtransform)(NSString *, id) = [self parserSubtransformWithNameOrBlock:fallback];
+
+    // only elements have attributes
     SCIXMLCompactingTransform *transform = [self new];
+    transform.nodeTypes = [NSSet setWithObject:SCIXMLNodeTypeElement];
+    transform.referencedNames = [NSSet setWithArray:typeMap.allKeys];
+    transform.metricsName = @"attributeParser";
 
     transform.attributeTransform = ^id _Nullable (NSDictionary *nameValuePair) {
         if (nameValuePair.sci_isDictionary == NO) {
@@ -403,11 +419,7 @@ NS_ASSUME_NONNULL_END
         NSString *name = nameValuePair[SCIXMLAttributeTransformKeyName];
         id value       = nameValuePair[SCIXMLAttributeTransformKeyValue];
 
-        // TODO(H2CO3): check that subtransform is not nil
-        id _Nullable (^subtransform)(NSString *, id);
-        subtransform = [self parserSubtransformWithTypeMap:typeMap
-                                                      name:name
-                                                  fallback:fallback];
+        id _Nullable (^subtransform)(NSString *, id) = subtransforms[name] ?: fallbackSubtransform;
 
         return subtransform(name, value);
     };
@@ -421,7 +433,13 @@ NS_ASSUME_NONNULL_END
     NSParameterAssert(typeMap);
     NSParameterAssert(fallback);
 
+    // Resolve the type map once, instead of for every member
+    NSDictionary<NSString *, id _Nullable (^)(NSString *, id)> *subtransforms = [self parserSubtransformsWithTypeMap:typeMap];
+    id _Nullable (^fallbackSubtransform)(NSString *, id) = [self parserSubtransformWithNameOrBlock:fallback];
+
     SCIXMLCompactingTransform *transform = [self new];
+    transform.referencedNames = [NSSet setWithArray:typeMap.allKeys];
+    transform.metricsName = @"memberParser";
 
     transform.nodeTransform = ^id (NSDictionary *immutableNode) {
         // if the node is not a dictionary, don't try to second guess the user
@@ -433,11 +451,7 @@ NS_ASSUME_NONNULL_END
         NSMutableDictionary *node = [immutableNode sci_mutableCopyOrSelf];
 
         for (NSString *name in memberNames) {
-            // TODO(H2CO3): check that subtransform is not nil
-            id _Nullable (^subtransform)(NSString *, id);
-            subtransform = [self parserSubtransformWithTypeMap:typeMap
-                                                          name:name
-                                                      fallback:fallback];
+            id _Nullable (^subtransform)(NSString *, id) = subtransforms[name] ?: fallbackSubtransform;
 
             id result = subtransform(name, node[name]);
 
@@ -532,6 +546,38 @@ NS_ASSUME_NONNULL_END
         SCIXMLParserTypeNumber: ^id _Nullable (NSString *name, id value) {
             return SCIStringToNumber(value);
         },
+        SCIXMLParserTypeEscapeC: ^id _Nullable (NSString *name, NSString *value) {
+            if (value.sci_isString == NO) {
+                return [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedTree
+                                             format:@"expected an NSString for key '%@'", name];
+            }
+
+            return SCIStringEscapeC(value);
+        },
+        SCIXMLParserTypeUnescapeC: ^id _Nullable (NSString *name, NSString *value) {
+            if (value.sci_isString == NO) {
+                return [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedTree
+                                             format:@"expected an NSString for key '%@'", name];
+            }
+
+            return SCIStringUnescapeC(value);
+        },
+        SCIXMLParserTypeEscapeXML: ^id _Nullable (NSString *name, NSString *value) {
+            if (value.sci_isString == NO) {
+                return [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedTree
+                                             format:@"expected an NSString for key '%@'", name];
+            }
+
+            return SCIStringEscapeXML(value);
+        },
+        SCIXMLParserTypeUnescapeXML: ^id _Nullable (NSString *name, NSString *value) {
+            if (value.sci_isString == NO) {
+                return [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedTree
+                                             format:@"expected an NSString for key '%@'", name];
+            }
+
+            return SCIStringUnescapeXML(value);
+        },
         SCIXMLParserTypeTimestamp: ^id _Nullable (NSString *name, id value) {
             id numberOrError = SCIStringToNumber(value);
 
@@ -550,39 +596,10 @@ NS_ASSUME_NONNULL_END
                                                     name, NSStringFromClass(value.class)];
             }
 
-            // Creating a date formatter is expensive - formatters should be re-used
-            static NSArray<NSDateFormatter *> *dateFormatters;
-            static dispatch_once_t token;
-
-            dispatch_once(&token, ^{
-                // Common date formats resembling ISO-8601 full date and time
-                NSArray<NSString *> *dateFormats = @[
-                    @"yyyy'-'MM'-'dd'T'HH':'mm':'ss.SZ",
-                    @"yyyy'-'MM'-'dd'T'HH':'mm':'ss.S",
-                    @"yyyy'-'MM'-'dd'T'HH':'mm':'ssZ",
-                    @"yyyy'-'MM'-'dd'T'HH':'mm':'ss",
-                ];
-
-                NSMutableArray<NSDateFormatter *> *mutableDateFormatters =
-                    [NSMutableArray arrayWithCapacity:dateFormats.count];
-
-                for (NSString *dateFormat in dateFormats) {
-                    NSDateFormatter *dateFormatter = [NSDateFormatter new];
-                    dateFormatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
-                    dateFormatter.timeZone = [NSTimeZone timeZoneWithName:@"UTC"];
-                    dateFormatter.dateFormat = dateFormat;
-                    [mutableDateFormatters addObject:dateFormatter];
-                }
-
-                dateFormatters = mutableDateFormatters;
-            });
-
-            for (NSDateFormatter *dateFormatter in dateFormatters) {
-                NSDate *date = [dateFormatter dateFromString:value];
-
-                if (date) {
-                    return date;
-                }
+            NSDate *date = SCIStringToDate(value);
+
+            if (date) {
+                return date;
             }
 
             return [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedTree
@@ -595,22 +612,7 @@ NS_ASSUME_NONNULL_END
                                              format:@"expected an NSString for key '%@'", name];
             }
 
-            // Remove any whitespace (it's customary to present Base-64 in a tabulated, multiline shape)
-            NSCharacterSet *wsCharset = NSCharacterSet.whitespaceAndNewlineCharacterSet;
-
-            if ([value rangeOfCharacterFromSet:wsCharset].location != NSNotFound) {
-                NSMutableString *noWsString = [value mutableCopy];
-
-                [noWsString replaceOccurrencesOfString:@"\\s"
-                                            withString:@""
-                                               options:NSRegularExpressionSearch
-                                                 range:(NSRange){ 0, noWsString.length }];
-
-                value = noWsString;
-            }
-
-            NSData *data = [[NSData alloc] initWithBase64EncodedString:value
-                                                               options:kNilOptions];
+            NSData *data = SCIBase64StringToData(value);
 
             if (data == nil) {
                 return [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedTree
@@ -628,24 +630,33 @@ NS_ASSUME_NONNULL_END
             return [NSURL URLWithString:value] ?: [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedTree
                                                                         format:@"malformed URL string for key '%@'", name];
         },
-        // TODO(H2CO3): implement all parser transforms
     };
 };
 
-+ (id _Nullable (^)(NSString *, id))parserSubtransformWithTypeMap:(NSDictionary<NSString *, id> *)typeMap
-                                                             name:(NSString *)name
-                                                         fallback:(id)fallback {
-
++ (NSDictionary<NSString *, id _Nullable (^)(NSString *, id)> *)parserSubtransformsWithTypeMap:(NSDictionary<NSString *, id> *)typeMap {
     NSParameterAssert(typeMap);
-    NSParameterAssert(name);
-    NSParameterAssert(fallback);
 
-    id subtransformNameOrBlock = typeMap[name] ?: fallback;
+    NSMutableDictionary<NSString *, id _Nullable (^)(NSString *, id)> *subtransforms = [NSMutableDictionary dictionaryWithCapacity:typeMap.count];
+
+    for (NSString *name in typeMap) {
+        subtransforms[name] = [self parserSubtransformWithNameOrBlock:typeMap[name]];
+    }
+
+    return subtransforms;
+}
+
++ (id _Nullable (^)(NSString *, id))parserSubtransformWithNameOrBlock:(id)subtransformNameOrBlock {
+    NSParameterAssert(subtransformNameOrBlock);
 
     // if it's a transform name, then look it up in the table of predefined parser subtransforms
     if ([subtransformNameOrBlock sci_isString]) {
-        // TODO(H2CO3): check that 'parserSubtransforms[subtransformNameOrBlock]' is not nil
-        return self.parserSubtransforms[subtransformNameOrBlock];
+        id _Nullable (^subtransform)(NSString *, id) = self.parserSubtransforms[subtransformNameOrBlock];
+
+        // Unknown (or not yet implemented) types fail when they are used
+        return subtransform ?: ^id _Nullable (NSString *name, id value) {
+            return [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeUnimplemented
+                                         format:@"unknown parser type '%@' for key '%@'", subtransformNameOrBlock, name];
+        };
     }
 
     // Otherwise, it must be a block
@@ -677,7 +688,10 @@ NS_ASSUME_NONNULL_END
     NSParameterAssert(nameList);
 
     NSSet<NSString *> *nameSet = [NSSet setWithArray:nameList];
-    id <SCIXMLCompactingTransform> transform = [self new];
+    SCIXMLCompactingTransform *transform = [self new];
+    transform.nodeTypes = [NSSet setWithObject:SCIXMLNodeTypeElement];
+    transform.referencedNames = nameSet;
+    transform.metricsName = @"attributeFilter";
 
     transform.attributeTransform = ^id _Nullable (NSDictionary *nameValuePair) {
         if (nameValuePair.sci_isDictionary == NO) {
@@ -752,3 +766,93 @@ NS_ASSUME_NONNULL_END
 }
 
 @end
+
+
+#pragma mark - Combining helpers
+
+NS_ASSUME_NONNULL_BEGIN
+
+static SCIXMLSubtransform _Nullable SCIXMLCombineSubtransforms(
+    SCIXMLSubtransform _Nullable lhsSubtransform,
+    SCIXMLSubtransform _Nullable rhsSubtransform,
+    SCIXMLTransformCombinationConflictResolutionStrategy strategy
+) {
+    // If only one of the transforms has the given subtransform, there's no conflict.
+    if (lhsSubtransform == nil || rhsSubtransform == nil) {
+        return lhsSubtransform ?: rhsSubtransform;
+    }
+
+    switch (strategy) {
+    case SCIXMLTransformCombinationConflictResolutionStrategyUseLeft:
+        return lhsSubtransform;
+    case SCIXMLTransformCombinationConflictResolutionStrategyUseRight:
+        return rhsSubtransform;
+    case SCIXMLTransformCombinationConflictResolutionStrategyCompose:
+        return ^id _Nullable(id value) {
+            NSObject *tmp = rhsSubtransform(value);
+            return tmp == nil || tmp.sci_isError ? tmp : lhsSubtransform(tmp);
+        };
+    default:
+        NSCAssert(NO, @"invalid conflict resolution strategy");
+        return nil;
+    }
+}
+
+static NSSet<NSString *> *_Nullable SCIXMLNodeTypesOfTransform(id <SCIXMLCompactingTransform> transform) {
+    // A transform without any sub-transforms isn't concerned with any node
+    if (transform.typeTransform == nil
+        &&
+        transform.nameTransform == nil
+        &&
+        transform.textTransform == nil
+        &&
+        transform.attributeTransform == nil
+        &&
+        transform.nodeTransform == nil) {
+        return [NSSet set];
+    }
+
+    // Transforms that can't declare their node types are relevant to all nodes
+    if ([transform isKindOfClass:SCIXMLCompactingTransform.class] == NO) {
+        return nil;
+    }
+
+    return ((SCIXMLCompactingTransform *)transform).nodeTypes;
+}
+
+static NSSet<NSString *> *_Nullable SCIXMLCombineNodeTypes(
+    id <SCIXMLCompactingTransform> lhs,
+    id <SCIXMLCompactingTransform> rhs
+) {
+    NSSet<NSString *> *lhsNodeTypes = SCIXMLNodeTypesOfTransform(lhs);
+    NSSet<NSString *> *rhsNodeTypes = SCIXMLNodeTypesOfTransform(rhs);
+
+    if (lhsNodeTypes == nil || rhsNodeTypes == nil) {
+        return nil;
+    }
+
+    return [lhsNodeTypes setByAddingObjectsFromSet:rhsNodeTypes];
+}
+
+static NSSet<NSString *> *_Nullable SCIXMLCombineReferencedNames(
+    id <SCIXMLCompactingTransform> lhs,
+    id <SCIXMLCompactingTransform> rhs
+) {
+    NSSet<NSString *> *lhsNames = nil;
+    NSSet<NSString *> *rhsNames = nil;
+
+    if ([lhs isKindOfClass:SCIXMLCompactingTransform.class]) {
+        lhsNames = ((SCIXMLCompactingTransform *)lhs).referencedNames;
+    }
+    if ([rhs isKindOfClass:SCIXMLCompactingTransform.class]) {
+        rhsNames = ((SCIXMLCompactingTransform *)rhs).referencedNames;
+    }
+
+    if (lhsNames == nil || rhsNames == nil) {
+        return lhsNames ?: rhsNames;
+    }
+
+    return [lhsNames setByAddingObjectsFromSet:rhsNames];
+}
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,41 @@
+//
+// SCIXMLCompiledCompactingTransform.h
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "SCIXMLCompactingTransform.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+// A compacting transform that is equivalent with combining a list of transforms
+// using the 'Compose' strategy. Instead of nesting the sub-transforms in closures,
+// however, it keeps the sub-transforms of each kind in a flat array of stages,
+// which are called in a loop. Stages that are not concerned with the type of the
+// node being compacted (as declared by the nodeTypes property of the transform
+// they come from) are not called at all.
+//
+// The sub-transform properties return the equivalent composed sub-transforms.
+// Setting one of them replaces all the stages of the corresponding kind.
+@interface SCIXMLCompiledCompactingTransform : SCIXMLCompactingTransform
+
+// Just like with +combineTransforms:conflictResolutionStrategy:, the first
+// transform in the array is applied first. Compiled transforms in the array
+// contribute their individual stages.
++ (instancetype)compiledTransformWithTransforms:(NSArray<id <SCIXMLCompactingTransform>> *)transforms;
+
+// Applies the sub-transforms to a single canonical node, the children
+// of which have already been compacted. It doesn't recurse.
+- (id _Nullable)compactNode:(NSDictionary *)canonical
+                      error:(NSError *__autoreleasing *)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
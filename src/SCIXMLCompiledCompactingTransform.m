@@ -0,0 +1,540 @@
+//
+// SCIXMLCompiledCompactingTransform.m
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import "SCIXMLCompiledCompactingTransform.h"
+#import "SCIXMLSerialization.h"
+#import "SCIXMLMetricsRecord.h"
+#import "NSObject+SCIXMLSerialization.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef id _Nullable (^SCIXMLSubtransform)(id);
+
+// The type of a canonical node, as a bit mask, so that the set of
+// node types a stage is concerned with can be tested quickly.
+typedef NS_OPTIONS(NSUInteger, SCIXMLNodeTypeMask) {
+    SCIXMLNodeTypeMaskElement   = 1 << 0,
+    SCIXMLNodeTypeMaskText      = 1 << 1,
+    SCIXMLNodeTypeMaskComment   = 1 << 2,
+    SCIXMLNodeTypeMaskCDATA     = 1 << 3,
+    SCIXMLNodeTypeMaskEntityRef = 1 << 4,
+    SCIXMLNodeTypeMaskOther     = 1 << 5, // missing or unknown type
+    SCIXMLNodeTypeMaskAll       = NSUIntegerMax,
+};
+
+// The block and the name are owned by the compiled transform.
+// The name is the metrics name of the transform the stage comes from.
+typedef struct {
+    __unsafe_unretained SCIXMLSubtransform block;
+    SCIXMLNodeTypeMask nodeTypes;
+    __unsafe_unretained NSString *_Nullable name;
+} SCIXMLCompactingStage;
+
+
+static SCIXMLNodeTypeMask SCIXMLNodeTypeMaskWithType(id _Nullable type);
+static SCIXMLNodeTypeMask SCIXMLNodeTypeMaskWithTypes(NSSet<NSString *> *_Nullable types);
+
+static id _Nullable SCIXMLRunStages(
+    const SCIXMLCompactingStage *stages,
+    NSUInteger count,
+    SCIXMLNodeTypeMask nodeType,
+    id _Nullable value,
+    SCIXMLSubtransformKind kind,
+    SCIXMLMetricsRecord *_Nullable metrics
+);
+
+static id _Nullable SCIXMLRunStagesMeasuring(
+    const SCIXMLCompactingStage *stages,
+    NSUInteger count,
+    SCIXMLNodeTypeMask nodeType,
+    id _Nullable value,
+    SCIXMLSubtransformKind kind,
+    SCIXMLMetricsRecord *metrics
+);
+
+
+@interface SCIXMLCompiledCompactingTransform () {
+    // Stages of each kind, backed by the corresponding data objects
+    const SCIXMLCompactingStage *_Nullable _stages[SCIXMLSubtransformKindCount];
+    NSUInteger _stageCounts[SCIXMLSubtransformKindCount];
+    NSMutableData *_Nullable _stageData[SCIXMLSubtransformKindCount];
+
+    // Own the blocks and the names of the stages (NSNull if a stage has no name)
+    NSMutableArray<SCIXMLSubtransform> *_Nullable _stageBlocks[SCIXMLSubtransformKindCount];
+    NSMutableArray *_Nullable _stageNames[SCIXMLSubtransformKindCount];
+
+    // Union of the node types of the stages of each kind
+    SCIXMLNodeTypeMask _stageNodeTypes[SCIXMLSubtransformKindCount];
+}
+
+- (void)appendStagesOfTransform:(id <SCIXMLCompactingTransform>)transform;
+
+- (void)appendSubtransform:(SCIXMLSubtransform _Nullable)subtransform
+                 nodeTypes:(SCIXMLNodeTypeMask)nodeTypes
+                      name:(NSString *_Nullable)name
+                    ofKind:(SCIXMLSubtransformKind)kind;
+
+- (void)replaceStagesOfKind:(SCIXMLSubtransformKind)kind
+            withSubtransform:(SCIXMLSubtransform _Nullable)subtransform;
+
+- (SCIXMLSubtransform _Nullable)composedSubtransformOfKind:(SCIXMLSubtransformKind)kind;
+
+- (BOOL)hasStagesOfKind:(SCIXMLSubtransformKind)kind forNodeType:(SCIXMLNodeTypeMask)nodeType;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+
+@implementation SCIXMLCompiledCompactingTransform
+
+#pragma mark - Compiling transforms
+
++ (instancetype)compiledTransformWithTransforms:(NSArray<id <SCIXMLCompactingTransform>> *)transforms {
+    NSParameterAssert(transforms);
+
+    SCIXMLCompiledCompactingTransform *compiled = [self new];
+    NSMutableSet<NSString *> *nodeTypes = [NSMutableSet new];
+    NSMutableSet<NSString *> *referencedNames = [NSMutableSet new];
+    BOOL relevantToAllNodeTypes = NO;
+
+    for (id <SCIXMLCompactingTransform> transform in transforms) {
+        [compiled appendStagesOfTransform:transform];
+
+        // The compiled transform is concerned with the union of the node types
+        // of its parts. Parts that can't declare them are relevant to all nodes.
+        if ([transform isKindOfClass:SCIXMLCompactingTransform.class]) {
+            NSSet<NSString *> *transformNodeTypes = ((SCIXMLCompactingTransform *)transform).nodeTypes;
+
+            if (transformNodeTypes) {
+                [nodeTypes unionSet:transformNodeTypes];
+            } else {
+                relevantToAllNodeTypes = YES;
+            }
+
+            [referencedNames unionSet:((SCIXMLCompactingTransform *)transform).referencedNames ?: [NSSet set]];
+        } else {
+            relevantToAllNodeTypes = YES;
+        }
+    }
+
+    compiled.nodeTypes = relevantToAllNodeTypes ? nil : nodeTypes;
+    compiled.referencedNames = referencedNames;
+
+    return compiled;
+}
+
+- (void)appendStagesOfTransform:(id <SCIXMLCompactingTransform>)transform {
+    NSParameterAssert(transform);
+
+    // Compiled transforms are flattened
+    if ([transform isKindOfClass:SCIXMLCompiledCompactingTransform.class]) {
+        SCIXMLCompiledCompactingTransform *compiled = (SCIXMLCompiledCompactingTransform *)transform;
+
+        for (SCIXMLSubtransformKind kind = 0; kind < SCIXMLSubtransformKindCount; kind++) {
+            for (NSUInteger i = 0; i < compiled->_stageCounts[kind]; i++) {
+                [self appendSubtransform:compiled->_stageBlocks[kind][i]
+                               nodeTypes:compiled->_stages[kind][i].nodeTypes
+                                    name:compiled->_stages[kind][i].name
+                                  ofKind:kind];
+            }
+        }
+
+        return;
+    }
+
+    SCIXMLNodeTypeMask nodeTypes = SCIXMLNodeTypeMaskAll;
+    NSString *name = nil;
+
+    if ([transform isKindOfClass:SCIXMLCompactingTransform.class]) {
+        nodeTypes = SCIXMLNodeTypeMaskWithTypes(((SCIXMLCompactingTransform *)transform).nodeTypes);
+        name = ((SCIXMLCompactingTransform *)transform).metricsName;
+    }
+
+    [self appendSubtransform:transform.typeTransform      nodeTypes:nodeTypes name:name ofKind:SCIXMLSubtransformKindType];
+    [self appendSubtransform:transform.nameTransform      nodeTypes:nodeTypes name:name ofKind:SCIXMLSubtransformKindName];
+    [self appendSubtransform:transform.textTransform      nodeTypes:nodeTypes name:name ofKind:SCIXMLSubtransformKindText];
+    [self appendSubtransform:transform.attributeTransform nodeTypes:nodeTypes name:name ofKind:SCIXMLSubtransformKindAttribute];
+    [self appendSubtransform:transform.nodeTransform      nodeTypes:nodeTypes name:name ofKind:SCIXMLSubtransformKindNode];
+}
+
+- (void)appendSubtransform:(SCIXMLSubtransform _Nullable)subtransform
+                 nodeTypes:(SCIXMLNodeTypeMask)nodeTypes
+                      name:(NSString *_Nullable)name
+                    ofKind:(SCIXMLSubtransformKind)kind {
+
+    // Missing sub-transforms don't become stages at all
+    if (subtransform == nil) {
+        return;
+    }
+
+    if (_stageData[kind] == nil) {
+        _stageData[kind] = [NSMutableData new];
+        _stageBlocks[kind] = [NSMutableArray new];
+        _stageNames[kind] = [NSMutableArray new];
+    }
+
+    // The array keeps its own copy alive
+    name = [name copy];
+
+    SCIXMLCompactingStage stage = {
+        .block     = subtransform,
+        .nodeTypes = nodeTypes,
+        .name      = name,
+    };
+
+    [_stageBlocks[kind] addObject:subtransform];
+    [_stageNames[kind] addObject:name ?: (id)NSNull.null];
+    [_stageData[kind] appendBytes:&stage length:sizeof stage];
+
+    // the bytes may have been moved by appending
+    _stages[kind] = _stageData[kind].bytes;
+    _stageCounts[kind] += 1;
+    _stageNodeTypes[kind] |= nodeTypes;
+}
+
+- (void)replaceStagesOfKind:(SCIXMLSubtransformKind)kind
+            withSubtransform:(SCIXMLSubtransform _Nullable)subtransform {
+
+    _stages[kind] = NULL;
+    _stageCounts[kind] = 0;
+    _stageData[kind] = nil;
+    _stageBlocks[kind] = nil;
+    _stageNames[kind] = nil;
+    _stageNodeTypes[kind] = 0;
+
+    // Nothing is known about which node types a sub-transform set directly is concerned with,
+    // nor which transform it comes from
+    [self appendSubtransform:subtransform
+                   nodeTypes:SCIXMLNodeTypeMaskAll
+                        name:nil
+                      ofKind:kind];
+}
+
+- (SCIXMLSubtransform _Nullable)composedSubtransformOfKind:(SCIXMLSubtransformKind)kind {
+    NSArray<SCIXMLSubtransform> *blocks = [_stageBlocks[kind] copy];
+
+    if (blocks.count <= 1) {
+        return blocks.firstObject;
+    }
+
+    // Skipping stages based on the node type is only an optimization,
+    // so the composed sub-transform may simply call all of them.
+    return ^id _Nullable (id value) {
+        for (SCIXMLSubtransform block in blocks) {
+            value = block(value);
+
+            if (value == nil || [value sci_isError]) {
+                break;
+            }
+        }
+
+        return value;
+    };
+}
+
+- (BOOL)hasStagesOfKind:(SCIXMLSubtransformKind)kind forNodeType:(SCIXMLNodeTypeMask)nodeType {
+    return (_stageNodeTypes[kind] & nodeType) != 0;
+}
+
+#pragma mark - Compacting nodes
+
+- (id _Nullable)compactNode:(NSDictionary *)canonical
+                      error:(NSError *__autoreleasing *)error {
+
+    NSParameterAssert(canonical);
+
+    // never leave out error parameter uninitialized
+    if (error) {
+        *error = nil;
+    }
+
+    NSMutableDictionary *node = [canonical sci_mutableCopyOrSelf];
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrentForSubtransforms();
+
+    // Stages are selected based on the type of the node before any of them runs
+    SCIXMLNodeTypeMask nodeType = SCIXMLNodeTypeMaskWithType(node[SCIXMLNodeKeyType]);
+
+    // The rest mirrors how SCIXMLSerialization applies an ordinary transform:
+    // every node has a type, ...
+    if ([self hasStagesOfKind:SCIXMLSubtransformKindType forNodeType:nodeType]) {
+        id value = SCIXMLRunStages(
+            _stages[SCIXMLSubtransformKindType],
+            _stageCounts[SCIXMLSubtransformKindType],
+            nodeType,
+            node[SCIXMLNodeKeyType],
+            SCIXMLSubtransformKindType,
+            metrics
+        );
+
+        if ([value sci_isError]) {
+            if (error) {
+                *error = value;
+            }
+            return nil;
+        }
+
+        node[SCIXMLNodeKeyType] = value;
+    }
+
+    // ...But not all of them have a name...
+    if (node[SCIXMLNodeKeyName] && [self hasStagesOfKind:SCIXMLSubtransformKindName forNodeType:nodeType]) {
+        id value = SCIXMLRunStages(
+            _stages[SCIXMLSubtransformKindName],
+            _stageCounts[SCIXMLSubtransformKindName],
+            nodeType,
+            node[SCIXMLNodeKeyName],
+            SCIXMLSubtransformKindName,
+            metrics
+        );
+
+        if ([value sci_isError]) {
+            if (error) {
+                *error = value;
+            }
+            return nil;
+        }
+
+        node[SCIXMLNodeKeyName] = value;
+    }
+
+    // ...or text contents...
+    if (node[SCIXMLNodeKeyText] && [self hasStagesOfKind:SCIXMLSubtransformKindText forNodeType:nodeType]) {
+        id value = SCIXMLRunStages(
+            _stages[SCIXMLSubtransformKindText],
+            _stageCounts[SCIXMLSubtransformKindText],
+            nodeType,
+            node[SCIXMLNodeKeyText],
+            SCIXMLSubtransformKindText,
+            metrics
+        );
+
+        if ([value sci_isError]) {
+            if (error) {
+                *error = value;
+            }
+            return nil;
+        }
+
+        node[SCIXMLNodeKeyText] = value;
+    }
+
+    // ...or an attribute dictionary.
+    node[SCIXMLNodeKeyAttributes] = [node[SCIXMLNodeKeyAttributes] sci_mutableCopyOrSelf];
+    NSMutableDictionary *attributes = node[SCIXMLNodeKeyAttributes];
+
+    if (attributes && [self hasStagesOfKind:SCIXMLSubtransformKindAttribute forNodeType:nodeType]) {
+        assert(attributes.sci_isMutableDictionary);
+
+        NSArray<NSString *> *attributeNames = attributes.allKeys;
+
+        for (NSString *attrName in attributeNames) {
+            assert(attrName.sci_isString);
+
+            id value = SCIXMLRunStages(
+                _stages[SCIXMLSubtransformKindAttribute],
+                _stageCounts[SCIXMLSubtransformKindAttribute],
+                nodeType,
+                @{
+                    SCIXMLAttributeTransformKeyName:  attrName,
+                    SCIXMLAttributeTransformKeyValue: attributes[attrName],
+                },
+                SCIXMLSubtransformKindAttribute,
+                metrics
+            );
+
+            if ([value sci_isError]) {
+                if (error) {
+                    *error = value;
+                }
+                return nil;
+            }
+
+            attributes[attrName] = value;
+        }
+    }
+
+    // Finally, the node stages
+    if ([self hasStagesOfKind:SCIXMLSubtransformKindNode forNodeType:nodeType]) {
+        id value = SCIXMLRunStages(
+            _stages[SCIXMLSubtransformKindNode],
+            _stageCounts[SCIXMLSubtransformKindNode],
+            nodeType,
+            node,
+            SCIXMLSubtransformKindNode,
+            metrics
+        );
+        NSAssert(value != nil, @"nodeTransform may not return nil, only a valid object or an NSError");
+
+        if ([value sci_isError]) {
+            if (error) {
+                *error = value;
+            }
+            return nil;
+        }
+
+        return value;
+    }
+
+    return node;
+}
+
+#pragma mark - Sub-transform properties
+
+- (SCIXMLSubtransform _Nullable)typeTransform {
+    return [self composedSubtransformOfKind:SCIXMLSubtransformKindType];
+}
+
+- (SCIXMLSubtransform _Nullable)nameTransform {
+    return [self composedSubtransformOfKind:SCIXMLSubtransformKindName];
+}
+
+- (SCIXMLSubtransform _Nullable)textTransform {
+    return [self composedSubtransformOfKind:SCIXMLSubtransformKindText];
+}
+
+- (SCIXMLSubtransform _Nullable)attributeTransform {
+    return [self composedSubtransformOfKind:SCIXMLSubtransformKindAttribute];
+}
+
+- (id (^_Nullable)(id))nodeTransform {
+    return [self composedSubtransformOfKind:SCIXMLSubtransformKindNode];
+}
+
+// These are also called by the initializer of the superclass
+- (void)setTypeTransform:(SCIXMLSubtransform _Nullable)typeTransform {
+    [self replaceStagesOfKind:SCIXMLSubtransformKindType withSubtransform:typeTransform];
+}
+
+- (void)setNameTransform:(SCIXMLSubtransform _Nullable)nameTransform {
+    [self replaceStagesOfKind:SCIXMLSubtransformKindName withSubtransform:nameTransform];
+}
+
+- (void)setTextTransform:(SCIXMLSubtransform _Nullable)textTransform {
+    [self replaceStagesOfKind:SCIXMLSubtransformKindText withSubtransform:textTransform];
+}
+
+- (void)setAttributeTransform:(SCIXMLSubtransform _Nullable)attributeTransform {
+    [self replaceStagesOfKind:SCIXMLSubtransformKindAttribute withSubtransform:attributeTransform];
+}
+
+- (void)setNodeTransform:(id (^_Nullable)(id))nodeTransform {
+    [self replaceStagesOfKind:SCIXMLSubtransformKindNode withSubtransform:nodeTransform];
+}
+
+#pragma mark - NSCopying
+
+- (instancetype)copyWithZone:(NSZone *)zone {
+    SCIXMLCompiledCompactingTransform *copy = [self.class compiledTransformWithTransforms:@[self]];
+    copy.nodeTypes = self.nodeTypes;
+    copy.referencedNames = self.referencedNames;
+    copy.metricsName = self.metricsName;
+    return copy;
+}
+
+@end
+
+
+#pragma mark - Stage helpers
+
+NS_ASSUME_NONNULL_BEGIN
+
+static SCIXMLNodeTypeMask SCIXMLNodeTypeMaskWithType(id _Nullable type) {
+    // Node types are usually the very same constant objects,
+    // so -isEqual: mostly returns after a pointer comparison.
+    if ([type isEqual:SCIXMLNodeTypeElement]) {
+        return SCIXMLNodeTypeMaskElement;
+    }
+    if ([type isEqual:SCIXMLNodeTypeText]) {
+        return SCIXMLNodeTypeMaskText;
+    }
+    if ([type isEqual:SCIXMLNodeTypeComment]) {
+        return SCIXMLNodeTypeMaskComment;
+    }
+    if ([type isEqual:SCIXMLNodeTypeCDATA]) {
+        return SCIXMLNodeTypeMaskCDATA;
+    }
+    if ([type isEqual:SCIXMLNodeTypeEntityRef]) {
+        return SCIXMLNodeTypeMaskEntityRef;
+    }
+
+    return SCIXMLNodeTypeMaskOther;
+}
+
+static SCIXMLNodeTypeMask SCIXMLNodeTypeMaskWithTypes(NSSet<NSString *> *_Nullable types) {
+    if (types == nil) {
+        return SCIXMLNodeTypeMaskAll;
+    }
+
+    SCIXMLNodeTypeMask mask = 0;
+
+    for (NSString *type in types) {
+        mask |= SCIXMLNodeTypeMaskWithType(type);
+    }
+
+    return mask;
+}
+
+static id _Nullable SCIXMLRunStages(
+    const SCIXMLCompactingStage *stages,
+    NSUInteger count,
+    SCIXMLNodeTypeMask nodeType,
+    id _Nullable value,
+    SCIXMLSubtransformKind kind,
+    SCIXMLMetricsRecord *_Nullable metrics
+) {
+    // Only a single branch if metrics are not being recorded
+    if (metrics) {
+        return SCIXMLRunStagesMeasuring(stages, count, nodeType, value, kind, metrics);
+    }
+
+    for (NSUInteger i = 0; i < count; i++) {
+        // The stage promised to leave this node unchanged
+        if ((stages[i].nodeTypes & nodeType) == 0) {
+            continue;
+        }
+
+        value = stages[i].block(value);
+
+        // Just like composed sub-transforms, stop at the first nil or error
+        if (value == nil || [value sci_isError]) {
+            break;
+        }
+    }
+
+    return value;
+}
+
+// Same as SCIXMLRunStages(), but times each stage
+static id _Nullable SCIXMLRunStagesMeasuring(
+    const SCIXMLCompactingStage *stages,
+    NSUInteger count,
+    SCIXMLNodeTypeMask nodeType,
+    id _Nullable value,
+    SCIXMLSubtransformKind kind,
+    SCIXMLMetricsRecord *metrics
+) {
+    for (NSUInteger i = 0; i < count; i++) {
+        if ((stages[i].nodeTypes & nodeType) == 0) {
+            continue;
+        }
+
+        value = SCIXMLMetricsCallSubtransform(metrics, kind, stages[i].name, stages[i].block, value);
+
+        if (value == nil || [value sci_isError]) {
+            break;
+        }
+    }
+
+    return value;
+}
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,48 @@
+//
+// SCIXMLDirectWriter.h
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <Foundation/Foundation.h>
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+// Serializes a canonical tree into a growable UTF-8 byte buffer directly,
+// without going through xmlTextWriter. The bytes of strings are copied out
+// of them in chunks, and escaped using lookup tables. The output is the same,
+// byte for byte, as that of the xmlTextWriter-based serializer, including the
+// XML declaration, indentation and escaping, and so are the errors reported
+// for malformed trees.
+@interface SCIXMLDirectWriter : NSObject
+
+// Indentation has the same meaning as for the xmlTextWriter-based serializer.
+- (instancetype)initWithIndentation:(NSString *_Nullable)indentation;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+// Writes the XML declaration, the node and everything below it.
+// Can only be called once per writer.
+- (BOOL)writeDocumentWithDictionary:(NSDictionary *)dictionary
+                              error:(NSError *__autoreleasing *)error;
+
+// Writes the XML declaration and the document described by a dictionary in
+// natural format, without canonicalizing it first. The output is the same as
+// that of canonicalizing it using the transform for natural dictionaries, then
+// serializing the canonical tree. Returns NO, without telling why, if the
+// dictionary is not in natural format, or if writing fails; canonicalizing it
+// finds out what's wrong with it. Can only be called once per writer.
+- (BOOL)writeDocumentWithNaturalDictionary:(NSDictionary *)root;
+
+// Returns the output written so far, which must be freed using free(),
+// and leaves the writer empty.
+- (char *_Nullable)detachBytesWithLength:(NSUInteger *)length;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,843 @@
+//
+// SCIXMLDirectWriter.m
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <stdio.h>
+#import <stdlib.h>
+#import <string.h>
+
+#import <libxml/xmlwriter.h>
+
+#import "SCIXMLDirectWriter.h"
+#import "SCIXMLSerialization.h"
+#import "SCIXMLCanonicalizingTransform.h"
+#import "NSObject+SCIXMLSerialization.h"
+
+
+// Size of the buffer the bytes of strings that need escaping are copied into
+#define SCIXML_DIRECT_SCRATCH_SIZE 4096
+
+// Initial capacity of the output buffer
+#define SCIXML_DIRECT_INITIAL_CAPACITY (16 * 1024)
+
+
+// How the characters of a string are to be written.
+// The values are indices into SCIXMLEscapeTables.
+typedef NS_ENUM(NSUInteger, SCIXMLEscaping) {
+    SCIXMLEscapingNone              = 0, // names, comments, CDATA sections
+    SCIXMLEscapingText              = 1, // text nodes
+    SCIXMLEscapingAttribute         = 2, // attribute values
+    SCIXMLEscapingAttributeNonASCII = 3, // attribute values, for older libxml versions
+    SCIXMLEscapingCount,
+};
+
+// Bytes in the tables below map to the index of their replacement, or 0 if they
+// are copied as-is. These are the characters xmlTextWriter escapes: in text,
+// via xmlEncodeSpecialChars(), and in attribute values, via
+// xmlBufAttrSerializeTxtContent() (which also escapes whitespace other than space).
+// Older versions of libxml also escape non-ASCII characters in attribute values.
+enum {
+    SCIXMLEscapeLT = 1,
+    SCIXMLEscapeGT,
+    SCIXMLEscapeAmp,
+    SCIXMLEscapeQuot,
+    SCIXMLEscapeCR,
+    SCIXMLEscapeLF,
+    SCIXMLEscapeTab,
+    SCIXMLEscapeNonASCII, // numeric character reference
+    SCIXMLEscapeCount,
+};
+
+// A non-ASCII character is replaced by a reference to its code point, e.g.
+// "&#xE9;", which is formatted when it's written, so it has no fixed sequence.
+static const char *const SCIXMLEscapeSequences[SCIXMLEscapeCount] = {
+    [0]                    = NULL,
+    [SCIXMLEscapeLT]       = "&lt;",
+    [SCIXMLEscapeGT]       = "&gt;",
+    [SCIXMLEscapeAmp]      = "&amp;",
+    [SCIXMLEscapeQuot]     = "&quot;",
+    [SCIXMLEscapeCR]       = "&#13;",
+    [SCIXMLEscapeLF]       = "&#10;",
+    [SCIXMLEscapeTab]      = "&#9;",
+    [SCIXMLEscapeNonASCII] = NULL,
+};
+
+// Sixteen non-ASCII bytes, i.e. leading or continuation bytes of UTF-8 sequences
+#define SCIXML_NON_ASCII_ROW \
+    SCIXMLEscapeNonASCII, SCIXMLEscapeNonASCII, SCIXMLEscapeNonASCII, SCIXMLEscapeNonASCII, \
+    SCIXMLEscapeNonASCII, SCIXMLEscapeNonASCII, SCIXMLEscapeNonASCII, SCIXMLEscapeNonASCII, \
+    SCIXMLEscapeNonASCII, SCIXMLEscapeNonASCII, SCIXMLEscapeNonASCII, SCIXMLEscapeNonASCII, \
+    SCIXMLEscapeNonASCII, SCIXMLEscapeNonASCII, SCIXMLEscapeNonASCII, SCIXMLEscapeNonASCII
+
+static const uint8_t SCIXMLEscapeTables[SCIXMLEscapingCount][256] = {
+    [SCIXMLEscapingText] = {
+        ['<']  = SCIXMLEscapeLT,
+        ['>']  = SCIXMLEscapeGT,
+        ['&']  = SCIXMLEscapeAmp,
+        ['"']  = SCIXMLEscapeQuot,
+        ['\r'] = SCIXMLEscapeCR,
+    },
+    [SCIXMLEscapingAttribute] = {
+        ['<']  = SCIXMLEscapeLT,
+        ['>']  = SCIXMLEscapeGT,
+        ['&']  = SCIXMLEscapeAmp,
+        ['"']  = SCIXMLEscapeQuot,
+        ['\r'] = SCIXMLEscapeCR,
+        ['\n'] = SCIXMLEscapeLF,
+        ['\t'] = SCIXMLEscapeTab,
+    },
+    [SCIXMLEscapingAttributeNonASCII] = {
+        ['<']  = SCIXMLEscapeLT,
+        ['>']  = SCIXMLEscapeGT,
+        ['&']  = SCIXMLEscapeAmp,
+        ['"']  = SCIXMLEscapeQuot,
+        ['\r'] = SCIXMLEscapeCR,
+        ['\n'] = SCIXMLEscapeLF,
+        ['\t'] = SCIXMLEscapeTab,
+        [0x80] = SCIXML_NON_ASCII_ROW, SCIXML_NON_ASCII_ROW, SCIXML_NON_ASCII_ROW, SCIXML_NON_ASCII_ROW,
+                 SCIXML_NON_ASCII_ROW, SCIXML_NON_ASCII_ROW, SCIXML_NON_ASCII_ROW, SCIXML_NON_ASCII_ROW,
+    },
+};
+
+#undef SCIXML_NON_ASCII_ROW
+
+
+// Older versions of libxml write non-ASCII characters in attribute values
+// as hexadecimal character references, newer ones write them as-is.
+// The linked library is asked once which one it does, so that the output
+// stays the same; returns the escaping of attribute values that matches it.
+static SCIXMLEscaping SCIXMLAttributeEscaping(void) {
+    static SCIXMLEscaping escaping = SCIXMLEscapingAttribute;
+    static dispatch_once_t token;
+
+    dispatch_once(&token, ^{
+        xmlBuffer *buf = xmlBufferCreate();
+        xmlTextWriter *writer = buf ? xmlNewTextWriterMemory(buf, NO) : NULL;
+
+        if (writer) {
+            xmlTextWriterStartElement(writer, (const xmlChar *)"a");
+            xmlTextWriterWriteAttribute(writer, (const xmlChar *)"b", (const xmlChar *)"\xC3\xA9");
+            xmlTextWriterEndElement(writer);
+            xmlTextWriterFlush(writer);
+
+            if (strstr((const char *)xmlBufferContent(buf), "&#x") != NULL) {
+                escaping = SCIXMLEscapingAttributeNonASCII;
+            }
+
+            xmlFreeTextWriter(writer);
+        }
+
+        if (buf) {
+            xmlBufferFree(buf);
+        }
+    });
+
+    return escaping;
+}
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SCIXMLDirectWriter () {
+    char *_Nullable _bytes;
+    NSUInteger _length;
+    NSUInteger _capacity;
+    BOOL _outOfMemory;
+
+    // Mirrors the state kept by xmlTextWriter
+    NSUInteger _depth;
+    BOOL _startTagOpen;
+    BOOL _doIndent;
+}
+
+@property (nonatomic, strong, nullable) NSData *indentation;
+
+- (BOOL)reserve:(NSUInteger)length;
+- (void)appendBytes:(const char *)bytes length:(NSUInteger)length;
+- (void)appendCString:(const char *)string;
+- (void)appendEscapedBytes:(const char *)bytes length:(NSUInteger)length escaping:(SCIXMLEscaping)escaping;
+- (NSInteger)appendString:(NSString *)string escaping:(SCIXMLEscaping)escaping;
+- (void)appendIndentationWithLevel:(NSUInteger)level;
+- (void)closeStartTagWithNewline:(BOOL)newline;
+- (void)endDocument;
+
+- (BOOL)startElementWithName:(NSString *)name
+                  nameOffset:(NSUInteger *)nameOffset
+                  nameLength:(NSUInteger *)nameLength;
+- (BOOL)appendAttributeWithName:(NSString *)name value:(NSString *)value;
+- (void)endElementWithNameOffset:(NSUInteger)nameOffset length:(NSUInteger)nameLength;
+- (BOOL)appendTextLikeString:(NSString *)text type:(NSString *)type;
+
+- (BOOL)writeNode:(NSDictionary *)node error:(NSError *__autoreleasing *)error;
+- (BOOL)writeElement:(NSDictionary *)node error:(NSError *__autoreleasing *)error;
+- (BOOL)writeTextLikeNode:(NSDictionary *)node
+                     type:(NSString *)type
+                    error:(NSError *__autoreleasing *)error;
+- (BOOL)writeEntityRef:(NSDictionary *)node error:(NSError *__autoreleasing *)error;
+
+- (BOOL)writeNaturalElementWithName:(id)name child:(id)child;
+- (BOOL)writeNaturalChildrenInArray:(NSArray *)array;
+- (BOOL)writeNaturalChildrenInDictionary:(NSDictionary *)dictionary;
+
+- (id _Nullable)valueOfNode:(NSDictionary *)node
+                     forKey:(NSString *)key
+                      class:(Class)cls
+                      error:(NSError *__autoreleasing *)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+
+@implementation SCIXMLDirectWriter
+
+- (instancetype)initWithIndentation:(NSString *)indentation {
+    self = [super init];
+    if (self) {
+        // Like libxml, use the C string, i.e. up to the first NUL character
+        const char *indentString = indentation.UTF8String;
+        _indentation = indentString ? [NSData dataWithBytes:indentString length:strlen(indentString)] : nil;
+        _doIndent = YES;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_bytes);
+}
+
+- (char *)detachBytesWithLength:(NSUInteger *)length {
+    NSParameterAssert(length);
+
+    char *bytes = _bytes;
+    *length = _length;
+
+    _bytes = NULL;
+    _length = 0;
+    _capacity = 0;
+
+    return bytes;
+}
+
+#pragma mark - Output buffer
+
+- (BOOL)reserve:(NSUInteger)length {
+    if (_capacity - _length >= length) {
+        return YES;
+    }
+
+    if (_outOfMemory) {
+        return NO;
+    }
+
+    NSUInteger newCapacity = MAX(SCIXML_DIRECT_INITIAL_CAPACITY, _capacity);
+    while (newCapacity - _length < length) {
+        newCapacity *= 2;
+    }
+
+    char *newBytes = realloc(_bytes, newCapacity);
+    if (newBytes == NULL) {
+        _outOfMemory = YES;
+        return NO;
+    }
+
+    _bytes = newBytes;
+    _capacity = newCapacity;
+
+    return YES;
+}
+
+- (void)appendBytes:(const char *)bytes length:(NSUInteger)length {
+    if ([self reserve:length]) {
+        memcpy(_bytes + _length, bytes, length);
+        _length += length;
+    }
+}
+
+- (void)appendCString:(const char *)string {
+    [self appendBytes:string length:strlen(string)];
+}
+
+- (void)appendEscapedBytes:(const char *)bytes length:(NSUInteger)length escaping:(SCIXMLEscaping)escaping {
+    const uint8_t *table = SCIXMLEscapeTables[escaping];
+    const uint8_t *p = (const uint8_t *)bytes;
+    const uint8_t *end = p + length;
+
+    while (p < end) {
+        // Copy the longest run that doesn't need escaping at once
+        const uint8_t *run = p;
+        while (p < end && table[*p] == 0) {
+            p++;
+        }
+
+        [self appendBytes:(const char *)run length:p - run];
+
+        if (p == end) {
+            break;
+        }
+
+        if (SCIXMLEscapeSequences[table[*p]] != NULL) {
+            [self appendCString:SCIXMLEscapeSequences[table[*p]]];
+            p++;
+            continue;
+        }
+
+        // Decode the UTF-8 sequence, and write it as e.g. "&#xE9;"
+        NSUInteger count = *p >= 0xF0 ? 4 : *p >= 0xE0 ? 3 : 2;
+        uint32_t codePoint = *p & (0x3F >> (count - 1));
+
+        for (NSUInteger i = 1; i < count && p + i < end; i++) {
+            codePoint = (codePoint << 6) | (p[i] & 0x3F);
+        }
+
+        char reference[16];
+        snprintf(reference, sizeof reference, "&#x%X;", codePoint);
+        [self appendCString:reference];
+
+        p = MIN(p + count, end);
+    }
+}
+
+// Returns the number of bytes taken from the string (before escaping),
+// or -1 if it can't be converted to UTF-8. Like -UTF8String, which the
+// xmlTextWriter-based serializer uses, a NUL character ends the string.
+- (NSInteger)appendString:(NSString *)string escaping:(SCIXMLEscaping)escaping {
+    NSRange range = NSMakeRange(0, string.length);
+    NSInteger total = 0;
+
+    char scratch[SCIXML_DIRECT_SCRATCH_SIZE];
+
+    while (range.length > 0) {
+        // Strings that don't need escaping are copied into the output directly
+        BOOL direct = escaping == SCIXMLEscapingNone;
+        NSUInteger maxLength = sizeof scratch;
+
+        if (direct) {
+            maxLength = [string maximumLengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+
+            if ([self reserve:maxLength] == NO) {
+                return -1;
+            }
+        }
+
+        char *buffer = direct ? _bytes + _length : scratch;
+        NSUInteger usedLength = 0;
+
+        BOOL converted = [string getBytes:buffer
+                                maxLength:maxLength
+                               usedLength:&usedLength
+                                 encoding:NSUTF8StringEncoding
+                                  options:0
+                                    range:range
+                           remainingRange:&range];
+
+        if (converted == NO || usedLength == 0) {
+            return -1;
+        }
+
+        const char *nul = memchr(buffer, 0, usedLength);
+        if (nul) {
+            usedLength = nul - buffer;
+        }
+
+        if (direct) {
+            _length += usedLength;
+        } else {
+            [self appendEscapedBytes:buffer length:usedLength escaping:escaping];
+        }
+
+        total += usedLength;
+
+        if (nul) {
+            break;
+        }
+    }
+
+    return total;
+}
+
+- (void)appendIndentationWithLevel:(NSUInteger)level {
+    for (NSUInteger i = 0; i < level; i++) {
+        [self appendBytes:self.indentation.bytes length:self.indentation.length];
+    }
+}
+
+// Called before writing anything into an element, like xmlTextWriter does
+// when it's in the state of having written the name and the attributes.
+// Only starting a child element or a comment writes a newline.
+- (void)closeStartTagWithNewline:(BOOL)newline {
+    if (_startTagOpen == NO) {
+        return;
+    }
+
+    [self appendBytes:">" length:1];
+
+    if (newline && self.indentation) {
+        [self appendBytes:"\n" length:1];
+    }
+
+    _startTagOpen = NO;
+}
+
+- (void)endDocument {
+    // With indentation, the root element already ends with a newline
+    if (self.indentation == nil) {
+        [self appendBytes:"\n" length:1];
+    }
+}
+
+// Writes the name of the element, and leaves the start tag open for the
+// attributes. Returns where the name is in the output, for the end tag.
+- (BOOL)startElementWithName:(NSString *)name
+                  nameOffset:(NSUInteger *)nameOffset
+                  nameLength:(NSUInteger *)nameLength {
+
+    [self closeStartTagWithNewline:YES];
+
+    _depth += 1;
+
+    if (self.indentation) {
+        [self appendIndentationWithLevel:_depth - 1];
+    }
+
+    [self appendBytes:"<" length:1];
+
+    // The name is copied from here when writing the closing tag
+    *nameOffset = _length;
+    NSInteger length = [self appendString:name escaping:SCIXMLEscapingNone];
+
+    if (length <= 0) {
+        return NO;
+    }
+
+    *nameLength = length;
+
+    return YES;
+}
+
+- (BOOL)appendAttributeWithName:(NSString *)name value:(NSString *)value {
+    [self appendBytes:" " length:1];
+    BOOL success = [self appendString:name escaping:SCIXMLEscapingNone] > 0;
+
+    [self appendBytes:"=\"" length:2];
+    success = success && [self appendString:value escaping:SCIXMLAttributeEscaping()] >= 0;
+
+    [self appendBytes:"\"" length:1];
+
+    return success;
+}
+
+// Writes the </closing> tag, or closes the <empty/> one.
+// The closing tag is only indented if the last thing written
+// into the element was a child element.
+- (void)endElementWithNameOffset:(NSUInteger)nameOffset length:(NSUInteger)nameLength {
+    if (_startTagOpen) {
+        [self appendBytes:"/>" length:2];
+        _startTagOpen = NO;
+    } else {
+        if (self.indentation && _doIndent) {
+            [self appendIndentationWithLevel:_depth - 1];
+        }
+
+        [self appendBytes:"</" length:2];
+
+        if ([self reserve:nameLength + 1]) {
+            memcpy(_bytes + _length, _bytes + nameOffset, nameLength);
+            _length += nameLength;
+        }
+
+        [self appendBytes:">" length:1];
+    }
+
+    _doIndent = YES;
+
+    if (self.indentation) {
+        [self appendBytes:"\n" length:1];
+    }
+
+    _depth -= 1;
+}
+
+- (BOOL)appendTextLikeString:(NSString *)text type:(NSString *)type {
+    BOOL isComment = [type isEqualToString:SCIXMLNodeTypeComment];
+    BOOL isCDATA = [type isEqualToString:SCIXMLNodeTypeCDATA];
+
+    [self closeStartTagWithNewline:isComment];
+
+    if (isComment) {
+        if (self.indentation) {
+            [self appendIndentationWithLevel:_depth];
+        }
+        [self appendCString:"<!--"];
+    } else if (isCDATA) {
+        [self appendCString:"<![CDATA["];
+    }
+
+    // Comments and CDATA sections are written as-is, and so is
+    // text outside of any element, since xmlTextWriter does that.
+    SCIXMLEscaping escaping = isComment || isCDATA || _depth == 0 ? SCIXMLEscapingNone : SCIXMLEscapingText;
+
+    if ([self appendString:text escaping:escaping] < 0) {
+        return NO;
+    }
+
+    _doIndent = NO;
+
+    if (isComment) {
+        [self appendCString:"-->"];
+
+        if (self.indentation) {
+            [self appendBytes:"\n" length:1];
+        }
+    } else if (isCDATA) {
+        [self appendCString:"]]>"];
+    }
+
+    return YES;
+}
+
+#pragma mark - Nodes
+
+- (BOOL)writeDocumentWithDictionary:(NSDictionary *)dictionary
+                              error:(NSError *__autoreleasing *)error {
+
+    NSParameterAssert(dictionary);
+
+    // never leave out error parameter uninitialized
+    if (error) {
+        *error = nil;
+    }
+
+    [self appendCString:"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"];
+
+    if ([self writeNode:dictionary error:error] == NO) {
+        return NO;
+    }
+
+    [self endDocument];
+
+    if (_outOfMemory) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeWriteFailed
+                                           format:@"could not allocate output buffer"];
+        }
+        return NO;
+    }
+
+    return YES;
+}
+
+- (BOOL)writeNode:(NSDictionary *)node error:(NSError *__autoreleasing *)error {
+    NSString *type = [self valueOfNode:node forKey:SCIXMLNodeKeyType class:NSString.class error:error];
+    if (type == nil) {
+        return NO;
+    }
+
+    if ([type isEqualToString:SCIXMLNodeTypeElement]) {
+        return [self writeElement:node error:error];
+    }
+
+    if (
+        [type isEqualToString:SCIXMLNodeTypeText]
+        ||
+        [type isEqualToString:SCIXMLNodeTypeComment]
+        ||
+        [type isEqualToString:SCIXMLNodeTypeCDATA]
+    ) {
+        return [self writeTextLikeNode:node type:type error:error];
+    }
+
+    if ([type isEqualToString:SCIXMLNodeTypeEntityRef]) {
+        return [self writeEntityRef:node error:error];
+    }
+
+    if (error) {
+        *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeUnimplemented
+                                       format:@"unhandled node type: %@", type];
+    }
+    return NO;
+}
+
+- (BOOL)writeElement:(NSDictionary *)node error:(NSError *__autoreleasing *)error {
+    // Obtain essential properties of the element
+    NSString *name = [self valueOfNode:node forKey:SCIXMLNodeKeyName class:NSString.class error:error];
+    if (name == nil) {
+        return NO;
+    }
+
+    NSArray *children = [self valueOfNode:node forKey:SCIXMLNodeKeyChildren class:NSArray.class error:error];
+    if (children == nil) {
+        return NO;
+    }
+
+    NSDictionary *attributes = [self valueOfNode:node forKey:SCIXMLNodeKeyAttributes class:NSDictionary.class error:error];
+    if (attributes == nil) {
+        return NO;
+    }
+
+    // Write <opening> tag
+    NSUInteger nameOffset = 0;
+    NSUInteger nameLength = 0;
+
+    if ([self startElementWithName:name nameOffset:&nameOffset nameLength:&nameLength] == NO) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeWriteFailed
+                                           format:@"could not start element <%@>", name];
+        }
+        return NO;
+    }
+
+    // Write attributes
+    for (NSString *attrName in attributes) {
+        NSString *attrValue = attributes[attrName];
+
+        // Both keys and values _must_ be strings!
+        if (attrName.sci_isString == NO || attrValue.sci_isString == NO) {
+            if (error) {
+                *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedTree
+                                               format:@"attribute name or value was not a string"];
+            }
+            return NO;
+        }
+
+        if ([self appendAttributeWithName:attrName value:attrValue] == NO) {
+            if (error) {
+                *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeWriteFailed
+                                               format:@"could not write attribute '%@'", attrName];
+            }
+            return NO;
+        }
+    }
+
+    _startTagOpen = YES;
+
+    // Write children recursively
+    for (NSDictionary *child in children) {
+        if (child.sci_isDictionary == NO) {
+            if (error) {
+                *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedTree
+                                               format:@"child node was not a dictionary"];
+            }
+            return NO;
+        }
+
+        if ([self writeNode:child error:error] == NO) {
+            return NO;
+        }
+    }
+
+    [self endElementWithNameOffset:nameOffset length:nameLength];
+
+    return YES;
+}
+
+- (BOOL)writeTextLikeNode:(NSDictionary *)node
+                     type:(NSString *)type
+                    error:(NSError *__autoreleasing *)error {
+
+    NSString *text = [self valueOfNode:node forKey:SCIXMLNodeKeyText class:NSString.class error:error];
+    if (text == nil) {
+        return NO;
+    }
+
+    if ([self appendTextLikeString:text type:type] == NO) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeWriteFailed
+                                           format:@"error writing XML for node %p of type %@",
+                                                  (void *)node,
+                                                  type];
+        }
+        return NO;
+    }
+
+    return YES;
+}
+
+- (BOOL)writeEntityRef:(NSDictionary *)node error:(NSError *__autoreleasing *)error {
+    NSString *name = [self valueOfNode:node forKey:SCIXMLNodeKeyName class:NSString.class error:error];
+    if (name == nil) {
+        return NO;
+    }
+
+    [self closeStartTagWithNewline:NO];
+    [self appendBytes:"&" length:1];
+
+    if ([self appendString:name escaping:SCIXMLEscapingNone] < 0) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeWriteFailed
+                                           format:@"error writing entity '&%@;' for node %p",
+                                                  name,
+                                                  (void *)node];
+        }
+        return NO;
+    }
+
+    [self appendBytes:";" length:1];
+    _doIndent = NO;
+
+    return YES;
+}
+
+#pragma mark - Natural dictionaries
+
+// Natural dictionaries are walked the same way as the canonicalizing transform
+// for them walks them, and every element and text node is written right away,
+// like the canonical node that the transform would make of it.
+- (BOOL)writeDocumentWithNaturalDictionary:(NSDictionary *)root {
+    NSParameterAssert(root);
+
+    if (root.count != 1) {
+        return NO;
+    }
+
+    [self appendCString:"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"];
+
+    for (id name in root) {
+        if ([self writeNaturalElementWithName:name child:root[name]] == NO) {
+            return NO;
+        }
+    }
+
+    [self endDocument];
+
+    return _outOfMemory == NO;
+}
+
+// Strings are the text of leaf elements. Dictionaries are either the children
+// of branch elements by name, or hold their attributes, and their text or
+// children in any of the other forms, under the temporary keys.
+- (BOOL)writeNaturalElementWithName:(id)name child:(id)child {
+    if ([name isKindOfClass:NSString.class] == NO) {
+        return NO;
+    }
+
+    NSDictionary *attributes = nil;
+    id children = child;
+
+    if ([child isKindOfClass:NSDictionary.class]) {
+        attributes = child[SCIXMLTempKeyAttrs];
+        children = child[SCIXMLTempKeyChild] ?: child;
+
+        if (attributes && [attributes isKindOfClass:NSDictionary.class] == NO) {
+            return NO;
+        }
+    }
+
+    NSUInteger nameOffset = 0;
+    NSUInteger nameLength = 0;
+
+    if ([self startElementWithName:name nameOffset:&nameOffset nameLength:&nameLength] == NO) {
+        return NO;
+    }
+
+    // The canonicalizing transform collects the attributes into a set,
+    // then into a new dictionary, which is the order they are written in
+    if (attributes.count > 1) {
+        NSSet *attributeNames = [NSSet setWithArray:attributes.allKeys];
+        NSMutableDictionary *orderedAttributes = [NSMutableDictionary dictionaryWithCapacity:attributeNames.count];
+
+        for (id attrName in attributeNames) {
+            orderedAttributes[attrName] = attributes[attrName];
+        }
+
+        attributes = orderedAttributes;
+    }
+
+    for (NSString *attrName in attributes) {
+        NSString *attrValue = attributes[attrName];
+
+        if (attrName.sci_isString == NO || attrValue.sci_isString == NO) {
+            return NO;
+        }
+
+        if ([self appendAttributeWithName:attrName value:attrValue] == NO) {
+            return NO;
+        }
+    }
+
+    _startTagOpen = YES;
+
+    BOOL success = NO;
+
+    if ([children isKindOfClass:NSString.class]) {
+        success = [self appendTextLikeString:children type:SCIXMLNodeTypeText];
+    } else if ([children isKindOfClass:NSArray.class]) {
+        success = [self writeNaturalChildrenInArray:children];
+    } else if ([children isKindOfClass:NSDictionary.class]) {
+        success = [self writeNaturalChildrenInDictionary:children];
+    }
+
+    if (success == NO) {
+        return NO;
+    }
+
+    [self endElementWithNameOffset:nameOffset length:nameLength];
+
+    return YES;
+}
+
+// Arrays hold single-key dictionaries, which allow repeated names
+- (BOOL)writeNaturalChildrenInArray:(NSArray *)array {
+    for (NSDictionary *node in array) {
+        if ([node isKindOfClass:NSDictionary.class] == NO || node.count != 1) {
+            return NO;
+        }
+
+        for (id name in node) {
+            if ([self writeNaturalElementWithName:name child:node[name]] == NO) {
+                return NO;
+            }
+        }
+    }
+
+    return YES;
+}
+
+- (BOOL)writeNaturalChildrenInDictionary:(NSDictionary *)dictionary {
+    for (id name in dictionary) {
+        if ([name isKindOfClass:NSString.class] == NO) {
+            return NO;
+        }
+
+        if ([name isEqualToString:SCIXMLTempKeyAttrs]) {
+            continue;
+        }
+
+        if ([self writeNaturalElementWithName:name child:dictionary[name]] == NO) {
+            return NO;
+        }
+    }
+
+    return YES;
+}
+
+// Same as the property getter of the xmlTextWriter-based serializer
+- (id)valueOfNode:(NSDictionary *)node
+           forKey:(NSString *)key
+            class:(Class)cls
+            error:(NSError *__autoreleasing *)error {
+
+    id value = node[key];
+
+    if ([value isKindOfClass:cls]) {
+        return value;
+    }
+
+    if (error) {
+        *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedTree
+                                       format:@"node %p has no value for key '%@' of type %@",
+                                              (void *)node,
+                                              key,
+                                              NSStringFromClass(cls)];
+    }
+
+    return nil;
+}
+
+@end
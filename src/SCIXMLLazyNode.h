@@ -0,0 +1,44 @@
+//
+// SCIXMLLazyNode.h
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <Foundation/Foundation.h>
+
+#import <libxml/tree.h>
+
+#import "SCIXMLStringArena.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+// An immutable canonical node backed by a node of a libxml document tree.
+// The type, name and text of a node are converted when the node itself is
+// created, but its children array and attribute dictionary are only created
+// when they are first accessed, and then cached. Children arrays create the
+// nodes in them on first access as well, so touching a small part of a large
+// document only converts that part.
+//
+// Every node keeps the document alive. The tree can be read from multiple
+// threads; nodes are created under a lock shared by the whole document.
+// Copying a node or a children array returns it as-is, and mutable copies
+// are ordinary mutable collections, made of the nodes of the lazy tree.
+@interface SCIXMLLazyNode : NSDictionary
+
+// Takes over the document, i.e. it will be freed along with the tree.
+// Fails if the document contains nodes that can't be represented in a
+// canonical tree, in which case the document is freed immediately.
+// If an arena is given, it must own the document, and the strings of the
+// tree refer to the document instead of copying its characters.
++ (NSDictionary *_Nullable)rootNodeWithDocument:(xmlDoc *)document
+                                          arena:(SCIXMLStringArena *_Nullable)arena
+                                          error:(NSError *__autoreleasing *)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
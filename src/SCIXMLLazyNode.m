@@ -0,0 +1,436 @@
+//
+// SCIXMLLazyNode.m
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <pthread.h>
+#import <stdlib.h>
+#import <string.h>
+
+#import "SCIXMLLazyNode.h"
+#import "SCIXMLNameTable.h"
+#import "SCIXMLSerialization.h"
+
+
+// Make an NSString out of a const xmlChar *.
+#define NSXS(str) (@((const char *)(str)))
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+// Owns the libxml document of a lazy tree, and everything needed to convert
+// its nodes, none of which is thread-safe, hence the lock.
+@interface SCIXMLLazyDocument : NSObject {
+    pthread_mutex_t _lock;
+}
+
+@property (nonatomic, readonly) xmlDoc *document;
+@property (nonatomic, readonly) SCIXMLNameTable *nameTable;
+@property (nonatomic, readonly, nullable) SCIXMLStringArena *arena;
+
+- (instancetype)initWithDocument:(xmlDoc *)document
+                           arena:(SCIXMLStringArena *_Nullable)arena NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+// Returns the object cached in the slot, or creates it under the lock of the
+// document and caches it if there isn't one. Slots hold retained references.
+- (id)objectInSlot:(void *_Nullable *_Nonnull)slot createdBy:(id (^)(void))create;
+
+- (NSString *)stringWithContent:(const xmlChar *)content;
+
+@end
+
+
+@interface SCIXMLLazyNode () {
+    SCIXMLLazyDocument *_document;
+    xmlNode *_node;
+
+    NSString *_type;
+    NSString *_Nullable _name;
+    NSString *_Nullable _text;
+
+    // Only used by elements; created on first access
+    void *_Nullable _children;
+    void *_Nullable _attributes;
+}
+
+// Must be called under the lock of the document
+- (instancetype)initWithDocument:(SCIXMLLazyDocument *)document node:(xmlNode *)node;
+
+- (NSArray *)children;
+- (NSDictionary<NSString *, NSString *> *)attributes;
+
+@end
+
+
+// The children of a lazy element. The child nodes of the libxml node are
+// indexed when the array is created, and converted on first access.
+@interface SCIXMLLazyChildren : NSArray {
+    SCIXMLLazyDocument *_document;
+    xmlNode *_Nonnull *_Nullable _nodes;
+    void *_Nullable *_Nullable _objects;
+    NSUInteger _count;
+}
+
+// Must be called under the lock of the document
+- (instancetype)initWithDocument:(SCIXMLLazyDocument *)document parent:(xmlNode *)parent;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+
+// The node types that have a canonical representation
+static BOOL SCIXMLLazyNodeTypeIsSupported(xmlElementType type) {
+    switch (type) {
+    case XML_ELEMENT_NODE:
+    case XML_TEXT_NODE:
+    case XML_COMMENT_NODE:
+    case XML_CDATA_SECTION_NODE:
+    case XML_ENTITY_REF_NODE:
+        return YES;
+    default:
+        return NO;
+    }
+}
+
+// Finds the first node of the subtree that has no canonical representation,
+// so that parsing fails like it does without a lazy tree, instead of failing
+// when the node is accessed. Walks the tree without recursion or allocation.
+static xmlNode *SCIXMLLazyFindUnsupportedNode(xmlNode *root) {
+    xmlNode *node = root;
+
+    while (node != NULL) {
+        if (SCIXMLLazyNodeTypeIsSupported(node->type) == NO) {
+            return node;
+        }
+
+        // Entity references are not expanded into children
+        if (node->type == XML_ELEMENT_NODE && node->children) {
+            node = node->children;
+            continue;
+        }
+
+        while (node != root && node->next == NULL) {
+            node = node->parent;
+        }
+
+        node = node == root ? NULL : node->next;
+    }
+
+    return NULL;
+}
+
+
+@implementation SCIXMLLazyDocument
+
+- (instancetype)initWithDocument:(xmlDoc *)document arena:(SCIXMLStringArena *)arena {
+    NSParameterAssert(document);
+
+    self = [super init];
+    if (self) {
+        pthread_mutex_init(&_lock, NULL);
+
+        _document = document;
+        _nameTable = [[SCIXMLNameTable alloc] initWithDictionary:document->dict];
+        _arena = arena;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    pthread_mutex_destroy(&_lock);
+
+    // Otherwise, the arena frees it
+    if (_arena == nil) {
+        xmlFreeDoc(_document);
+    }
+}
+
+- (id)objectInSlot:(void **)slot createdBy:(id (^)(void))create {
+    NSParameterAssert(slot);
+    NSParameterAssert(create);
+
+    void *object = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+
+    if (object) {
+        return (__bridge id)object;
+    }
+
+    pthread_mutex_lock(&_lock);
+
+    // Creating the object may raise, e.g. if it can't be allocated,
+    // which must not leave the document locked for every later access
+    @try {
+        // Another thread may have created it in the meantime
+        object = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+
+        if (object == NULL) {
+            object = (__bridge_retained void *)create();
+            __atomic_store_n(slot, object, __ATOMIC_RELEASE);
+        }
+    } @finally {
+        pthread_mutex_unlock(&_lock);
+    }
+
+    return (__bridge id)object;
+}
+
+- (NSString *)stringWithContent:(const xmlChar *)content {
+    NSParameterAssert(content);
+
+    if (_arena) {
+        return [_arena stringWithBytesNoCopy:content length:strlen((const char *)content)];
+    }
+
+    return NSXS(content);
+}
+
+@end
+
+
+@implementation SCIXMLLazyNode
+
++ (NSDictionary *)rootNodeWithDocument:(xmlDoc *)document
+                                 arena:(SCIXMLStringArena *)arena
+                                 error:(NSError *__autoreleasing *)error {
+
+    NSParameterAssert(document);
+
+    if (error) {
+        *error = nil;
+    }
+
+    xmlNode *root = xmlDocGetRootElement(document);
+    xmlNode *unsupported = SCIXMLLazyFindUnsupportedNode(root);
+
+    if (unsupported) {
+        // Like the document tree conversion, which doesn't handle them either
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeUnimplemented
+                                           format:@"unhandled node type: %d", (int)unsupported->type];
+        }
+
+        if (arena == nil) {
+            xmlFreeDoc(document);
+        }
+        return nil;
+    }
+
+    SCIXMLLazyDocument *lazyDocument = [[SCIXMLLazyDocument alloc] initWithDocument:document arena:arena];
+
+    // No other thread can access the document yet, so there's no need to lock it
+    return [[self alloc] initWithDocument:lazyDocument node:root];
+}
+
+- (instancetype)initWithDocument:(SCIXMLLazyDocument *)document node:(xmlNode *)node {
+    NSParameterAssert(document);
+    NSParameterAssert(node);
+    NSParameterAssert(SCIXMLLazyNodeTypeIsSupported(node->type));
+
+    self = [super init];
+    if (self) {
+        _document = document;
+        _node = node;
+
+        switch (node->type) {
+        case XML_ELEMENT_NODE:
+            _type = SCIXMLNodeTypeElement;
+            _name = [document.nameTable stringWithName:node->name];
+            break;
+        case XML_TEXT_NODE:
+            _type = SCIXMLNodeTypeText;
+            _text = [document stringWithContent:node->content];
+            break;
+        case XML_COMMENT_NODE:
+            _type = SCIXMLNodeTypeComment;
+            _text = [document stringWithContent:node->content];
+            break;
+        case XML_CDATA_SECTION_NODE:
+            _type = SCIXMLNodeTypeCDATA;
+            _text = [document stringWithContent:node->content];
+            break;
+        case XML_ENTITY_REF_NODE:
+            _type = SCIXMLNodeTypeEntityRef;
+            _name = [document.nameTable stringWithName:node->name];
+            break;
+        default:
+            abort();
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    // Balances the retain of -[SCIXMLLazyDocument objectInSlot:createdBy:]
+    (void)(__bridge_transfer id)_children;
+    (void)(__bridge_transfer id)_attributes;
+}
+
+- (NSArray *)children {
+    return [_document objectInSlot:&_children createdBy:^id {
+        return [[SCIXMLLazyChildren alloc] initWithDocument:self->_document parent:self->_node];
+    }];
+}
+
+- (NSDictionary<NSString *, NSString *> *)attributes {
+    return [_document objectInSlot:&_attributes createdBy:^id {
+        NSMutableDictionary<NSString *, NSString *> *attributes = [NSMutableDictionary new];
+        xmlNode *node = self->_node;
+
+        // The same as converting the document tree eagerly
+        for (xmlAttr *attr = node->properties; attr != NULL; attr = attr->next) {
+            NSString *name = [self->_document.nameTable stringWithName:attr->name];
+
+            if (attr->children && attr->children->next == NULL && attr->children->type == XML_TEXT_NODE) {
+                if (attributes[name] == nil) {
+                    attributes[name] = [self->_document stringWithContent:attr->children->content];
+                }
+                continue;
+            }
+
+            xmlChar *value = xmlGetProp(node, attr->name);
+            attributes[name] = NSXS(value);
+            xmlFree(value);
+        }
+
+        return [attributes copy];
+    }];
+}
+
+#pragma mark - NSDictionary primitives
+
+- (NSUInteger)count {
+    // Elements have a type, a name, children and attributes,
+    // every other node has a type and either a name or a text.
+    return _node->type == XML_ELEMENT_NODE ? 4 : 2;
+}
+
+- (id _Nullable)objectForKey:(id)key {
+    if (key == SCIXMLNodeKeyType || [key isEqual:SCIXMLNodeKeyType]) {
+        return _type;
+    }
+
+    if (key == SCIXMLNodeKeyName || [key isEqual:SCIXMLNodeKeyName]) {
+        return _name;
+    }
+
+    if (key == SCIXMLNodeKeyText || [key isEqual:SCIXMLNodeKeyText]) {
+        return _text;
+    }
+
+    if (_node->type != XML_ELEMENT_NODE) {
+        return nil;
+    }
+
+    if (key == SCIXMLNodeKeyChildren || [key isEqual:SCIXMLNodeKeyChildren]) {
+        return self.children;
+    }
+
+    if (key == SCIXMLNodeKeyAttributes || [key isEqual:SCIXMLNodeKeyAttributes]) {
+        return self.attributes;
+    }
+
+    return nil;
+}
+
+- (NSEnumerator *)keyEnumerator {
+    if (_node->type == XML_ELEMENT_NODE) {
+        return @[ SCIXMLNodeKeyType, SCIXMLNodeKeyName, SCIXMLNodeKeyChildren, SCIXMLNodeKeyAttributes ].objectEnumerator;
+    }
+
+    NSString *otherKey = _text ? SCIXMLNodeKeyText : SCIXMLNodeKeyName;
+
+    return @[ SCIXMLNodeKeyType, otherKey ].objectEnumerator;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self;
+}
+
+@end
+
+
+@implementation SCIXMLLazyChildren
+
+- (instancetype)initWithDocument:(SCIXMLLazyDocument *)document parent:(xmlNode *)parent {
+    NSParameterAssert(document);
+    NSParameterAssert(parent);
+
+    self = [super init];
+    if (self) {
+        _document = document;
+
+        for (xmlNode *child = parent->children; child != NULL; child = child->next) {
+            _count++;
+        }
+
+        if (_count == 0) {
+            return self;
+        }
+
+        _nodes = malloc(_count * sizeof _nodes[0]);
+        _objects = calloc(_count, sizeof _objects[0]);
+
+        if (_nodes == NULL || _objects == NULL) {
+            NSUInteger count = _count;
+
+            // ARC doesn't release objects when an exception is raised, so
+            // nothing may be left for -dealloc to release either way
+            free(_nodes);
+            free(_objects);
+            _nodes = NULL;
+            _objects = NULL;
+            _count = 0;
+
+            [NSException raise:NSMallocException format:@"could not index %lu children", (unsigned long)count];
+        }
+
+        NSUInteger i = 0;
+
+        for (xmlNode *child = parent->children; child != NULL; child = child->next) {
+            _nodes[i++] = child;
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    for (NSUInteger i = 0; i < _count && _objects; i++) {
+        (void)(__bridge_transfer id)_objects[i];
+    }
+
+    free(_objects);
+    free(_nodes);
+}
+
+#pragma mark - NSArray primitives
+
+- (NSUInteger)count {
+    return _count;
+}
+
+- (id)objectAtIndex:(NSUInteger)index {
+    if (index >= _count) {
+        [NSException raise:NSRangeException
+                    format:@"index %lu beyond bounds [0 .. %lu)", (unsigned long)index, (unsigned long)_count];
+    }
+
+    SCIXMLLazyDocument *document = _document;
+    xmlNode *node = _nodes[index];
+
+    return [document objectInSlot:&_objects[index] createdBy:^id {
+        return [[SCIXMLLazyNode alloc] initWithDocument:document node:node];
+    }];
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self;
+}
+
+@end
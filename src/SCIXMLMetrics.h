@@ -0,0 +1,84 @@
+//
+// SCIXMLMetrics.h
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "SCIXMLCompactingTransform.h"
+
+
+// The phases of parsing and serialization. Phases don't overlap: while
+// e.g. a node is compacted during parsing, the time is spent compacting,
+// not parsing. Time spent outside of any phase (e.g. in the blocks of the
+// record streaming methods) is not attributed to any of them, except for
+// calls to SCIXMLSerialization made from such a block (or from a transform)
+// on the thread of the outer call: they are not reported on their own, but
+// folded into the outer call, so their phases, counts and bytes are added to
+// those of the outer call. Calls made on the other threads of a concurrent
+// compaction are reported on their own instead.
+typedef NS_ENUM(NSUInteger, SCIXMLMetricsPhase) {
+    SCIXMLMetricsPhaseParse,        // libxml parsing, including building the tree from SAX events
+    SCIXMLMetricsPhaseBuild,        // converting a libxml document tree into a canonical tree
+    SCIXMLMetricsPhaseCompact,      // applying a compacting transform
+    SCIXMLMetricsPhaseCanonicalize, // applying a canonicalizing transform
+    SCIXMLMetricsPhaseWrite,        // generating the output, including writing it to a stream or a file
+    SCIXMLMetricsPhaseCount,
+};
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+// Describes a single call to a method of SCIXMLSerialization
+@interface SCIXMLMetrics : NSObject
+
+// The selector of the method, e.g. @"compactedObjectWithXMLData:compactingTransform:error:"
+@property (nonatomic, readonly) NSString *operation;
+
+// Wall-clock time between the start and the end of the call, in seconds
+@property (nonatomic, readonly) NSTimeInterval duration;
+
+// The number of canonical nodes and attributes built, compacted or written,
+// and the number of levels of nested elements in the deepest of them
+// (1 for a root element without element children). When parsing records,
+// they are the totals over all records. Zero when no canonical tree is
+// involved, e.g. when writing a natural dictionary directly, or when it's
+// built lazily (see SCIXMLReadingOptionsLazyTree).
+@property (nonatomic, readonly) NSUInteger nodeCount;
+@property (nonatomic, readonly) NSUInteger attributeCount;
+@property (nonatomic, readonly) NSUInteger maximumDepth;
+
+// The number of bytes parsed or generated
+@property (nonatomic, readonly) NSUInteger byteCount;
+
+// Wall-clock time spent in the given phase, in seconds
+- (NSTimeInterval)durationOfPhase:(SCIXMLMetricsPhase)phase;
+
+// Time spent in compacting sub-transforms of the given kind, in seconds.
+// With concurrent compaction, this is the sum over all threads, so it may
+// exceed the duration of the compaction phase.
+- (NSTimeInterval)durationOfSubtransformKind:(SCIXMLSubtransformKind)kind;
+
+// Time spent in the sub-transforms of each transform that has a metrics name
+// (see SCIXMLCompactingTransform), in seconds, keyed by the name
+@property (nonatomic, readonly) NSDictionary<NSString *, NSNumber *> *transformDurations;
+
+@end
+
+
+@protocol SCIXMLMetricsDelegate <NSObject>
+
+// Called on the thread that made the call, just before the method returns.
+// Methods of SCIXMLSerialization called from here are measured separately,
+// and reported by a nested call of this method. Calls made from transforms
+// during concurrent compaction may be reported on several threads at once.
+- (void)serializationDidFinishWithMetrics:(SCIXMLMetrics *)metrics;
+
+@end
+
+NS_ASSUME_NONNULL_END
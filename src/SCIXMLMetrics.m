@@ -0,0 +1,99 @@
+//
+// SCIXMLMetrics.m
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import "SCIXMLMetrics.h"
+#import "SCIXMLMetricsRecord.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SCIXMLMetrics () {
+    NSTimeInterval _phaseDurations[SCIXMLMetricsPhaseCount];
+    NSTimeInterval _subtransformDurations[SCIXMLSubtransformKindCount];
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+
+static NSTimeInterval SCIXMLMetricsSeconds(uint64_t nanoseconds) {
+    return nanoseconds / 1e9;
+}
+
+
+@implementation SCIXMLMetrics
+
+- (instancetype)initWithRecord:(const SCIXMLMetricsRecord *)record {
+    NSParameterAssert(record);
+
+    self = [super init];
+    if (self) {
+        _operation = NSStringFromSelector(record->operation);
+        _duration = SCIXMLMetricsSeconds(SCIXMLMetricsTime() - record->start);
+
+        _nodeCount = record->nodeCount;
+        _attributeCount = record->attributeCount;
+        _maximumDepth = record->maximumDepth;
+        _byteCount = record->byteCount;
+
+        for (SCIXMLMetricsPhase phase = 0; phase < SCIXMLMetricsPhaseCount; phase++) {
+            _phaseDurations[phase] = SCIXMLMetricsSeconds(record->phaseDurations[phase]);
+        }
+
+        for (SCIXMLSubtransformKind kind = 0; kind < SCIXMLSubtransformKindCount; kind++) {
+            _subtransformDurations[kind] = SCIXMLMetricsSeconds(record->subtransformDurations[kind]);
+        }
+
+        // Different objects with the same name are added up
+        NSMutableDictionary<NSString *, NSNumber *> *transformDurations = [NSMutableDictionary new];
+
+        for (NSUInteger i = 0; i < SCIXML_METRICS_TRANSFORM_SLOTS && record->transforms[i].name; i++) {
+            NSString *name = [(__bridge NSString *)record->transforms[i].name copy];
+            NSTimeInterval duration = SCIXMLMetricsSeconds(record->transforms[i].duration);
+
+            transformDurations[name] = @(transformDurations[name].doubleValue + duration);
+        }
+
+        _transformDurations = [transformDurations copy];
+    }
+    return self;
+}
+
+- (NSTimeInterval)durationOfPhase:(SCIXMLMetricsPhase)phase {
+    NSParameterAssert(phase < SCIXMLMetricsPhaseCount);
+    return _phaseDurations[phase];
+}
+
+- (NSTimeInterval)durationOfSubtransformKind:(SCIXMLSubtransformKind)kind {
+    NSParameterAssert(kind < SCIXMLSubtransformKindCount);
+    return _subtransformDurations[kind];
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@ %p: %@ %.3f ms"
+                                       " (parse %.3f, build %.3f, compact %.3f, canonicalize %.3f, write %.3f),"
+                                       " %lu nodes, %lu attributes, depth %lu, %lu bytes>",
+                                       NSStringFromClass(self.class),
+                                       (void *)self,
+                                       self.operation,
+                                       self.duration * 1e3,
+                                       _phaseDurations[SCIXMLMetricsPhaseParse] * 1e3,
+                                       _phaseDurations[SCIXMLMetricsPhaseBuild] * 1e3,
+                                       _phaseDurations[SCIXMLMetricsPhaseCompact] * 1e3,
+                                       _phaseDurations[SCIXMLMetricsPhaseCanonicalize] * 1e3,
+                                       _phaseDurations[SCIXMLMetricsPhaseWrite] * 1e3,
+                                       (unsigned long)self.nodeCount,
+                                       (unsigned long)self.attributeCount,
+                                       (unsigned long)self.maximumDepth,
+                                       (unsigned long)self.byteCount];
+}
+
+@end
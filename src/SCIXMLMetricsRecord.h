@@ -0,0 +1,209 @@
+//
+// SCIXMLMetricsRecord.h
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <stdint.h>
+
+#import <Foundation/Foundation.h>
+
+#import "SCIXMLMetrics.h"
+
+
+// Not a phase; time spent outside of the phases is not attributed to any of them
+#define SCIXMLMetricsNoPhase SCIXMLMetricsPhaseCount
+
+// Number of distinct transform names recorded per call; the rest are dropped
+#define SCIXML_METRICS_TRANSFORM_SLOTS 16
+
+// Declares a variable in a public method of SCIXMLSerialization that records
+// the metrics of the call if a delegate is installed, and reports them to it
+// when it goes out of scope, i.e. when the method returns. Calls made from
+// within another call on the same thread are recorded as part of the outer
+// one; calls made on a thread compacting concurrently for another call are
+// recorded on their own.
+#define SCIXML_METRICS_RECORD_CALL()                                        \
+    __attribute__((cleanup(SCIXMLMetricsEndCall), unused))                 \
+    SCIXMLMetricsRecord *_Nullable SCIXMLMetricsCall = SCIXMLMetricsBeginCall(_cmd)
+
+
+// The metrics of a call being recorded. Phases, counts and the current
+// phase are only accessed by the thread that made the call; the durations
+// of sub-transforms are also added to by threads compacting concurrently
+// (see SCIXMLMetricsHelperRecord), so they are accessed atomically.
+typedef struct {
+    SEL operation;
+    uint64_t start;
+
+    SCIXMLMetricsPhase phase;
+    uint64_t phaseStart;
+    uint64_t phaseDurations[SCIXMLMetricsPhaseCount];
+
+    NSUInteger nodeCount;
+    NSUInteger attributeCount;
+    NSUInteger maximumDepth;
+    NSUInteger byteCount;
+
+    uint64_t subtransformDurations[SCIXMLSubtransformKindCount];
+
+    // Names are compared by address; they are owned by the transforms,
+    // which are alive until the call returns. A slot is claimed by setting
+    // its name, and never released.
+    struct {
+        const void *_Nullable name;
+        uint64_t duration;
+    } transforms[SCIXML_METRICS_TRANSFORM_SLOTS];
+} SCIXMLMetricsRecord;
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+// Non-zero once a metrics delegate has been installed
+FOUNDATION_EXPORT BOOL SCIXMLMetricsEnabled;
+
+// The record of the call being made on the current thread, if any
+FOUNDATION_EXPORT __thread SCIXMLMetricsRecord *_Nullable SCIXMLMetricsCurrentRecord;
+
+// The record of the call the current thread is compacting concurrently for,
+// if any. Only the durations of sub-transforms are added to it; it's not
+// current, so calls made on the thread meanwhile are recorded on their own.
+FOUNDATION_EXPORT __thread SCIXMLMetricsRecord *_Nullable SCIXMLMetricsHelperRecord;
+
+// Not retained. Installing one enables recording.
+FOUNDATION_EXPORT id <SCIXMLMetricsDelegate> _Nullable SCIXMLMetricsGetDelegate(void);
+FOUNDATION_EXPORT void SCIXMLMetricsSetDelegate(id <SCIXMLMetricsDelegate> _Nullable delegate);
+
+// Monotonic time in nanoseconds
+FOUNDATION_EXPORT uint64_t SCIXMLMetricsTime(void);
+
+FOUNDATION_EXPORT SCIXMLMetricsRecord *_Nullable SCIXMLMetricsBeginRecording(SEL operation);
+FOUNDATION_EXPORT void SCIXMLMetricsFinishRecording(SCIXMLMetricsRecord *record);
+
+// Ends the current phase, if any, and starts the given one
+FOUNDATION_EXPORT void SCIXMLMetricsSwitchPhase(SCIXMLMetricsRecord *record, SCIXMLMetricsPhase phase);
+
+// Counts the nodes and attributes of a canonical tree, and its depth.
+// The time it takes is not attributed to the current phase.
+FOUNDATION_EXPORT void SCIXMLMetricsCountTree(SCIXMLMetricsRecord *record, id tree);
+
+FOUNDATION_EXPORT void SCIXMLMetricsAddSubtransformDuration(
+    SCIXMLMetricsRecord *record,
+    SCIXMLSubtransformKind kind,
+    NSString *_Nullable transformName,
+    uint64_t duration
+);
+
+
+// The record of the current call, or NULL if metrics are not being recorded.
+// Unless a delegate has ever been installed, this is a single branch.
+static inline SCIXMLMetricsRecord *_Nullable SCIXMLMetricsCurrent(void) {
+    return __atomic_load_n(&SCIXMLMetricsEnabled, __ATOMIC_RELAXED) ? SCIXMLMetricsCurrentRecord : NULL;
+}
+
+// The record that sub-transforms called on the current thread are timed in:
+// that of the call being made on it, or else that of the call it's compacting
+// concurrently for, or NULL if metrics are not being recorded.
+static inline SCIXMLMetricsRecord *_Nullable SCIXMLMetricsCurrentForSubtransforms(void) {
+    if (__atomic_load_n(&SCIXMLMetricsEnabled, __ATOMIC_RELAXED) == NO) {
+        return NULL;
+    }
+
+    return SCIXMLMetricsCurrentRecord ?: SCIXMLMetricsHelperRecord;
+}
+
+// Makes the calling thread time sub-transforms in the record, on behalf of
+// the thread that made the call. Returns the previous one.
+static inline SCIXMLMetricsRecord *_Nullable SCIXMLMetricsHelpRecord(SCIXMLMetricsRecord *_Nullable record) {
+    SCIXMLMetricsRecord *previous = SCIXMLMetricsHelperRecord;
+
+    if (record != previous) {
+        SCIXMLMetricsHelperRecord = record;
+    }
+
+    return previous;
+}
+
+static inline SCIXMLMetricsRecord *_Nullable SCIXMLMetricsBeginCall(SEL operation) {
+    // Calls made from within another call on this thread are part of the outer one
+    if (__atomic_load_n(&SCIXMLMetricsEnabled, __ATOMIC_RELAXED) == NO || SCIXMLMetricsCurrentRecord != NULL) {
+        return NULL;
+    }
+
+    return SCIXMLMetricsBeginRecording(operation);
+}
+
+static inline void SCIXMLMetricsEndCall(SCIXMLMetricsRecord *_Nullable *_Nonnull record) {
+    if (*record) {
+        SCIXMLMetricsFinishRecording(*record);
+    }
+}
+
+// Starts a phase, and returns the one to return to once it's over.
+// Both do nothing if the record is NULL.
+static inline SCIXMLMetricsPhase SCIXMLMetricsEnterPhase(SCIXMLMetricsRecord *_Nullable record, SCIXMLMetricsPhase phase) {
+    if (record == NULL) {
+        return SCIXMLMetricsNoPhase;
+    }
+
+    SCIXMLMetricsPhase previous = record->phase;
+    SCIXMLMetricsSwitchPhase(record, phase);
+    return previous;
+}
+
+static inline void SCIXMLMetricsLeavePhase(SCIXMLMetricsRecord *_Nullable record, SCIXMLMetricsPhase previous) {
+    if (record) {
+        SCIXMLMetricsSwitchPhase(record, previous);
+    }
+}
+
+static inline void SCIXMLMetricsAddByteCount(SCIXMLMetricsRecord *_Nullable record, NSUInteger byteCount) {
+    if (record) {
+        record->byteCount += byteCount;
+    }
+}
+
+static inline void SCIXMLMetricsAddTreeCounts(
+    SCIXMLMetricsRecord *_Nullable record,
+    NSUInteger nodeCount,
+    NSUInteger attributeCount,
+    NSUInteger maximumDepth
+) {
+    if (record) {
+        record->nodeCount += nodeCount;
+        record->attributeCount += attributeCount;
+        record->maximumDepth = MAX(record->maximumDepth, maximumDepth);
+    }
+}
+
+// Calls a sub-transform, timing it if the record is not NULL
+static inline id _Nullable SCIXMLMetricsCallSubtransform(
+    SCIXMLMetricsRecord *_Nullable record,
+    SCIXMLSubtransformKind kind,
+    NSString *_Nullable transformName,
+    id _Nullable (^subtransform)(id),
+    id _Nullable value
+) {
+    if (record == NULL) {
+        return subtransform(value);
+    }
+
+    uint64_t start = SCIXMLMetricsTime();
+    id result = subtransform(value);
+    SCIXMLMetricsAddSubtransformDuration(record, kind, transformName, SCIXMLMetricsTime() - start);
+
+    return result;
+}
+
+
+@interface SCIXMLMetrics ()
+
+- (instancetype)initWithRecord:(const SCIXMLMetricsRecord *)record;
+
+@end
+
+NS_ASSUME_NONNULL_END
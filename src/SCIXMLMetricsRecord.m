@@ -0,0 +1,174 @@
+//
+// SCIXMLMetricsRecord.m
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <stdlib.h>
+#import <time.h>
+
+#import "SCIXMLMetricsRecord.h"
+#import "SCIXMLSerialization.h"
+#import "NSObject+SCIXMLSerialization.h"
+
+
+BOOL SCIXMLMetricsEnabled = NO;
+
+__thread SCIXMLMetricsRecord *SCIXMLMetricsCurrentRecord = NULL;
+__thread SCIXMLMetricsRecord *SCIXMLMetricsHelperRecord = NULL;
+
+// Only written by SCIXMLMetricsSetDelegate()
+static __weak id <SCIXMLMetricsDelegate> SCIXMLMetricsDelegate = nil;
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+static NSUInteger SCIXMLMetricsCountSubtree(SCIXMLMetricsRecord *record, id node, NSUInteger depth);
+
+NS_ASSUME_NONNULL_END
+
+
+id <SCIXMLMetricsDelegate> SCIXMLMetricsGetDelegate(void) {
+    return SCIXMLMetricsDelegate;
+}
+
+void SCIXMLMetricsSetDelegate(id <SCIXMLMetricsDelegate> delegate) {
+    SCIXMLMetricsDelegate = delegate;
+
+    // Calls that are already being made finish recording either way
+    __atomic_store_n(&SCIXMLMetricsEnabled, delegate != nil, __ATOMIC_RELAXED);
+}
+
+uint64_t SCIXMLMetricsTime(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+SCIXMLMetricsRecord *SCIXMLMetricsBeginRecording(SEL operation) {
+    SCIXMLMetricsRecord *record = calloc(1, sizeof *record);
+
+    // Not recording is better than failing the call
+    if (record == NULL) {
+        return NULL;
+    }
+
+    record->operation = operation;
+    record->start = SCIXMLMetricsTime();
+    record->phase = SCIXMLMetricsNoPhase;
+
+    SCIXMLMetricsCurrentRecord = record;
+
+    return record;
+}
+
+void SCIXMLMetricsFinishRecording(SCIXMLMetricsRecord *record) {
+    NSCParameterAssert(record);
+
+    SCIXMLMetricsSwitchPhase(record, SCIXMLMetricsNoPhase);
+
+    SCIXMLMetrics *metrics = [[SCIXMLMetrics alloc] initWithRecord:record];
+
+    // The delegate may make calls of its own, which are recorded separately
+    SCIXMLMetricsCurrentRecord = NULL;
+    free(record);
+
+    [SCIXMLMetricsGetDelegate() serializationDidFinishWithMetrics:metrics];
+}
+
+void SCIXMLMetricsSwitchPhase(SCIXMLMetricsRecord *record, SCIXMLMetricsPhase phase) {
+    NSCParameterAssert(record);
+
+    if (record->phase == phase) {
+        return;
+    }
+
+    uint64_t now = SCIXMLMetricsTime();
+
+    if (record->phase != SCIXMLMetricsNoPhase) {
+        record->phaseDurations[record->phase] += now - record->phaseStart;
+    }
+
+    record->phase = phase;
+    record->phaseStart = now;
+}
+
+void SCIXMLMetricsCountTree(SCIXMLMetricsRecord *record, id tree) {
+    NSCParameterAssert(record);
+    NSCParameterAssert(tree);
+
+    SCIXMLMetricsPhase phase = record->phase;
+    SCIXMLMetricsSwitchPhase(record, SCIXMLMetricsNoPhase);
+
+    NSUInteger depth = SCIXMLMetricsCountSubtree(record, tree, 0);
+    record->maximumDepth = MAX(record->maximumDepth, depth);
+
+    SCIXMLMetricsSwitchPhase(record, phase);
+}
+
+// Returns the depth of the subtree, in elements
+static NSUInteger SCIXMLMetricsCountSubtree(SCIXMLMetricsRecord *record, id node, NSUInteger depth) {
+    record->nodeCount += 1;
+
+    if ([node sci_isDictionary] == NO || [node[SCIXMLNodeKeyType] isEqual:SCIXMLNodeTypeElement] == NO) {
+        return depth;
+    }
+
+    NSDictionary *attributes = node[SCIXMLNodeKeyAttributes];
+    NSArray *children = node[SCIXMLNodeKeyChildren];
+    NSUInteger maximumDepth = depth + 1;
+
+    record->attributeCount += [attributes sci_isDictionary] ? attributes.count : 0;
+
+    if ([children sci_isArray]) {
+        for (id child in children) {
+            maximumDepth = MAX(maximumDepth, SCIXMLMetricsCountSubtree(record, child, depth + 1));
+        }
+    }
+
+    return maximumDepth;
+}
+
+void SCIXMLMetricsAddSubtransformDuration(
+    SCIXMLMetricsRecord *record,
+    SCIXMLSubtransformKind kind,
+    NSString *transformName,
+    uint64_t duration
+) {
+    NSCParameterAssert(record);
+    NSCParameterAssert(kind < SCIXMLSubtransformKindCount);
+
+    __atomic_fetch_add(&record->subtransformDurations[kind], duration, __ATOMIC_RELAXED);
+
+    if (transformName == nil) {
+        return;
+    }
+
+    const void *name = (__bridge const void *)transformName;
+
+    // Names are usually the very same objects for every node,
+    // so they mostly end up in the first few slots.
+    for (NSUInteger i = 0; i < SCIXML_METRICS_TRANSFORM_SLOTS; i++) {
+        const void *slotName = __atomic_load_n(&record->transforms[i].name, __ATOMIC_ACQUIRE);
+
+        if (slotName == NULL) {
+            // Another thread may claim the slot first, possibly for the same name
+            const void *expected = NULL;
+
+            if (__atomic_compare_exchange_n(&record->transforms[i].name, &expected, name, NO, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                slotName = name;
+            } else {
+                slotName = expected;
+            }
+        }
+
+        if (slotName == name) {
+            __atomic_fetch_add(&record->transforms[i].duration, duration, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+}
@@ -0,0 +1,42 @@
+//
+// SCIXMLNameTable.h
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <Foundation/Foundation.h>
+
+#import <libxml/dict.h>
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+// Converts the names of elements, attributes and entities into strings
+// during a single parse. Names interned in the parser's dictionary are
+// looked up by their address, so each distinct name is only converted
+// once, and all of its occurrences are represented by the same object.
+@interface SCIXMLNameTable : NSObject
+
+// The dictionary may be NULL, in which case nothing is cached
+- (instancetype)initWithDictionary:(xmlDict *_Nullable)dictionary NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+// Occurrences of these strings in the document will be represented by the
+// very same objects, so that looking them up in collections keyed by them
+// succeeds by pointer comparison, without comparing any characters.
+- (void)addStrings:(id <NSFastEnumeration>)strings;
+
+- (NSString *)stringWithName:(const xmlChar *)name;
+
+// The number of names converted so far, and the number
+// of string objects that actually had to be created for them
+@property (nonatomic, readonly) NSUInteger lookupCount;
+@property (nonatomic, readonly) NSUInteger stringCount;
+
+@end
+
+NS_ASSUME_NONNULL_END
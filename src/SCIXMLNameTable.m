@@ -0,0 +1,196 @@
+//
+// SCIXMLNameTable.m
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <stdint.h>
+#import <stdlib.h>
+
+#import "SCIXMLNameTable.h"
+
+
+// Make an NSString out of a const xlmChar *.
+#define NSXS(str) (@((const char *)(str)))
+
+// Initial number of slots in the hash table; must be a power of 2.
+// Documents usually contain a few dozen distinct names.
+#define SCIXML_NAME_TABLE_INITIAL_CAPACITY 128
+
+
+// The string is owned by the table
+typedef struct {
+    const xmlChar *name;
+    __unsafe_unretained NSString *string;
+} SCIXMLNameTableEntry;
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SCIXMLNameTable () {
+    xmlDict *_Nullable _dictionary;
+
+    // Open addressing with linear probing, keyed by address.
+    // Never more than half full.
+    SCIXMLNameTableEntry *_Nullable _entries;
+    NSUInteger _capacity;
+    NSUInteger _count;
+}
+
+@property (nonatomic, readwrite) NSUInteger lookupCount;
+@property (nonatomic, readwrite) NSUInteger stringCount;
+
+// Keeps the strings of the entries alive
+@property (nonatomic, strong) NSMutableArray<NSString *> *strings;
+
+- (NSString *_Nullable)cachedStringWithName:(const xmlChar *)name;
+- (void)cacheString:(NSString *)string withName:(const xmlChar *)name;
+- (BOOL)growIfNeeded;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+
+static NSUInteger SCIXMLNameTableHash(const xmlChar *name, NSUInteger capacity) {
+    // Names are allocated at least 8 bytes apart;
+    // Fibonacci hashing spreads the remaining bits.
+    uint64_t bits = (uintptr_t)name >> 3;
+    return (NSUInteger)((bits * 11400714819323198485ull) >> 32) & (capacity - 1);
+}
+
+
+@implementation SCIXMLNameTable
+
+- (instancetype)initWithDictionary:(xmlDict *)dictionary {
+    self = [super init];
+    if (self) {
+        _strings = [NSMutableArray new];
+
+        if (dictionary != NULL && xmlDictReference(dictionary) == 0) {
+            _dictionary = dictionary;
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_entries);
+
+    if (_dictionary) {
+        xmlDictFree(_dictionary);
+    }
+}
+
+- (void)addStrings:(id <NSFastEnumeration>)strings {
+    NSParameterAssert(strings);
+
+    if (_dictionary == NULL) {
+        return;
+    }
+
+    for (NSString *string in strings) {
+        // Interning the string makes its address the one the parser will report
+        const xmlChar *name = xmlDictLookup(_dictionary, (const xmlChar *)string.UTF8String, -1);
+
+        if (name != NULL && [self cachedStringWithName:name] == nil) {
+            [self cacheString:string withName:name];
+        }
+    }
+}
+
+- (NSString *)stringWithName:(const xmlChar *)name {
+    NSParameterAssert(name);
+
+    _lookupCount += 1;
+
+    NSString *string = [self cachedStringWithName:name];
+
+    if (string) {
+        return string;
+    }
+
+    string = NSXS(name);
+    _stringCount += 1;
+
+    // Only names owned by the dictionary are guaranteed to keep their
+    // address (and contents) for the lifetime of the table.
+    if (_dictionary && xmlDictOwns(_dictionary, name) == 1) {
+        [self cacheString:string withName:name];
+    }
+
+    return string;
+}
+
+- (NSString *_Nullable)cachedStringWithName:(const xmlChar *)name {
+    if (_entries == NULL) {
+        return nil;
+    }
+
+    for (NSUInteger i = SCIXMLNameTableHash(name, _capacity); _entries[i].name; i = (i + 1) & (_capacity - 1)) {
+        if (_entries[i].name == name) {
+            return _entries[i].string;
+        }
+    }
+
+    return nil;
+}
+
+- (void)cacheString:(NSString *)string withName:(const xmlChar *)name {
+    // If the table can't grow, the name is just not cached
+    if ([self growIfNeeded] == NO) {
+        return;
+    }
+
+    NSUInteger i = SCIXMLNameTableHash(name, _capacity);
+
+    while (_entries[i].name) {
+        i = (i + 1) & (_capacity - 1);
+    }
+
+    [self.strings addObject:string];
+
+    _entries[i].name = name;
+    _entries[i].string = string;
+    _count += 1;
+}
+
+- (BOOL)growIfNeeded {
+    if (2 * (_count + 1) <= _capacity) {
+        return YES;
+    }
+
+    NSUInteger newCapacity = _capacity ? 2 * _capacity : SCIXML_NAME_TABLE_INITIAL_CAPACITY;
+    SCIXMLNameTableEntry *newEntries = calloc(newCapacity, sizeof newEntries[0]);
+
+    if (newEntries == NULL) {
+        return NO;
+    }
+
+    // Rehash existing entries
+    for (NSUInteger j = 0; j < _capacity; j++) {
+        if (_entries[j].name == NULL) {
+            continue;
+        }
+
+        NSUInteger i = SCIXMLNameTableHash(_entries[j].name, newCapacity);
+
+        while (newEntries[i].name) {
+            i = (i + 1) & (newCapacity - 1);
+        }
+
+        newEntries[i] = _entries[j];
+    }
+
+    free(_entries);
+    _entries = newEntries;
+    _capacity = newCapacity;
+
+    return YES;
+}
+
+@end
@@ -0,0 +1,44 @@
+//
+// SCIXMLOutputSink.h
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <Foundation/Foundation.h>
+
+#import <libxml/xmlIO.h>
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+// Receives the output of an xmlTextWriter, and writes it to a stream or
+// a file descriptor in chunks of a fixed size, so that the memory needed
+// for serialization doesn't depend on the size of the document.
+@interface SCIXMLOutputSink : NSObject
+
+// The stream must already be open. It is not closed by the sink.
+- (instancetype)initWithStream:(NSOutputStream *)stream;
+
+// The file descriptor is not closed by the sink.
+- (instancetype)initWithFileDescriptor:(int)fileDescriptor;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+// Returns an output buffer that writes to the sink, to be passed to
+// xmlNewTextWriter(), which takes ownership of it. The sink must outlive
+// the buffer. Closing the buffer writes the last, incomplete chunk.
+- (xmlOutputBuffer *_Nullable)newOutputBuffer;
+
+// The first error that occurred when writing to the stream or file
+@property (nonatomic, readonly, nullable) NSError *error;
+
+// The number of bytes written so far
+@property (nonatomic, readonly) NSUInteger byteCount;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,156 @@
+//
+// SCIXMLOutputSink.m
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <errno.h>
+#import <string.h>
+#import <unistd.h>
+
+#import "SCIXMLOutputSink.h"
+
+
+// Number of bytes collected before writing them to the stream or the file
+#define SCIXML_OUTPUT_CHUNK_SIZE (64 * 1024)
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SCIXMLOutputSink () {
+    char _chunk[SCIXML_OUTPUT_CHUNK_SIZE];
+    NSUInteger _chunkLength;
+}
+
+@property (nonatomic, strong, nullable) NSOutputStream *stream;
+@property (nonatomic, assign) int fileDescriptor;
+
+@property (nonatomic, readwrite, nullable) NSError *error;
+@property (nonatomic, readwrite) NSUInteger byteCount;
+
+- (BOOL)appendBytes:(const char *)bytes length:(NSUInteger)length;
+- (BOOL)flushChunk;
+- (BOOL)writeBytes:(const char *)bytes length:(NSUInteger)length;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+
+#pragma mark - xmlOutputBuffer callbacks
+
+static int SCIXMLOutputSinkWrite(void *context, const char *buffer, int len) {
+    SCIXMLOutputSink *sink = (__bridge SCIXMLOutputSink *)context;
+    return [sink appendBytes:buffer length:len] ? len : -1;
+}
+
+static int SCIXMLOutputSinkClose(void *context) {
+    SCIXMLOutputSink *sink = (__bridge SCIXMLOutputSink *)context;
+    return [sink flushChunk] ? 0 : -1;
+}
+
+
+@implementation SCIXMLOutputSink
+
+- (instancetype)initWithStream:(NSOutputStream *)stream {
+    NSParameterAssert(stream);
+
+    self = [super init];
+    if (self) {
+        _stream = stream;
+        _fileDescriptor = -1;
+    }
+    return self;
+}
+
+- (instancetype)initWithFileDescriptor:(int)fileDescriptor {
+    NSParameterAssert(fileDescriptor >= 0);
+
+    self = [super init];
+    if (self) {
+        _fileDescriptor = fileDescriptor;
+    }
+    return self;
+}
+
+- (xmlOutputBuffer *)newOutputBuffer {
+    return xmlOutputBufferCreateIO(
+        SCIXMLOutputSinkWrite,
+        SCIXMLOutputSinkClose,
+        (__bridge void *)self,
+        NULL // no encoding conversion; the output is UTF-8
+    );
+}
+
+- (BOOL)appendBytes:(const char *)bytes length:(NSUInteger)length {
+    // Once writing has failed, everything else is discarded
+    if (self.error) {
+        return NO;
+    }
+
+    while (length > 0) {
+        NSUInteger n = MIN(length, SCIXML_OUTPUT_CHUNK_SIZE - _chunkLength);
+
+        memcpy(_chunk + _chunkLength, bytes, n);
+        _chunkLength += n;
+        bytes += n;
+        length -= n;
+
+        if (_chunkLength == SCIXML_OUTPUT_CHUNK_SIZE && [self flushChunk] == NO) {
+            return NO;
+        }
+    }
+
+    return YES;
+}
+
+- (BOOL)flushChunk {
+    if (self.error) {
+        return NO;
+    }
+
+    BOOL success = [self writeBytes:_chunk length:_chunkLength];
+    _chunkLength = 0;
+
+    return success;
+}
+
+- (BOOL)writeBytes:(const char *)bytes length:(NSUInteger)length {
+    while (length > 0) {
+        NSInteger n = 0;
+
+        if (self.stream) {
+            n = [self.stream write:(const uint8_t *)bytes maxLength:length];
+
+            if (n <= 0) {
+                self.error = self.stream.streamError ?: [NSError errorWithDomain:NSPOSIXErrorDomain
+                                                                            code:ENOSPC
+                                                                        userInfo:nil];
+                return NO;
+            }
+        } else {
+            n = write(self.fileDescriptor, bytes, length);
+
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (n < 0) {
+                self.error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+                return NO;
+            }
+        }
+
+        bytes += n;
+        length -= n;
+        self.byteCount += n;
+    }
+
+    return YES;
+}
+
+@end
@@ -0,0 +1,51 @@
+//
+// SCIXMLParserContext.h
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <Foundation/Foundation.h>
+
+#import <libxml/parser.h>
+
+#import "SCIXMLNameTable.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+// A libxml parser context that parses one document after the other, along
+// with the name table of its dictionary. Each thread keeps the context of its
+// last parse, so that parsing many small documents in a row doesn't allocate
+// a context, a dictionary and a name table for each of them, and the names
+// seen in earlier documents don't have to be converted into strings again.
+//
+// A context is only used by one parse at a time: it's taken from the thread
+// when acquired, and put back when relinquished. Contexts that are not
+// relinquished (e.g. because a document keeps their dictionary in use
+// beyond the parse) are simply freed once they are released.
+@interface SCIXMLParserContext : NSObject
+
+// The context kept by the current thread, or a new one if there's none,
+// e.g. because the thread is already parsing. Nil if libxml can't allocate one.
++ (instancetype _Nullable)acquireContext;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+// Resets the context, including the SAX handlers, and keeps it for the next
+// parse on the current thread, unless the thread already keeps another one,
+// or the dictionary has grown too large, e.g. by parsing documents with many
+// distinct names, in which case it's freed instead.
+- (void)relinquish;
+
+@property (nonatomic, readonly) xmlParserCtxt *parser;
+
+// The name table of the parser's dictionary
+@property (nonatomic, readonly) SCIXMLNameTable *nameTable;
+
+@end
+
+NS_ASSUME_NONNULL_END
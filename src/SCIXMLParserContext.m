@@ -0,0 +1,104 @@
+//
+// SCIXMLParserContext.m
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <pthread.h>
+
+#import <libxml/SAX2.h>
+
+#import "SCIXMLParserContext.h"
+
+
+// Contexts whose dictionary holds more names than this are not kept,
+// so that the names of unrelated documents don't accumulate forever.
+#define SCIXML_PARSER_CONTEXT_MAX_NAMES 4096
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SCIXMLParserContext ()
+
+- (instancetype _Nullable)initWithNewParser NS_DESIGNATED_INITIALIZER;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+
+// Releases the context kept by a thread when the thread exits
+static void SCIXMLParserContextDestroy(void *context) {
+    (void)(__bridge_transfer SCIXMLParserContext *)context;
+}
+
+static pthread_key_t SCIXMLParserContextKey(void) {
+    static pthread_key_t key;
+    static dispatch_once_t token;
+
+    dispatch_once(&token, ^{
+        pthread_key_create(&key, SCIXMLParserContextDestroy);
+    });
+
+    return key;
+}
+
+
+@implementation SCIXMLParserContext
+
++ (instancetype)acquireContext {
+    pthread_key_t key = SCIXMLParserContextKey();
+    void *context = pthread_getspecific(key);
+
+    if (context == NULL) {
+        return [[self alloc] initWithNewParser];
+    }
+
+    pthread_setspecific(key, NULL);
+
+    return (__bridge_transfer SCIXMLParserContext *)context;
+}
+
+- (instancetype)initWithNewParser {
+    self = [super init];
+    if (self) {
+        _parser = xmlNewParserCtxt();
+
+        if (_parser == NULL) {
+            return nil;
+        }
+
+        _nameTable = [[SCIXMLNameTable alloc] initWithDictionary:_parser->dict];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_parser) {
+        xmlFreeParserCtxt(_parser);
+    }
+}
+
+- (void)relinquish {
+    // Frees the inputs and the state of the last parse. The handlers
+    // installed by a tree builder must not outlive the builder either.
+    xmlCtxtReset(_parser);
+    xmlSAXVersion(_parser->sax, 2);
+    _parser->_private = NULL;
+
+    if (_parser->dict == NULL || xmlDictSize(_parser->dict) > SCIXML_PARSER_CONTEXT_MAX_NAMES) {
+        return;
+    }
+
+    pthread_key_t key = SCIXMLParserContextKey();
+
+    if (pthread_getspecific(key) == NULL) {
+        pthread_setspecific(key, (__bridge_retained void *)self);
+    }
+}
+
+@end
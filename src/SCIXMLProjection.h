@@ -0,0 +1,56 @@
+//
+// SCIXMLProjection.h
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <Foundation/Foundation.h>
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+// Selects the elements of a document that are built while parsing.
+// Elements that are not selected are skipped along with their subtree as
+// soon as their start tag is parsed: no strings, nodes or transforms are
+// created or called for them, so a projection that only selects a few
+// elements of a large document parses nearly as fast as libxml can scan it.
+//
+// Paths are slash-separated lists of element names, starting at the root
+// element, e.g. @"catalog/book/title". An element is selected unless:
+//
+//  * its name is one of the dropped element names, or
+//  * its path is one of the dropped paths, or starts with one of them, or
+//  * there are kept paths, and its path is neither one of them, nor starts
+//    with one of them, nor is a leading part of one of them.
+//
+// Elements of the last kind (ancestors of kept elements) keep their name and
+// attributes, but only the children that are themselves selected, i.e. their
+// text, comments and any other children are dropped.
+//
+// The resulting tree is the same as the one obtained by parsing the whole
+// document and removing the elements that are not selected.
+@interface SCIXMLProjection : NSObject <NSCopying>
+
++ (instancetype)projectionKeepingPaths:(NSArray<NSString *> *)paths;
++ (instancetype)projectionDroppingPaths:(NSArray<NSString *> *)paths;
++ (instancetype)projectionDroppingElementsNamed:(NSArray<NSString *> *)names;
+
+// Passing nil kept paths keeps everything that is not dropped
+- (instancetype)initWithKeptPaths:(NSArray<NSString *> *_Nullable)keptPaths
+                     droppedPaths:(NSArray<NSString *> *_Nullable)droppedPaths
+              droppedElementNames:(NSArray<NSString *> *_Nullable)droppedElementNames NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+// The paths, split into their components, e.g. @[@"catalog", @"book", @"title"]
+@property (nonatomic, readonly, nullable) NSArray<NSArray<NSString *> *> *keptPaths;
+@property (nonatomic, readonly) NSArray<NSArray<NSString *> *> *droppedPaths;
+@property (nonatomic, readonly) NSArray<NSString *> *droppedElementNames;
+
+@end
+
+NS_ASSUME_NONNULL_END
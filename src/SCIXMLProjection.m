@@ -0,0 +1,81 @@
+//
+// SCIXMLProjection.m
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import "SCIXMLProjection.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+static NSArray<NSArray<NSString *> *> *SCIXMLProjectionSplitPaths(NSArray<NSString *> *paths);
+
+NS_ASSUME_NONNULL_END
+
+
+@implementation SCIXMLProjection
+
++ (instancetype)projectionKeepingPaths:(NSArray<NSString *> *)paths {
+    NSParameterAssert(paths);
+    return [[self alloc] initWithKeptPaths:paths droppedPaths:nil droppedElementNames:nil];
+}
+
++ (instancetype)projectionDroppingPaths:(NSArray<NSString *> *)paths {
+    NSParameterAssert(paths);
+    return [[self alloc] initWithKeptPaths:nil droppedPaths:paths droppedElementNames:nil];
+}
+
++ (instancetype)projectionDroppingElementsNamed:(NSArray<NSString *> *)names {
+    NSParameterAssert(names);
+    return [[self alloc] initWithKeptPaths:nil droppedPaths:nil droppedElementNames:names];
+}
+
+- (instancetype)initWithKeptPaths:(NSArray<NSString *> *)keptPaths
+                     droppedPaths:(NSArray<NSString *> *)droppedPaths
+              droppedElementNames:(NSArray<NSString *> *)droppedElementNames {
+
+    self = [super init];
+    if (self) {
+        _keptPaths = keptPaths ? SCIXMLProjectionSplitPaths(keptPaths) : nil;
+        _droppedPaths = SCIXMLProjectionSplitPaths(droppedPaths ?: @[]);
+        _droppedElementNames = [droppedElementNames copy] ?: @[];
+    }
+    return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self; // immutable
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@ %p: keeping %@, dropping %@ and elements named %@>",
+                                      NSStringFromClass(self.class),
+                                      (void *)self,
+                                      self.keptPaths ?: @"everything",
+                                      self.droppedPaths,
+                                      self.droppedElementNames];
+}
+
+@end
+
+
+static NSArray<NSArray<NSString *> *> *SCIXMLProjectionSplitPaths(NSArray<NSString *> *paths) {
+    NSMutableArray<NSArray<NSString *> *> *components = [NSMutableArray arrayWithCapacity:paths.count];
+
+    for (NSString *path in paths) {
+        // A leading slash is allowed, but there are no relative paths
+        NSString *trimmed = [path hasPrefix:@"/"] ? [path substringFromIndex:1] : path;
+        NSArray<NSString *> *names = [trimmed componentsSeparatedByString:@"/"];
+
+        NSCParameterAssert(trimmed.length > 0 && [names containsObject:@""] == NO);
+
+        [components addObject:names];
+    }
+
+    return components;
+}
@@ -12,7 +12,10 @@
 
 #import "NSError+SCIXMLSerialization.h"
 #import "SCIXMLCompactingTransform.h"
+#import "SCIXMLCompiledCompactingTransform.h"
 #import "SCIXMLCanonicalizingTransform.h"
+#import "SCIXMLMetrics.h"
+#import "SCIXMLProjection.h"
 
 
 NS_ASSUME_NONNULL_BEGIN
@@ -32,9 +35,93 @@ FOUNDATION_EXPORT NSString *const SCIXMLNodeTypeComment;
 FOUNDATION_EXPORT NSString *const SCIXMLNodeTypeCDATA;
 FOUNDATION_EXPORT NSString *const SCIXMLNodeTypeEntityRef;
 
+NS_ASSUME_NONNULL_END
+
+
+// Options for parsing. The methods that don't take an options argument
+// behave as if SCIXMLReadingOptionsNone was specified.
+typedef NS_OPTIONS(NSUInteger, SCIXMLReadingOptions) {
+    SCIXMLReadingOptionsNone = 0,
+
+    // By default, the canonical tree is built directly while parsing, and
+    // when compacting, each node is compacted as soon as its end tag is parsed.
+    // With this option, libxml builds a complete document tree first, which
+    // is then converted into a complete canonical tree, which is then compacted.
+    // The result is the same, but it needs considerably more time and memory.
+    // Mostly useful for comparison.
+    SCIXMLReadingOptionsUseDocumentTree = 1 << 0,
+
+    // Builds nodes as instances of SCIXMLCanonicalNode, which keeps the values
+    // for the canonical keys in fixed slots instead of a hash table.
+    // The resulting tree compares equal to the one built without this option,
+    // and it is just as mutable.
+    // Ignored together with SCIXMLReadingOptionsUseDocumentTree.
+    SCIXMLReadingOptionsCanonicalNodeClass = 1 << 1,
+
+    // The characters of text nodes, comments, CDATA sections and attribute
+    // values are not copied into each string individually. Instead, the strings
+    // refer to an arena (or, with SCIXMLReadingOptionsUseDocumentTree, the
+    // document tree itself), which each of them keeps alive. Strings, subtrees
+    // and copies taken out of the tree remain valid after it's released, but
+    // so does the memory of the whole arena, as long as any of them is alive.
+    SCIXMLReadingOptionsNoCopyStrings = 1 << 2,
+
+    // Instead of compacting each node as soon as it's parsed, builds the
+    // complete canonical tree first, and then compacts large sibling subtrees
+    // concurrently, using all active processors (see
+    // +compactedObjectWithCanonicalDictionary:compactingTransform:maximumConcurrency:error:).
+    // Only affects the methods that compact.
+    SCIXMLReadingOptionsConcurrentCompaction = 1 << 3,
+
+    // Parses into a libxml document tree like SCIXMLReadingOptionsUseDocumentTree,
+    // but instead of converting all of it, returns an immutable canonical tree
+    // that keeps the document alive, and converts each node, children array and
+    // attribute dictionary when it's first accessed. Useful when only a small
+    // part of a large document is needed. The tree compares equal to the one
+    // built without this option, and it can be read from multiple threads.
+    // Mutable copies are shallow, like those of any other dictionary.
+    // Implies SCIXMLReadingOptionsUseDocumentTree, and may be combined with
+    // SCIXMLReadingOptionsNoCopyStrings. Ignored by the methods that compact,
+    // since compacting touches every node anyway.
+    SCIXMLReadingOptionsLazyTree = 1 << 4,
+};
+
+// Options for serializing. The methods that don't take an options argument
+// behave as if SCIXMLWritingOptionsNone was specified.
+typedef NS_OPTIONS(NSUInteger, SCIXMLWritingOptions) {
+    SCIXMLWritingOptionsNone = 0,
+
+    // By default, the output is generated by libxml's xmlTextWriter.
+    // With this option, it's generated directly into a byte buffer instead,
+    // which avoids creating a C string from each NSString, and escapes text
+    // using lookup tables. The output and the errors are exactly the same.
+    // Natural dictionaries are then also written as they are walked, instead
+    // of being canonicalized first.
+    SCIXMLWritingOptionsDirectWriter = 1 << 0,
+};
+
+
+NS_ASSUME_NONNULL_BEGIN
+
 
 @interface SCIXMLSerialization : NSObject
 
+#pragma mark - Metrics
+
+// Once a delegate is installed, each call to the methods below is measured:
+// the time spent in each phase (see SCIXMLMetricsPhase) and in compacting
+// sub-transforms, and the size of the trees and the documents involved.
+// The metrics are then passed to the delegate (see SCIXMLMetricsDelegate).
+// A method calling another one is reported as a single call, and so are calls
+// made from the blocks and transforms passed to a method while it runs on the
+// same thread. Calls made from transforms running on other threads, during
+// concurrent compaction, are reported on their own; only the time spent in
+// the sub-transforms themselves is added to the call that started them.
+// The delegate is not retained. Without a delegate, nothing is measured,
+// which costs a single branch per call, and one per node when compacting.
++ (id <SCIXMLMetricsDelegate> _Nullable)metricsDelegate;
++ (void)setMetricsDelegate:(id <SCIXMLMetricsDelegate> _Nullable)delegate;
+
 #pragma mark - Parsing/Deserialization from Strings
 
 + (NSDictionary *_Nullable)canonicalDictionaryWithXMLString:(NSString *)xml
@@ -46,6 +133,14 @@ FOUNDATION_EXPORT NSString *const SCIXMLNodeTypeEntityRef;
 
 #pragma mark - Parsing/Deserialization from Binary Data
 
+// Each thread keeps the libxml parser context of its last parse, along with
+// the strings made of the names in it, and reuses them for its next parse,
+// which makes parsing many small documents in a row considerably cheaper.
+// This also applies to the methods parsing strings, but not to the ones
+// parsing records, nor when the returned tree keeps the libxml document
+// alive (with SCIXMLReadingOptionsUseDocumentTree combined with
+// SCIXMLReadingOptionsNoCopyStrings, or with SCIXMLReadingOptionsLazyTree).
+
 + (NSDictionary *_Nullable)canonicalDictionaryWithXMLData:(NSData *)xml
                                                     error:(NSError *__autoreleasing *)error;
 
@@ -53,12 +148,134 @@ FOUNDATION_EXPORT NSString *const SCIXMLNodeTypeEntityRef;
                        compactingTransform:(id <SCIXMLCompactingTransform>)transform
                                      error:(NSError *__autoreleasing *)error;
 
++ (NSDictionary *_Nullable)canonicalDictionaryWithXMLData:(NSData *)xml
+                                                  options:(SCIXMLReadingOptions)options
+                                                    error:(NSError *__autoreleasing *)error;
+
++ (id _Nullable)compactedObjectWithXMLData:(NSData *)xml
+                       compactingTransform:(id <SCIXMLCompactingTransform>)transform
+                                   options:(SCIXMLReadingOptions)options
+                                     error:(NSError *__autoreleasing *)error;
+
+// Only build the elements selected by the projection (see SCIXMLProjection),
+// skipping the rest while parsing. The tree is always built from SAX events,
+// so SCIXMLReadingOptionsUseDocumentTree and SCIXMLReadingOptionsLazyTree are
+// ignored. A nil projection selects everything.
+
++ (NSDictionary *_Nullable)canonicalDictionaryWithXMLData:(NSData *)xml
+                                               projection:(SCIXMLProjection *_Nullable)projection
+                                                  options:(SCIXMLReadingOptions)options
+                                                    error:(NSError *__autoreleasing *)error;
+
++ (id _Nullable)compactedObjectWithXMLData:(NSData *)xml
+                       compactingTransform:(id <SCIXMLCompactingTransform>)transform
+                                projection:(SCIXMLProjection *_Nullable)projection
+                                   options:(SCIXMLReadingOptions)options
+                                     error:(NSError *__autoreleasing *)error;
+
+#pragma mark - Compaction of Canonical Trees
+
+// Compacts a canonical tree, e.g. one returned by the methods above.
+// Mutable parts of the tree are modified in place, so the tree should not
+// be used afterwards. Sibling subtrees that are large enough are compacted
+// concurrently, on at most 'concurrency' threads, including the calling one.
+// 0 means the number of active processors, and 1 means compacting serially.
+// Either way, the result is the same, and so is the error: if several nodes
+// fail to compact, the first one in the order of serial compaction (children
+// before their parent, siblings in document order) is reported. Transforms
+// must be safe to call concurrently (see SCIXMLCompactingTransform).
++ (id _Nullable)compactedObjectWithCanonicalDictionary:(NSDictionary *)dictionary
+                                   compactingTransform:(id <SCIXMLCompactingTransform>)transform
+                                    maximumConcurrency:(NSUInteger)concurrency
+                                                 error:(NSError *__autoreleasing *)error;
+
+#pragma mark - Parsing/Deserialization of Records from Streams
+
+// These methods parse the input incrementally, and only build the elements
+// at the given record path (e.g. @[@"root", @"record"]), one at a time.
+// Each record is passed to the block as soon as its end tag is parsed,
+// compacted if a transform is given, and canonical otherwise.
+// Everything outside of the records is ignored. Set *stop to YES
+// in the block in order to stop parsing; this is not an error.
+// The encoding of the input is detected from its contents.
+
++ (BOOL)enumerateRecordsWithXMLStream:(NSInputStream *)stream
+                           recordPath:(NSArray<NSString *> *)recordPath
+                  compactingTransform:(id <SCIXMLCompactingTransform> _Nullable)transform
+                           usingBlock:(void (^)(id record, BOOL *stop))block
+                                error:(NSError *__autoreleasing *)error;
+
++ (BOOL)enumerateRecordsWithContentsOfFile:(NSString *)path
+                                recordPath:(NSArray<NSString *> *)recordPath
+                       compactingTransform:(id <SCIXMLCompactingTransform> _Nullable)transform
+                                usingBlock:(void (^)(id record, BOOL *stop))block
+                                     error:(NSError *__autoreleasing *)error;
+
+#pragma mark - Snapshots of Parsed Trees
+
+// A snapshot is a binary image of a tree returned by the methods above, e.g.
+// a compacted object, which loads in a fraction of the time it takes to parse
+// (and compact) the XML it was made from. Loading maps the file into memory,
+// and returns immutable dictionaries and arrays that only decode an element
+// when it's first accessed, so the time it takes doesn't depend on the size
+// of the tree. Loaded trees can be read from multiple threads. Their strings
+// and data are copies, so they stay valid after the tree is released.
+//
+// Trees may consist of dictionaries with string keys, arrays, strings, numbers,
+// dates, data, URLs and NSNull. Snapshots record the version of their format,
+// and a hash of the XML and of the configuration, which is an arbitrary string
+// that identifies everything else the tree depends on, e.g. the transform and
+// its version. Loading a snapshot made by another version of this library,
+// from other XML or with another configuration fails with
+// SCIXMLErrorCodeStaleSnapshot. Loading a truncated snapshot, or one with a
+// corrupt header or string table, fails with SCIXMLErrorCodeMalformedSnapshot.
+// Since loading doesn't read the rest, other corruption is only detected when
+// the element is decoded, which raises NSInternalInconsistencyException instead
+// of reading outside the file. Snapshots are replaced atomically, so they are
+// only corrupt if something other than this library modified them.
+
++ (NSData *_Nullable)snapshotDataWithObject:(id)object
+                                    xmlData:(NSData *)xml
+                              configuration:(NSString *)configuration
+                                      error:(NSError *__autoreleasing *)error;
+
+// The file is replaced atomically, so it can be written by one process
+// while others load it.
++ (BOOL)writeSnapshotOfObject:(id)object
+                      xmlData:(NSData *)xml
+                configuration:(NSString *)configuration
+                       toFile:(NSString *)path
+                        error:(NSError *__autoreleasing *)error;
+
+// A nil XML is not compared with the one the snapshot was made from,
+// e.g. when checking it would mean reading a large file only for that.
++ (id _Nullable)objectWithSnapshotFile:(NSString *)path
+                               xmlData:(NSData *_Nullable)xml
+                         configuration:(NSString *)configuration
+                                 error:(NSError *__autoreleasing *)error;
+
+// Loads the snapshot if it's up to date, or parses and compacts the XML and
+// then writes a snapshot of the result otherwise, e.g. if it's stale, missing
+// or truncated. Failing to write it is not an error. The options are part of
+// the configuration.
++ (id _Nullable)compactedObjectWithXMLData:(NSData *)xml
+                       compactingTransform:(id <SCIXMLCompactingTransform>)transform
+                                   options:(SCIXMLReadingOptions)options
+                              snapshotFile:(NSString *)path
+                             configuration:(NSString *)configuration
+                                     error:(NSError *__autoreleasing *)error;
+
 #pragma mark - Generating/Serialization into Strings
 
 + (NSString *_Nullable)xmlStringWithCanonicalDictionary:(NSDictionary *)dictionary
                                             indentation:(NSString *_Nullable)indentation
                                                   error:(NSError *__autoreleasing *)error;
 
++ (NSString *_Nullable)xmlStringWithCanonicalDictionary:(NSDictionary *)dictionary
+                                            indentation:(NSString *_Nullable)indentation
+                                                options:(SCIXMLWritingOptions)options
+                                                  error:(NSError *__autoreleasing *)error;
+
 + (NSString *_Nullable)xmlStringWithCompactedObject:(id)object
                             canonicalizingTransform:(id <SCIXMLCanonicalizingTransform>)transform
                                         indentation:(NSString *_Nullable)indentation
@@ -68,12 +285,22 @@ FOUNDATION_EXPORT NSString *const SCIXMLNodeTypeEntityRef;
                                           indentation:(NSString *_Nullable)indentation
                                                 error:(NSError *__autoreleasing *)error;
 
++ (NSString *_Nullable)xmlStringWithNaturalDictionary:(NSDictionary *)root
+                                          indentation:(NSString *_Nullable)indentation
+                                              options:(SCIXMLWritingOptions)options
+                                                error:(NSError *__autoreleasing *)error;
+
 #pragma mark - Generating/Serialization into Binary Data
 
 + (NSData *_Nullable)xmlDataWithCanonicalDictionary:(NSDictionary *)dictionary
                                         indentation:(NSString *_Nullable)indentation
                                               error:(NSError *__autoreleasing *)error;
 
++ (NSData *_Nullable)xmlDataWithCanonicalDictionary:(NSDictionary *)dictionary
+                                        indentation:(NSString *_Nullable)indentation
+                                            options:(SCIXMLWritingOptions)options
+                                              error:(NSError *__autoreleasing *)error;
+
 + (NSData *_Nullable)xmlDataWithCompactedObject:(id)object
                         canonicalizingTransform:(id <SCIXMLCanonicalizingTransform>)transform
                                     indentation:(NSString *_Nullable)indentation
@@ -83,6 +310,61 @@ FOUNDATION_EXPORT NSString *const SCIXMLNodeTypeEntityRef;
                                       indentation:(NSString *_Nullable)indentation
                                             error:(NSError *__autoreleasing *)error;
 
++ (NSData *_Nullable)xmlDataWithNaturalDictionary:(NSDictionary *)root
+                                      indentation:(NSString *_Nullable)indentation
+                                          options:(SCIXMLWritingOptions)options
+                                            error:(NSError *__autoreleasing *)error;
+
+#pragma mark - Generating/Serialization into Streams and Files
+
+// These methods write the output in chunks of a fixed size as it's generated,
+// instead of collecting it in memory. The stream is opened if necessary,
+// in which case it's also closed once writing has finished. If an error
+// occurs, the output written until then is left in place.
+
++ (BOOL)writeCanonicalDictionary:(NSDictionary *)dictionary
+                     toXMLStream:(NSOutputStream *)stream
+                     indentation:(NSString *_Nullable)indentation
+                           error:(NSError *__autoreleasing *)error;
+
++ (BOOL)writeCompactedObject:(id)object
+     canonicalizingTransform:(id <SCIXMLCanonicalizingTransform>)transform
+                 toXMLStream:(NSOutputStream *)stream
+                 indentation:(NSString *_Nullable)indentation
+                       error:(NSError *__autoreleasing *)error;
+
++ (BOOL)writeNaturalDictionary:(NSDictionary *)root
+                   toXMLStream:(NSOutputStream *)stream
+                   indentation:(NSString *_Nullable)indentation
+                         error:(NSError *__autoreleasing *)error;
+
+// The file is created or truncated
++ (BOOL)writeCanonicalDictionary:(NSDictionary *)dictionary
+                          toFile:(NSString *)path
+                     indentation:(NSString *_Nullable)indentation
+                           error:(NSError *__autoreleasing *)error;
+
+// The file descriptor is not closed
++ (BOOL)writeCanonicalDictionary:(NSDictionary *)dictionary
+                toFileDescriptor:(int)fileDescriptor
+                     indentation:(NSString *_Nullable)indentation
+                           error:(NSError *__autoreleasing *)error;
+
+// Writes a root element with the given name and attributes, containing
+// the records returned by the block, one at a time. The block is called
+// until it returns nil, or an NSError instance, which stops writing and
+// is reported as the error. Records are written as soon as they are
+// returned, and they are canonicalized first if a transform is given,
+// so they don't all have to be kept in memory at the same time.
+// The attributes are checked and written like those of any other element.
++ (BOOL)writeRecordsToXMLStream:(NSOutputStream *)stream
+                rootElementName:(NSString *)rootName
+                     attributes:(NSDictionary<NSString *, NSString *> *_Nullable)attributes
+        canonicalizingTransform:(id <SCIXMLCanonicalizingTransform> _Nullable)transform
+                    indentation:(NSString *_Nullable)indentation
+                     usingBlock:(id _Nullable (^)(void))block
+                          error:(NSError *__autoreleasing *)error;
+
 @end
 
 NS_ASSUME_NONNULL_END
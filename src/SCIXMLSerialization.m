@@ -9,6 +9,7 @@
 //
 
 #import <stdlib.h>
+#import <string.h>
 
 #import <libxml/parser.h>
 #import <libxml/tree.h>
@@ -16,6 +17,15 @@
 #import <libxml/xmlwriter.h>
 
 #import "SCIXMLSerialization.h"
+#import "SCIXMLTreeBuilder.h"
+#import "SCIXMLNameTable.h"
+#import "SCIXMLParserContext.h"
+#import "SCIXMLStringArena.h"
+#import "SCIXMLOutputSink.h"
+#import "SCIXMLDirectWriter.h"
+#import "SCIXMLLazyNode.h"
+#import "SCIXMLSnapshot.h"
+#import "SCIXMLMetricsRecord.h"
 #import "NSObject+SCIXMLSerialization.h"
 
 
@@ -39,6 +49,16 @@
         "out error parameter when requested"                            \
     )
 
+// Options passed to libxml, regardless of how the tree is built
+#define SCIXML_LIBXML_PARSER_OPTIONS (XML_PARSE_NOENT | XML_PARSE_NONET | XML_PARSE_NOBLANKS | XML_PARSE_HUGE)
+
+// Number of bytes read from a stream and fed to the push parser at once
+#define SCIXML_STREAM_CHUNK_SIZE (64 * 1024)
+
+// Subtrees with fewer nodes than this are always compacted on the thread
+// that encounters them, since handing them to another one isn't worth it.
+#define SCIXML_CONCURRENT_COMPACTION_THRESHOLD 1024
+
 
 NSString *const SCIXMLNodeKeyType       = @"type";
 NSString *const SCIXMLNodeKeyName       = @"name";
@@ -53,6 +73,12 @@ NSString *const SCIXMLNodeTypeCDATA     = @"cdata";
 NSString *const SCIXMLNodeTypeEntityRef = @"entityref";
 
 
+// Shared by all threads taking part in a concurrent compaction
+typedef struct {
+    NSInteger idleWorkers; // accessed atomically
+} SCIXMLConcurrentCompaction;
+
+
 NS_ASSUME_NONNULL_BEGIN
 
 typedef NSDictionary *_Nullable (^SCIXMLTypewiseCanonicalizerSubtransform)(
@@ -66,20 +92,82 @@ typedef NSDictionary *_Nullable (^SCIXMLTypewiseCanonicalizerSubtransform)(
 
 + (BOOL)libxmlUsesLibcAllocators;
 
-// Returns a canonical dictionary
+// Builds the tree from SAX events. If a transform is given, each node
+// is compacted as soon as it's complete, so a compacted object is returned.
+// Otherwise, it returns a canonical dictionary.
++ (id _Nullable)streamingParseXMLData:(NSData *)xml
+                  compactingTransform:(id <SCIXMLCompactingTransform> _Nullable)transform
+                           projection:(SCIXMLProjection *_Nullable)projection
+                              options:(SCIXMLReadingOptions)options
+                                error:(NSError *__autoreleasing *)error;
+
+// Makes the builder compact each node as soon as it's complete
++ (void)installCompactingTransform:(id <SCIXMLCompactingTransform>)transform
+                         inBuilder:(SCIXMLTreeBuilder *)builder;
+
+// Returns a canonical dictionary, converted from a libxml document tree
++ (NSDictionary *_Nullable)documentTreeCanonicalDictionaryWithXMLData:(NSData *)xml
+                                                              options:(SCIXMLReadingOptions)options
+                                                                error:(NSError *__autoreleasing *)error;
+
+// Returns a canonical dictionary. If an arena is given, it must own the
+// document, and the strings of the dictionary refer to the nodes directly.
 + (NSDictionary *_Nullable)dictionaryWithNode:(xmlNode *)node
+                                    nameTable:(SCIXMLNameTable *)nameTable
+                                        arena:(SCIXMLStringArena *_Nullable)arena
                                         error:(NSError *__autoreleasing *)error;
 
+// Returns a string with the contents of a text-like node
++ (NSString *)stringWithContent:(const xmlChar *)content
+                          arena:(SCIXMLStringArena *_Nullable)arena;
+
 // Expects a canonical dictionary
 + (xmlChar *_Nullable)bufferWithDictionary:(NSDictionary *)dictionary
                                indentation:(NSString *_Nullable)indentation
                                     length:(NSUInteger *)length
                                      error:(NSError *__autoreleasing *)error;
 
+// Sets up indentation and starts the document
++ (char *_Nullable)directBufferWithDictionary:(NSDictionary *)dictionary
+                                  indentation:(NSString *_Nullable)indentation
+                                       length:(NSUInteger *)length
+                                        error:(NSError *__autoreleasing *)error;
+
+// Returns NULL if the dictionary is not in natural format, or if writing
+// fails. The canonicalizing serializer then reports the error.
++ (char *_Nullable)directBufferWithNaturalDictionary:(NSDictionary *)root
+                                         indentation:(NSString *_Nullable)indentation
+                                              length:(NSUInteger *)length;
+
++ (BOOL)startDocumentWithWriter:(xmlTextWriter *)writer
+                    indentation:(NSString *_Nullable)indentation
+                          error:(NSError *__autoreleasing *)error;
+
+// Writes a complete document. Expects a canonical dictionary
++ (BOOL)writeDocumentWithDictionary:(NSDictionary *)dictionary
+                        indentation:(NSString *_Nullable)indentation
+                             writer:(xmlTextWriter *)writer
+                              error:(NSError *__autoreleasing *)error;
+
+// Opens the stream unless it's already open, and closes it afterwards if so
++ (BOOL)writeToXMLStream:(NSOutputStream *)stream
+                   error:(NSError *__autoreleasing *)error
+              usingBlock:(BOOL (^)(xmlTextWriter *, NSError *__autoreleasing *))block;
+
+// Calls the block with a writer that writes to the sink
++ (BOOL)writeToSink:(SCIXMLOutputSink *)sink
+              error:(NSError *__autoreleasing *)error
+         usingBlock:(BOOL (^)(xmlTextWriter *, NSError *__autoreleasing *))block;
+
 + (BOOL)writeXMLNode:(NSDictionary *)node
               writer:(xmlTextWriter *)writer
                error:(NSError *__autoreleasing *)error;
 
+// Writes the attributes of the element just started
++ (BOOL)writeAttributes:(NSDictionary *)attributes
+                 writer:(xmlTextWriter *)writer
+                  error:(NSError *__autoreleasing *)error;
+
 + (id _Nullable (^)(NSString *, Class))propertyGetterWithNode:(NSDictionary *)node
                                                         error:(NSError *__autoreleasing *)error;
 
@@ -93,6 +181,24 @@ typedef NSDictionary *_Nullable (^SCIXMLTypewiseCanonicalizerSubtransform)(
                     withTransform:(id <SCIXMLCompactingTransform>)transform
                             error:(NSError *__autoreleasing *)error;
 
+// Concurrently compacts large sibling subtrees, using at most 'concurrency'
+// threads, including the calling one. 1 means compacting serially.
++ (id _Nullable)compactDictionary:(NSDictionary *)canonical
+                    withTransform:(id <SCIXMLCompactingTransform>)transform
+               maximumConcurrency:(NSUInteger)concurrency
+                            error:(NSError *__autoreleasing *)error;
+
++ (id _Nullable)compactDictionary:(NSDictionary *)canonical
+                    withTransform:(id <SCIXMLCompactingTransform>)transform
+                      concurrency:(SCIXMLConcurrentCompaction *)concurrency
+                            error:(NSError *__autoreleasing *)error;
+
+// Expects a canonical node, the children of which have already been compacted.
+// Only applies the transform to the node itself; it doesn't recurse.
++ (id _Nullable)compactNode:(NSDictionary *)canonical
+              withTransform:(id <SCIXMLCompactingTransform>)transform
+                      error:(NSError *__autoreleasing *)error;
+
 // Returns a canonical dictionary
 + (NSDictionary *_Nullable)canonicalizeObject:(id)compacted
                                 withTransform:(id <SCIXMLCanonicalizingTransform>)transform
@@ -132,10 +238,209 @@ NS_ASSUME_NONNULL_END
 
 #pragma mark - Parsing and Serialization Core (internal)
 
++ (id _Nullable)streamingParseXMLData:(NSData *)xml
+                  compactingTransform:(id <SCIXMLCompactingTransform> _Nullable)transform
+                           projection:(SCIXMLProjection *_Nullable)projection
+                              options:(SCIXMLReadingOptions)options
+                                error:(NSError *__autoreleasing *)error {
+
+    NSParameterAssert(xml);
+
+    // never leave out error parameter uninitialized
+    if (error) {
+        *error = nil;
+    }
+
+    // Initialize parser, or reuse the one of the last parse on this thread
+    SCIXMLParserContext *context = [SCIXMLParserContext acquireContext];
+
+    if (context == nil) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeParserInit];
+        }
+        return nil;
+    }
+
+    xmlParserCtxt *parser = context.parser;
+
+    // Build the tree while parsing. The returned document
+    // only holds the DTD and the entity declarations, if any.
+    SCIXMLTreeBuilder *builder = [SCIXMLTreeBuilder new];
+    builder.usesCanonicalNodeClass = (options & SCIXMLReadingOptionsCanonicalNodeClass) != 0;
+    builder.usesStringArena = (options & SCIXMLReadingOptionsNoCopyStrings) != 0;
+    builder.projection = projection;
+    builder.nameTable = context.nameTable;
+    [builder attachToParser:parser];
+
+    if (transform) {
+        [self installCompactingTransform:transform inBuilder:builder];
+    }
+
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrent();
+    SCIXMLMetricsPhase previousPhase = SCIXMLMetricsEnterPhase(metrics, SCIXMLMetricsPhaseParse);
+
+    xmlDoc *doc = xmlCtxtReadMemory(
+        parser,
+        xml.bytes,
+        (int)xml.length,
+        "",
+        "UTF-8",
+        SCIXML_LIBXML_PARSER_OPTIONS
+    );
+
+    SCIXMLMetricsLeavePhase(metrics, previousPhase);
+    SCIXMLMetricsAddByteCount(metrics, xml.length);
+    SCIXMLMetricsAddTreeCounts(metrics, builder.nodeCount, builder.attributeCount, builder.maximumDepth);
+
+    id root = nil;
+
+    if (builder.error) {
+        if (error) {
+            *error = builder.error;
+        }
+    } else if (doc == NULL || parser->wellFormed == 0 || builder.root == nil) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedXML
+                                         rawError:xmlCtxtGetLastError(parser)];
+        }
+    } else {
+        root = builder.root;
+    }
+
+    xmlFreeDoc(doc);
+    [context relinquish];
+
+    return root;
+}
+
++ (void)installCompactingTransform:(id <SCIXMLCompactingTransform>)transform
+                         inBuilder:(SCIXMLTreeBuilder *)builder {
+
+    NSParameterAssert(transform);
+    NSParameterAssert(builder);
+
+    // Names looked up by the transform are then compared by address
+    if ([transform isKindOfClass:SCIXMLCompactingTransform.class]) {
+        NSSet<NSString *> *referencedNames = ((SCIXMLCompactingTransform *)transform).referencedNames;
+
+        if (referencedNames) {
+            [builder.nameTable addStrings:referencedNames];
+        }
+    }
+
+    // Compaction is bottom-up, so a node can be compacted as soon as its
+    // end tag has been parsed, and its canonical form can be thrown away.
+    builder.nodeFinalizer = ^id _Nullable (NSMutableDictionary *node, NSError *__autoreleasing *error) {
+        SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrent();
+        SCIXMLMetricsPhase previousPhase = SCIXMLMetricsEnterPhase(metrics, SCIXMLMetricsPhaseCompact);
+
+        id compacted = [self compactNode:node
+                           withTransform:transform
+                                   error:error];
+
+        SCIXMLMetricsLeavePhase(metrics, previousPhase);
+
+        return compacted;
+    };
+}
+
++ (NSDictionary *_Nullable)documentTreeCanonicalDictionaryWithXMLData:(NSData *)xml
+                                                              options:(SCIXMLReadingOptions)options
+                                                                error:(NSError *__autoreleasing *)error {
+
+    NSParameterAssert(xml);
+
+    if (error) {
+        *error = nil;
+    }
+
+    // Initialize parser, or reuse the one of the last parse on this thread
+    SCIXMLParserContext *context = [SCIXMLParserContext acquireContext];
+
+    if (context == nil) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeParserInit];
+        }
+        return nil;
+    }
+
+    xmlParserCtxt *parser = context.parser;
+
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrent();
+    SCIXMLMetricsPhase previousPhase = SCIXMLMetricsEnterPhase(metrics, SCIXMLMetricsPhaseParse);
+
+    // Parse text into libxml's tree representation
+    xmlDoc *doc = xmlCtxtReadMemory(
+        parser,
+        xml.bytes,
+        (int)xml.length,
+        "",
+        "UTF-8",
+        SCIXML_LIBXML_PARSER_OPTIONS
+    );
+
+    SCIXMLMetricsLeavePhase(metrics, previousPhase);
+    SCIXMLMetricsAddByteCount(metrics, xml.length);
+
+    if (doc == NULL) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedXML
+                                         rawError:xmlCtxtGetLastError(parser)];
+        }
+        [context relinquish];
+        return nil;
+    }
+
+    // Without copying strings, the document lives as long as the strings
+    // referring to it, and so does its dictionary, which is that of the parser.
+    // Since the document may then be freed on another thread while the
+    // dictionary is used for parsing, the context is not reused in that case,
+    // nor with a lazy tree.
+    SCIXMLStringArena *arena = nil;
+
+    if (options & SCIXMLReadingOptionsNoCopyStrings) {
+        arena = [SCIXMLStringArena new];
+        [arena takeOverDocument:doc];
+    }
+
+    // The lazy tree converts nodes as they are accessed, so they are neither
+    // built nor counted here. It takes over the document unless the arena has.
+    if (options & SCIXMLReadingOptionsLazyTree) {
+        return [SCIXMLLazyNode rootNodeWithDocument:doc arena:arena error:error];
+    }
+
+    // Transform the libxml tree into a tree of Cocoa collections.
+    // Names in the tree are interned in the dictionary of the document,
+    // which is that of the context, so names from earlier parses are known.
+    xmlNode *root = xmlDocGetRootElement(doc);
+    SCIXMLNameTable *nameTable = context.nameTable;
+
+    previousPhase = SCIXMLMetricsEnterPhase(metrics, SCIXMLMetricsPhaseBuild);
+    NSDictionary *dict = [self dictionaryWithNode:root nameTable:nameTable arena:arena error:error];
+    SCIXMLMetricsLeavePhase(metrics, previousPhase);
+
+    if (metrics && dict) {
+        SCIXMLMetricsCountTree(metrics, dict);
+    }
+
+    // The strings keep the document alive, if they refer to it
+    if (arena) {
+        return dict;
+    }
+
+    xmlFreeDoc(doc);
+    [context relinquish];
+
+    return dict;
+}
+
 + (NSDictionary *_Nullable)dictionaryWithNode:(xmlNode *)node
+                                    nameTable:(SCIXMLNameTable *)nameTable
+                                        arena:(SCIXMLStringArena *_Nullable)arena
                                         error:(NSError *__autoreleasing *)error {
 
     NSParameterAssert(node);
+    NSParameterAssert(nameTable);
 
     // never leave out error parameter uninitialized
     if (error) {
@@ -147,20 +452,33 @@ NS_ASSUME_NONNULL_END
     switch (node->type) {
     case XML_ELEMENT_NODE: {
         dict[SCIXMLNodeKeyType]       = SCIXMLNodeTypeElement;
-        dict[SCIXMLNodeKeyName]       = NSXS(node->name);
+        dict[SCIXMLNodeKeyName]       = [nameTable stringWithName:node->name];
         dict[SCIXMLNodeKeyChildren]   = [NSMutableArray new];
         dict[SCIXMLNodeKeyAttributes] = [NSMutableDictionary new];
 
         // Collect attributes
         for (xmlAttr *attr = node->properties; attr != NULL; attr = attr->next) {
+            NSString *name = [nameTable stringWithName:attr->name];
+
+            // The value of an attribute is usually a single text node,
+            // which can be used directly. Otherwise, (e.g. if it contains
+            // an entity reference,) libxml has to assemble it.
+            if (attr->children && attr->children->next == NULL && attr->children->type == XML_TEXT_NODE) {
+                if (dict[SCIXMLNodeKeyAttributes][name] == nil) {
+                    dict[SCIXMLNodeKeyAttributes][name] = [self stringWithContent:attr->children->content
+                                                                            arena:arena];
+                }
+                continue;
+            }
+
             xmlChar *value = xmlGetProp(node, attr->name);
-            dict[SCIXMLNodeKeyAttributes][NSXS(attr->name)] = NSXS(value);
+            dict[SCIXMLNodeKeyAttributes][name] = NSXS(value);
             xmlFree(value);
         }
 
         // Collect children
         for (xmlNode *child = node->children; child != NULL; child = child->next) {
-            NSDictionary *childDict = [self dictionaryWithNode:child error:error];
+            NSDictionary *childDict = [self dictionaryWithNode:child nameTable:nameTable arena:arena error:error];
 
             if (childDict == nil) {
                 return nil;
@@ -173,22 +491,22 @@ NS_ASSUME_NONNULL_END
     }
     case XML_TEXT_NODE: {
         dict[SCIXMLNodeKeyType] = SCIXMLNodeTypeText;
-        dict[SCIXMLNodeKeyText] = NSXS(node->content);
+        dict[SCIXMLNodeKeyText] = [self stringWithContent:node->content arena:arena];
         break;
     }
     case XML_COMMENT_NODE: {
         dict[SCIXMLNodeKeyType] = SCIXMLNodeTypeComment;
-        dict[SCIXMLNodeKeyText] = NSXS(node->content);
+        dict[SCIXMLNodeKeyText] = [self stringWithContent:node->content arena:arena];
         break;
     }
     case XML_CDATA_SECTION_NODE: {
         dict[SCIXMLNodeKeyType] = SCIXMLNodeTypeCDATA;
-        dict[SCIXMLNodeKeyText] = NSXS(node->content);
+        dict[SCIXMLNodeKeyText] = [self stringWithContent:node->content arena:arena];
         break;
     }
     case XML_ENTITY_REF_NODE: {
         dict[SCIXMLNodeKeyType] = SCIXMLNodeTypeEntityRef;
-        dict[SCIXMLNodeKeyName] = NSXS(node->name);
+        dict[SCIXMLNodeKeyName] = [nameTable stringWithName:node->name];
         break;
     }
     default:
@@ -204,6 +522,18 @@ NS_ASSUME_NONNULL_END
     return dict;
 }
 
++ (NSString *)stringWithContent:(const xmlChar *)content
+                          arena:(SCIXMLStringArena *_Nullable)arena {
+
+    NSParameterAssert(content);
+
+    if (arena) {
+        return [arena stringWithBytesNoCopy:content length:strlen((const char *)content)];
+    }
+
+    return NSXS(content);
+}
+
 + (xmlChar *_Nullable)bufferWithDictionary:(NSDictionary *)dictionary
                                indentation:(NSString *_Nullable)indentation
                                     length:(NSUInteger *)length
@@ -242,6 +572,92 @@ NS_ASSUME_NONNULL_END
         return NULL;
     }
 
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrent();
+    SCIXMLMetricsPhase previousPhase = SCIXMLMetricsEnterPhase(metrics, SCIXMLMetricsPhaseWrite);
+
+    // Try writing the document.
+    // Move content out of buffer upon success.
+    xmlChar *content = NULL;
+
+    if ([self writeDocumentWithDictionary:dictionary indentation:indentation writer:writer error:error]) {
+        *length = xmlBufferLength(buf);
+        content = xmlBufferDetach(buf);
+    }
+
+    // Clean up writer state
+    xmlFreeTextWriter(writer);
+    xmlBufferFree(buf);
+
+    SCIXMLMetricsLeavePhase(metrics, previousPhase);
+    SCIXMLMetricsAddByteCount(metrics, *length);
+
+    return content;
+}
+
+// Same as -bufferWithDictionary:indentation:length:error:, but bypasses
+// xmlTextWriter. The returned buffer must be freed using free(), not xmlFree().
++ (char *_Nullable)directBufferWithDictionary:(NSDictionary *)dictionary
+                                  indentation:(NSString *_Nullable)indentation
+                                       length:(NSUInteger *)length
+                                        error:(NSError *__autoreleasing *)error {
+
+    NSParameterAssert(dictionary);
+    NSParameterAssert(length);
+
+    *length = 0;
+
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrent();
+
+    if (metrics) {
+        SCIXMLMetricsCountTree(metrics, dictionary);
+    }
+
+    SCIXMLMetricsPhase previousPhase = SCIXMLMetricsEnterPhase(metrics, SCIXMLMetricsPhaseWrite);
+
+    SCIXMLDirectWriter *writer = [[SCIXMLDirectWriter alloc] initWithIndentation:indentation];
+    char *bytes = NULL;
+
+    if ([writer writeDocumentWithDictionary:dictionary error:error]) {
+        bytes = [writer detachBytesWithLength:length];
+    }
+
+    SCIXMLMetricsLeavePhase(metrics, previousPhase);
+    SCIXMLMetricsAddByteCount(metrics, *length);
+
+    return bytes;
+}
+
++ (char *_Nullable)directBufferWithNaturalDictionary:(NSDictionary *)root
+                                         indentation:(NSString *_Nullable)indentation
+                                              length:(NSUInteger *)length {
+
+    NSParameterAssert(root);
+    NSParameterAssert(length);
+
+    *length = 0;
+
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrent();
+    SCIXMLMetricsPhase previousPhase = SCIXMLMetricsEnterPhase(metrics, SCIXMLMetricsPhaseWrite);
+
+    SCIXMLDirectWriter *writer = [[SCIXMLDirectWriter alloc] initWithIndentation:indentation];
+    char *bytes = NULL;
+
+    if ([writer writeDocumentWithNaturalDictionary:root]) {
+        bytes = [writer detachBytesWithLength:length];
+    }
+
+    SCIXMLMetricsLeavePhase(metrics, previousPhase);
+    SCIXMLMetricsAddByteCount(metrics, *length);
+
+    return bytes;
+}
+
++ (BOOL)startDocumentWithWriter:(xmlTextWriter *)writer
+                    indentation:(NSString *_Nullable)indentation
+                          error:(NSError *__autoreleasing *)error {
+
+    NSParameterAssert(writer);
+
     // If the user wants indentation, try setting it up.
     if (
         indentation
@@ -256,9 +672,7 @@ NS_ASSUME_NONNULL_END
             *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeWriterInit
                                            format:@"could not set indentation"];
         }
-        xmlFreeTextWriter(writer);
-        xmlBufferFree(buf);
-        return NULL;
+        return NO;
     }
 
     // Start writing the document (which is not just the same as the root node!)
@@ -267,83 +681,217 @@ NS_ASSUME_NONNULL_END
             *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeWriterInit
                                            format:@"could not start writing document"];
         }
-        xmlFreeTextWriter(writer);
-        xmlBufferFree(buf);
-        return NULL;
-    }
-
-    // Try writing root element.
-    // Move content out of buffer upon success.
-    xmlChar *content = NULL;
-
-    if ([self writeXMLNode:dictionary writer:writer error:error]) {
-        // If writing the root element succeeded, try closing the document.
-        if (xmlTextWriterEndDocument(writer) >= 0) {
-            *length = xmlBufferLength(buf);
-            content = xmlBufferDetach(buf);
-        } else if (error) {
-            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeWriteFailed
-                                           format:@"error writing XML for node %p", (void *)dictionary];
-        }
+        return NO;
     }
 
-    // Clean up writer state
-    xmlFreeTextWriter(writer);
-    xmlBufferFree(buf);
-
-    return content;
+    return YES;
 }
 
-+ (BOOL)writeXMLNode:(NSDictionary *)node
-              writer:(xmlTextWriter *)writer
-               error:(NSError *__autoreleasing *)error {
++ (BOOL)writeDocumentWithDictionary:(NSDictionary *)dictionary
+                        indentation:(NSString *_Nullable)indentation
+                             writer:(xmlTextWriter *)writer
+                              error:(NSError *__autoreleasing *)error {
 
-    NSParameterAssert(node);
+    NSParameterAssert(dictionary);
     NSParameterAssert(writer);
 
-    id (^getter)(NSString *, Class) = [self propertyGetterWithNode:node error:error];
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrent();
 
-    NSString *nodeType = GET_NODE_PROPERTY(getter, SCIXMLNodeKeyType, NSString);
-    if (nodeType == nil) {
+    if (metrics) {
+        SCIXMLMetricsCountTree(metrics, dictionary);
+    }
+
+    if ([self startDocumentWithWriter:writer indentation:indentation error:error] == NO) {
         return NO;
     }
 
-    // Obtain writer function based on node type
-    BOOL (^nodeWriter)(
-        NSDictionary *,
-        xmlTextWriter *,
-        NSError *__autoreleasing *
-    );
+    // Try writing root element.
+    if ([self writeXMLNode:dictionary writer:writer error:error] == NO) {
+        return NO;
+    }
 
-    nodeWriter = self.nodeWriters[nodeType];
-    if (nodeWriter == nil) {
+    // If writing the root element succeeded, try closing the document.
+    if (xmlTextWriterEndDocument(writer) < 0) {
         if (error) {
-            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeUnimplemented
-                                           format:@"unhandled node type: %@", nodeType];
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeWriteFailed
+                                           format:@"error writing XML for node %p", (void *)dictionary];
         }
         return NO;
     }
 
-    return nodeWriter(node, writer, error);
+    return YES;
 }
 
-+ (id _Nullable (^)(NSString *, Class))propertyGetterWithNode:(NSDictionary *)node
-                                                        error:(NSError *__autoreleasing *)error {
++ (BOOL)writeToXMLStream:(NSOutputStream *)stream
+                   error:(NSError *__autoreleasing *)error
+              usingBlock:(BOOL (^)(xmlTextWriter *, NSError *__autoreleasing *))block {
 
-    NSParameterAssert(node);
+    NSParameterAssert(stream);
+    NSParameterAssert(block);
 
-    // This function attempts to retrieve a value from the node dictionary,
-    // then checks if it is of the specified type/class.
-    // If the key does not exist or the value is of the wrong type, it
-    // sets the error and returns nil. Otherwise, it returns the value.
-    return ^id _Nullable(NSString *key, Class cls) {
-        id value = node[key];
+    // Only close the stream if we opened it
+    BOOL shouldCloseStream = stream.streamStatus == NSStreamStatusNotOpen;
+    if (shouldCloseStream) {
+        [stream open];
+    }
 
-        if ([value isKindOfClass:cls] == NO) {
-            value = nil;
+    BOOL success = NO;
+
+    if (stream.streamStatus == NSStreamStatusError) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeWriterInit
+                                           format:@"could not open output stream: %@",
+                                                  stream.streamError.localizedDescription];
         }
+    } else {
+        SCIXMLOutputSink *sink = [[SCIXMLOutputSink alloc] initWithStream:stream];
+        success = [self writeToSink:sink error:error usingBlock:block];
+    }
 
-        if (value == nil && error) {
+    if (shouldCloseStream) {
+        [stream close];
+    }
+
+    return success;
+}
+
++ (BOOL)writeToSink:(SCIXMLOutputSink *)sink
+              error:(NSError *__autoreleasing *)error
+         usingBlock:(BOOL (^)(xmlTextWriter *, NSError *__autoreleasing *))block {
+
+    NSParameterAssert(sink);
+    NSParameterAssert(block);
+
+    // never leave out error parameter uninitialized
+    if (error) {
+        *error = nil;
+    }
+
+    xmlOutputBuffer *output = [sink newOutputBuffer];
+    if (output == NULL) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeWriterInit
+                                           format:@"could not allocate output buffer"];
+        }
+        return NO;
+    }
+
+    // The writer takes ownership of the output buffer if it succeeds
+    xmlTextWriter *writer = xmlNewTextWriter(output);
+    if (writer == NULL) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeWriterInit
+                                           format:@"could not allocate writer"];
+        }
+        xmlOutputBufferClose(output);
+        return NO;
+    }
+
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrent();
+    SCIXMLMetricsPhase previousPhase = SCIXMLMetricsEnterPhase(metrics, SCIXMLMetricsPhaseWrite);
+
+    BOOL success = block(writer, error);
+
+    // Flushes the output buffer, and writes the last chunk
+    xmlFreeTextWriter(writer);
+
+    SCIXMLMetricsLeavePhase(metrics, previousPhase);
+    SCIXMLMetricsAddByteCount(metrics, sink.byteCount);
+
+    // Errors of the sink make the writer fail, but they are more specific
+    if (sink.error) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeWriteFailed
+                                           format:@"could not write output: %@",
+                                                  sink.error.localizedDescription];
+        }
+        return NO;
+    }
+
+    return success;
+}
+
++ (BOOL)writeXMLNode:(NSDictionary *)node
+              writer:(xmlTextWriter *)writer
+               error:(NSError *__autoreleasing *)error {
+
+    NSParameterAssert(node);
+    NSParameterAssert(writer);
+
+    id (^getter)(NSString *, Class) = [self propertyGetterWithNode:node error:error];
+
+    NSString *nodeType = GET_NODE_PROPERTY(getter, SCIXMLNodeKeyType, NSString);
+    if (nodeType == nil) {
+        return NO;
+    }
+
+    // Obtain writer function based on node type
+    BOOL (^nodeWriter)(
+        NSDictionary *,
+        xmlTextWriter *,
+        NSError *__autoreleasing *
+    );
+
+    nodeWriter = self.nodeWriters[nodeType];
+    if (nodeWriter == nil) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeUnimplemented
+                                           format:@"unhandled node type: %@", nodeType];
+        }
+        return NO;
+    }
+
+    return nodeWriter(node, writer, error);
+}
+
++ (BOOL)writeAttributes:(NSDictionary *)attributes
+                 writer:(xmlTextWriter *)writer
+                  error:(NSError *__autoreleasing *)error {
+
+    NSParameterAssert(attributes);
+    NSParameterAssert(writer);
+
+    for (NSString *attrName in attributes) {
+        NSString *attrValue = attributes[attrName];
+
+        // Both keys and values _must_ be strings!
+        if (attrName.sci_isString && attrValue.sci_isString) {
+            if (xmlTextWriterWriteAttribute(writer, XS(attrName.UTF8String), XS(attrValue.UTF8String)) < 0) {
+                if (error) {
+                    *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeWriteFailed
+                                                   format:@"could not write attribute '%@'", attrName];
+                }
+                return NO;
+            }
+        } else {
+            if (error) {
+                *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedTree
+                                               format:@"attribute name or value was not a string"];
+            }
+            return NO;
+        }
+    }
+
+    return YES;
+}
+
++ (id _Nullable (^)(NSString *, Class))propertyGetterWithNode:(NSDictionary *)node
+                                                        error:(NSError *__autoreleasing *)error {
+
+    NSParameterAssert(node);
+
+    // This function attempts to retrieve a value from the node dictionary,
+    // then checks if it is of the specified type/class.
+    // If the key does not exist or the value is of the wrong type, it
+    // sets the error and returns nil. Otherwise, it returns the value.
+    return ^id _Nullable(NSString *key, Class cls) {
+        id value = node[key];
+
+        if ([value isKindOfClass:cls] == NO) {
+            value = nil;
+        }
+
+        if (value == nil && error) {
             *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedTree
                                            format:@"node %p has no value for key '%@' of type %@",
                                                   (void *)node,
@@ -398,25 +946,8 @@ NS_ASSUME_NONNULL_END
             }
 
             // Write attributes
-            for (NSString *attrName in attributes) {
-                NSString *attrValue = attributes[attrName];
-
-                // Both keys and values _must_ be strings!
-                if (attrName.sci_isString && attrValue.sci_isString) {
-                    if (xmlTextWriterWriteAttribute(writer, XS(attrName.UTF8String), XS(attrValue.UTF8String)) < 0) {
-                        if (error) {
-                            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeWriteFailed
-                                                           format:@"could not write attribute '%@'", attrName];
-                        }
-                        return NO;
-                    }
-                } else {
-                    if (error) {
-                        *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedTree
-                                                       format:@"attribute name or value was not a string"];
-                    }
-                    return NO;
-                }
+            if ([self writeAttributes:attributes writer:writer error:error] == NO) {
+                return NO;
             }
 
             // Write children recursively
@@ -543,10 +1074,249 @@ NS_ASSUME_NONNULL_END
     }
 
     // ...and the actual application of individual transforms comes only after that.
+    return [self compactNode:node
+               withTransform:transform
+                       error:error];
+}
+
++ (id _Nullable)compactDictionary:(NSDictionary *)canonical
+                    withTransform:(id <SCIXMLCompactingTransform>)transform
+               maximumConcurrency:(NSUInteger)concurrency
+                            error:(NSError *__autoreleasing *)error {
+
+    NSParameterAssert(canonical);
+    NSParameterAssert(transform);
+
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrent();
+    SCIXMLMetricsPhase previousPhase = SCIXMLMetricsEnterPhase(metrics, SCIXMLMetricsPhaseCompact);
+    id compacted = nil;
+
+    if (concurrency <= 1) {
+        compacted = [self compactDictionary:canonical withTransform:transform error:error];
+    } else {
+        SCIXMLConcurrentCompaction context = {
+            .idleWorkers = concurrency - 1, // the calling thread is already working
+        };
+
+        compacted = [self compactDictionary:canonical
+                              withTransform:transform
+                                concurrency:&context
+                                      error:error];
+    }
+
+    SCIXMLMetricsLeavePhase(metrics, previousPhase);
+
+    return compacted;
+}
+
+// Counts the nodes in a subtree, but only up to the limit
+static NSUInteger SCIXMLSubtreeSizeUpTo(id node, NSUInteger limit) {
+    NSUInteger size = 1;
+
+    if ([node sci_isDictionary] == NO) {
+        return size;
+    }
+
+    for (id child in node[SCIXMLNodeKeyChildren]) {
+        if (size >= limit) {
+            break;
+        }
+
+        size += SCIXMLSubtreeSizeUpTo(child, limit - size);
+    }
+
+    return size;
+}
+
+// Takes as many idle workers as possible, but at most 'count'
+static NSUInteger SCIXMLAcquireWorkers(SCIXMLConcurrentCompaction *concurrency, NSUInteger count) {
+    NSInteger idle = __atomic_load_n(&concurrency->idleWorkers, __ATOMIC_RELAXED);
+
+    while (idle > 0 && count > 0) {
+        NSInteger acquired = MIN(idle, (NSInteger)count);
+
+        if (__atomic_compare_exchange_n(&concurrency->idleWorkers, &idle, idle - acquired, YES, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return acquired;
+        }
+    }
+
+    return 0;
+}
+
++ (id _Nullable)compactDictionary:(NSDictionary *)canonical
+                    withTransform:(id <SCIXMLCompactingTransform>)transform
+                      concurrency:(SCIXMLConcurrentCompaction *)concurrency
+                            error:(NSError *__autoreleasing *)error {
+
+    NSParameterAssert(canonical);
+    NSParameterAssert(transform);
+    NSParameterAssert(concurrency);
+
+    // Small subtrees are compacted serially, without further ado
+    if (SCIXMLSubtreeSizeUpTo(canonical, SCIXML_CONCURRENT_COMPACTION_THRESHOLD) < SCIXML_CONCURRENT_COMPACTION_THRESHOLD) {
+        return [self compactDictionary:canonical withTransform:transform error:error];
+    }
+
+    // never leave out error parameter uninitialized
+    if (error) {
+        *error = nil;
+    }
+
+    // Same as with serial compaction, the children are compacted first
+    NSMutableDictionary *node = [canonical sci_mutableCopyOrSelf];
+    node[SCIXMLNodeKeyChildren] = [node[SCIXMLNodeKeyChildren] sci_mutableCopyOrSelf];
+    NSMutableArray *children = node[SCIXMLNodeKeyChildren];
+    NSUInteger count = children.count;
+
+    // Only large children are worth an additional thread; small ones are
+    // distributed among the threads that are already working anyway.
+    BOOL *isLarge = calloc(count, sizeof isLarge[0]);
+    __strong id *results = (__strong id *)calloc(count, sizeof(id));
+    __strong NSError **errors = (__strong NSError **)calloc(count, sizeof(NSError *));
+
+    if (count > 0 && (isLarge == NULL || results == NULL || errors == NULL)) {
+        free(isLarge);
+        free(results);
+        free(errors);
+        return [self compactDictionary:node withTransform:transform error:error];
+    }
+
+    NSUInteger largeCount = 0;
+
+    for (NSUInteger i = 0; i < count; i++) {
+        NSUInteger size = SCIXMLSubtreeSizeUpTo(children[i], SCIXML_CONCURRENT_COMPACTION_THRESHOLD);
+        isLarge[i] = size >= SCIXML_CONCURRENT_COMPACTION_THRESHOLD;
+        largeCount += isLarge[i];
+    }
+
+    // Children are taken in document order by whichever thread is free.
+    // Once a child failed, the ones after it are skipped, but the ones before
+    // it are still compacted, so that the error reported is the one that comes
+    // first, just like when compacting serially.
+    __block NSUInteger next = 0;
+    __block NSUInteger firstFailure = count;
+
+    void (^work)(void) = ^{
+        for (
+            NSUInteger i = __atomic_fetch_add(&next, 1, __ATOMIC_RELAXED);
+            i < count && i < __atomic_load_n(&firstFailure, __ATOMIC_ACQUIRE);
+            i = __atomic_fetch_add(&next, 1, __ATOMIC_RELAXED)
+        ) {
+            @autoreleasepool {
+                NSError *childError = nil;
+                id result = isLarge[i] ? [self compactDictionary:children[i]
+                                                   withTransform:transform
+                                                     concurrency:concurrency
+                                                           error:&childError]
+                                       : [self compactDictionary:children[i]
+                                                   withTransform:transform
+                                                           error:&childError];
+
+                if (result) {
+                    results[i] = result;
+                    continue;
+                }
+
+                errors[i] = childError;
+
+                // Record the failure unless an earlier child already failed
+                NSUInteger failure = __atomic_load_n(&firstFailure, __ATOMIC_RELAXED);
+                while (i < failure && __atomic_compare_exchange_n(&firstFailure, &failure, i, YES, __ATOMIC_RELEASE, __ATOMIC_RELAXED) == NO) {
+                }
+            }
+        }
+    };
+
+    // Helpers only read the children array, and write disjoint elements of the
+    // result arrays. The array itself is only modified once they have finished.
+    NSUInteger helpers = largeCount > 1 ? SCIXMLAcquireWorkers(concurrency, largeCount - 1) : 0;
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+
+    // Helpers add the time spent in sub-transforms to the metrics of the call,
+    // atomically, but don't make it current, since nothing else is atomic
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrentForSubtransforms();
+
+    for (NSUInteger i = 0; i < helpers; i++) {
+        dispatch_group_async(group, queue, ^{
+            SCIXMLMetricsRecord *previousMetrics = SCIXMLMetricsHelpRecord(metrics);
+            work();
+            SCIXMLMetricsHelpRecord(previousMetrics);
+
+            __atomic_fetch_add(&concurrency->idleWorkers, 1, __ATOMIC_RELEASE);
+        });
+    }
+
+    work();
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+
+    BOOL success = firstFailure == count;
+
+    if (success) {
+        for (NSUInteger i = 0; i < count; i++) {
+            children[i] = results[i];
+        }
+    } else if (error) {
+        *error = errors[firstFailure];
+    }
+
+    // ARC doesn't release the elements of malloc()'d arrays by itself
+    for (NSUInteger i = 0; i < count; i++) {
+        results[i] = nil;
+        errors[i] = nil;
+    }
+
+    free(isLarge);
+    free(results);
+    free(errors);
+
+    if (success == NO) {
+        return nil;
+    }
+
+    // The node itself is compacted only after all of its children
+    return [self compactNode:node
+               withTransform:transform
+                       error:error];
+}
+
++ (id _Nullable)compactNode:(NSDictionary *)canonical
+              withTransform:(id <SCIXMLCompactingTransform>)transform
+                      error:(NSError *__autoreleasing *)error {
+
+    NSParameterAssert(canonical);
+    NSParameterAssert(transform);
+
+    // Compiled transforms run their stages in a flat loop instead
+    if ([transform isKindOfClass:SCIXMLCompiledCompactingTransform.class]) {
+        return [(SCIXMLCompiledCompactingTransform *)transform compactNode:canonical
+                                                                     error:error];
+    }
+
+    // never leave out error parameter uninitialized
+    if (error) {
+        *error = nil;
+    }
+
+    NSMutableDictionary *node = [canonical sci_mutableCopyOrSelf];
+
+    // Sub-transforms are only timed if metrics are being recorded
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrentForSubtransforms();
+    NSString *transformName = nil;
+
+    if (metrics && [transform isKindOfClass:SCIXMLCompactingTransform.class]) {
+        transformName = ((SCIXMLCompactingTransform *)transform).metricsName;
+    }
 
     // Every node has a type, ...
     if (transform.typeTransform) {
-        id value = transform.typeTransform(node[SCIXMLNodeKeyType]);
+        id value = SCIXMLMetricsCallSubtransform(
+            metrics,
+            SCIXMLSubtransformKindType,
+            transformName,
+            transform.typeTransform,
+            node[SCIXMLNodeKeyType]
+        );
 
         if ([value sci_isError]) {
             if (error) {
@@ -560,7 +1330,13 @@ NS_ASSUME_NONNULL_END
 
     // ...But not all of them have a name...
     if (node[SCIXMLNodeKeyName] && transform.nameTransform) {
-        id value = transform.nameTransform(node[SCIXMLNodeKeyName]);
+        id value = SCIXMLMetricsCallSubtransform(
+            metrics,
+            SCIXMLSubtransformKindName,
+            transformName,
+            transform.nameTransform,
+            node[SCIXMLNodeKeyName]
+        );
 
         if ([value sci_isError]) {
             if (error) {
@@ -574,7 +1350,13 @@ NS_ASSUME_NONNULL_END
 
     // ...or text contents...
     if (node[SCIXMLNodeKeyText] && transform.textTransform) {
-        id value = transform.textTransform(node[SCIXMLNodeKeyText]);
+        id value = SCIXMLMetricsCallSubtransform(
+            metrics,
+            SCIXMLSubtransformKindText,
+            transformName,
+            transform.textTransform,
+            node[SCIXMLNodeKeyText]
+        );
 
         if ([value sci_isError]) {
             if (error) {
@@ -598,7 +1380,11 @@ NS_ASSUME_NONNULL_END
         for (NSString *attrName in attributeNames) {
             assert(attrName.sci_isString);
 
-            id value = transform.attributeTransform(
+            id value = SCIXMLMetricsCallSubtransform(
+                metrics,
+                SCIXMLSubtransformKindAttribute,
+                transformName,
+                transform.attributeTransform,
                 @{
                     SCIXMLAttributeTransformKeyName:  attrName,
                     SCIXMLAttributeTransformKeyValue: attributes[attrName],
@@ -620,7 +1406,13 @@ NS_ASSUME_NONNULL_END
     // have been performed, we give the transform a last opportunity to make
     // the node even more meaningful and concise.
     if (transform.nodeTransform) {
-        id value = transform.nodeTransform(node);
+        id value = SCIXMLMetricsCallSubtransform(
+            metrics,
+            SCIXMLSubtransformKindNode,
+            transformName,
+            transform.nodeTransform,
+            node
+        );
         NSAssert(value != nil, @"nodeTransform may not return nil, only a valid object or an NSError");
 
         if ([value sci_isError]) {
@@ -904,11 +1696,23 @@ NS_ASSUME_NONNULL_END
     };
 }
 
+#pragma mark - Metrics
+
++ (id <SCIXMLMetricsDelegate> _Nullable)metricsDelegate {
+    return SCIXMLMetricsGetDelegate();
+}
+
++ (void)setMetricsDelegate:(id <SCIXMLMetricsDelegate> _Nullable)delegate {
+    SCIXMLMetricsSetDelegate(delegate);
+}
+
 #pragma mark - Parsing/Deserialization from Strings
 
 + (NSDictionary *_Nullable)canonicalDictionaryWithXMLString:(NSString *)xml
                                                       error:(NSError *__autoreleasing *)error {
 
+    SCIXML_METRICS_RECORD_CALL();
+
     NSParameterAssert(xml);
 
     NSData *data = [xml dataUsingEncoding:NSUTF8StringEncoding];
@@ -928,6 +1732,8 @@ NS_ASSUME_NONNULL_END
                          compactingTransform:(id <SCIXMLCompactingTransform>)transform
                                        error:(NSError *__autoreleasing *)error {
 
+    SCIXML_METRICS_RECORD_CALL();
+
     NSParameterAssert(xml);
     NSParameterAssert(transform);
 
@@ -950,78 +1756,476 @@ NS_ASSUME_NONNULL_END
 + (NSDictionary *_Nullable)canonicalDictionaryWithXMLData:(NSData *)xml
                                                     error:(NSError *__autoreleasing *)error {
 
-    NSParameterAssert(xml);
+    SCIXML_METRICS_RECORD_CALL();
 
-    if (error) {
-        *error = nil;
-    }
+    return [self canonicalDictionaryWithXMLData:xml
+                                        options:SCIXMLReadingOptionsNone
+                                          error:error];
+}
 
-    // Initialize parser
-    xmlParserCtxt *parser = xmlNewParserCtxt();
++ (id _Nullable)compactedObjectWithXMLData:(NSData *)xml
+                       compactingTransform:(id <SCIXMLCompactingTransform>)transform
+                                     error:(NSError *__autoreleasing *)error {
 
-    if (parser == NULL) {
-        if (error) {
-            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeParserInit];
-        }
-        return nil;
-    }
+    SCIXML_METRICS_RECORD_CALL();
 
-    // Parse text into libxml's tree representation
-    xmlDoc *doc = xmlCtxtReadMemory(
-        parser,
-        xml.bytes,
-        (int)xml.length,
-        "",
-        "UTF-8",
-        XML_PARSE_NOENT | XML_PARSE_NONET | XML_PARSE_NOBLANKS | XML_PARSE_HUGE
-    );
+    return [self compactedObjectWithXMLData:xml
+                        compactingTransform:transform
+                                    options:SCIXMLReadingOptionsNone
+                                      error:error];
+}
 
-    xmlFreeParserCtxt(parser); // does not free 'doc'
++ (NSDictionary *_Nullable)canonicalDictionaryWithXMLData:(NSData *)xml
+                                                  options:(SCIXMLReadingOptions)options
+                                                    error:(NSError *__autoreleasing *)error {
 
-    if (doc == NULL) {
-        if (error) {
-            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedXML
-                                         rawError:xmlCtxtGetLastError(parser)];
-        }
-        return nil;
-    }
+    SCIXML_METRICS_RECORD_CALL();
 
-    // Transform the libxml tree into a tree of Cocoa collections
-    xmlNode *root = xmlDocGetRootElement(doc);
-    NSDictionary *dict = [self dictionaryWithNode:root error:error];
+    return [self canonicalDictionaryWithXMLData:xml
+                                     projection:nil
+                                        options:options
+                                          error:error];
+}
 
-    xmlFreeDoc(doc);
++ (id _Nullable)compactedObjectWithXMLData:(NSData *)xml
+                       compactingTransform:(id <SCIXMLCompactingTransform>)transform
+                                   options:(SCIXMLReadingOptions)options
+                                     error:(NSError *__autoreleasing *)error {
 
-    return dict;
+    SCIXML_METRICS_RECORD_CALL();
+
+    return [self compactedObjectWithXMLData:xml
+                        compactingTransform:transform
+                                 projection:nil
+                                    options:options
+                                      error:error];
+}
+
++ (NSDictionary *_Nullable)canonicalDictionaryWithXMLData:(NSData *)xml
+                                               projection:(SCIXMLProjection *_Nullable)projection
+                                                  options:(SCIXMLReadingOptions)options
+                                                    error:(NSError *__autoreleasing *)error {
+
+    SCIXML_METRICS_RECORD_CALL();
+
+    NSParameterAssert(xml);
+
+    // Projections are applied to SAX events, so they always need the builder
+    if (projection == nil && (options & (SCIXMLReadingOptionsUseDocumentTree | SCIXMLReadingOptionsLazyTree))) {
+        return [self documentTreeCanonicalDictionaryWithXMLData:xml options:options error:error];
+    }
+
+    return [self streamingParseXMLData:xml
+                   compactingTransform:nil
+                            projection:projection
+                               options:options
+                                 error:error];
 }
 
 + (id _Nullable)compactedObjectWithXMLData:(NSData *)xml
                        compactingTransform:(id <SCIXMLCompactingTransform>)transform
+                                projection:(SCIXMLProjection *_Nullable)projection
+                                   options:(SCIXMLReadingOptions)options
                                      error:(NSError *__autoreleasing *)error {
 
+    SCIXML_METRICS_RECORD_CALL();
+
     NSParameterAssert(xml);
     NSParameterAssert(transform);
 
+    // Unless a document tree or concurrent compaction is requested, compaction is fused with parsing
+    BOOL usesDocumentTree = projection == nil && (options & SCIXMLReadingOptionsUseDocumentTree);
+
+    if (usesDocumentTree == NO && (options & SCIXMLReadingOptionsConcurrentCompaction) == 0) {
+        return [self streamingParseXMLData:xml
+                       compactingTransform:transform
+                                projection:projection
+                                   options:options
+                                     error:error];
+    }
+
+    // Compacting would access every node of a lazy tree anyway
     NSDictionary *canonicalDict = [self canonicalDictionaryWithXMLData:xml
+                                                            projection:projection
+                                                               options:options & ~SCIXMLReadingOptionsLazyTree
                                                                  error:error];
 
     if (canonicalDict == nil) {
         return nil;
     }
 
+    NSUInteger concurrency = options & SCIXMLReadingOptionsConcurrentCompaction ? NSProcessInfo.processInfo.activeProcessorCount : 1;
     return [self compactDictionary:canonicalDict
                      withTransform:transform
+                maximumConcurrency:concurrency
+                             error:error];
+}
+
+#pragma mark - Compaction of Canonical Trees
+
++ (id _Nullable)compactedObjectWithCanonicalDictionary:(NSDictionary *)dictionary
+                                   compactingTransform:(id <SCIXMLCompactingTransform>)transform
+                                    maximumConcurrency:(NSUInteger)concurrency
+                                                 error:(NSError *__autoreleasing *)error {
+
+    SCIXML_METRICS_RECORD_CALL();
+
+    NSParameterAssert(dictionary);
+    NSParameterAssert(transform);
+
+    if (concurrency == 0) {
+        concurrency = NSProcessInfo.processInfo.activeProcessorCount;
+    }
+
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrent();
+
+    if (metrics) {
+        SCIXMLMetricsCountTree(metrics, dictionary);
+    }
+
+    return [self compactDictionary:dictionary
+                     withTransform:transform
+                maximumConcurrency:concurrency
                              error:error];
 }
 
+#pragma mark - Parsing/Deserialization of Records from Streams
+
++ (BOOL)enumerateRecordsWithXMLStream:(NSInputStream *)stream
+                           recordPath:(NSArray<NSString *> *)recordPath
+                  compactingTransform:(id <SCIXMLCompactingTransform> _Nullable)transform
+                           usingBlock:(void (^)(id record, BOOL *stop))block
+                                error:(NSError *__autoreleasing *)error {
+
+    SCIXML_METRICS_RECORD_CALL();
+
+    NSParameterAssert(stream);
+    NSParameterAssert(recordPath.count > 0);
+    NSParameterAssert(block);
+
+    // never leave out error parameter uninitialized
+    if (error) {
+        *error = nil;
+    }
+
+    // Initialize parser. The encoding is detected from the first chunk.
+    xmlParserCtxt *parser = xmlCreatePushParserCtxt(NULL, NULL, NULL, 0, "");
+
+    if (parser == NULL) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeParserInit];
+        }
+        return NO;
+    }
+
+    SCIXMLTreeBuilder *builder = [SCIXMLTreeBuilder new];
+    builder.recordPath = recordPath;
+    builder.recordHandler = block;
+    [builder attachToParser:parser];
+
+    if (transform) {
+        [self installCompactingTransform:transform inBuilder:builder];
+    }
+
+    xmlCtxtUseOptions(parser, SCIXML_LIBXML_PARSER_OPTIONS);
+
+    // Only close the stream if we opened it
+    BOOL shouldCloseStream = stream.streamStatus == NSStreamStatusNotOpen;
+    if (shouldCloseStream) {
+        [stream open];
+    }
+
+    NSMutableData *buffer = [NSMutableData dataWithLength:SCIXML_STREAM_CHUNK_SIZE];
+    NSError *streamError = nil;
+
+    // Reading the stream counts as parsing
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrent();
+    SCIXMLMetricsPhase previousPhase = SCIXMLMetricsEnterPhase(metrics, SCIXMLMetricsPhaseParse);
+
+    // Feed the parser one chunk at a time. Nodes are built in the
+    // autorelease pool of the chunk in which their end tag is found,
+    // so memory usage doesn't grow with the size of the input.
+    // An empty read means end of input; it terminates the parser.
+    while (builder.error == nil && builder.stopped == NO && parser->wellFormed) {
+        NSInteger length = [stream read:buffer.mutableBytes maxLength:buffer.length];
+
+        if (length < 0) {
+            streamError = stream.streamError;
+            break;
+        }
+
+        SCIXMLMetricsAddByteCount(metrics, length);
+
+        @autoreleasepool {
+            xmlParseChunk(parser, buffer.bytes, (int)length, length == 0);
+        }
+
+        if (length == 0) {
+            break;
+        }
+    }
+
+    SCIXMLMetricsLeavePhase(metrics, previousPhase);
+    SCIXMLMetricsAddTreeCounts(metrics, builder.nodeCount, builder.attributeCount, builder.maximumDepth);
+
+    if (shouldCloseStream) {
+        [stream close];
+    }
+
+    BOOL success = NO;
+
+    // libxml reports an error once the parser has been stopped,
+    // so the builder's state needs to be checked first.
+    if (builder.error) {
+        if (error) {
+            *error = builder.error;
+        }
+    } else if (builder.stopped) {
+        success = YES;
+    } else if (streamError) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeReadFailed
+                                           format:@"could not read input stream: %@",
+                                                  streamError.localizedDescription];
+        }
+    } else if (parser->wellFormed == 0) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedXML
+                                         rawError:xmlCtxtGetLastError(parser)];
+        }
+    } else {
+        success = YES;
+    }
+
+    // The document only holds the DTD and the entity declarations, if any
+    xmlFreeDoc(parser->myDoc);
+    parser->myDoc = NULL;
+    xmlFreeParserCtxt(parser);
+
+    return success;
+}
+
++ (BOOL)enumerateRecordsWithContentsOfFile:(NSString *)path
+                                recordPath:(NSArray<NSString *> *)recordPath
+                       compactingTransform:(id <SCIXMLCompactingTransform> _Nullable)transform
+                                usingBlock:(void (^)(id record, BOOL *stop))block
+                                     error:(NSError *__autoreleasing *)error {
+
+    SCIXML_METRICS_RECORD_CALL();
+
+    NSParameterAssert(path);
+
+    NSInputStream *stream = [NSInputStream inputStreamWithFileAtPath:path];
+
+    if (stream == nil) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeReadFailed
+                                           format:@"could not open file: %@", path];
+        }
+        return NO;
+    }
+
+    return [self enumerateRecordsWithXMLStream:stream
+                                    recordPath:recordPath
+                           compactingTransform:transform
+                                    usingBlock:block
+                                         error:error];
+}
+
+#pragma mark - Snapshots of Parsed Trees
+
+static uint64_t SCIXMLSnapshotSourceHash(NSData *xml) {
+    return SCIXMLSnapshotHash(xml.bytes, xml.length, 0);
+}
+
+static uint64_t SCIXMLSnapshotConfigurationHash(NSString *configuration) {
+    const char *utf8 = configuration.UTF8String ?: "";
+    return SCIXMLSnapshotHash(utf8, strlen(utf8), 1);
+}
+
++ (NSData *_Nullable)snapshotDataWithObject:(id)object
+                                    xmlData:(NSData *)xml
+                              configuration:(NSString *)configuration
+                                      error:(NSError *__autoreleasing *)error {
+
+    SCIXML_METRICS_RECORD_CALL();
+
+    NSParameterAssert(object);
+    NSParameterAssert(xml);
+    NSParameterAssert(configuration);
+
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrent();
+    SCIXMLMetricsPhase previousPhase = SCIXMLMetricsEnterPhase(metrics, SCIXMLMetricsPhaseWrite);
+
+    NSData *data = [SCIXMLSnapshot snapshotDataWithObject:object
+                                               sourceHash:SCIXMLSnapshotSourceHash(xml)
+                                        configurationHash:SCIXMLSnapshotConfigurationHash(configuration)
+                                                    error:error];
+
+    SCIXMLMetricsLeavePhase(metrics, previousPhase);
+    SCIXMLMetricsAddByteCount(metrics, data.length);
+
+    return data;
+}
+
++ (BOOL)writeSnapshotOfObject:(id)object
+                      xmlData:(NSData *)xml
+                configuration:(NSString *)configuration
+                       toFile:(NSString *)path
+                        error:(NSError *__autoreleasing *)error {
+
+    SCIXML_METRICS_RECORD_CALL();
+
+    NSParameterAssert(path);
+
+    NSData *data = [self snapshotDataWithObject:object
+                                        xmlData:xml
+                                  configuration:configuration
+                                          error:error];
+
+    if (data == nil) {
+        return NO;
+    }
+
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrent();
+    SCIXMLMetricsPhase previousPhase = SCIXMLMetricsEnterPhase(metrics, SCIXMLMetricsPhaseWrite);
+
+    NSError *writeError = nil;
+    BOOL success = [data writeToFile:path options:NSDataWritingAtomic error:&writeError];
+
+    SCIXMLMetricsLeavePhase(metrics, previousPhase);
+
+    if (success == NO && error) {
+        *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeWriteFailed
+                                       format:@"could not write snapshot %@: %@", path, writeError.localizedDescription];
+    }
+
+    return success;
+}
+
++ (id _Nullable)objectWithSnapshotFile:(NSString *)path
+                               xmlData:(NSData *_Nullable)xml
+                         configuration:(NSString *)configuration
+                                 error:(NSError *__autoreleasing *)error {
+
+    SCIXML_METRICS_RECORD_CALL();
+
+    NSParameterAssert(path);
+    NSParameterAssert(configuration);
+
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrent();
+    SCIXMLMetricsPhase previousPhase = SCIXMLMetricsEnterPhase(metrics, SCIXMLMetricsPhaseParse);
+
+    uint64_t sourceHash = xml ? SCIXMLSnapshotSourceHash(xml) : 0;
+    NSUInteger length = 0;
+
+    id object = [SCIXMLSnapshot rootObjectWithContentsOfFile:path
+                                                  sourceHash:xml ? &sourceHash : NULL
+                                           configurationHash:SCIXMLSnapshotConfigurationHash(configuration)
+                                                      length:&length
+                                                       error:error];
+
+    SCIXMLMetricsLeavePhase(metrics, previousPhase);
+    SCIXMLMetricsAddByteCount(metrics, length);
+
+    return object;
+}
+
++ (id _Nullable)compactedObjectWithXMLData:(NSData *)xml
+                       compactingTransform:(id <SCIXMLCompactingTransform>)transform
+                                   options:(SCIXMLReadingOptions)options
+                              snapshotFile:(NSString *)path
+                             configuration:(NSString *)configuration
+                                     error:(NSError *__autoreleasing *)error {
+
+    SCIXML_METRICS_RECORD_CALL();
+
+    NSParameterAssert(xml);
+    NSParameterAssert(transform);
+    NSParameterAssert(path);
+    NSParameterAssert(configuration);
+
+    NSString *configurationWithOptions = [NSString stringWithFormat:@"%@\n%lu", configuration, (unsigned long)options];
+
+    // Any snapshot that can't be loaded, be it stale, missing or truncated, is replaced
+    id snapshot = [self objectWithSnapshotFile:path
+                                       xmlData:xml
+                                 configuration:configurationWithOptions
+                                         error:NULL];
+
+    if (snapshot) {
+        return snapshot;
+    }
+
+    id compacted = [self compactedObjectWithXMLData:xml
+                                compactingTransform:transform
+                                            options:options
+                                              error:error];
+
+    if (compacted == nil) {
+        return nil;
+    }
+
+    // A snapshot that can't be written only makes the next load slower
+    [self writeSnapshotOfObject:compacted
+                        xmlData:xml
+                  configuration:configurationWithOptions
+                         toFile:path
+                          error:NULL];
+
+    return compacted;
+}
+
 #pragma mark - Generating/Serialization into Strings
 
 + (NSString *_Nullable)xmlStringWithCanonicalDictionary:(NSDictionary *)dictionary
                                             indentation:(NSString *_Nullable)indentation
                                                   error:(NSError *__autoreleasing *)error {
 
+    SCIXML_METRICS_RECORD_CALL();
+
+    return [self xmlStringWithCanonicalDictionary:dictionary
+                                      indentation:indentation
+                                          options:SCIXMLWritingOptionsNone
+                                            error:error];
+}
+
++ (NSString *_Nullable)xmlStringWithCanonicalDictionary:(NSDictionary *)dictionary
+                                            indentation:(NSString *_Nullable)indentation
+                                                options:(SCIXMLWritingOptions)options
+                                                  error:(NSError *__autoreleasing *)error {
+
+    SCIXML_METRICS_RECORD_CALL();
+
     NSParameterAssert(dictionary);
 
+    if (options & SCIXMLWritingOptionsDirectWriter) {
+        NSUInteger length = 0;
+        char *buf = [self directBufferWithDictionary:dictionary
+                                         indentation:indentation
+                                              length:&length
+                                               error:error];
+        if (buf == NULL) {
+            return nil;
+        }
+
+        NSString *string = [[NSString alloc] initWithBytesNoCopy:buf
+                                                          length:length
+                                                        encoding:NSUTF8StringEncoding
+                                                    freeWhenDone:YES];
+
+        // if initialization fails, NSString doesn't free the buffer
+        if (string == nil) {
+            free(buf);
+
+            if (error) {
+                *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeNotUTF8Encoded];
+            }
+        }
+
+        return string;
+    }
+
     NSString *string = nil;
     NSUInteger length = 0;
     xmlChar *buf = [self bufferWithDictionary:dictionary
@@ -1067,12 +2271,20 @@ NS_ASSUME_NONNULL_END
                                         indentation:(NSString *_Nullable)indentation
                                               error:(NSError *__autoreleasing *)error {
 
+    SCIXML_METRICS_RECORD_CALL();
+
     NSParameterAssert(object);
     NSParameterAssert(transform);
 
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrent();
+    SCIXMLMetricsPhase previousPhase = SCIXMLMetricsEnterPhase(metrics, SCIXMLMetricsPhaseCanonicalize);
+
     NSDictionary *canonicalDict = [self canonicalizeObject:object
                                              withTransform:transform
                                                      error:error];
+
+    SCIXMLMetricsLeavePhase(metrics, previousPhase);
+
     if (canonicalDict == nil) {
         return nil;
     }
@@ -1086,12 +2298,52 @@ NS_ASSUME_NONNULL_END
                                           indentation:(NSString *_Nullable)indentation
                                                 error:(NSError *__autoreleasing *)error {
 
+    SCIXML_METRICS_RECORD_CALL();
+
+    return [self xmlStringWithNaturalDictionary:root
+                                    indentation:indentation
+                                        options:SCIXMLWritingOptionsNone
+                                          error:error];
+}
+
++ (NSString *_Nullable)xmlStringWithNaturalDictionary:(NSDictionary *)root
+                                          indentation:(NSString *_Nullable)indentation
+                                              options:(SCIXMLWritingOptions)options
+                                                error:(NSError *__autoreleasing *)error {
+
+    SCIXML_METRICS_RECORD_CALL();
+
     NSParameterAssert(root);
 
+    // If the direct writer fails, canonicalizing finds out why
+    if (options & SCIXMLWritingOptionsDirectWriter) {
+        NSUInteger length = 0;
+        char *buf = [self directBufferWithNaturalDictionary:root indentation:indentation length:&length];
+
+        if (buf) {
+            NSString *string = [[NSString alloc] initWithBytesNoCopy:buf
+                                                              length:length
+                                                            encoding:NSUTF8StringEncoding
+                                                        freeWhenDone:YES];
+
+            // if initialization fails, NSString doesn't free the buffer
+            if (string) {
+                return string;
+            }
+
+            free(buf);
+        }
+    }
+
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrent();
+    SCIXMLMetricsPhase previousPhase = SCIXMLMetricsEnterPhase(metrics, SCIXMLMetricsPhaseCanonicalize);
+
     // First, generate a semi-canonical representation of the root object (which is in natural format)
     NSDictionary *semiCanonical = [SCIXMLCanonicalizingTransform semiCanonicalDictionaryWithNaturalDictionary:root
                                                                                                         error:error];
 
+    SCIXMLMetricsLeavePhase(metrics, previousPhase);
+
     if (semiCanonical == nil) {
         return nil;
     }
@@ -1109,8 +2361,33 @@ NS_ASSUME_NONNULL_END
                                         indentation:(NSString *_Nullable)indentation
                                               error:(NSError *__autoreleasing *)error {
 
+    SCIXML_METRICS_RECORD_CALL();
+
+    return [self xmlDataWithCanonicalDictionary:dictionary
+                                    indentation:indentation
+                                        options:SCIXMLWritingOptionsNone
+                                          error:error];
+}
+
++ (NSData *_Nullable)xmlDataWithCanonicalDictionary:(NSDictionary *)dictionary
+                                        indentation:(NSString *_Nullable)indentation
+                                            options:(SCIXMLWritingOptions)options
+                                              error:(NSError *__autoreleasing *)error {
+
+    SCIXML_METRICS_RECORD_CALL();
+
     NSParameterAssert(dictionary);
 
+    if (options & SCIXMLWritingOptionsDirectWriter) {
+        NSUInteger length = 0;
+        char *buf = [self directBufferWithDictionary:dictionary
+                                         indentation:indentation
+                                              length:&length
+                                               error:error];
+
+        return buf ? [NSData dataWithBytesNoCopy:buf length:length freeWhenDone:YES] : nil;
+    }
+
     NSUInteger length = 0;
     xmlChar *buf = [self bufferWithDictionary:dictionary
                                   indentation:indentation
@@ -1141,12 +2418,20 @@ NS_ASSUME_NONNULL_END
                                     indentation:(NSString *_Nullable)indentation
                                           error:(NSError *__autoreleasing *)error {
 
+    SCIXML_METRICS_RECORD_CALL();
+
     NSParameterAssert(object);
     NSParameterAssert(transform);
 
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrent();
+    SCIXMLMetricsPhase previousPhase = SCIXMLMetricsEnterPhase(metrics, SCIXMLMetricsPhaseCanonicalize);
+
     NSDictionary *canonicalDict = [self canonicalizeObject:object
                                              withTransform:transform
                                                      error:error];
+
+    SCIXMLMetricsLeavePhase(metrics, previousPhase);
+
     if (canonicalDict == nil) {
         return nil;
     }
@@ -1160,12 +2445,42 @@ NS_ASSUME_NONNULL_END
                                       indentation:(NSString *_Nullable)indentation
                                             error:(NSError *__autoreleasing *)error {
 
+    SCIXML_METRICS_RECORD_CALL();
+
+    return [self xmlDataWithNaturalDictionary:root
+                                  indentation:indentation
+                                      options:SCIXMLWritingOptionsNone
+                                        error:error];
+}
+
++ (NSData *_Nullable)xmlDataWithNaturalDictionary:(NSDictionary *)root
+                                      indentation:(NSString *_Nullable)indentation
+                                          options:(SCIXMLWritingOptions)options
+                                            error:(NSError *__autoreleasing *)error {
+
+    SCIXML_METRICS_RECORD_CALL();
+
     NSParameterAssert(root);
 
+    // If the direct writer fails, canonicalizing finds out why
+    if (options & SCIXMLWritingOptionsDirectWriter) {
+        NSUInteger length = 0;
+        char *buf = [self directBufferWithNaturalDictionary:root indentation:indentation length:&length];
+
+        if (buf) {
+            return [NSData dataWithBytesNoCopy:buf length:length freeWhenDone:YES];
+        }
+    }
+
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrent();
+    SCIXMLMetricsPhase previousPhase = SCIXMLMetricsEnterPhase(metrics, SCIXMLMetricsPhaseCanonicalize);
+
     // First, generate a semi-canonical representation of the root object (which is in natural format)
     NSDictionary *semiCanonical = [SCIXMLCanonicalizingTransform semiCanonicalDictionaryWithNaturalDictionary:root
                                                                                                         error:error];
 
+    SCIXMLMetricsLeavePhase(metrics, previousPhase);
+
     if (semiCanonical == nil) {
         return nil;
     }
@@ -1177,4 +2492,242 @@ NS_ASSUME_NONNULL_END
                                       error:error];
 }
 
+#pragma mark - Generating/Serialization into Streams and Files
+
++ (BOOL)writeCanonicalDictionary:(NSDictionary *)dictionary
+                     toXMLStream:(NSOutputStream *)stream
+                     indentation:(NSString *_Nullable)indentation
+                           error:(NSError *__autoreleasing *)error {
+
+    SCIXML_METRICS_RECORD_CALL();
+
+    NSParameterAssert(dictionary);
+    NSParameterAssert(stream);
+
+    return [self writeToXMLStream:stream
+                            error:error
+                       usingBlock:^BOOL(xmlTextWriter *writer, NSError *__autoreleasing *error) {
+        return [self writeDocumentWithDictionary:dictionary
+                                     indentation:indentation
+                                          writer:writer
+                                           error:error];
+    }];
+}
+
++ (BOOL)writeCompactedObject:(id)object
+     canonicalizingTransform:(id <SCIXMLCanonicalizingTransform>)transform
+                 toXMLStream:(NSOutputStream *)stream
+                 indentation:(NSString *_Nullable)indentation
+                       error:(NSError *__autoreleasing *)error {
+
+    SCIXML_METRICS_RECORD_CALL();
+
+    NSParameterAssert(object);
+    NSParameterAssert(transform);
+
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrent();
+    SCIXMLMetricsPhase previousPhase = SCIXMLMetricsEnterPhase(metrics, SCIXMLMetricsPhaseCanonicalize);
+
+    NSDictionary *canonicalDict = [self canonicalizeObject:object
+                                             withTransform:transform
+                                                     error:error];
+
+    SCIXMLMetricsLeavePhase(metrics, previousPhase);
+
+    if (canonicalDict == nil) {
+        return NO;
+    }
+
+    return [self writeCanonicalDictionary:canonicalDict
+                              toXMLStream:stream
+                              indentation:indentation
+                                    error:error];
+}
+
++ (BOOL)writeNaturalDictionary:(NSDictionary *)root
+                   toXMLStream:(NSOutputStream *)stream
+                   indentation:(NSString *_Nullable)indentation
+                         error:(NSError *__autoreleasing *)error {
+
+    SCIXML_METRICS_RECORD_CALL();
+
+    NSParameterAssert(root);
+
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrent();
+    SCIXMLMetricsPhase previousPhase = SCIXMLMetricsEnterPhase(metrics, SCIXMLMetricsPhaseCanonicalize);
+
+    // First, generate a semi-canonical representation of the root object (which is in natural format)
+    NSDictionary *semiCanonical = [SCIXMLCanonicalizingTransform semiCanonicalDictionaryWithNaturalDictionary:root
+                                                                                                        error:error];
+
+    SCIXMLMetricsLeavePhase(metrics, previousPhase);
+
+    if (semiCanonical == nil) {
+        return NO;
+    }
+
+    // Then, canonicalize the semi-canonical dictionary
+    return [self writeCompactedObject:semiCanonical
+              canonicalizingTransform:SCIXMLCanonicalizingTransform.transformForCanonicalizingNaturalDictionary
+                          toXMLStream:stream
+                          indentation:indentation
+                                error:error];
+}
+
++ (BOOL)writeCanonicalDictionary:(NSDictionary *)dictionary
+                          toFile:(NSString *)path
+                     indentation:(NSString *_Nullable)indentation
+                           error:(NSError *__autoreleasing *)error {
+
+    SCIXML_METRICS_RECORD_CALL();
+
+    NSParameterAssert(path);
+
+    NSOutputStream *stream = [NSOutputStream outputStreamToFileAtPath:path append:NO];
+
+    if (stream == nil) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeWriterInit
+                                           format:@"could not open file: %@", path];
+        }
+        return NO;
+    }
+
+    return [self writeCanonicalDictionary:dictionary
+                              toXMLStream:stream
+                              indentation:indentation
+                                    error:error];
+}
+
++ (BOOL)writeCanonicalDictionary:(NSDictionary *)dictionary
+                toFileDescriptor:(int)fileDescriptor
+                     indentation:(NSString *_Nullable)indentation
+                           error:(NSError *__autoreleasing *)error {
+
+    SCIXML_METRICS_RECORD_CALL();
+
+    NSParameterAssert(dictionary);
+    NSParameterAssert(fileDescriptor >= 0);
+
+    SCIXMLOutputSink *sink = [[SCIXMLOutputSink alloc] initWithFileDescriptor:fileDescriptor];
+
+    return [self writeToSink:sink
+                       error:error
+                  usingBlock:^BOOL(xmlTextWriter *writer, NSError *__autoreleasing *error) {
+        return [self writeDocumentWithDictionary:dictionary
+                                     indentation:indentation
+                                          writer:writer
+                                           error:error];
+    }];
+}
+
++ (BOOL)writeRecordsToXMLStream:(NSOutputStream *)stream
+                rootElementName:(NSString *)rootName
+                     attributes:(NSDictionary<NSString *, NSString *> *_Nullable)attributes
+        canonicalizingTransform:(id <SCIXMLCanonicalizingTransform> _Nullable)transform
+                    indentation:(NSString *_Nullable)indentation
+                     usingBlock:(id _Nullable (^)(void))block
+                          error:(NSError *__autoreleasing *)error {
+
+    SCIXML_METRICS_RECORD_CALL();
+
+    NSParameterAssert(stream);
+    NSParameterAssert(rootName);
+    NSParameterAssert(block);
+
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrent();
+
+    return [self writeToXMLStream:stream
+                            error:error
+                       usingBlock:^BOOL(xmlTextWriter *writer, NSError *__autoreleasing *error) {
+
+        if ([self startDocumentWithWriter:writer indentation:indentation error:error] == NO) {
+            return NO;
+        }
+
+        if (xmlTextWriterStartElement(writer, XS(rootName.UTF8String)) < 0) {
+            if (error) {
+                *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeWriteFailed
+                                               format:@"could not start element <%@>", rootName];
+            }
+            return NO;
+        }
+
+        // Checked like the attributes of any other element
+        if (attributes && attributes.sci_isDictionary == NO) {
+            if (error) {
+                *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedTree
+                                               format:@"attributes of the root element were not a dictionary"];
+            }
+            return NO;
+        }
+
+        if (attributes && [self writeAttributes:attributes writer:writer error:error] == NO) {
+            return NO;
+        }
+
+        // Each record is released as soon as it's written.
+        // The error is kept alive outside of the autorelease pool.
+        NSError *recordError = nil;
+        BOOL success = YES;
+
+        while (success) {
+            @autoreleasepool {
+                // Producing the records is not part of any phase
+                SCIXMLMetricsPhase previousPhase = SCIXMLMetricsEnterPhase(metrics, SCIXMLMetricsNoPhase);
+                id record = block();
+                SCIXMLMetricsLeavePhase(metrics, previousPhase);
+
+                if (record == nil) {
+                    break;
+                }
+
+                if ([record sci_isError]) {
+                    recordError = record;
+                    success = NO;
+                    break;
+                }
+
+                NSDictionary *canonicalDict = record;
+
+                if (transform) {
+                    SCIXMLMetricsPhase previousPhase = SCIXMLMetricsEnterPhase(metrics, SCIXMLMetricsPhaseCanonicalize);
+
+                    canonicalDict = [self canonicalizeObject:record
+                                               withTransform:transform
+                                                       error:&recordError];
+
+                    SCIXMLMetricsLeavePhase(metrics, previousPhase);
+                }
+
+                if (metrics && canonicalDict) {
+                    SCIXMLMetricsCountTree(metrics, canonicalDict);
+                }
+
+                success = canonicalDict && [self writeXMLNode:canonicalDict
+                                                       writer:writer
+                                                        error:&recordError];
+            }
+        }
+
+        if (success == NO) {
+            if (error) {
+                *error = recordError;
+            }
+            return NO;
+        }
+
+        // Closes the root element as well
+        if (xmlTextWriterEndDocument(writer) < 0) {
+            if (error) {
+                *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeWriteFailed
+                                               format:@"could not end element </%@>", rootName];
+            }
+            return NO;
+        }
+
+        return YES;
+    }];
+}
+
 @end
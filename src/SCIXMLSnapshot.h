@@ -0,0 +1,67 @@
+//
+// SCIXMLSnapshot.h
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <stdint.h>
+
+#import <Foundation/Foundation.h>
+
+
+// Incremented whenever the layout of snapshots changes.
+// Snapshots of other versions are considered stale.
+#define SCIXML_SNAPSHOT_VERSION 1
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+// A fast, non-cryptographic 64-bit hash, used for detecting that a snapshot
+// was made from different XML or a different configuration. It reads 8 bytes
+// at a time, so hashing the input costs much less than parsing it.
+FOUNDATION_EXPORT uint64_t SCIXMLSnapshotHash(const void *bytes, NSUInteger length, uint64_t seed);
+
+// A binary image of a tree of property list-like objects (dictionaries with
+// string keys, arrays, strings, numbers, dates, data, URLs and NSNull), e.g.
+// a compacted or canonical tree, which is loaded by mapping it into memory.
+//
+// Strings are stored once in a string table, and containers are stored as
+// arrays of 64-bit values, each of which is either a small integer, a
+// constant, an index into the string table, or the offset of a record
+// describing the object. The entries of dictionaries are sorted by the UTF-8
+// bytes of their keys, so a key is found by binary search.
+//
+// A loaded snapshot is an immutable tree of dictionaries and arrays that keep
+// the mapping alive, and decode their elements when they are first accessed,
+// and then cache them. It can be read from multiple threads. Strings and data
+// are copied out of the mapping, so they can outlive the tree.
+@interface SCIXMLSnapshot : NSObject
+
+// The hashes of the XML and of the configuration are stored in the snapshot
++ (NSData *_Nullable)snapshotDataWithObject:(id)object
+                                 sourceHash:(uint64_t)sourceHash
+                          configurationHash:(uint64_t)configurationHash
+                                      error:(NSError *__autoreleasing *)error;
+
+// Fails if the snapshot was written by another version, or on a machine with
+// another byte order, or the hashes don't match. A NULL source hash is not
+// checked. Fails with SCIXMLErrorCodeMalformedSnapshot if the snapshot is
+// truncated, or its header or string table is corrupt; anything else is only
+// checked, in constant time per record, when it's decoded, which raises
+// NSInternalInconsistencyException if it's corrupt. Sets *length to the size
+// of the snapshot.
++ (id _Nullable)rootObjectWithContentsOfFile:(NSString *)path
+                                  sourceHash:(const uint64_t *_Nullable)sourceHash
+                           configurationHash:(uint64_t)configurationHash
+                                      length:(NSUInteger *)length
+                                       error:(NSError *__autoreleasing *)error;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+@end
+
+NS_ASSUME_NONNULL_END
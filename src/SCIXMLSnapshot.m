@@ -0,0 +1,930 @@
+//
+// SCIXMLSnapshot.m
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <errno.h>
+#import <fcntl.h>
+#import <pthread.h>
+#import <stdlib.h>
+#import <string.h>
+#import <unistd.h>
+#import <sys/mman.h>
+#import <sys/stat.h>
+
+#import "SCIXMLSnapshot.h"
+#import "NSError+SCIXMLSerialization.h"
+
+
+#define SCIXML_SNAPSHOT_MAGIC      "SCIXSNAP"
+#define SCIXML_SNAPSHOT_BYTE_ORDER 0x01020304u
+
+// The kind of a value is in its lowest bits, and its payload in the rest
+#define SCIXML_SNAPSHOT_TAG_BITS 4
+#define SCIXML_SNAPSHOT_TAG_MASK ((UINT64_C(1) << SCIXML_SNAPSHOT_TAG_BITS) - 1)
+
+// Integers that fit in the payload of a value are stored inline
+#define SCIXML_SNAPSHOT_INLINE_MIN (-(INT64_C(1) << (63 - SCIXML_SNAPSHOT_TAG_BITS)))
+#define SCIXML_SNAPSHOT_INLINE_MAX ((INT64_C(1) << (63 - SCIXML_SNAPSHOT_TAG_BITS)) - 1)
+
+
+// Every number is in the byte order of the machine that wrote the snapshot,
+// and every record starts at an offset that is a multiple of 8.
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t length;            // of the whole snapshot, in bytes
+    uint64_t sourceHash;
+    uint64_t configurationHash;
+    uint64_t strings;           // offset of the string table
+    uint64_t root;              // the value of the root object
+} SCIXMLSnapshotHeader;
+
+// The string table is a count followed by the offsets of the strings. Each
+// string is a length followed by its UTF-8 bytes and a terminating NUL.
+typedef NS_ENUM(uint64_t, SCIXMLSnapshotTag) {
+    SCIXMLSnapshotTagNull,
+    SCIXMLSnapshotTagFalse,
+    SCIXMLSnapshotTagTrue,
+    SCIXMLSnapshotTagInteger,    // the payload itself, sign-extended
+    SCIXMLSnapshotTagSigned,     // offset of an int64_t
+    SCIXMLSnapshotTagUnsigned,   // offset of a uint64_t
+    SCIXMLSnapshotTagDouble,     // offset of a double
+    SCIXMLSnapshotTagDate,       // offset of a double, seconds since 1970
+    SCIXMLSnapshotTagString,     // index into the string table
+    SCIXMLSnapshotTagURL,        // index of the absolute string
+    SCIXMLSnapshotTagData,       // offset of a length, followed by the bytes
+    SCIXMLSnapshotTagArray,      // offset of a count, followed by the values
+    SCIXMLSnapshotTagDictionary, // offset of a count, followed by the string
+                                 // indices of the keys, then the values
+};
+
+static inline uint64_t SCIXMLSnapshotValue(SCIXMLSnapshotTag tag, uint64_t payload) {
+    return payload << SCIXML_SNAPSHOT_TAG_BITS | tag;
+}
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SCIXMLSnapshotWriter : NSObject {
+    NSMutableData *_data;
+    NSMutableDictionary<NSString *, NSNumber *> *_stringIndices;
+    NSMutableArray<NSData *> *_strings;
+}
+
+- (NSData *_Nullable)dataWithObject:(id)object
+                         sourceHash:(uint64_t)sourceHash
+                  configurationHash:(uint64_t)configurationHash
+                              error:(NSError *__autoreleasing *)error;
+
+@end
+
+
+@interface SCIXMLSnapshot () {
+    // Strings are created under the lock, and so are containers and their
+    // elements, which create strings in turn, hence a recursive lock.
+    pthread_mutex_t _lock;
+
+    const uint8_t *_bytes;
+    NSUInteger _length;
+
+    const uint64_t *_stringOffsets;
+    NSUInteger _stringCount;
+    void *_Nullable *_Nullable _strings;
+}
+
+// Takes over the mapping, i.e. it's unmapped when the snapshot is deallocated
+- (instancetype)initWithMapping:(const void *)bytes length:(NSUInteger)length NS_DESIGNATED_INITIALIZER;
+
+// Checks everything that is needed before decoding the root object
+- (BOOL)validateWithSourceHash:(const uint64_t *_Nullable)sourceHash
+             configurationHash:(uint64_t)configurationHash
+                         error:(NSError *__autoreleasing *)error;
+
+// The record at the offset, which must be within the snapshot. A corrupt
+// snapshot raises an exception, since it's only detected when decoding.
+- (const void *)recordAtOffset:(uint64_t)offset length:(uint64_t)length;
+
+// The records of containers: the count, and a pointer to the values after it
+- (const uint64_t *)valuesAtOffset:(uint64_t)offset count:(NSUInteger *)count perElement:(NSUInteger)valuesPerElement;
+
+// The records of strings and data: the bytes after the length
+- (const uint8_t *)bytesAtOffset:(uint64_t)offset length:(NSUInteger *)length;
+
+- (const char *)UTF8StringAtIndex:(uint64_t)index length:(NSUInteger *_Nullable)length;
+- (NSString *)stringAtIndex:(uint64_t)index;
+
+- (id)objectWithValue:(uint64_t)value;
+
+// The same as -[SCIXMLLazyDocument objectInSlot:createdBy:]
+- (id)objectInSlot:(void *_Nullable *_Nonnull)slot createdBy:(id (^)(void))create;
+
+@end
+
+
+@interface SCIXMLSnapshotArray : NSArray {
+    SCIXMLSnapshot *_snapshot;
+    const uint64_t *_values;
+    NSUInteger _count;
+    void *_Nullable *_Nullable _objects;
+}
+
+- (instancetype)initWithSnapshot:(SCIXMLSnapshot *)snapshot offset:(uint64_t)offset;
+
+@end
+
+
+@interface SCIXMLSnapshotDictionary : NSDictionary {
+    SCIXMLSnapshot *_snapshot;
+    const uint64_t *_keys;
+    const uint64_t *_values;
+    NSUInteger _count;
+    void *_Nullable *_Nullable _objects;
+    void *_Nullable _allKeys;
+}
+
+- (instancetype)initWithSnapshot:(SCIXMLSnapshot *)snapshot offset:(uint64_t)offset;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+
+// Allocates the slots that cache the decoded elements of a container
+static void **SCIXMLSnapshotAllocateSlots(NSUInteger count) {
+    if (count == 0) {
+        return NULL;
+    }
+
+    void **slots = calloc(count, sizeof slots[0]);
+
+    if (slots == NULL) {
+        [NSException raise:NSMallocException format:@"could not allocate %lu slots", (unsigned long)count];
+    }
+
+    return slots;
+}
+
+static void SCIXMLSnapshotFreeSlots(void **slots, NSUInteger count) {
+    for (NSUInteger i = 0; i < count && slots; i++) {
+        (void)(__bridge_transfer id)slots[i];
+    }
+
+    free(slots);
+}
+
+static inline uint64_t SCIXMLSnapshotMix(uint64_t x) {
+    // The finalizer of SplitMix64
+    x ^= x >> 30;
+    x *= UINT64_C(0xbf58476d1ce4e5b9);
+    x ^= x >> 27;
+    x *= UINT64_C(0x94d049bb133111eb);
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t SCIXMLSnapshotHash(const void *bytes, NSUInteger length, uint64_t seed) {
+    const uint8_t *cursor = bytes;
+    const uint8_t *end = cursor + length;
+    uint64_t hash = SCIXMLSnapshotMix(seed ^ length);
+
+    // Multiplying the word doesn't depend on the hash so far, so only the
+    // xor, the rotation and the second multiplication are on the critical path
+    for (; end - cursor >= 8; cursor += 8) {
+        uint64_t word;
+        memcpy(&word, cursor, sizeof word);
+
+        hash ^= word * UINT64_C(0x9e3779b97f4a7c15);
+        hash = (hash << 31 | hash >> 33) * UINT64_C(0xff51afd7ed558ccd);
+    }
+
+    uint64_t tail = 0;
+    memcpy(&tail, cursor, end - cursor);
+
+    return SCIXMLSnapshotMix(hash ^ tail);
+}
+
+
+@implementation SCIXMLSnapshotWriter
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _data = [NSMutableData new];
+        _stringIndices = [NSMutableDictionary new];
+        _strings = [NSMutableArray new];
+    }
+    return self;
+}
+
+- (NSData *)dataWithObject:(id)object
+                sourceHash:(uint64_t)sourceHash
+         configurationHash:(uint64_t)configurationHash
+                     error:(NSError *__autoreleasing *)error {
+
+    SCIXMLSnapshotHeader header = {
+        .magic = SCIXML_SNAPSHOT_MAGIC,
+        .version = SCIXML_SNAPSHOT_VERSION,
+        .byteOrder = SCIXML_SNAPSHOT_BYTE_ORDER,
+        .sourceHash = sourceHash,
+        .configurationHash = configurationHash,
+    };
+
+    // Filled in once everything else has been written
+    [_data appendBytes:&header length:sizeof header];
+
+    uint64_t root = 0;
+
+    if ([self appendObject:object value:&root error:error] == NO) {
+        return nil;
+    }
+
+    header.strings = [self appendStringTable];
+    header.root = root;
+    header.length = _data.length;
+
+    [_data replaceBytesInRange:NSMakeRange(0, sizeof header) withBytes:&header];
+
+    return _data;
+}
+
+// Appends the bytes, pads the snapshot to a multiple of 8, and returns their offset
+- (uint64_t)appendRecord:(const void *)bytes length:(NSUInteger)length {
+    static const uint8_t padding[8] = { 0 };
+    uint64_t offset = _data.length;
+
+    [_data appendBytes:bytes length:length];
+    [_data appendBytes:padding length:(8 - _data.length % 8) % 8];
+
+    return offset;
+}
+
+- (BOOL)indexOfString:(NSString *)string index:(uint64_t *)index error:(NSError *__autoreleasing *)error {
+    NSNumber *existing = _stringIndices[string];
+
+    if (existing) {
+        *index = existing.unsignedLongLongValue;
+        return YES;
+    }
+
+    NSData *utf8 = [string dataUsingEncoding:NSUTF8StringEncoding];
+
+    if (utf8 == nil) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedTree
+                                           format:@"string can't be encoded as UTF-8: %@", string];
+        }
+        return NO;
+    }
+
+    *index = _strings.count;
+    _stringIndices[string] = @(*index);
+    [_strings addObject:utf8];
+
+    return YES;
+}
+
+- (uint64_t)appendStringTable {
+    NSUInteger count = _strings.count;
+    NSMutableData *table = [NSMutableData dataWithLength:(count + 1) * sizeof(uint64_t)];
+    uint64_t *offsets = table.mutableBytes;
+
+    offsets[0] = count;
+
+    for (NSUInteger i = 0; i < count; i++) {
+        NSData *utf8 = _strings[i];
+        uint64_t length = utf8.length;
+
+        offsets[i + 1] = [self appendRecord:&length length:sizeof length];
+        [_data appendData:utf8];
+        [self appendRecord:"" length:1]; // the terminating NUL
+    }
+
+    return [self appendRecord:table.bytes length:table.length];
+}
+
+- (BOOL)appendObject:(id)object value:(uint64_t *)value error:(NSError *__autoreleasing *)error {
+    if ([object isKindOfClass:NSString.class]) {
+        uint64_t index = 0;
+
+        if ([self indexOfString:object index:&index error:error] == NO) {
+            return NO;
+        }
+
+        *value = SCIXMLSnapshotValue(SCIXMLSnapshotTagString, index);
+        return YES;
+    }
+
+    if ([object isKindOfClass:NSNumber.class]) {
+        *value = [self valueWithNumber:object];
+        return YES;
+    }
+
+    if ([object isKindOfClass:NSDictionary.class]) {
+        return [self appendDictionary:object value:value error:error];
+    }
+
+    if ([object isKindOfClass:NSArray.class]) {
+        return [self appendArray:object value:value error:error];
+    }
+
+    if (object == NSNull.null) {
+        *value = SCIXMLSnapshotValue(SCIXMLSnapshotTagNull, 0);
+        return YES;
+    }
+
+    if ([object isKindOfClass:NSDate.class]) {
+        double interval = [object timeIntervalSince1970];
+        *value = SCIXMLSnapshotValue(SCIXMLSnapshotTagDate, [self appendRecord:&interval length:sizeof interval]);
+        return YES;
+    }
+
+    if ([object isKindOfClass:NSData.class]) {
+        uint64_t length = [object length];
+        uint64_t offset = [self appendRecord:&length length:sizeof length];
+
+        [self appendRecord:[object bytes] length:[object length]];
+
+        *value = SCIXMLSnapshotValue(SCIXMLSnapshotTagData, offset);
+        return YES;
+    }
+
+    if ([object isKindOfClass:NSURL.class]) {
+        uint64_t index = 0;
+
+        if ([self indexOfString:[object absoluteString] index:&index error:error] == NO) {
+            return NO;
+        }
+
+        *value = SCIXMLSnapshotValue(SCIXMLSnapshotTagURL, index);
+        return YES;
+    }
+
+    if (error) {
+        *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeUnimplemented
+                                       format:@"can't make a snapshot of an instance of %@",
+                                              NSStringFromClass([object class])];
+    }
+    return NO;
+}
+
+- (uint64_t)valueWithNumber:(NSNumber *)number {
+    if (number == (id)@YES || number == (id)@NO) {
+        return SCIXMLSnapshotValue(number.boolValue ? SCIXMLSnapshotTagTrue : SCIXMLSnapshotTagFalse, 0);
+    }
+
+    char type = number.objCType[0];
+
+    if (type == 'f' || type == 'd') {
+        double doubleValue = number.doubleValue;
+        return SCIXMLSnapshotValue(SCIXMLSnapshotTagDouble, [self appendRecord:&doubleValue length:sizeof doubleValue]);
+    }
+
+    if (strchr("CSILQ", type) && number.unsignedLongLongValue > INT64_MAX) {
+        uint64_t unsignedValue = number.unsignedLongLongValue;
+        return SCIXMLSnapshotValue(SCIXMLSnapshotTagUnsigned, [self appendRecord:&unsignedValue length:sizeof unsignedValue]);
+    }
+
+    int64_t signedValue = number.longLongValue;
+
+    if (signedValue >= SCIXML_SNAPSHOT_INLINE_MIN && signedValue <= SCIXML_SNAPSHOT_INLINE_MAX) {
+        return SCIXMLSnapshotValue(SCIXMLSnapshotTagInteger, (uint64_t)signedValue);
+    }
+
+    return SCIXMLSnapshotValue(SCIXMLSnapshotTagSigned, [self appendRecord:&signedValue length:sizeof signedValue]);
+}
+
+- (BOOL)appendArray:(NSArray *)array value:(uint64_t *)value error:(NSError *__autoreleasing *)error {
+    NSUInteger count = array.count;
+    NSMutableData *record = [NSMutableData dataWithLength:(count + 1) * sizeof(uint64_t)];
+    uint64_t *values = record.mutableBytes;
+
+    values[0] = count;
+
+    // The elements are written before the array that refers to them
+    for (NSUInteger i = 0; i < count; i++) {
+        if ([self appendObject:array[i] value:&values[i + 1] error:error] == NO) {
+            return NO;
+        }
+    }
+
+    *value = SCIXMLSnapshotValue(SCIXMLSnapshotTagArray, [self appendRecord:record.bytes length:record.length]);
+    return YES;
+}
+
+- (BOOL)appendDictionary:(NSDictionary *)dictionary value:(uint64_t *)value error:(NSError *__autoreleasing *)error {
+    for (id key in dictionary) {
+        if ([key isKindOfClass:NSString.class] == NO || strlen([key UTF8String] ?: "") != [key lengthOfBytesUsingEncoding:NSUTF8StringEncoding]) {
+            if (error) {
+                *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedTree
+                                               format:@"snapshot keys must be strings without NUL characters: %@", key];
+            }
+            return NO;
+        }
+    }
+
+    // In the same order as strcmp() compares them when looking them up
+    NSArray<NSString *> *keys = [dictionary.allKeys sortedArrayUsingComparator:^NSComparisonResult(NSString *lhs, NSString *rhs) {
+        int order = strcmp(lhs.UTF8String, rhs.UTF8String);
+        return order < 0 ? NSOrderedAscending : order > 0 ? NSOrderedDescending : NSOrderedSame;
+    }];
+
+    NSUInteger count = keys.count;
+    NSMutableData *record = [NSMutableData dataWithLength:(2 * count + 1) * sizeof(uint64_t)];
+    uint64_t *values = record.mutableBytes;
+
+    values[0] = count;
+
+    for (NSUInteger i = 0; i < count; i++) {
+        if ([self indexOfString:keys[i] index:&values[i + 1] error:error] == NO) {
+            return NO;
+        }
+
+        if ([self appendObject:dictionary[keys[i]] value:&values[count + i + 1] error:error] == NO) {
+            return NO;
+        }
+    }
+
+    *value = SCIXMLSnapshotValue(SCIXMLSnapshotTagDictionary, [self appendRecord:record.bytes length:record.length]);
+    return YES;
+}
+
+@end
+
+
+@implementation SCIXMLSnapshot
+
++ (NSData *)snapshotDataWithObject:(id)object
+                        sourceHash:(uint64_t)sourceHash
+                 configurationHash:(uint64_t)configurationHash
+                             error:(NSError *__autoreleasing *)error {
+
+    NSParameterAssert(object);
+
+    if (error) {
+        *error = nil;
+    }
+
+    return [[SCIXMLSnapshotWriter new] dataWithObject:object
+                                           sourceHash:sourceHash
+                                    configurationHash:configurationHash
+                                                error:error];
+}
+
++ (id)rootObjectWithContentsOfFile:(NSString *)path
+                        sourceHash:(const uint64_t *)sourceHash
+                 configurationHash:(uint64_t)configurationHash
+                            length:(NSUInteger *)length
+                             error:(NSError *__autoreleasing *)error {
+
+    NSParameterAssert(path);
+    NSParameterAssert(length);
+
+    if (error) {
+        *error = nil;
+    }
+
+    *length = 0;
+
+    int fd = open(path.fileSystemRepresentation, O_RDONLY);
+
+    if (fd < 0) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeReadFailed
+                                           format:@"could not open snapshot %@: %s", path, strerror(errno)];
+        }
+        return nil;
+    }
+
+    struct stat info;
+
+    if (fstat(fd, &info) < 0 || info.st_size < (off_t)sizeof(SCIXMLSnapshotHeader)) {
+        close(fd);
+
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedSnapshot
+                                           format:@"not a snapshot: %@", path];
+        }
+        return nil;
+    }
+
+    void *bytes = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int mmapErrno = errno;
+
+    // The mapping stays valid after closing the file
+    close(fd);
+
+    if (bytes == MAP_FAILED) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeReadFailed
+                                           format:@"could not map snapshot %@: %s", path, strerror(mmapErrno)];
+        }
+        return nil;
+    }
+
+    SCIXMLSnapshot *snapshot = [[self alloc] initWithMapping:bytes length:(NSUInteger)info.st_size];
+
+    if ([snapshot validateWithSourceHash:sourceHash configurationHash:configurationHash error:error] == NO) {
+        return nil;
+    }
+
+    *length = (NSUInteger)info.st_size;
+
+    const SCIXMLSnapshotHeader *header = bytes;
+
+    // Containers keep the snapshot alive; anything else is copied out of it
+    return [snapshot objectWithValue:header->root];
+}
+
+- (instancetype)initWithMapping:(const void *)bytes length:(NSUInteger)length {
+    NSParameterAssert(bytes);
+
+    self = [super init];
+    if (self) {
+        pthread_mutexattr_t attributes;
+        pthread_mutexattr_init(&attributes);
+        pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+        pthread_mutex_init(&_lock, &attributes);
+        pthread_mutexattr_destroy(&attributes);
+
+        _bytes = bytes;
+        _length = length;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    SCIXMLSnapshotFreeSlots(_strings, _stringCount);
+    pthread_mutex_destroy(&_lock);
+    munmap((void *)_bytes, _length);
+}
+
+- (BOOL)validateWithSourceHash:(const uint64_t *)sourceHash
+             configurationHash:(uint64_t)configurationHash
+                         error:(NSError *__autoreleasing *)error {
+
+    const SCIXMLSnapshotHeader *header = (const SCIXMLSnapshotHeader *)_bytes;
+
+    if (memcmp(header->magic, SCIXML_SNAPSHOT_MAGIC, sizeof header->magic) != 0) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedSnapshot format:@"not a snapshot"];
+        }
+        return NO;
+    }
+
+    if (header->version != SCIXML_SNAPSHOT_VERSION || header->byteOrder != SCIXML_SNAPSHOT_BYTE_ORDER) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeStaleSnapshot
+                                           format:@"snapshot of another version or byte order"];
+        }
+        return NO;
+    }
+
+    if (header->length != _length) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedSnapshot
+                                           format:@"snapshot of %llu bytes is %lu bytes long",
+                                                  (unsigned long long)header->length,
+                                                  (unsigned long)_length];
+        }
+        return NO;
+    }
+
+    if ((sourceHash && header->sourceHash != *sourceHash) || header->configurationHash != configurationHash) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeStaleSnapshot
+                                           format:@"snapshot of other XML or another configuration"];
+        }
+        return NO;
+    }
+
+    // A truncated snapshot is caught above; anything beyond the string table is
+    // only checked when decoding, so that loading doesn't touch every page.
+    uint64_t stringTable = header->strings;
+
+    if (stringTable % 8 != 0 || stringTable < sizeof *header || stringTable > _length - sizeof(uint64_t)) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedSnapshot format:@"corrupt string table"];
+        }
+        return NO;
+    }
+
+    const uint64_t *table = (const uint64_t *)(_bytes + stringTable);
+
+    if (table[0] > (_length - stringTable) / sizeof(uint64_t) - 1) {
+        if (error) {
+            *error = [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedSnapshot format:@"corrupt string table"];
+        }
+        return NO;
+    }
+
+    _stringOffsets = table + 1;
+    _stringCount = (NSUInteger)table[0];
+    _strings = SCIXMLSnapshotAllocateSlots(_stringCount);
+
+    return YES;
+}
+
+- (const void *)recordAtOffset:(uint64_t)offset length:(uint64_t)length {
+    if (offset % 8 != 0 || offset < sizeof(SCIXMLSnapshotHeader) || offset > _length || length > _length - offset) {
+        [NSException raise:NSInternalInconsistencyException
+                    format:@"corrupt snapshot: %llu bytes at offset %llu beyond its %lu bytes",
+                           (unsigned long long)length,
+                           (unsigned long long)offset,
+                           (unsigned long)_length];
+    }
+
+    return _bytes + offset;
+}
+
+- (const uint64_t *)valuesAtOffset:(uint64_t)offset count:(NSUInteger *)count perElement:(NSUInteger)valuesPerElement {
+    const uint64_t *record = [self recordAtOffset:offset length:sizeof(uint64_t)];
+
+    // Dividing instead of multiplying the count, which might overflow
+    if (record[0] > (_length - offset) / sizeof(uint64_t) / valuesPerElement) {
+        [NSException raise:NSInternalInconsistencyException
+                    format:@"corrupt snapshot: %llu elements at offset %llu",
+                           (unsigned long long)record[0],
+                           (unsigned long long)offset];
+    }
+
+    *count = (NSUInteger)record[0];
+    return [self recordAtOffset:offset length:(1 + *count * valuesPerElement) * sizeof(uint64_t)];
+}
+
+- (const uint8_t *)bytesAtOffset:(uint64_t)offset length:(NSUInteger *)length {
+    const uint64_t *record = [self recordAtOffset:offset length:sizeof(uint64_t)];
+
+    if (record[0] > _length - offset - sizeof(uint64_t)) {
+        [NSException raise:NSInternalInconsistencyException
+                    format:@"corrupt snapshot: %llu bytes at offset %llu",
+                           (unsigned long long)record[0],
+                           (unsigned long long)offset];
+    }
+
+    *length = (NSUInteger)record[0];
+    return (const uint8_t *)(record + 1);
+}
+
+- (const char *)UTF8StringAtIndex:(uint64_t)index length:(NSUInteger *)length {
+    if (index >= _stringCount) {
+        [NSException raise:NSInternalInconsistencyException
+                    format:@"corrupt snapshot: string #%llu of %lu",
+                           (unsigned long long)index,
+                           (unsigned long)_stringCount];
+    }
+
+    NSUInteger stringLength = 0;
+    const uint8_t *bytes = [self bytesAtOffset:_stringOffsets[index] length:&stringLength];
+
+    if (bytes + stringLength >= _bytes + _length || bytes[stringLength] != '\0') {
+        [NSException raise:NSInternalInconsistencyException
+                    format:@"corrupt snapshot: unterminated string #%llu", (unsigned long long)index];
+    }
+
+    if (length) {
+        *length = stringLength;
+    }
+
+    return (const char *)bytes;
+}
+
+- (NSString *)stringAtIndex:(uint64_t)index {
+    NSUInteger length = 0;
+    const char *bytes = [self UTF8StringAtIndex:index length:&length];
+
+    return [self objectInSlot:&_strings[index] createdBy:^id {
+        NSString *string = [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+
+        if (string == nil) {
+            [NSException raise:NSInternalInconsistencyException
+                        format:@"corrupt snapshot: string #%llu is not UTF-8", (unsigned long long)index];
+        }
+
+        return string;
+    }];
+}
+
+- (id)objectWithValue:(uint64_t)value {
+    uint64_t payload = value >> SCIXML_SNAPSHOT_TAG_BITS;
+
+    switch ((SCIXMLSnapshotTag)(value & SCIXML_SNAPSHOT_TAG_MASK)) {
+    case SCIXMLSnapshotTagNull:
+        return NSNull.null;
+    case SCIXMLSnapshotTagFalse:
+        return @NO;
+    case SCIXMLSnapshotTagTrue:
+        return @YES;
+    case SCIXMLSnapshotTagInteger:
+        // Sign-extends the payload
+        return @((int64_t)value >> SCIXML_SNAPSHOT_TAG_BITS);
+    case SCIXMLSnapshotTagSigned:
+        return @(*(const int64_t *)[self recordAtOffset:payload length:sizeof(int64_t)]);
+    case SCIXMLSnapshotTagUnsigned:
+        return @(*(const uint64_t *)[self recordAtOffset:payload length:sizeof(uint64_t)]);
+    case SCIXMLSnapshotTagDouble:
+        return @(*(const double *)[self recordAtOffset:payload length:sizeof(double)]);
+    case SCIXMLSnapshotTagDate:
+        return [NSDate dateWithTimeIntervalSince1970:*(const double *)[self recordAtOffset:payload length:sizeof(double)]];
+    case SCIXMLSnapshotTagString:
+        return [self stringAtIndex:payload];
+    case SCIXMLSnapshotTagURL: {
+        NSURL *URL = [NSURL URLWithString:[self stringAtIndex:payload]];
+
+        if (URL == nil) {
+            [NSException raise:NSInternalInconsistencyException
+                        format:@"corrupt snapshot: string #%llu is not a URL", (unsigned long long)payload];
+        }
+
+        return URL;
+    }
+    case SCIXMLSnapshotTagData: {
+        NSUInteger length = 0;
+        const uint8_t *bytes = [self bytesAtOffset:payload length:&length];
+        return [NSData dataWithBytes:bytes length:length];
+    }
+    case SCIXMLSnapshotTagArray:
+        return [[SCIXMLSnapshotArray alloc] initWithSnapshot:self offset:payload];
+    case SCIXMLSnapshotTagDictionary:
+        return [[SCIXMLSnapshotDictionary alloc] initWithSnapshot:self offset:payload];
+    default:
+        [NSException raise:NSInternalInconsistencyException
+                    format:@"corrupt snapshot: unknown value 0x%llx", (unsigned long long)value];
+        return nil;
+    }
+}
+
+- (id)objectInSlot:(void **)slot createdBy:(id (^)(void))create {
+    NSParameterAssert(slot);
+    NSParameterAssert(create);
+
+    void *object = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+
+    if (object) {
+        return (__bridge id)object;
+    }
+
+    pthread_mutex_lock(&_lock);
+
+    // Decoding raises on records that are out of bounds, which must not
+    // leave the snapshot locked for every later access
+    @try {
+        // Another thread may have created it in the meantime
+        object = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+
+        if (object == NULL) {
+            object = (__bridge_retained void *)create();
+            __atomic_store_n(slot, object, __ATOMIC_RELEASE);
+        }
+    } @finally {
+        pthread_mutex_unlock(&_lock);
+    }
+
+    return (__bridge id)object;
+}
+
+@end
+
+
+@implementation SCIXMLSnapshotArray
+
+- (instancetype)initWithSnapshot:(SCIXMLSnapshot *)snapshot offset:(uint64_t)offset {
+    NSParameterAssert(snapshot);
+
+    self = [super init];
+    if (self) {
+        _snapshot = snapshot;
+        _values = [snapshot valuesAtOffset:offset count:&_count perElement:1] + 1;
+        _objects = SCIXMLSnapshotAllocateSlots(_count);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    SCIXMLSnapshotFreeSlots(_objects, _count);
+}
+
+#pragma mark - NSArray primitives
+
+- (NSUInteger)count {
+    return _count;
+}
+
+- (id)objectAtIndex:(NSUInteger)index {
+    if (index >= _count) {
+        [NSException raise:NSRangeException
+                    format:@"index %lu beyond bounds [0 .. %lu)", (unsigned long)index, (unsigned long)_count];
+    }
+
+    SCIXMLSnapshot *snapshot = _snapshot;
+    uint64_t value = _values[index];
+
+    return [snapshot objectInSlot:&_objects[index] createdBy:^id {
+        return [snapshot objectWithValue:value];
+    }];
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self;
+}
+
+@end
+
+
+@implementation SCIXMLSnapshotDictionary
+
+- (instancetype)initWithSnapshot:(SCIXMLSnapshot *)snapshot offset:(uint64_t)offset {
+    NSParameterAssert(snapshot);
+
+    self = [super init];
+    if (self) {
+        _snapshot = snapshot;
+        _keys = [snapshot valuesAtOffset:offset count:&_count perElement:2] + 1;
+        _values = _keys + _count;
+        _objects = SCIXMLSnapshotAllocateSlots(_count);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    SCIXMLSnapshotFreeSlots(_objects, _count);
+    (void)(__bridge_transfer id)_allKeys;
+}
+
+- (id)objectForEntryAtIndex:(NSUInteger)index {
+    SCIXMLSnapshot *snapshot = _snapshot;
+    uint64_t value = _values[index];
+
+    return [snapshot objectInSlot:&_objects[index] createdBy:^id {
+        return [snapshot objectWithValue:value];
+    }];
+}
+
+#pragma mark - NSDictionary primitives
+
+- (NSUInteger)count {
+    return _count;
+}
+
+- (id _Nullable)objectForKey:(id)key {
+    if ([key isKindOfClass:NSString.class] == NO) {
+        return nil;
+    }
+
+    const char *needle = [key UTF8String];
+
+    if (needle == NULL) {
+        return nil;
+    }
+
+    // The keys are sorted by their UTF-8 bytes
+    NSUInteger low = 0;
+    NSUInteger high = _count;
+
+    while (low < high) {
+        NSUInteger middle = low + (high - low) / 2;
+        int order = strcmp(needle, [_snapshot UTF8StringAtIndex:_keys[middle] length:NULL]);
+
+        if (order == 0) {
+            return [self objectForEntryAtIndex:middle];
+        }
+
+        if (order < 0) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+
+    return nil;
+}
+
+- (NSEnumerator *)keyEnumerator {
+    SCIXMLSnapshot *snapshot = _snapshot;
+    const uint64_t *keys = _keys;
+    NSUInteger count = _count;
+
+    NSArray *allKeys = [snapshot objectInSlot:&_allKeys createdBy:^id {
+        NSMutableArray<NSString *> *strings = [NSMutableArray arrayWithCapacity:count];
+
+        for (NSUInteger i = 0; i < count; i++) {
+            [strings addObject:[snapshot stringAtIndex:keys[i]]];
+        }
+
+        return [strings copy];
+    }];
+
+    return allKeys.objectEnumerator;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self;
+}
+
+@end
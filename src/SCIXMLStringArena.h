@@ -0,0 +1,45 @@
+//
+// SCIXMLStringArena.h
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <Foundation/Foundation.h>
+
+#import <libxml/tree.h>
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+// Owns the characters of the strings created during a single parse.
+// Bytes are copied into large blocks by bumping a pointer, and the strings
+// refer to them without copying, so creating a string doesn't allocate
+// memory for its characters, and releasing it doesn't free any.
+//
+// Each string keeps the memory of the arena alive until it's released, so
+// strings stay valid in subtrees, copies and compacted objects even after
+// the tree, or the arena itself, is released.
+@interface SCIXMLStringArena : NSObject
+
+// Copies the UTF-8 bytes into the arena
+- (NSString *)stringWithBytes:(const void *)bytes length:(NSUInteger)length;
+
+// Doesn't copy the bytes, which must stay valid as long as the memory of the
+// arena is alive, e.g. because they are owned by a document that it has taken over.
+- (NSString *)stringWithBytesNoCopy:(const void *)bytes length:(NSUInteger)length;
+
+// The document is freed along with the memory of the arena, i.e. when
+// both the arena and all strings created by it have been deallocated.
+- (void)takeOverDocument:(xmlDoc *)document;
+
+// Number of strings created, and bytes copied into the arena
+@property (nonatomic, readonly) NSUInteger stringCount;
+@property (nonatomic, readonly) NSUInteger byteCount;
+
+@end
+
+NS_ASSUME_NONNULL_END
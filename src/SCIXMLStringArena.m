@@ -0,0 +1,178 @@
+//
+// SCIXMLStringArena.m
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <stdlib.h>
+#import <string.h>
+
+#import "SCIXMLStringArena.h"
+
+
+// Size of the blocks strings are copied into. Longer strings get a block of their own.
+#define SCIXML_ARENA_BLOCK_SIZE (64 * 1024)
+#define SCIXML_ARENA_MAX_SHARED_LENGTH (SCIXML_ARENA_BLOCK_SIZE / 8)
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+// The memory of an arena: the blocks and the document the strings refer to.
+// It's kept alive by the arena and by the deallocator of each string, so
+// that strings don't dangle when the arena is released before them.
+@interface SCIXMLStringArenaStorage : NSObject {
+@public
+    char *_Nullable *_Nullable _blocks;
+    NSUInteger _blockCount;
+    NSUInteger _blockCapacity;
+
+    xmlDoc *_Nullable _document;
+}
+
+- (char *_Nullable)allocateBlockOfSize:(NSUInteger)size;
+
+@end
+
+
+@interface SCIXMLStringArena () {
+    SCIXMLStringArenaStorage *_storage;
+
+    // Shared by all strings; it only captures the storage, not the arena
+    void (^_deallocator)(void *, NSUInteger);
+
+    // Free space in the last shared block
+    char *_Nullable _next;
+    NSUInteger _remaining;
+}
+
+@property (nonatomic, readwrite) NSUInteger stringCount;
+@property (nonatomic, readwrite) NSUInteger byteCount;
+
+- (char *_Nullable)allocate:(NSUInteger)length;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+
+@implementation SCIXMLStringArenaStorage
+
+- (void)dealloc {
+    for (NSUInteger i = 0; i < _blockCount; i++) {
+        free(_blocks[i]);
+    }
+
+    free(_blocks);
+
+    if (_document) {
+        xmlFreeDoc(_document);
+    }
+}
+
+- (char *)allocateBlockOfSize:(NSUInteger)size {
+    if (_blockCount == _blockCapacity) {
+        NSUInteger newCapacity = MAX(16, 2 * _blockCapacity);
+        char **newBlocks = realloc(_blocks, newCapacity * sizeof newBlocks[0]);
+
+        if (newBlocks == NULL) {
+            return NULL;
+        }
+
+        _blocks = newBlocks;
+        _blockCapacity = newCapacity;
+    }
+
+    char *block = malloc(size);
+
+    if (block) {
+        _blocks[_blockCount++] = block;
+    }
+
+    return block;
+}
+
+@end
+
+
+@implementation SCIXMLStringArena
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        SCIXMLStringArenaStorage *storage = [SCIXMLStringArenaStorage new];
+
+        _storage = storage;
+        _deallocator = ^(void *bytes, NSUInteger length) {
+            (void)storage;
+        };
+    }
+    return self;
+}
+
+- (NSString *)stringWithBytes:(const void *)bytes length:(NSUInteger)length {
+    NSParameterAssert(bytes || length == 0);
+
+    if (length == 0) {
+        self.stringCount += 1;
+        return @"";
+    }
+
+    char *buffer = [self allocate:length];
+
+    // If the arena is out of memory, the string owns its characters as usual
+    if (buffer == NULL) {
+        self.stringCount += 1;
+        return [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+    }
+
+    memcpy(buffer, bytes, length);
+    self.byteCount += length;
+
+    return [self stringWithBytesNoCopy:buffer length:length];
+}
+
+- (NSString *)stringWithBytesNoCopy:(const void *)bytes length:(NSUInteger)length {
+    NSParameterAssert(bytes || length == 0);
+
+    self.stringCount += 1;
+
+    return [[NSString alloc] initWithBytesNoCopy:(void *)bytes
+                                          length:length
+                                        encoding:NSUTF8StringEncoding
+                                     deallocator:_deallocator];
+}
+
+- (void)takeOverDocument:(xmlDoc *)document {
+    NSParameterAssert(document);
+    NSAssert(_storage->_document == NULL, @"arena already owns a document");
+
+    _storage->_document = document;
+}
+
+#pragma mark - Allocation
+
+- (char *)allocate:(NSUInteger)length {
+    if (length > SCIXML_ARENA_MAX_SHARED_LENGTH) {
+        return [_storage allocateBlockOfSize:length];
+    }
+
+    if (length > _remaining) {
+        _next = [_storage allocateBlockOfSize:SCIXML_ARENA_BLOCK_SIZE];
+        _remaining = _next ? SCIXML_ARENA_BLOCK_SIZE : 0;
+
+        if (_next == NULL) {
+            return NULL;
+        }
+    }
+
+    char *buffer = _next;
+    _next += length;
+    _remaining -= length;
+
+    return buffer;
+}
+
+@end
@@ -0,0 +1,90 @@
+//
+// SCIXMLTreeBuilder.h
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <Foundation/Foundation.h>
+
+#import <libxml/parser.h>
+
+#import "SCIXMLNameTable.h"
+#import "SCIXMLProjection.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+// Builds a canonical tree directly from libxml2's SAX2 events, without
+// materializing an intermediate xmlDoc. The resulting tree is identical
+// to the one that would be obtained by converting the corresponding DOM.
+@interface SCIXMLTreeBuilder : NSObject
+
+// Called on every node within the root element (including the root itself)
+// as soon as it is complete, i.e. after the finalizer has been called on all
+// of its children. The returned object replaces the node in the tree.
+// It must return nil and populate the out error parameter upon failure,
+// which stops the parser. If nil, nodes are left in canonical form.
+@property (nonatomic, copy, nullable) id _Nullable (^nodeFinalizer)(NSMutableDictionary *, NSError *__autoreleasing *);
+
+// If set, only the elements at this path are built, e.g. @[@"root", @"record"]
+// selects the 'record' children of the root element named 'root'.
+// Each of them is passed to the record handler once it's complete
+// (and finalized), then it's released; the root property remains nil.
+// Everything outside of the records is skipped.
+@property (nonatomic, copy, nullable) NSArray<NSString *> *recordPath;
+
+// Called with each record if a record path is set.
+// Setting *stop to YES stops the parser.
+@property (nonatomic, copy, nullable) void (^recordHandler)(id record, BOOL *stop);
+
+// If set, elements not selected by the projection are skipped along with
+// their subtree, before anything is built for them. With a record path,
+// it applies within the records too; paths start at the root element either
+// way. If it doesn't select the root element, and there's no record path,
+// parsing fails. Must be set before the builder is attached to a parser.
+@property (nonatomic, copy, nullable) SCIXMLProjection *projection;
+
+// If YES, nodes are built as SCIXMLCanonicalNode objects instead of
+// NSMutableDictionary instances. Must be set before parsing starts.
+@property (nonatomic, assign) BOOL usesCanonicalNodeClass;
+
+// If YES, the characters of text nodes, comments and attribute values are
+// copied into an arena, which the strings refer to without copying. Each
+// root element (or record) gets its own arena, the memory of which is kept
+// alive by its strings. Must be set before parsing starts.
+@property (nonatomic, assign) BOOL usesStringArena;
+
+// The (finalized) root element, once parsing has finished
+@property (nonatomic, readonly, nullable) id root;
+
+// Converts the names of elements, attributes and entities. Created when the
+// builder is attached to a parser, unless one is set before, e.g. one that
+// has been used with the same parser before (see SCIXMLParserContext).
+// It must be the name table of the parser's dictionary.
+@property (nonatomic, strong, nullable) SCIXMLNameTable *nameTable;
+
+// The number of nodes and attributes built so far, and the largest number
+// of elements open at the same time, including the ones not being built,
+// but not the ones within subtrees skipped because of the projection
+@property (nonatomic, readonly) NSUInteger nodeCount;
+@property (nonatomic, readonly) NSUInteger attributeCount;
+@property (nonatomic, readonly) NSUInteger maximumDepth;
+
+// YES if the record handler has stopped the parser
+@property (nonatomic, readonly) BOOL stopped;
+
+// The error that made the builder stop the parser, if any.
+// libxml's own parse errors are not reported here.
+@property (nonatomic, readonly, nullable) NSError *error;
+
+// Installs the SAX callbacks of the builder in the parser context.
+// The builder must outlive the parsing operation.
+- (void)attachToParser:(xmlParserCtxt *)parser;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,816 @@
+//
+// SCIXMLTreeBuilder.m
+// SCIXMLSerialization
+//
+// Created by Arpad Goretity
+// on 17/10/2026
+//
+// Copyright (C) SciApps.io, 2026.
+//
+
+#import <stdlib.h>
+#import <string.h>
+
+#import <libxml/parserInternals.h>
+
+#import "SCIXMLTreeBuilder.h"
+#import "SCIXMLCanonicalNode.h"
+#import "SCIXMLStringArena.h"
+#import "SCIXMLSerialization.h"
+#import "SCIXMLMetricsRecord.h"
+
+
+// Each attribute is described by 5 pointers in the array passed to startElementNs:
+// local name, prefix, URI, value and end of value, in this order.
+#define SAX2_ATTRIBUTE_STRIDE 5
+
+
+// libxml decides whether a whitespace-only run of text is an ignorable
+// "blank" node (XML_PARSE_NOBLANKS) by looking at the node currently being
+// built: its type, its name, and the type of its first and last children.
+// Since we don't build libxml nodes, we push a stand-in element onto the
+// parser's node stack instead, the child pointers of which point to stand-ins
+// too, with their type set to that of the actual first and last child.
+// This makes blank elimination behave exactly as it does with a DOM.
+typedef struct {
+    xmlNode element;
+    xmlNode firstChild;
+    xmlNode lastChild;
+
+    // The node of the projection trie matching the path of the element, if any,
+    // and whether the children of the element other than elements are built
+    NSUInteger projectionNode;
+    BOOL keepsContent;
+} SCIXMLStandInNode;
+
+// The paths of a projection are merged into a trie, the root of which
+// (at index 0) stands for the document, and its children for the root element.
+typedef struct {
+    __unsafe_unretained NSString *name; // owned by the projection
+    NSUInteger firstChild;
+    NSUInteger nextSibling;
+    BOOL kept;        // a kept path ends here
+    BOOL leadsToKept; // a kept path ends here or further down
+    BOOL dropped;     // a dropped path ends here
+} SCIXMLProjectionNode;
+
+#define SCIXMLProjectionNone NSUIntegerMax
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SCIXMLTreeBuilder () {
+    // Stand-in nodes, one per level of nesting. These are never moved once
+    // allocated, because the parser keeps pointers to them on its node stack.
+    SCIXMLStandInNode *_Nullable *_Nullable _standIns;
+    NSUInteger _standInCapacity;
+
+    // Number of elements currently open, including the ones not being built
+    NSUInteger _depth;
+
+    // Number of open elements matching the leading components of the record path
+    NSUInteger _matchedDepth;
+
+    // The trie of the projection, built when the root element starts
+    SCIXMLProjectionNode *_Nullable _projectionNodes;
+    NSUInteger _projectionNodeCount;
+    NSUInteger _projectionNodeCapacity;
+
+    // Number of elements open within a subtree that the projection skips,
+    // including its root, which is not counted by _depth
+    NSUInteger _skippedDepth;
+
+    // Accumulates the contents of the text or CDATA node being parsed,
+    // because libxml may report them in several chunks.
+    // The node type is 0 if there's no such node.
+    xmlElementType _textNodeType;
+    char *_Nullable _text;
+    NSUInteger _textLength;
+    NSUInteger _textCapacity;
+}
+
+@property (nonatomic, readwrite, nullable) id root;
+@property (nonatomic, readwrite, nullable) NSError *error;
+@property (nonatomic, readwrite) BOOL stopped;
+@property (nonatomic, readwrite) NSUInteger nodeCount;
+@property (nonatomic, readwrite) NSUInteger attributeCount;
+@property (nonatomic, readwrite) NSUInteger maximumDepth;
+
+// Owns the strings of the root element (or record) being built, if any
+@property (nonatomic, strong, nullable) SCIXMLStringArena *stringArena;
+
+// Elements currently open and being built, and their children arrays,
+// from the root (or the record) downwards.
+@property (nonatomic, strong) NSMutableArray<NSMutableDictionary *> *elementStack;
+@property (nonatomic, strong) NSMutableArray<NSMutableArray *> *childrenStack;
+
+- (void)startElement:(const xmlChar *)localname
+       numAttributes:(int)numAttributes
+        numDefaulted:(int)numDefaulted
+          attributes:(const xmlChar *_Nullable *_Nullable)attributes
+              parser:(xmlParserCtxt *)parser;
+
+- (void)endElementWithParser:(xmlParserCtxt *)parser;
+
+- (NSMutableDictionary *)attributeDictionaryWithCount:(int)count attributes:(const xmlChar *_Nullable *_Nullable)attributes;
+
+- (BOOL)selectsElement:(const xmlChar *)localname
+        projectionNode:(NSUInteger *)projectionNode
+          keepsContent:(BOOL *)keepsContent
+                parser:(xmlParserCtxt *)parser;
+
+- (BOOL)buildProjectionTrie;
+- (NSUInteger)addProjectionPath:(NSArray<NSString *> *)path leadingToKept:(BOOL)leadsToKept;
+- (NSUInteger)projectionChildOfNode:(NSUInteger)node withName:(NSString *)name;
+
+- (BOOL)isBuildingContent;
+- (BOOL)shouldBuildElement:(const xmlChar *)localname;
+- (void)handleRecord:(id)record parser:(xmlParserCtxt *)parser;
+
+- (void)appendText:(const xmlChar *)bytes
+            length:(int)length
+          nodeType:(xmlElementType)nodeType
+            parser:(xmlParserCtxt *)parser;
+
+- (void)addComment:(const xmlChar *)text parser:(xmlParserCtxt *)parser;
+- (void)addEntityReference:(const xmlChar *)name parser:(xmlParserCtxt *)parser;
+- (void)addProcessingInstructionWithParser:(xmlParserCtxt *)parser;
+
+- (void)flushTextWithParser:(xmlParserCtxt *)parser;
+- (NSMutableDictionary *)nodeWithType:(NSString *)type;
+- (NSString *)stringWithBytes:(const void *)bytes length:(NSUInteger)length;
+- (void)addChild:(NSMutableDictionary *)child parser:(xmlParserCtxt *)parser;
+- (void)appendChild:(id)child;
+- (id _Nullable)finalizeNode:(NSMutableDictionary *)node parser:(xmlParserCtxt *)parser;
+- (void)updateStandInWithChildOfType:(xmlElementType)nodeType;
+
+- (SCIXMLStandInNode *_Nullable)standInAtDepth:(NSUInteger)depth;
+
+- (void)stopParser:(xmlParserCtxt *)parser withError:(NSError *)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+
+#pragma mark - SAX2 callbacks
+
+static SCIXMLTreeBuilder *SCIXMLTreeBuilderFromContext(void *ctx) {
+    xmlParserCtxt *parser = ctx;
+    return (__bridge SCIXMLTreeBuilder *)parser->_private;
+}
+
+static void SCIXMLSAXStartElementNs(
+    void *ctx,
+    const xmlChar *localname,
+    const xmlChar *prefix,
+    const xmlChar *URI,
+    int nb_namespaces,
+    const xmlChar **namespaces,
+    int nb_attributes,
+    int nb_defaulted,
+    const xmlChar **attributes
+) {
+    [SCIXMLTreeBuilderFromContext(ctx) startElement:localname
+                                      numAttributes:nb_attributes
+                                       numDefaulted:nb_defaulted
+                                         attributes:attributes
+                                             parser:ctx];
+}
+
+static void SCIXMLSAXEndElementNs(
+    void *ctx,
+    const xmlChar *localname,
+    const xmlChar *prefix,
+    const xmlChar *URI
+) {
+    [SCIXMLTreeBuilderFromContext(ctx) endElementWithParser:ctx];
+}
+
+static void SCIXMLSAXCharacters(void *ctx, const xmlChar *ch, int len) {
+    [SCIXMLTreeBuilderFromContext(ctx) appendText:ch
+                                           length:len
+                                         nodeType:XML_TEXT_NODE
+                                           parser:ctx];
+}
+
+static void SCIXMLSAXCDATABlock(void *ctx, const xmlChar *value, int len) {
+    [SCIXMLTreeBuilderFromContext(ctx) appendText:value
+                                           length:len
+                                         nodeType:XML_CDATA_SECTION_NODE
+                                           parser:ctx];
+}
+
+static void SCIXMLSAXComment(void *ctx, const xmlChar *value) {
+    [SCIXMLTreeBuilderFromContext(ctx) addComment:value parser:ctx];
+}
+
+static void SCIXMLSAXReference(void *ctx, const xmlChar *name) {
+    [SCIXMLTreeBuilderFromContext(ctx) addEntityReference:name parser:ctx];
+}
+
+static void SCIXMLSAXProcessingInstruction(void *ctx, const xmlChar *target, const xmlChar *data) {
+    [SCIXMLTreeBuilderFromContext(ctx) addProcessingInstructionWithParser:ctx];
+}
+
+
+@implementation SCIXMLTreeBuilder
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _elementStack = [NSMutableArray new];
+        _childrenStack = [NSMutableArray new];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    for (NSUInteger i = 0; i < _standInCapacity; i++) {
+        free(_standIns[i]);
+    }
+
+    free(_standIns);
+    free(_text);
+    free(_projectionNodes);
+}
+
+- (void)attachToParser:(xmlParserCtxt *)parser {
+    NSParameterAssert(parser);
+    NSParameterAssert(parser->sax);
+
+    // Everything else (document, DTD and entity declarations) is left to
+    // the default SAX2 handlers, so that entities are substituted exactly
+    // like they are when building a DOM.
+    // Names are interned in the dictionary of the parser,
+    // so each of them is only converted into a string once.
+    if (self.nameTable == nil) {
+        self.nameTable = [[SCIXMLNameTable alloc] initWithDictionary:parser->dict];
+    }
+
+    // Record path components are compared with the name of every element
+    // outside the records, which is then mostly a pointer comparison.
+    if (self.recordPath) {
+        [self.nameTable addStrings:self.recordPath];
+    }
+
+    // The same goes for the paths and names of the projection
+    for (NSArray<NSString *> *path in self.projection.keptPaths) {
+        [self.nameTable addStrings:path];
+    }
+
+    for (NSArray<NSString *> *path in self.projection.droppedPaths) {
+        [self.nameTable addStrings:path];
+    }
+
+    if (self.projection) {
+        [self.nameTable addStrings:self.projection.droppedElementNames];
+    }
+
+    parser->_private                   = (__bridge void *)self;
+    parser->sax->startElementNs        = SCIXMLSAXStartElementNs;
+    parser->sax->endElementNs          = SCIXMLSAXEndElementNs;
+    parser->sax->characters            = SCIXMLSAXCharacters;
+    parser->sax->cdataBlock            = SCIXMLSAXCDATABlock;
+    parser->sax->comment               = SCIXMLSAXComment;
+    parser->sax->reference             = SCIXMLSAXReference;
+    parser->sax->processingInstruction = SCIXMLSAXProcessingInstruction;
+}
+
+#pragma mark - Building the tree
+
+- (void)startElement:(const xmlChar *)localname
+       numAttributes:(int)numAttributes
+        numDefaulted:(int)numDefaulted
+          attributes:(const xmlChar **)attributes
+              parser:(xmlParserCtxt *)parser {
+
+    // Nothing within a skipped subtree is looked at
+    if (_skippedDepth > 0) {
+        _skippedDepth++;
+        return;
+    }
+
+    [self flushTextWithParser:parser];
+
+    SCIXMLStandInNode *standIn = [self standInAtDepth:_depth];
+    if (standIn == NULL) {
+        [self stopParser:parser withError:[NSError SCIXMLErrorWithCode:SCIXMLErrorCodeParserInit
+                                                                format:@"could not allocate parser state"]];
+        return;
+    }
+
+    // The element itself is only added to its parent once it's complete,
+    // but the stand-in of the parent must know about it right away.
+    if (_depth > 0) {
+        [self updateStandInWithChildOfType:XML_ELEMENT_NODE];
+    }
+
+    NSUInteger projectionNode = SCIXMLProjectionNone;
+    BOOL keepsContent = YES;
+
+    if (self.projection && [self selectsElement:localname
+                                 projectionNode:&projectionNode
+                                   keepsContent:&keepsContent
+                                         parser:parser] == NO) {
+        // Not even a stand-in is pushed for the element, since libxml
+        // only looks at it when deciding about text within the element.
+        _skippedDepth = 1;
+        return;
+    }
+
+    memset(standIn, 0, sizeof *standIn);
+    standIn->element.type = XML_ELEMENT_NODE;
+    standIn->element.name = localname; // owned by the parser's dictionary
+    standIn->projectionNode = projectionNode;
+    standIn->keepsContent = keepsContent;
+
+    nodePush(parser, &standIn->element);
+    _depth++;
+    _maximumDepth = MAX(_maximumDepth, _depth);
+
+    if ([self shouldBuildElement:localname] == NO) {
+        return;
+    }
+
+    // A new root element or record
+    if (self.usesStringArena && self.elementStack.count == 0) {
+        self.stringArena = [SCIXMLStringArena new];
+    }
+
+    // Attributes defaulted from the DTD don't end up in the DOM either,
+    // unless XML_COMPLETE_ATTRS is requested (which we never do).
+    int numSpecified = numAttributes - numDefaulted;
+
+    NSMutableDictionary *element = [self nodeWithType:SCIXMLNodeTypeElement];
+    element[SCIXMLNodeKeyName] = [self.nameTable stringWithName:localname];
+
+    NSMutableArray *children = [NSMutableArray new];
+
+    element[SCIXMLNodeKeyChildren]   = children;
+    element[SCIXMLNodeKeyAttributes] = [self attributeDictionaryWithCount:numSpecified attributes:attributes];
+
+    [self.childrenStack addObject:children];
+
+    _attributeCount += [element[SCIXMLNodeKeyAttributes] count];
+
+    [self.elementStack addObject:element];
+}
+
+- (NSMutableDictionary *)attributeDictionaryWithCount:(int)count attributes:(const xmlChar **)attributes {
+    NSMutableDictionary *attributeDict = [NSMutableDictionary dictionaryWithCapacity:count];
+
+    for (int i = 0; i < count; i++) {
+        const xmlChar **attribute = attributes + i * SAX2_ATTRIBUTE_STRIDE;
+        NSString *name = [self.nameTable stringWithName:attribute[0]];
+
+        // Attributes of a DOM node are looked up by local name, so the
+        // first one wins if several of them share the same local name.
+        if (attributeDict[name] != nil) {
+            continue;
+        }
+
+        attributeDict[name] = [self stringWithBytes:attribute[3] length:attribute[4] - attribute[3]];
+    }
+
+    return attributeDict;
+}
+
+- (void)endElementWithParser:(xmlParserCtxt *)parser {
+    if (_skippedDepth > 0) {
+        _skippedDepth--;
+        return;
+    }
+
+    [self flushTextWithParser:parser];
+
+    nodePop(parser);
+    _depth--;
+    _matchedDepth = MIN(_matchedDepth, _depth);
+
+    // Elements being built are always the innermost ones,
+    // so if none of them is open, this one isn't built either.
+    if (self.elementStack.count == 0) {
+        return;
+    }
+
+    NSMutableDictionary *element = self.elementStack.lastObject;
+    [self.elementStack removeLastObject];
+
+    [self.childrenStack removeLastObject];
+
+    id node = [self finalizeNode:element parser:parser];
+    if (node == nil) {
+        return;
+    }
+
+    if (self.elementStack.count > 0) {
+        [self appendChild:node];
+        return;
+    }
+
+    // The next root element (or record) gets an arena of its own
+    self.stringArena = nil;
+
+    if (self.recordPath) {
+        [self handleRecord:node parser:parser];
+    } else {
+        self.root = node;
+    }
+}
+
+- (BOOL)isBuildingContent {
+    // Nodes outside the root element (or the records) are not part of the tree,
+    // and neither are the ones the projection doesn't keep
+    return _skippedDepth == 0 && self.elementStack.count > 0 && _standIns[_depth - 1]->keepsContent;
+}
+
+- (BOOL)shouldBuildElement:(const xmlChar *)localname {
+    // Everything within the root element or a record is built
+    if (self.recordPath == nil || self.elementStack.count > 0) {
+        return YES;
+    }
+
+    // Otherwise, the element may only start a record if all of its
+    // ancestors match the record path, and so does the element itself.
+    NSUInteger depth = _depth - 1;
+
+    if (_matchedDepth != depth || depth >= self.recordPath.count) {
+        return NO;
+    }
+
+    if ([self.recordPath[depth] isEqualToString:[self.nameTable stringWithName:localname]] == NO) {
+        return NO;
+    }
+
+    _matchedDepth = depth + 1;
+
+    return _matchedDepth == self.recordPath.count;
+}
+
+- (void)handleRecord:(id)record parser:(xmlParserCtxt *)parser {
+    BOOL stop = NO;
+
+    // Handling the records is not part of parsing
+    SCIXMLMetricsRecord *metrics = SCIXMLMetricsCurrent();
+    SCIXMLMetricsPhase previousPhase = SCIXMLMetricsEnterPhase(metrics, SCIXMLMetricsNoPhase);
+
+    @autoreleasepool {
+        self.recordHandler(record, &stop);
+    }
+
+    SCIXMLMetricsLeavePhase(metrics, previousPhase);
+
+    if (stop) {
+        self.stopped = YES;
+        xmlStopParser(parser);
+    }
+}
+
+- (void)appendText:(const xmlChar *)bytes
+            length:(int)length
+          nodeType:(xmlElementType)nodeType
+            parser:(xmlParserCtxt *)parser {
+
+    if ([self isBuildingContent] == NO) {
+        return;
+    }
+
+    // Adjacent chunks of the same type are coalesced into one node.
+    // Otherwise, the stand-in is updated right away, because libxml
+    // looks at it when deciding about the next chunk.
+    if (_textNodeType != nodeType) {
+        [self flushTextWithParser:parser];
+        [self updateStandInWithChildOfType:nodeType];
+        _textNodeType = nodeType;
+    }
+
+    NSUInteger newLength = _textLength + length;
+
+    if (newLength > _textCapacity) {
+        NSUInteger newCapacity = MAX(newLength, 2 * _textCapacity);
+        char *newText = realloc(_text, newCapacity);
+
+        if (newText == NULL) {
+            [self stopParser:parser withError:[NSError SCIXMLErrorWithCode:SCIXMLErrorCodeParserInit
+                                                                    format:@"could not allocate text buffer"]];
+            return;
+        }
+
+        _text = newText;
+        _textCapacity = newCapacity;
+    }
+
+    memcpy(_text + _textLength, bytes, length);
+    _textLength = newLength;
+}
+
+- (void)addComment:(const xmlChar *)text parser:(xmlParserCtxt *)parser {
+    if ([self isBuildingContent] == NO) {
+        return;
+    }
+
+    [self flushTextWithParser:parser];
+
+    NSMutableDictionary *node = [self nodeWithType:SCIXMLNodeTypeComment];
+    node[SCIXMLNodeKeyText] = [self stringWithBytes:text length:strlen((const char *)text)];
+
+    [self updateStandInWithChildOfType:XML_COMMENT_NODE];
+    [self addChild:node parser:parser];
+}
+
+- (void)addEntityReference:(const xmlChar *)name parser:(xmlParserCtxt *)parser {
+    if ([self isBuildingContent] == NO) {
+        return;
+    }
+
+    [self flushTextWithParser:parser];
+
+    NSMutableDictionary *node = [self nodeWithType:SCIXMLNodeTypeEntityRef];
+    node[SCIXMLNodeKeyName] = [self.nameTable stringWithName:name];
+
+    [self updateStandInWithChildOfType:XML_ENTITY_REF_NODE];
+    [self addChild:node parser:parser];
+}
+
+- (void)addProcessingInstructionWithParser:(xmlParserCtxt *)parser {
+    if ([self isBuildingContent] == NO) {
+        return;
+    }
+
+    // Processing instructions within the root element can't be
+    // represented yet, just like in the conversion of a DOM.
+    [self stopParser:parser withError:[NSError SCIXMLErrorWithCode:SCIXMLErrorCodeUnimplemented
+                                                            format:@"unhandled node type: %d", (int)XML_PI_NODE]];
+}
+
+- (void)flushTextWithParser:(xmlParserCtxt *)parser {
+    if (_textNodeType == 0) {
+        return;
+    }
+
+    NSString *text = [self stringWithBytes:_text length:_textLength];
+
+    NSString *type = _textNodeType == XML_CDATA_SECTION_NODE ? SCIXMLNodeTypeCDATA : SCIXMLNodeTypeText;
+    NSMutableDictionary *node = [self nodeWithType:type];
+    node[SCIXMLNodeKeyText] = text;
+
+    _textNodeType = 0;
+    _textLength = 0;
+
+    // The stand-in has already been updated when the first chunk arrived
+    [self addChild:node parser:parser];
+}
+
+- (NSMutableDictionary *)nodeWithType:(NSString *)type {
+    if (self.usesCanonicalNodeClass) {
+        return [SCIXMLCanonicalNode nodeWithType:type];
+    }
+
+    NSMutableDictionary *node = [NSMutableDictionary new];
+    node[SCIXMLNodeKeyType] = type;
+    return node;
+}
+
+- (NSString *)stringWithBytes:(const void *)bytes length:(NSUInteger)length {
+    if (self.stringArena) {
+        return [self.stringArena stringWithBytes:bytes length:length];
+    }
+
+    return [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+}
+
+- (void)addChild:(NSMutableDictionary *)child parser:(xmlParserCtxt *)parser {
+    id node = [self finalizeNode:child parser:parser];
+
+    if (node) {
+        [self appendChild:node];
+    }
+}
+
+- (void)appendChild:(id)child {
+    [self.childrenStack.lastObject addObject:child];
+}
+
+- (id _Nullable)finalizeNode:(NSMutableDictionary *)node parser:(xmlParserCtxt *)parser {
+    // The parser may still deliver the event being processed when it's stopped
+    if (self.error || self.stopped) {
+        return nil;
+    }
+
+    _nodeCount++;
+
+    if (self.nodeFinalizer == nil) {
+        return node;
+    }
+
+    NSError *error = nil;
+    id result = self.nodeFinalizer(node, &error);
+
+    if (result == nil) {
+        [self stopParser:parser withError:error ?: [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedTree
+                                                                          format:@"could not finalize node %p", (void *)node]];
+    }
+
+    return result;
+}
+
+- (void)updateStandInWithChildOfType:(xmlElementType)nodeType {
+    // The stand-in of the parent was allocated when the parent was opened
+    SCIXMLStandInNode *standIn = _standIns[_depth - 1];
+
+    if (standIn->element.children == NULL) {
+        standIn->firstChild.type = nodeType;
+        standIn->element.children = &standIn->firstChild;
+    }
+
+    standIn->lastChild.type = nodeType;
+    standIn->element.last = &standIn->lastChild;
+}
+
+- (SCIXMLStandInNode *_Nullable)standInAtDepth:(NSUInteger)depth {
+    if (depth >= _standInCapacity) {
+        NSUInteger newCapacity = MAX(depth + 1, 2 * _standInCapacity);
+        SCIXMLStandInNode **newStandIns = realloc(_standIns, newCapacity * sizeof newStandIns[0]);
+
+        if (newStandIns == NULL) {
+            return NULL;
+        }
+
+        for (NSUInteger i = _standInCapacity; i < newCapacity; i++) {
+            newStandIns[i] = NULL;
+        }
+
+        _standIns = newStandIns;
+        _standInCapacity = newCapacity;
+    }
+
+    // may still be NULL if the allocation fails
+    if (_standIns[depth] == NULL) {
+        _standIns[depth] = calloc(1, sizeof(SCIXMLStandInNode));
+    }
+
+    return _standIns[depth];
+}
+
+- (void)stopParser:(xmlParserCtxt *)parser withError:(NSError *)error {
+    NSParameterAssert(parser);
+    NSParameterAssert(error);
+
+    // Only the first error is reported
+    if (self.error == nil) {
+        self.error = error;
+    }
+
+    xmlStopParser(parser);
+}
+
+
+#pragma mark - Projection
+
+- (BOOL)selectsElement:(const xmlChar *)localname
+        projectionNode:(NSUInteger *)projectionNode
+          keepsContent:(BOOL *)keepsContent
+                parser:(xmlParserCtxt *)parser {
+
+    if (_projectionNodes == NULL && [self buildProjectionTrie] == NO) {
+        [self stopParser:parser withError:[NSError SCIXMLErrorWithCode:SCIXMLErrorCodeParserInit
+                                                                format:@"could not allocate parser state"]];
+        return NO;
+    }
+
+    SCIXMLProjection *projection = self.projection;
+    NSString *name = [self.nameTable stringWithName:localname];
+
+    // The state of the parent; the document keeps everything below unless there are kept paths
+    NSUInteger parent = _depth > 0 ? _standIns[_depth - 1]->projectionNode : 0;
+    BOOL parentKeepsContent = _depth > 0 ? _standIns[_depth - 1]->keepsContent : projection.keptPaths == nil;
+
+    NSUInteger node = SCIXMLProjectionNone;
+    BOOL selected = YES;
+
+    // Names are mostly compared by address (see -attachToParser:)
+    for (NSString *droppedName in projection.droppedElementNames) {
+        if (name == droppedName || [name isEqualToString:droppedName]) {
+            selected = NO;
+            break;
+        }
+    }
+
+    if (selected && parent != SCIXMLProjectionNone) {
+        node = [self projectionChildOfNode:parent withName:name];
+    }
+
+    if (selected && node != SCIXMLProjectionNone && _projectionNodes[node].dropped) {
+        selected = NO;
+    }
+
+    if (selected && parentKeepsContent == NO) {
+        // Only ancestors of kept elements, and the kept elements themselves
+        selected = node != SCIXMLProjectionNone && _projectionNodes[node].leadsToKept;
+    }
+
+    if (selected == NO) {
+        // Without a root element, there's no tree, unless there are records
+        if (_depth == 0 && self.recordPath == nil) {
+            [self stopParser:parser withError:[NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedTree
+                                                                    format:@"the projection does not select the root element '%@'", name]];
+        }
+        return NO;
+    }
+
+    *projectionNode = node;
+    *keepsContent = parentKeepsContent || _projectionNodes[node].kept;
+
+    return YES;
+}
+
+- (BOOL)buildProjectionTrie {
+    _projectionNodeCapacity = 16;
+    _projectionNodes = calloc(_projectionNodeCapacity, sizeof _projectionNodes[0]);
+
+    if (_projectionNodes == NULL) {
+        return NO;
+    }
+
+    _projectionNodes[0].firstChild = SCIXMLProjectionNone;
+    _projectionNodes[0].nextSibling = SCIXMLProjectionNone;
+    _projectionNodeCount = 1;
+
+    for (NSArray<NSString *> *path in self.projection.keptPaths) {
+        NSUInteger node = [self addProjectionPath:path leadingToKept:YES];
+
+        if (node == SCIXMLProjectionNone) {
+            return NO;
+        }
+
+        _projectionNodes[node].kept = YES;
+    }
+
+    for (NSArray<NSString *> *path in self.projection.droppedPaths) {
+        NSUInteger node = [self addProjectionPath:path leadingToKept:NO];
+
+        if (node == SCIXMLProjectionNone) {
+            return NO;
+        }
+
+        _projectionNodes[node].dropped = YES;
+    }
+
+    return YES;
+}
+
+// Returns the node at the end of the path, adding the missing ones
+- (NSUInteger)addProjectionPath:(NSArray<NSString *> *)path leadingToKept:(BOOL)leadsToKept {
+    NSUInteger node = 0;
+
+    for (NSString *name in path) {
+        NSUInteger child = [self projectionChildOfNode:node withName:name];
+
+        if (child == SCIXMLProjectionNone) {
+            if (_projectionNodeCount == _projectionNodeCapacity) {
+                NSUInteger newCapacity = 2 * _projectionNodeCapacity;
+                SCIXMLProjectionNode *newNodes = realloc(_projectionNodes, newCapacity * sizeof newNodes[0]);
+
+                if (newNodes == NULL) {
+                    return SCIXMLProjectionNone;
+                }
+
+                _projectionNodes = newNodes;
+                _projectionNodeCapacity = newCapacity;
+            }
+
+            child = _projectionNodeCount++;
+
+            _projectionNodes[child] = (SCIXMLProjectionNode){
+                .name = name,
+                .firstChild = SCIXMLProjectionNone,
+                .nextSibling = _projectionNodes[node].firstChild,
+            };
+            _projectionNodes[node].firstChild = child;
+        }
+
+        _projectionNodes[child].leadsToKept |= leadsToKept;
+        node = child;
+    }
+
+    return node;
+}
+
+- (NSUInteger)projectionChildOfNode:(NSUInteger)node withName:(NSString *)name {
+    NSUInteger child = _projectionNodes[node].firstChild;
+
+    while (child != SCIXMLProjectionNone) {
+        NSString *childName = _projectionNodes[child].name;
+
+        if (childName == name || [childName isEqualToString:name]) {
+            return child;
+        }
+
+        child = _projectionNodes[child].nextSibling;
+    }
+
+    return SCIXMLProjectionNone;
+}
+
+@end
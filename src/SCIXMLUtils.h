@@ -22,6 +22,31 @@ id SCIStringToInteger(NSString *str);
 id SCIStringToFloating(NSString *str);
 id SCIStringToNumber(NSString *str);
 
+// Parses the ISO-8601 date formats of the Date parser type. Returns nil if the
+// string is not a valid date in any of them. The common forms are parsed
+// directly; only unusual ones go through NSDateFormatter, which is slow.
+NSDate *_Nullable SCIStringToDate(NSString *str);
+// Always uses NSDateFormatter. For verifying SCIStringToDate().
+NSDate *_Nullable SCIStringToDateUsingFormatters(NSString *str);
+
+// Decodes Base-64, ignoring whitespace. Returns nil if the string is not valid
+// Base-64. Decodes the common, ASCII-only strings directly into the result,
+// using SSSE3 where available; only the rest is left to NSData.
+NSData *_Nullable SCIBase64StringToData(NSString *str);
+// Always removes whitespace with a regular expression, then uses NSData.
+// For verifying SCIBase64StringToData().
+NSData *_Nullable SCIBase64StringToDataUsingFoundation(NSString *str);
+
+// The EscapeC/UnescapeC and EscapeXML/UnescapeXML parser types. They return
+// the very same string if there's nothing to escape or unescape, which is
+// found by scanning its UTF-8 bytes with SSE2 or AVX2 where available.
+// Unescaping returns an NSError if a sequence is invalid, or if the result
+// would not be valid UTF-8.
+id SCIStringEscapeC(NSString *str);
+id SCIStringUnescapeC(NSString *str);
+id SCIStringEscapeXML(NSString *str);
+id SCIStringUnescapeXML(NSString *str);
+
 BOOL SCIDictionaryHasExactKeys(
     NSDictionary<NSString *, id> *dictionary,
     NSArray<NSString *> *keys
@@ -8,17 +8,48 @@
 // Copyright (C) SciApps.io, 2016.
 //
 
+#import <errno.h>
+#import <limits.h>
 #import <math.h>
 
+#ifdef __SSE2__
+#import <emmintrin.h>
+#endif
+
+#ifdef __SSSE3__
+#import <tmmintrin.h>
+#endif
+
+#ifdef __AVX2__
+#import <immintrin.h>
+#endif
+
 #import "SCIXMLUtils.h"
 #import "NSError+SCIXMLSerialization.h"
 #import "NSObject+SCIXMLSerialization.h"
 
 
+// Long enough for any integer, and for all but contrived floating-point numbers
+#define SCI_NUMBER_BUFFER_SIZE 64
+
+// Base-64 strings are copied out of NSString in chunks of this many characters
+#define SCI_BASE64_CHUNK_SIZE 4096
+
+// Strings are scanned for bytes to be escaped in chunks of this many bytes
+#define SCI_ESCAPE_CHUNK_SIZE 4096
+
+// Number of printable ASCII bytes that the vectorized scanners compare against
+#define SCI_ESCAPE_SPECIALS 5
+
+// The longest XML character reference accepted, including leading zeros
+#define SCI_XML_REFERENCE_MAX 32
+
+
 typedef NS_ENUM(NSUInteger, SCINumberParsingResult) {
     SCINumberParsingResultSuccess,
     SCINumberParsingResultNoConversion,
     SCINumberParsingResultOverflow,
+    SCINumberParsingResultUnsupported, // the fast scanners leave it to the general parsers
 };
 
 typedef NS_ENUM(NSUInteger, SCINumberParsingType) {
@@ -27,6 +58,14 @@ typedef NS_ENUM(NSUInteger, SCINumberParsingType) {
     SCINumberParsingTypeDouble,
 };
 
+// The result of the fast scanners; 'type' tells which value is set
+typedef struct {
+    SCINumberParsingType type;
+    long long signedValue;
+    unsigned long long unsignedValue;
+    double doubleValue;
+} SCIParsedNumber;
+
 typedef NS_ENUM(NSUInteger, BlockFlags) {
     BLOCK_HAS_COPY_DISPOSE = 1 << 25,
     BLOCK_HAS_CTOR         = 1 << 26, // helpers have C++ code
@@ -129,27 +168,26 @@ BOOL SCIBlockIsParserSubtransform(id block) {
         && [actualValueType hasPrefix:expectedValueType];
 }
 
-static const char *SCISkipBasePrefix(const char *str, unsigned base) {
+// Returns the base indicated by a 0b, 0o or 0x prefix (case-insensitively), or 0
+static unsigned SCIBaseOfPrefix(const char *str) {
     NSCParameterAssert(str);
 
-    // if the string is not at least 2 characters long, it can't have a base prefix
-    if (strlen(str) < 2) {
-        return str;
+    if (str[0] != '0') {
+        return 0;
     }
 
-    NSDictionary<NSNumber *, NSString *> *prefixes = @{
-        @2:  @"b",
-        @8:  @"o",
-        @16: @"x",
-    };
-
-    const char *prefix = prefixes[@(base)].UTF8String;
-
-    if (prefix && str[0] == '0' && tolower(str[1]) == *prefix) {
-        return str + 2;
+    switch (str[1] | 0x20) {
+    case 'b': return 2;
+    case 'o': return 8;
+    case 'x': return 16;
+    default:  return 0;
     }
+}
 
-    return str;
+static const char *SCISkipBasePrefix(const char *str, unsigned base) {
+    NSCParameterAssert(str);
+
+    return SCIBaseOfPrefix(str) == base ? str + 2 : str;
 }
 
 static NSError *SCIErrorFromNumberParsingResult(SCINumberParsingResult result, NSString *str) {
@@ -175,6 +213,167 @@ static NSError *SCIErrorFromNumberParsingResult(SCINumberParsingResult result, N
     }
 }
 
+#pragma mark - Fast scanners
+
+// The scanners below parse the most common forms of numbers in a single pass
+// over a C string, without allocating memory. They produce exactly the same
+// results as the general, strto*()-based parsers further below. Whenever that
+// would take reproducing some quirk of those (e.g. strtoull() accepting and
+// negating a minus sign), they return SCINumberParsingResultUnsupported, and
+// the general parsers are used instead.
+
+// Copies the string into the buffer as a C string, without allocating memory,
+// if it's pure ASCII, short enough, and has no leading or trailing whitespace.
+// This is the case for virtually all numbers. Otherwise returns NO.
+static BOOL SCIGetPlainASCIIString(NSString *str, char *buffer, NSUInteger size) {
+    NSCParameterAssert(buffer);
+
+    if (str.sci_isString == NO || [str getCString:buffer maxLength:size encoding:NSASCIIStringEncoding] == NO) {
+        return NO;
+    }
+
+    // The general parsers trim whitespace, then parse up to the first NUL character
+    size_t length = strlen(buffer);
+
+    return length == 0 || (isspace((unsigned char)buffer[0]) == 0 && isspace((unsigned char)buffer[length - 1]) == 0);
+}
+
+// The value of a digit or letter in bases up to 36
+static unsigned SCIDigitValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+
+    char lower = c | 0x20;
+
+    if (lower >= 'a' && lower <= 'z') {
+        return lower - 'a' + 10;
+    }
+
+    return 36;
+}
+
+// Scans as many digits of the given base as possible, and advances the cursor
+// past them. Returns the number of digits. If the value doesn't fit into an
+// unsigned long long, *overflow is set, and the value is meaningless.
+static NSUInteger SCIScanDigits(const char **cursor, unsigned base, unsigned long long *value, BOOL *overflow) {
+    const char *p = *cursor;
+    unsigned long long v = 0;
+    BOOL o = NO;
+
+    for (unsigned digit = SCIDigitValue(*p); digit < base; digit = SCIDigitValue(*++p)) {
+        if (v > (ULLONG_MAX - digit) / base) {
+            o = YES;
+        } else {
+            v = v * base + digit;
+        }
+    }
+
+    NSUInteger count = p - *cursor;
+
+    *cursor = p;
+    *value = v;
+    *overflow = o;
+
+    return count;
+}
+
+// Like strtoll(), then strtoull() if that overflows
+static SCINumberParsingResult SCIScanDecimal(const char *cstr, SCIParsedNumber *number) {
+    const char *p = cstr;
+    BOOL negative = *p == '-';
+
+    if (*p == '-' || *p == '+') {
+        p++;
+    }
+
+    unsigned long long magnitude = 0;
+    BOOL overflow = NO;
+    NSUInteger digitCount = SCIScanDigits(&p, 10, &magnitude, &overflow);
+
+    BOOL plain = digitCount > 0 && *p == '\0';
+    BOOL signedOverflow = overflow || magnitude > (unsigned long long)LLONG_MAX + negative;
+
+    // What the general parser makes of these depends on strtoull()
+    if (signedOverflow && (negative || plain == NO)) {
+        return SCINumberParsingResultUnsupported;
+    }
+
+    if (plain == NO) {
+        return SCINumberParsingResultNoConversion;
+    }
+
+    if (overflow) {
+        return SCINumberParsingResultOverflow;
+    }
+
+    if (signedOverflow) {
+        number->type = SCINumberParsingTypeUnsignedLongLong;
+        number->unsignedValue = magnitude;
+    } else {
+        number->type = SCINumberParsingTypeSignedLongLong;
+        number->signedValue = negative ? (long long)(0 - magnitude) : (long long)magnitude;
+    }
+
+    return SCINumberParsingResultSuccess;
+}
+
+// Like strtoull(), with an optional base prefix
+static SCINumberParsingResult SCIScanUnsigned(const char *cstr, unsigned base, SCIParsedNumber *number) {
+    const char *p = SCISkipBasePrefix(cstr, base);
+    unsigned long long value = 0;
+    BOOL overflow = NO;
+    NSUInteger digitCount = SCIScanDigits(&p, base, &value, &overflow);
+
+    if (digitCount == 0 || *p != '\0') {
+        return SCINumberParsingResultUnsupported;
+    }
+
+    if (overflow) {
+        return SCINumberParsingResultOverflow;
+    }
+
+    number->type = SCINumberParsingTypeUnsignedLongLong;
+    number->unsignedValue = value;
+
+    return SCINumberParsingResultSuccess;
+}
+
+// Correct rounding is best left to strtod(), which doesn't allocate either
+static SCINumberParsingResult SCIScanFloating(const char *cstr, SCIParsedNumber *number) {
+    char *end = NULL;
+    errno = 0;
+
+    double value = strtod(cstr, &end);
+
+    if (errno == ERANGE) {
+        return SCINumberParsingResultOverflow;
+    }
+
+    if (*end != '\0' || end == cstr) {
+        return SCINumberParsingResultNoConversion;
+    }
+
+    number->type = SCINumberParsingTypeDouble;
+    number->doubleValue = value;
+
+    return SCINumberParsingResultSuccess;
+}
+
+static id SCIObjectWithParsingResult(SCINumberParsingResult result, SCIParsedNumber number, NSString *str) {
+    if (result != SCINumberParsingResultSuccess) {
+        return SCIErrorFromNumberParsingResult(result, str);
+    }
+
+    switch (number.type) {
+    case SCINumberParsingTypeSignedLongLong:   return @(number.signedValue);
+    case SCINumberParsingTypeUnsignedLongLong: return @(number.unsignedValue);
+    default:                                   return @(number.doubleValue);
+    }
+}
+
+#pragma mark - General parsers
+
 static SCINumberParsingResult SCIStringToArithmetic(
     NSString *str,
     unsigned base,
@@ -271,9 +470,7 @@ static double SCIStringToDouble(NSString *str, SCINumberParsingResult *result) {
     return number;
 }
 
-NS_ASSUME_NONNULL_END
-
-id SCIStringToDecimal(NSString *str) {
+static id SCIGeneralStringToDecimal(NSString *str) {
     SCINumberParsingResult result = SCINumberParsingResultSuccess;
 
     // First, try parsing a signed number (in order to allow negatives)
@@ -299,7 +496,7 @@ id SCIStringToDecimal(NSString *str) {
     }
 }
 
-id SCIStringToUnsigned(NSString *str, unsigned base) {
+static id SCIGeneralStringToUnsigned(NSString *str, unsigned base) {
     NSCParameterAssert(str);
 
     SCINumberParsingResult result = SCINumberParsingResultSuccess;
@@ -312,7 +509,7 @@ id SCIStringToUnsigned(NSString *str, unsigned base) {
     }
 }
 
-id SCIStringToInteger(NSString *str) {
+static id SCIGeneralStringToInteger(NSString *str) {
     NSCParameterAssert(str);
 
     // First, try parsing it as a binary, octal or hexadecimal
@@ -334,15 +531,15 @@ id SCIStringToInteger(NSString *str) {
     for (NSString *prefix in prefixes) {
         if ([trimmedLowercase hasPrefix:prefix]) {
             unsigned base = prefixes[prefix].unsignedIntValue;
-            return SCIStringToUnsigned(str, base);
+            return SCIGeneralStringToUnsigned(str, base);
         }
     }
 
     // Otherwise, try parsing it as a decimal signed or unsigned integer
-    return SCIStringToDecimal(str);
+    return SCIGeneralStringToDecimal(str);
 }
 
-id SCIStringToFloating(NSString *str) {
+static id SCIGeneralStringToFloating(NSString *str) {
     NSCParameterAssert(str);
 
     SCINumberParsingResult result = SCINumberParsingResultSuccess;
@@ -355,11 +552,11 @@ id SCIStringToFloating(NSString *str) {
     }
 }
 
-id SCIStringToNumber(NSString *str) {
+static id SCIGeneralStringToNumber(NSString *str) {
     NSCParameterAssert(str);
 
     // First, try parsing the string as an integer
-    id numOrError = SCIStringToInteger(str);
+    id numOrError = SCIGeneralStringToInteger(str);
 
     // return it if the conversion succeeded
     if ([numOrError sci_isNumber]) {
@@ -367,8 +564,1103 @@ id SCIStringToNumber(NSString *str) {
     }
 
     // If it failed, however, try again assuming floating-point
-    return SCIStringToFloating(str);
+    return SCIGeneralStringToFloating(str);
+}
+
+NS_ASSUME_NONNULL_END
+
+id SCIStringToDecimal(NSString *str) {
+    char buffer[SCI_NUMBER_BUFFER_SIZE];
+    SCIParsedNumber number = { 0 };
+
+    if (SCIGetPlainASCIIString(str, buffer, sizeof buffer)) {
+        SCINumberParsingResult result = SCIScanDecimal(buffer, &number);
+
+        if (result != SCINumberParsingResultUnsupported) {
+            return SCIObjectWithParsingResult(result, number, str);
+        }
+    }
+
+    return SCIGeneralStringToDecimal(str);
+}
+
+id SCIStringToUnsigned(NSString *str, unsigned base) {
+    NSCParameterAssert(str);
+
+    char buffer[SCI_NUMBER_BUFFER_SIZE];
+    SCIParsedNumber number = { 0 };
+
+    if (SCIGetPlainASCIIString(str, buffer, sizeof buffer)) {
+        SCINumberParsingResult result = SCIScanUnsigned(buffer, base, &number);
+
+        if (result != SCINumberParsingResultUnsupported) {
+            return SCIObjectWithParsingResult(result, number, str);
+        }
+    }
+
+    return SCIGeneralStringToUnsigned(str, base);
+}
+
+id SCIStringToInteger(NSString *str) {
+    NSCParameterAssert(str);
+
+    char buffer[SCI_NUMBER_BUFFER_SIZE];
+    SCIParsedNumber number = { 0 };
+
+    // The prefix decides the base, like in the general parser
+    if (SCIGetPlainASCIIString(str, buffer, sizeof buffer)) {
+        unsigned base = SCIBaseOfPrefix(buffer);
+        SCINumberParsingResult result = base ? SCIScanUnsigned(buffer, base, &number) : SCIScanDecimal(buffer, &number);
+
+        if (result != SCINumberParsingResultUnsupported) {
+            return SCIObjectWithParsingResult(result, number, str);
+        }
+    }
+
+    return SCIGeneralStringToInteger(str);
+}
+
+id SCIStringToFloating(NSString *str) {
+    NSCParameterAssert(str);
+
+    char buffer[SCI_NUMBER_BUFFER_SIZE];
+    SCIParsedNumber number = { 0 };
+
+    if (SCIGetPlainASCIIString(str, buffer, sizeof buffer)) {
+        return SCIObjectWithParsingResult(SCIScanFloating(buffer, &number), number, str);
+    }
+
+    return SCIGeneralStringToFloating(str);
+}
+
+id SCIStringToNumber(NSString *str) {
+    NSCParameterAssert(str);
+
+    char buffer[SCI_NUMBER_BUFFER_SIZE];
+    SCIParsedNumber number = { 0 };
+
+    // Scanning the string as an integer also finds out whether it is one.
+    // If it isn't (or it overflows), it's parsed as floating-point instead,
+    // which is what happens to it in the general parser, too.
+    if (SCIGetPlainASCIIString(str, buffer, sizeof buffer)) {
+        unsigned base = SCIBaseOfPrefix(buffer);
+        SCINumberParsingResult result = base ? SCIScanUnsigned(buffer, base, &number) : SCIScanDecimal(buffer, &number);
+
+        if (result == SCINumberParsingResultSuccess) {
+            return SCIObjectWithParsingResult(result, number, str);
+        }
+
+        if (result != SCINumberParsingResultUnsupported) {
+            return SCIObjectWithParsingResult(SCIScanFloating(buffer, &number), number, str);
+        }
+    }
+
+    return SCIGeneralStringToNumber(str);
+}
+
+#pragma mark - Dates
+
+// Common date formats resembling ISO-8601 full date and time, tried in order
+static NSArray<NSDateFormatter *> *SCIDateFormatters(void) {
+    // Creating a date formatter is expensive - formatters should be re-used
+    static NSArray<NSDateFormatter *> *dateFormatters;
+    static dispatch_once_t token;
+
+    dispatch_once(&token, ^{
+        NSArray<NSString *> *dateFormats = @[
+            @"yyyy'-'MM'-'dd'T'HH':'mm':'ss.SZ",
+            @"yyyy'-'MM'-'dd'T'HH':'mm':'ss.S",
+            @"yyyy'-'MM'-'dd'T'HH':'mm':'ssZ",
+            @"yyyy'-'MM'-'dd'T'HH':'mm':'ss",
+        ];
+
+        NSMutableArray<NSDateFormatter *> *mutableDateFormatters =
+            [NSMutableArray arrayWithCapacity:dateFormats.count];
+
+        for (NSString *dateFormat in dateFormats) {
+            NSDateFormatter *dateFormatter = [NSDateFormatter new];
+            dateFormatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+            dateFormatter.timeZone = [NSTimeZone timeZoneWithName:@"UTC"];
+            dateFormatter.dateFormat = dateFormat;
+            [mutableDateFormatters addObject:dateFormatter];
+        }
+
+        dateFormatters = mutableDateFormatters;
+    });
+
+    return dateFormatters;
+}
+
+// Scans exactly 'count' decimal digits, and advances the cursor past them
+static BOOL SCIScanFixedDigits(const char **cursor, NSUInteger count, unsigned *value) {
+    const char *p = *cursor;
+    unsigned v = 0;
+
+    for (NSUInteger i = 0; i < count; i++, p++) {
+        if (*p < '0' || *p > '9') {
+            return NO;
+        }
+
+        v = v * 10 + (*p - '0');
+    }
+
+    *cursor = p;
+    *value = v;
+
+    return YES;
+}
+
+static unsigned SCIDaysInMonth(unsigned year, unsigned month) {
+    static const unsigned char days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    BOOL leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+
+    return month == 2 && leap ? 29 : days[month - 1];
+}
+
+// Days since 01/01/1970 in the Gregorian calendar, for years after 0 AD
+static long long SCIDaysSinceEpoch(unsigned year, unsigned month, unsigned day) {
+    // Years starting in March put the leap day at their end
+    long long y = (long long)year - (month <= 2);
+    long long m = month;
+    long long era = y / 400;
+    long long yearOfEra = y - era * 400;
+    long long dayOfYear = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + day - 1;
+    long long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+
+    return era * 146097 + dayOfEra - 719468;
+}
+
+// Recognizes all the formats of SCIDateFormatters() in a single pass:
+// yyyy-MM-ddTHH:mm:ss, optionally followed by 1 to 3 digits of fractional
+// seconds, then optionally by 'Z' or a UTC offset of the form +hh:mm or +hhmm.
+// Computes the milliseconds since 1970 like the formatters do, which also
+// count in milliseconds, and which assume UTC unless an offset is given.
+// Returns NO for anything else, including out-of-range fields and dates
+// before 1583, which the formatters put in the Julian calendar; whether and
+// how those are parsed is left to the formatters.
+static BOOL SCIScanDate(const char *cstr, long long *milliseconds) {
+    const char *p = cstr;
+    unsigned year, month, day, hour, minute, second;
+    unsigned fraction = 0;
+    long long offset = 0;
+
+    BOOL scanned = SCIScanFixedDigits(&p, 4, &year)   && *p++ == '-'
+                && SCIScanFixedDigits(&p, 2, &month)  && *p++ == '-'
+                && SCIScanFixedDigits(&p, 2, &day)    && *p++ == 'T'
+                && SCIScanFixedDigits(&p, 2, &hour)   && *p++ == ':'
+                && SCIScanFixedDigits(&p, 2, &minute) && *p++ == ':'
+                && SCIScanFixedDigits(&p, 2, &second);
+
+    if (scanned == NO) {
+        return NO;
+    }
+
+    if (*p == '.') {
+        p++;
+
+        NSUInteger digits = 0;
+
+        for (; *p >= '0' && *p <= '9'; p++, digits++) {
+            fraction = fraction * 10 + (*p - '0');
+        }
+
+        if (digits < 1 || digits > 3) {
+            return NO;
+        }
+
+        for (; digits < 3; digits++) {
+            fraction *= 10;
+        }
+    }
+
+    if (*p == 'Z') {
+        p++;
+    } else if (*p == '+' || *p == '-') {
+        BOOL negative = *p++ == '-';
+        unsigned offsetHours, offsetMinutes;
+
+        if (SCIScanFixedDigits(&p, 2, &offsetHours) == NO) {
+            return NO;
+        }
+
+        if (*p == ':') {
+            p++;
+        }
+
+        if (SCIScanFixedDigits(&p, 2, &offsetMinutes) == NO || offsetHours > 18 || offsetMinutes > 59) {
+            return NO;
+        }
+
+        offset = (offsetHours * 60 + offsetMinutes) * 60;
+        offset = negative ? -offset : offset;
+    }
+
+    if (*p != '\0') {
+        return NO;
+    }
+
+    if (year < 1583
+     || month < 1 || month > 12
+     || day < 1 || day > SCIDaysInMonth(year, month)
+     || hour > 23 || minute > 59 || second > 59) {
+        return NO;
+    }
+
+    long long seconds = SCIDaysSinceEpoch(year, month, day) * 86400 + hour * 3600 + minute * 60 + second - offset;
+
+    *milliseconds = seconds * 1000 + fraction;
+
+    return YES;
+}
+
+NSDate *SCIStringToDateUsingFormatters(NSString *str) {
+    NSCParameterAssert(str);
+
+    for (NSDateFormatter *dateFormatter in SCIDateFormatters()) {
+        NSDate *date = [dateFormatter dateFromString:str];
+
+        if (date) {
+            return date;
+        }
+    }
+
+    return nil;
+}
+
+NSDate *SCIStringToDate(NSString *str) {
+    NSCParameterAssert(str);
+
+    char buffer[SCI_NUMBER_BUFFER_SIZE];
+    long long milliseconds = 0;
+
+    if (SCIGetPlainASCIIString(str, buffer, sizeof buffer) && SCIScanDate(buffer, &milliseconds)) {
+        return [NSDate dateWithTimeIntervalSince1970:milliseconds / 1000.0];
+    }
+
+    return SCIStringToDateUsingFormatters(str);
+}
+
+#pragma mark - Base-64
+
+// Values of characters that are not digits of Base-64
+enum {
+    SCIBase64Whitespace = 0x40,
+    SCIBase64Padding    = 0x41,
+    SCIBase64Invalid    = 0xFF,
+};
+
+// The state of decoding a string one chunk at a time
+typedef struct {
+    uint8_t *output;  // where the next decoded byte goes
+    uint32_t bits;    // the digits of the current, incomplete quantum
+    unsigned count;   // the number of those digits
+    unsigned padding; // the number of '=' characters seen
+} SCIBase64Decoder;
+
+// Maps each character to the value of the Base-64 digit, or to one of the
+// above. Whitespace is the ASCII subset of what the regular expression '\s'
+// matches, i.e. what SCIBase64StringToDataUsingFoundation() removes.
+static const uint8_t *SCIBase64DecodingTable(void) {
+    static uint8_t table[256];
+    static dispatch_once_t token;
+
+    dispatch_once(&token, ^{
+        const char *digits = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        memset(table, SCIBase64Invalid, sizeof table);
+
+        for (unsigned i = 0; i < 64; i++) {
+            table[(uint8_t)digits[i]] = i;
+        }
+
+        table['='] = SCIBase64Padding;
+        table[' '] = table['\t'] = table['\n'] = table['\f'] = table['\r'] = SCIBase64Whitespace;
+    });
+
+    return table;
+}
+
+#ifdef __SSSE3__
+// Decodes 16 Base-64 digits into 12 bytes, but stores 16 bytes to the output.
+// Returns NO, without storing anything, if any of the characters is not a digit.
+// Characters are classified by their high and low nibbles using lookup tables,
+// then turned into digit values by adding an offset that depends on their range.
+static BOOL SCIBase64DecodeBlock(const uint8_t *input, uint8_t *output) {
+    const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                          0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask2F = _mm_set1_epi8(0x2F);
+
+    __m128i chars = _mm_loadu_si128((const __m128i *)input);
+    __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(chars, 4), mask2F);
+    __m128i loNibbles = _mm_and_si128(chars, mask2F);
+    __m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+    __m128i lo = _mm_shuffle_epi8(lutLo, loNibbles);
+
+    if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0) {
+        return NO;
+    }
+
+    // '/' is the only character in its range
+    __m128i eq2F = _mm_cmpeq_epi8(chars, mask2F);
+    __m128i roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(eq2F, hiNibbles));
+    __m128i values = _mm_add_epi8(chars, roll);
+
+    // Pack 4 x 6 bits into 3 bytes, first within 16-bit, then within 32-bit lanes
+    __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    __m128i quads = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    __m128i bytes = _mm_shuffle_epi8(quads, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+    _mm_storeu_si128((__m128i *)output, bytes);
+
+    return YES;
 }
+#endif
+
+// Decodes the next chunk of characters. Runs of digits are decoded a block or
+// a quantum at a time; whitespace and padding one character at a time.
+// Returns NO if the characters are not canonical Base-64, i.e. contain anything
+// other than digits, whitespace and at most 2 padding characters at the end.
+static BOOL SCIBase64DecodeChunk(SCIBase64Decoder *decoder, const uint8_t *p, const uint8_t *end) {
+    const uint8_t *table = SCIBase64DecodingTable();
+    uint8_t *o = decoder->output;
+
+    while (p < end) {
+        if (decoder->count == 0 && decoder->padding == 0) {
+#ifdef __SSSE3__
+            while (end - p >= 16 && SCIBase64DecodeBlock(p, o)) {
+                p += 16;
+                o += 12;
+            }
+#endif
+            while (end - p >= 4) {
+                uint8_t a = table[p[0]], b = table[p[1]], c = table[p[2]], d = table[p[3]];
+
+                // Not a digit
+                if ((a | b | c | d) & 0xC0) {
+                    break;
+                }
+
+                o[0] = a << 2 | b >> 4;
+                o[1] = b << 4 | c >> 2;
+                o[2] = c << 6 | d;
+
+                p += 4;
+                o += 3;
+            }
+
+            if (p == end) {
+                break;
+            }
+        }
+
+        uint8_t value = table[*p++];
+
+        if (value < 64) {
+            if (decoder->padding > 0) {
+                return NO;
+            }
+
+            decoder->bits = decoder->bits << 6 | value;
+
+            if (++decoder->count == 4) {
+                o[0] = decoder->bits >> 16;
+                o[1] = decoder->bits >> 8;
+                o[2] = decoder->bits;
+                o += 3;
+
+                decoder->bits = 0;
+                decoder->count = 0;
+            }
+        } else if (value == SCIBase64Padding) {
+            if (decoder->count < 2 || decoder->count + ++decoder->padding > 4) {
+                return NO;
+            }
+        } else if (value != SCIBase64Whitespace) {
+            return NO;
+        }
+    }
+
+    decoder->output = o;
+
+    return YES;
+}
+
+// Decodes the last, padded quantum, if any. Returns NO if the string ended
+// in the middle of a quantum, or if the unused bits of the last one are set.
+static BOOL SCIBase64FinishDecoding(SCIBase64Decoder *decoder) {
+    if (decoder->padding == 0) {
+        return decoder->count == 0;
+    }
+
+    if (decoder->count + decoder->padding != 4) {
+        return NO;
+    }
+
+    uint8_t *o = decoder->output;
+
+    if (decoder->count == 2) {
+        if (decoder->bits & 0xF) {
+            return NO;
+        }
+
+        *o++ = decoder->bits >> 4;
+    } else {
+        if (decoder->bits & 0x3) {
+            return NO;
+        }
+
+        *o++ = decoder->bits >> 10;
+        *o++ = decoder->bits >> 2;
+    }
+
+    decoder->output = o;
+
+    return YES;
+}
+
+// Decodes ASCII strings of canonical Base-64 with any whitespace in between
+// directly into the bytes of the resulting NSData, without any other copy of
+// the string than a small buffer on the stack. Returns nil for anything else,
+// and for empty data, which are left to NSData to decide upon.
+static NSData *_Nullable SCIScanBase64(NSString *str) {
+    NSUInteger length = str.length;
+
+    // Whitespace only makes the data shorter. SCIBase64DecodeBlock()
+    // may store up to 4 bytes past the end of the decoded ones.
+    uint8_t *bytes = malloc(length / 4 * 3 + 16);
+
+    if (bytes == NULL) {
+        return nil;
+    }
+
+    SCIBase64Decoder decoder = { .output = bytes };
+    uint8_t buffer[SCI_BASE64_CHUNK_SIZE];
+    NSRange remaining = { 0, length };
+    BOOL decoded = YES;
+
+    while (decoded && remaining.length > 0) {
+        NSUInteger used = 0;
+
+        // Stops at the first non-ASCII character, if any
+        [str getBytes:buffer
+            maxLength:sizeof buffer
+           usedLength:&used
+             encoding:NSASCIIStringEncoding
+              options:kNilOptions
+                range:remaining
+       remainingRange:&remaining];
+
+        decoded = used > 0 && SCIBase64DecodeChunk(&decoder, buffer, buffer + used);
+    }
+
+    decoded = decoded && SCIBase64FinishDecoding(&decoder);
+
+    NSUInteger decodedLength = decoder.output - bytes;
+
+    if (decoded == NO || decodedLength == 0) {
+        free(bytes);
+        return nil;
+    }
+
+    // Give back what whitespace and padding left unused
+    uint8_t *shrunk = realloc(bytes, decodedLength);
+
+    return [NSData dataWithBytesNoCopy:shrunk ?: bytes length:decodedLength freeWhenDone:YES];
+}
+
+NSData *SCIBase64StringToDataUsingFoundation(NSString *str) {
+    NSCParameterAssert(str);
+
+    // Remove any whitespace (it's customary to present Base-64 in a tabulated, multiline shape)
+    NSCharacterSet *wsCharset = NSCharacterSet.whitespaceAndNewlineCharacterSet;
+
+    if ([str rangeOfCharacterFromSet:wsCharset].location != NSNotFound) {
+        NSMutableString *noWsString = [str mutableCopy];
+
+        [noWsString replaceOccurrencesOfString:@"\\s"
+                                    withString:@""
+                                       options:NSRegularExpressionSearch
+                                         range:(NSRange){ 0, noWsString.length }];
+
+        str = noWsString;
+    }
+
+    return [[NSData alloc] initWithBase64EncodedString:str options:kNilOptions];
+}
+
+NSData *SCIBase64StringToData(NSString *str) {
+    NSCParameterAssert(str);
+
+    return SCIScanBase64(str) ?: SCIBase64StringToDataUsingFoundation(str);
+}
+
+#pragma mark - Escaping
+
+typedef NS_ENUM(NSUInteger, SCIEscaping) {
+    SCIEscapingC,
+    SCIEscapingXML,
+    SCIUnescapingC,
+    SCIUnescapingXML,
+    SCIEscapingCount,
+};
+
+// The bytes that are escaped, or that start an escape sequence. Only ASCII
+// bytes are ever special, so scanning the UTF-8 bytes of a string finds them
+// without decoding it, and the runs between them are copied as they are.
+typedef struct {
+    uint8_t lengths[256];                  // of the escape sequence of each byte, 0 if it's not special
+    char sequences[256][8];                // the escape sequence of each byte, when escaping
+    uint8_t specials[SCI_ESCAPE_SPECIALS]; // the special printable bytes, repeated to fill the array
+    BOOL controls;                         // whether C0 control characters and DEL are special too
+} SCIEscapeTable;
+
+// Decodes the escape sequence at the cursor, which points to its special byte,
+// writes what it stands for to the output, and advances both. Returns NO if the
+// sequence is invalid. The output is never longer than the sequence itself,
+// so that strings can be unescaped in place.
+typedef BOOL (*SCIUnescapeFunction)(const uint8_t **cursor, const uint8_t *end, uint8_t **output);
+
+static void SCIEscapeTableSetSequence(SCIEscapeTable *table, uint8_t byte, const char *sequence) {
+    table->lengths[byte] = strlen(sequence);
+    strcpy(table->sequences[byte], sequence);
+}
+
+static void SCIEscapeTableSetSpecials(SCIEscapeTable *table, const char *specials) {
+    size_t count = strlen(specials);
+
+    for (size_t i = 0; i < SCI_ESCAPE_SPECIALS; i++) {
+        table->specials[i] = specials[i % count];
+        table->lengths[table->specials[i]] = MAX(table->lengths[table->specials[i]], 1);
+    }
+}
+
+static const SCIEscapeTable *SCIEscapeTables(void) {
+    static SCIEscapeTable tables[SCIEscapingCount];
+    static dispatch_once_t token;
+
+    dispatch_once(&token, ^{
+        // Escaped like in a C string literal; control characters without
+        // a name are written in octal, which, unlike hex, is at most 3 digits
+        SCIEscapeTable *c = &tables[SCIEscapingC];
+
+        for (unsigned byte = 0; byte < 0x20; byte++) {
+            snprintf(c->sequences[byte], sizeof c->sequences[byte], "\\%03o", byte);
+            c->lengths[byte] = 4;
+        }
+
+        snprintf(c->sequences[0x7F], sizeof c->sequences[0x7F], "\\%03o", 0x7F);
+        c->lengths[0x7F] = 4;
+
+        SCIEscapeTableSetSequence(c, '\a', "\\a");
+        SCIEscapeTableSetSequence(c, '\b', "\\b");
+        SCIEscapeTableSetSequence(c, '\f', "\\f");
+        SCIEscapeTableSetSequence(c, '\n', "\\n");
+        SCIEscapeTableSetSequence(c, '\r', "\\r");
+        SCIEscapeTableSetSequence(c, '\t', "\\t");
+        SCIEscapeTableSetSequence(c, '\v', "\\v");
+        SCIEscapeTableSetSequence(c, '"', "\\\"");
+        SCIEscapeTableSetSequence(c, '\\', "\\\\");
+        SCIEscapeTableSetSpecials(c, "\"\\");
+        c->controls = YES;
+
+        // The characters xmlEncodeSpecialChars() escapes in text,
+        // like SCIXMLEscapingText of the direct writer
+        SCIEscapeTable *xml = &tables[SCIEscapingXML];
+
+        SCIEscapeTableSetSequence(xml, '<', "&lt;");
+        SCIEscapeTableSetSequence(xml, '>', "&gt;");
+        SCIEscapeTableSetSequence(xml, '&', "&amp;");
+        SCIEscapeTableSetSequence(xml, '"', "&quot;");
+        SCIEscapeTableSetSequence(xml, '\r', "&#13;");
+        SCIEscapeTableSetSpecials(xml, "<>&\"\r");
+
+        SCIEscapeTableSetSpecials(&tables[SCIUnescapingC], "\\");
+        SCIEscapeTableSetSpecials(&tables[SCIUnescapingXML], "&");
+    });
+
+    return tables;
+}
+
+// Returns the offset of the first special byte, or the length if there's none.
+// Compares 32 or 16 bytes at a time where possible, and the rest one by one.
+static NSUInteger SCIEscapeScan(const SCIEscapeTable *table, const uint8_t *bytes, NSUInteger length) {
+    NSUInteger i = 0;
+
+#ifdef __AVX2__
+    {
+        const __m256i s0 = _mm256_set1_epi8(table->specials[0]);
+        const __m256i s1 = _mm256_set1_epi8(table->specials[1]);
+        const __m256i s2 = _mm256_set1_epi8(table->specials[2]);
+        const __m256i s3 = _mm256_set1_epi8(table->specials[3]);
+        const __m256i s4 = _mm256_set1_epi8(table->specials[4]);
+        const __m256i lastControl = _mm256_set1_epi8(0x1F);
+        const __m256i del = _mm256_set1_epi8(0x7F);
+
+        for (; length - i >= 32; i += 32) {
+            __m256i chunk = _mm256_loadu_si256((const __m256i *)(bytes + i));
+            __m256i hits = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, s0), _mm256_cmpeq_epi8(chunk, s1)),
+                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, s2),
+                                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, s3), _mm256_cmpeq_epi8(chunk, s4)))
+            );
+
+            if (table->controls) {
+                // Unsigned x <= 0x1F, i.e. max(x, 0x1F) == 0x1F
+                __m256i controls = _mm256_cmpeq_epi8(_mm256_max_epu8(chunk, lastControl), lastControl);
+                hits = _mm256_or_si256(hits, _mm256_or_si256(controls, _mm256_cmpeq_epi8(chunk, del)));
+            }
+
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(hits);
+
+            if (mask != 0) {
+                return i + __builtin_ctz(mask);
+            }
+        }
+    }
+#endif
+
+#ifdef __SSE2__
+    {
+        const __m128i s0 = _mm_set1_epi8(table->specials[0]);
+        const __m128i s1 = _mm_set1_epi8(table->specials[1]);
+        const __m128i s2 = _mm_set1_epi8(table->specials[2]);
+        const __m128i s3 = _mm_set1_epi8(table->specials[3]);
+        const __m128i s4 = _mm_set1_epi8(table->specials[4]);
+        const __m128i lastControl = _mm_set1_epi8(0x1F);
+        const __m128i del = _mm_set1_epi8(0x7F);
+
+        for (; length - i >= 16; i += 16) {
+            __m128i chunk = _mm_loadu_si128((const __m128i *)(bytes + i));
+            __m128i hits = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, s0), _mm_cmpeq_epi8(chunk, s1)),
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, s2),
+                             _mm_or_si128(_mm_cmpeq_epi8(chunk, s3), _mm_cmpeq_epi8(chunk, s4)))
+            );
+
+            if (table->controls) {
+                __m128i controls = _mm_cmpeq_epi8(_mm_max_epu8(chunk, lastControl), lastControl);
+                hits = _mm_or_si128(hits, _mm_or_si128(controls, _mm_cmpeq_epi8(chunk, del)));
+            }
+
+            int mask = _mm_movemask_epi8(hits);
+
+            if (mask != 0) {
+                return i + __builtin_ctz(mask);
+            }
+        }
+    }
+#endif
+
+    for (; i < length; i++) {
+        if (table->lengths[bytes[i]]) {
+            return i;
+        }
+    }
+
+    return length;
+}
+
+// Copies the UTF-8 bytes of the string out in chunks, and scans them,
+// so that strings without special bytes are not copied as a whole.
+// Also returns YES if the string can't be converted to UTF-8.
+static BOOL SCIStringHasSpecialBytes(NSString *str, const SCIEscapeTable *table) {
+    uint8_t buffer[SCI_ESCAPE_CHUNK_SIZE];
+    NSRange remaining = { 0, str.length };
+
+    while (remaining.length > 0) {
+        NSUInteger used = 0;
+
+        BOOL converted = [str getBytes:buffer
+                             maxLength:sizeof buffer
+                            usedLength:&used
+                              encoding:NSUTF8StringEncoding
+                               options:kNilOptions
+                                 range:remaining
+                        remainingRange:&remaining];
+
+        if (converted == NO || used == 0 || SCIEscapeScan(table, buffer, used) < used) {
+            return YES;
+        }
+    }
+
+    return NO;
+}
+
+// The UTF-8 bytes of the string, to be free()'d, or NULL if it can't be converted
+static uint8_t *_Nullable SCIStringCopyUTF8(NSString *str, NSUInteger *length) {
+    NSUInteger capacity = [str lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    uint8_t *bytes = capacity > 0 ? malloc(capacity) : NULL;
+    NSRange remaining = { 0, 0 };
+
+    if (bytes == NULL) {
+        return NULL;
+    }
+
+    BOOL converted = [str getBytes:bytes
+                         maxLength:capacity
+                        usedLength:length
+                          encoding:NSUTF8StringEncoding
+                           options:kNilOptions
+                             range:NSMakeRange(0, str.length)
+                    remainingRange:&remaining];
+
+    if (converted == NO || remaining.length > 0) {
+        free(bytes);
+        return NULL;
+    }
+
+    return bytes;
+}
+
+static id SCIStringEscape(NSString *str, SCIEscaping escaping) {
+    NSCParameterAssert(str);
+
+    const SCIEscapeTable *table = &SCIEscapeTables()[escaping];
+
+    if (SCIStringHasSpecialBytes(str, table) == NO) {
+        return str;
+    }
+
+    NSUInteger length = 0;
+    uint8_t *input = SCIStringCopyUTF8(str, &length);
+
+    if (input == NULL) {
+        return [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedTree
+                                     format:@"can't escape '%@' because it can't be converted to UTF-8", str];
+    }
+
+    const uint8_t *end = input + length;
+    NSUInteger outputLength = length;
+
+    // Measure the output first, so that it's allocated only once
+    for (const uint8_t *p = input + SCIEscapeScan(table, input, length); p < end; p++) {
+        outputLength += table->lengths[*p] - 1;
+        p += SCIEscapeScan(table, p + 1, end - p - 1);
+    }
+
+    uint8_t *output = malloc(outputLength);
+
+    if (output == NULL) {
+        free(input);
+        [NSException raise:NSMallocException format:@"could not allocate %lu bytes", (unsigned long)outputLength];
+    }
+
+    uint8_t *o = output;
+
+    for (const uint8_t *p = input; p < end; p++) {
+        NSUInteger run = SCIEscapeScan(table, p, end - p);
+
+        memcpy(o, p, run);
+        o += run;
+        p += run;
+
+        if (p == end) {
+            break;
+        }
+
+        memcpy(o, table->sequences[*p], table->lengths[*p]);
+        o += table->lengths[*p];
+    }
+
+    free(input);
+
+    return [[NSString alloc] initWithBytesNoCopy:output
+                                          length:outputLength
+                                        encoding:NSUTF8StringEncoding
+                                    freeWhenDone:YES];
+}
+
+static BOOL SCIIsValidUTF8(const uint8_t *p, const uint8_t *end) {
+    while (p < end) {
+        // Skip ASCII 8 bytes at a time
+        uint64_t word;
+
+        while (end - p >= 8 && (memcpy(&word, p, sizeof word), (word & 0x8080808080808080ull) == 0)) {
+            p += 8;
+        }
+
+        if (p == end) {
+            break;
+        }
+
+        uint8_t lead = *p++;
+
+        if (lead < 0x80) {
+            continue;
+        }
+
+        NSUInteger count;
+        uint32_t min;
+        uint32_t codePoint;
+
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            count = 1, min = 0x80, codePoint = lead & 0x1F;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            count = 2, min = 0x800, codePoint = lead & 0x0F;
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            count = 3, min = 0x10000, codePoint = lead & 0x07;
+        } else {
+            return NO;
+        }
+
+        if ((NSUInteger)(end - p) < count) {
+            return NO;
+        }
+
+        for (NSUInteger i = 0; i < count; i++, p++) {
+            if ((*p & 0xC0) != 0x80) {
+                return NO;
+            }
+
+            codePoint = codePoint << 6 | (*p & 0x3F);
+        }
+
+        if (codePoint < min || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+            return NO;
+        }
+    }
+
+    return YES;
+}
+
+static uint8_t *SCIAppendUTF8(uint8_t *o, uint32_t codePoint) {
+    if (codePoint < 0x80) {
+        *o++ = codePoint;
+    } else if (codePoint < 0x800) {
+        *o++ = 0xC0 | codePoint >> 6;
+        *o++ = 0x80 | (codePoint & 0x3F);
+    } else if (codePoint < 0x10000) {
+        *o++ = 0xE0 | codePoint >> 12;
+        *o++ = 0x80 | (codePoint >> 6 & 0x3F);
+        *o++ = 0x80 | (codePoint & 0x3F);
+    } else {
+        *o++ = 0xF0 | codePoint >> 18;
+        *o++ = 0x80 | (codePoint >> 12 & 0x3F);
+        *o++ = 0x80 | (codePoint >> 6 & 0x3F);
+        *o++ = 0x80 | (codePoint & 0x3F);
+    }
+
+    return o;
+}
+
+// Scans at most 'max' digits of the base, and at least one. Returns NO if
+// there are none, or if the value exceeds the limit.
+static BOOL SCIScanEscapeDigits(const uint8_t **cursor, const uint8_t *end, unsigned base, NSUInteger max, uint32_t limit, uint32_t *value) {
+    const uint8_t *p = *cursor;
+    uint32_t v = 0;
+
+    for (unsigned digit; p < end && (NSUInteger)(p - *cursor) < max && (digit = SCIDigitValue(*p)) < base; p++) {
+        if (v > (limit - digit) / base) {
+            return NO;
+        }
+
+        v = v * base + digit;
+    }
+
+    if (p == *cursor) {
+        return NO;
+    }
+
+    *cursor = p;
+    *value = v;
+
+    return YES;
+}
+
+// The escape sequences of C string literals, including octal, hexadecimal
+// and universal character names. Octal and hexadecimal ones stand for a
+// single byte, which may make the result invalid UTF-8.
+static BOOL SCIUnescapeCSequence(const uint8_t **cursor, const uint8_t *end, uint8_t **output) {
+    const uint8_t *p = *cursor + 1;
+    uint8_t *o = *output;
+
+    if (p == end) {
+        return NO;
+    }
+
+    uint8_t c = *p++;
+    uint32_t value = 0;
+
+    if (c >= '0' && c <= '7') {
+        p--;
+
+        if (SCIScanEscapeDigits(&p, end, 8, 3, 0xFF, &value) == NO) {
+            return NO;
+        }
+
+        *o++ = value;
+    } else if (c == 'x') {
+        if (SCIScanEscapeDigits(&p, end, 16, NSUIntegerMax, 0xFF, &value) == NO) {
+            return NO;
+        }
+
+        *o++ = value;
+    } else if (c == 'u' || c == 'U') {
+        NSUInteger digits = c == 'u' ? 4 : 8;
+        const uint8_t *start = p;
+
+        if (SCIScanEscapeDigits(&p, end, 16, digits, 0x10FFFF, &value) == NO
+         || (NSUInteger)(p - start) != digits
+         || (value >= 0xD800 && value <= 0xDFFF)) {
+            return NO;
+        }
+
+        o = SCIAppendUTF8(o, value);
+    } else {
+        switch (c) {
+        case 'a': *o++ = '\a'; break;
+        case 'b': *o++ = '\b'; break;
+        case 'f': *o++ = '\f'; break;
+        case 'n': *o++ = '\n'; break;
+        case 'r': *o++ = '\r'; break;
+        case 't': *o++ = '\t'; break;
+        case 'v': *o++ = '\v'; break;
+        case '\\':
+        case '\'':
+        case '"':
+        case '?':
+            *o++ = c;
+            break;
+        default:
+            return NO;
+        }
+    }
+
+    *cursor = p;
+    *output = o;
+
+    return YES;
+}
+
+// The predefined entities of XML, and character references
+// of characters that are allowed in XML documents
+static BOOL SCIUnescapeXMLSequence(const uint8_t **cursor, const uint8_t *end, uint8_t **output) {
+    const uint8_t *p = *cursor + 1;
+    const uint8_t *semicolon = memchr(p, ';', MIN((NSUInteger)(end - p), SCI_XML_REFERENCE_MAX));
+    uint8_t *o = *output;
+
+    if (semicolon == NULL) {
+        return NO;
+    }
+
+    NSUInteger length = semicolon - p;
+
+    if (length > 1 && p[0] == '#') {
+        BOOL hex = p[1] == 'x';
+        const uint8_t *digits = p + (hex ? 2 : 1);
+        uint32_t value = 0;
+
+        if (SCIScanEscapeDigits(&digits, semicolon, hex ? 16 : 10, NSUIntegerMax, 0x10FFFF, &value) == NO
+         || digits != semicolon) {
+            return NO;
+        }
+
+        BOOL allowed = value == 0x9 || value == 0xA || value == 0xD
+                    || (value >= 0x20 && value <= 0xD7FF)
+                    || (value >= 0xE000 && value <= 0xFFFD)
+                    || value >= 0x10000;
+
+        if (allowed == NO) {
+            return NO;
+        }
+
+        o = SCIAppendUTF8(o, value);
+    } else if (length == 2 && memcmp(p, "lt", 2) == 0) {
+        *o++ = '<';
+    } else if (length == 2 && memcmp(p, "gt", 2) == 0) {
+        *o++ = '>';
+    } else if (length == 3 && memcmp(p, "amp", 3) == 0) {
+        *o++ = '&';
+    } else if (length == 4 && memcmp(p, "quot", 4) == 0) {
+        *o++ = '"';
+    } else if (length == 4 && memcmp(p, "apos", 4) == 0) {
+        *o++ = '\'';
+    } else {
+        return NO;
+    }
+
+    *cursor = semicolon + 1;
+    *output = o;
+
+    return YES;
+}
+
+static id SCIStringUnescape(NSString *str, SCIEscaping escaping, SCIUnescapeFunction unescapeSequence, BOOL validatesUTF8) {
+    NSCParameterAssert(str);
+
+    const SCIEscapeTable *table = &SCIEscapeTables()[escaping];
+
+    if (SCIStringHasSpecialBytes(str, table) == NO) {
+        return str;
+    }
+
+    NSUInteger length = 0;
+    uint8_t *bytes = SCIStringCopyUTF8(str, &length);
+
+    if (bytes == NULL) {
+        return [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedTree
+                                     format:@"can't unescape '%@' because it can't be converted to UTF-8", str];
+    }
+
+    const uint8_t *p = bytes;
+    const uint8_t *end = bytes + length;
+    uint8_t *o = bytes;
+
+    while (p < end) {
+        NSUInteger run = SCIEscapeScan(table, p, end - p);
+
+        // The output is never ahead of the input
+        memmove(o, p, run);
+        o += run;
+        p += run;
+
+        if (p == end) {
+            break;
+        }
+
+        if (unescapeSequence(&p, end, &o) == NO) {
+            NSUInteger offset = p - bytes;
+            free(bytes);
+
+            return [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedTree
+                                         format:@"invalid escape sequence at byte %lu of '%@'", (unsigned long)offset, str];
+        }
+    }
+
+    if (validatesUTF8 && SCIIsValidUTF8(bytes, o) == NO) {
+        free(bytes);
+
+        return [NSError SCIXMLErrorWithCode:SCIXMLErrorCodeMalformedTree
+                                     format:@"unescaping '%@' results in invalid UTF-8", str];
+    }
+
+    return [[NSString alloc] initWithBytesNoCopy:bytes
+                                          length:o - bytes
+                                        encoding:NSUTF8StringEncoding
+                                    freeWhenDone:YES];
+}
+
+id SCIStringEscapeC(NSString *str) {
+    return SCIStringEscape(str, SCIEscapingC);
+}
+
+id SCIStringUnescapeC(NSString *str) {
+    return SCIStringUnescape(str, SCIUnescapingC, SCIUnescapeCSequence, YES);
+}
+
+id SCIStringEscapeXML(NSString *str) {
+    return SCIStringEscape(str, SCIEscapingXML);
+}
+
+id SCIStringUnescapeXML(NSString *str) {
+    return SCIStringUnescape(str, SCIUnescapingXML, SCIUnescapeXMLSequence, NO);
+}
+
+#pragma mark - Other helpers
 
 BOOL SCIDictionaryHasExactKeys(
     NSDictionary<NSString *, id> *dictionary,
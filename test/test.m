@@ -1,57 +1,1592 @@
+#import <stdio.h>
+#import <unistd.h>
+
+#import <libxml/entities.h>
+
 #import "SCIXMLSerialization.h"
+#import "SCIXMLUtils.h"
 
 
-int main(int argc, char *argv[])
-{
-    @autoreleasepool {
-#if 1
-        NSStringEncoding enc = 0;
-        NSString *inXML = [NSString stringWithContentsOfFile:@(argv[1])
-                                              usedEncoding:&enc
-                                                     error:NULL];
+// Usage: test [XML file...]
+//    or: make check
+//
+// Checks that alternative code paths produce identical results, on the
+// documents below and on the files given on the command line. Prints every
+// failure, and exits with a non-zero status if there were any.
 
-        inXML = @"<root><date>2017-04-03T13:37:42</date></root>";
+static NSUInteger SCITestFailures = 0;
 
-        NSDictionary *typeMap = @{ @"date": SCIXMLParserTypeDate };
+#define SCITestCheck(condition, ...)  \
+    do {                              \
+        if ((condition) == NO) {      \
+            NSLog(__VA_ARGS__);       \
+            SCITestFailures++;        \
+        }                             \
+    } while (0)
 
-        id <SCIXMLCompactingTransform> transform;
-        transform = [SCIXMLCompactingTransform basicCompactingTransformWithChildFlatteningGroupingMap:nil
-                                                                               attributeParserTypeMap:nil
-                                                                              attributeParserFallback:nil
-                                                                                  memberParserTypeMap:typeMap
-                                                                                 memberParserFallback:nil];
 
-        NSError *error = nil;
-        id obj = [SCIXMLSerialization compactedObjectWithXMLString:inXML
-                                               compactingTransform:[transform copy] // test copying
-                                                             error:&error];
-        NSLog(@"%@ | %@", obj, [obj[@"date"] class] ?: error.localizedDescription);
-#else
-        NSDictionary *root = @{
-            @"DC_LOGINREQ": @[
-                @{ @"LangCode": @"EN", },
-                @{
-                    @"baz": @{
-                        SCIXMLTempKeyAttrs: @{
-                            @"attrname": @"attrvalue",
-                        },
-                        SCIXMLTempKeyChild: @[
-                            @{ @"baz": @"BAZ 1" },
-                            @{ @"baz": @"BAZ 2" },
-                        ],
+#pragma mark - Documents
+
+// Documents with every supported kind of node, and malformed ones,
+// which must fail in the same way on every code path
+static NSArray<NSString *> *SCITestDocuments(void) {
+    return @[
+        @"<root/>",
+        @"<root a=\"1\" b=\"&amp;&lt;&#233;\" c=\"\">text &amp; more<child/><child x=\"y\">leaf</child></root>",
+        @"<root><![CDATA[<raw> & \"quoted\" ]]>text<!-- a comment --><a><!----></a></root>",
+        @"<!DOCTYPE root [<!ENTITY who \"world\"><!ENTITY tag \"<b>bold</b>\">]>"
+         "<root greeting=\"hello &who;\">hello &who;, &tag; &#233;&#x41;&lt;</root>",
+        @"<root>\n  <a>x</a>\n  <b> y </b>\n  <c>\n    <d/>\n  </c>\n</root>",
+        @"<r xmlns=\"urn:d\" xmlns:p=\"urn:p\"><p:a p:x=\"1\" x=\"2\">t</p:a><b/></r>",
+        @"<?xml version=\"1.0\" encoding=\"UTF-8\"?><root>árvíztűrő tükörfúrógép \U0001F600</root>",
+        @"<root>a<b>b<c>c</c>b</b>a<!-- x -->a</root>",
+
+        // Malformed, unsupported and empty documents
+        @"",
+        @"<root>",
+        @"<root><a></root>",
+        @"<root>&undefined;</root>",
+        @"<root a=\"1\" a=\"2\"/>",
+        @"<root/><root/>",
+        @"<root><?pi data?></root>",
+    ];
+}
+
+static NSArray<NSData *> *SCITestDocumentData(NSArray<NSString *> *paths) {
+    NSMutableArray<NSData *> *documents = [NSMutableArray new];
+
+    for (NSString *document in SCITestDocuments()) {
+        [documents addObject:[document dataUsingEncoding:NSUTF8StringEncoding]];
+    }
+
+    for (NSString *path in paths) {
+        NSData *data = [NSData dataWithContentsOfFile:path];
+        SCITestCheck(data != nil, @"could not read '%@'", path);
+
+        if (data) {
+            [documents addObject:data];
+        }
+    }
+
+    return documents;
+}
+
+static NSString *SCITestDescription(NSData *document) {
+    NSString *string = [[NSString alloc] initWithData:document encoding:NSUTF8StringEncoding];
+    return string.length > 80 ? [[string substringToIndex:80] stringByAppendingString:@"..."] : string;
+}
+
+// Either both succeeded with equal results, or both failed with the same code
+static BOOL SCITestSameOutcome(id result, NSError *error, id expected, NSError *expectedError) {
+    if (result == nil || expected == nil) {
+        return result == nil && expected == nil && error.code == expectedError.code;
+    }
+
+    return [result isEqual:expected];
+}
+
+
+#pragma mark - Examples
+
+static void SCITestExamples(void) {
+    NSString *inXML = @"<root><date>2017-04-03T13:37:42</date></root>";
+
+    NSDictionary *typeMap = @{ @"date": SCIXMLParserTypeDate };
+
+    id <SCIXMLCompactingTransform> transform;
+    transform = [SCIXMLCompactingTransform basicCompactingTransformWithChildFlatteningGroupingMap:nil
+                                                                           attributeParserTypeMap:nil
+                                                                          attributeParserFallback:nil
+                                                                              memberParserTypeMap:typeMap
+                                                                             memberParserFallback:nil];
+
+    NSError *error = nil;
+    id obj = [SCIXMLSerialization compactedObjectWithXMLString:inXML
+                                           compactingTransform:[transform copy] // test copying
+                                                         error:&error];
+
+    SCITestCheck([obj[@"date"] isEqual:[NSDate dateWithTimeIntervalSince1970:1491226662]],
+                 @"%@ | %@", obj, [obj[@"date"] class] ?: error.localizedDescription);
+
+    NSDictionary *root = @{
+        @"DC_LOGINREQ": @[
+            @{ @"LangCode": @"EN", },
+            @{
+                @"baz": @{
+                    SCIXMLTempKeyAttrs: @{
+                        @"attrname": @"attrvalue",
                     },
+                    SCIXMLTempKeyChild: @[
+                        @{ @"baz": @"BAZ 1" },
+                        @{ @"baz": @"BAZ 2" },
+                    ],
                 },
-            ],
-        };
+            },
+        ],
+    };
+
+    error = nil;
+    NSString *xml = [SCIXMLSerialization xmlStringWithNaturalDictionary:root
+                                                            indentation:@"    "
+                                                                  error:&error];
+
+    SCITestCheck([xml containsString:@"<baz attrname=\"attrvalue\">"] && [xml containsString:@"<baz>BAZ 2</baz>"],
+                 @"\n\n%@", xml ?: error);
+}
+
+
+#pragma mark - Parsing
+
+// The canonical tree built from SAX events, with every option that affects
+// how it's built, must equal the one converted from the document tree
+static void SCITestParsing(NSArray<NSData *> *documents) {
+    SCIXMLReadingOptions options[] = {
+        SCIXMLReadingOptionsNone,
+        SCIXMLReadingOptionsCanonicalNodeClass,
+        SCIXMLReadingOptionsNoCopyStrings,
+        SCIXMLReadingOptionsCanonicalNodeClass | SCIXMLReadingOptionsNoCopyStrings,
+        SCIXMLReadingOptionsUseDocumentTree | SCIXMLReadingOptionsNoCopyStrings,
+        SCIXMLReadingOptionsLazyTree,
+        SCIXMLReadingOptionsLazyTree | SCIXMLReadingOptionsNoCopyStrings,
+    };
+
+    for (NSData *document in documents) {
+        @autoreleasepool {
+            NSError *domError = nil;
+            NSDictionary *dom = [SCIXMLSerialization canonicalDictionaryWithXMLData:document
+                                                                            options:SCIXMLReadingOptionsUseDocumentTree
+                                                                              error:&domError];
+
+            for (size_t i = 0; i < sizeof options / sizeof options[0]; i++) {
+                NSError *error = nil;
+                NSDictionary *tree = [SCIXMLSerialization canonicalDictionaryWithXMLData:document
+                                                                                 options:options[i]
+                                                                                   error:&error];
+
+                // The children of the root of a lazy tree are first materialized concurrently
+                if (options[i] & SCIXMLReadingOptionsLazyTree) {
+                    NSArray *children = tree[SCIXMLNodeKeyChildren];
+
+                    dispatch_apply(children.count, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t j) {
+                        [children[j] description];
+                    });
+                }
+
+                SCITestCheck(SCITestSameOutcome(tree, error, dom, domError),
+                             @"parsing '%@' with options %lu differs:\n%@ (%@)\nexpected %@ (%@)",
+                             SCITestDescription(document), (unsigned long)options[i], tree, error, dom, domError);
+            }
+        }
+    }
+
+    NSDictionary<NSString *, NSNumber *> *errorCodes = @{
+        @"<root>":                   @(SCIXMLErrorCodeMalformedXML),
+        @"<root><a></root>":         @(SCIXMLErrorCodeMalformedXML),
+        @"<root>&undefined;</root>": @(SCIXMLErrorCodeMalformedXML),
+        @"<root><?pi data?></root>": @(SCIXMLErrorCodeUnimplemented),
+    };
+
+    [errorCodes enumerateKeysAndObjectsUsingBlock:^(NSString *document, NSNumber *code, BOOL *stop) {
+        for (NSNumber *option in @[ @(SCIXMLReadingOptionsNone), @(SCIXMLReadingOptionsUseDocumentTree), @(SCIXMLReadingOptionsLazyTree) ]) {
+            NSError *error = nil;
+            id tree = [SCIXMLSerialization canonicalDictionaryWithXMLData:[document dataUsingEncoding:NSUTF8StringEncoding]
+                                                                  options:option.unsignedIntegerValue
+                                                                    error:&error];
+
+            SCITestCheck(tree == nil && [error.domain isEqual:SCIXMLErrorDomain] && error.code == code.integerValue,
+                         @"parsing '%@' with options %@ should fail with code %@: %@ (%@)", document, option, code, tree, error);
+        }
+    }];
+
+    // Entities are substituted, and the content of CDATA sections is kept as it is
+    NSDictionary *tree = [SCIXMLSerialization canonicalDictionaryWithXMLData:documents[3] error:NULL];
+    SCITestCheck([tree[SCIXMLNodeKeyAttributes][@"greeting"] isEqual:@"hello world"],
+                 @"entity not substituted in attribute: %@", tree);
+
+    tree = [SCIXMLSerialization canonicalDictionaryWithXMLData:documents[2] error:NULL];
+    NSDictionary *cdata = [tree[SCIXMLNodeKeyChildren] firstObject];
+    SCITestCheck([cdata[SCIXMLNodeKeyType] isEqual:SCIXMLNodeTypeCDATA] && [cdata[SCIXMLNodeKeyText] isEqual:@"<raw> & \"quoted\" "],
+                 @"CDATA section not kept: %@", tree);
+
+    // Even empty children and attributes of canonical node objects are mutable
+    tree = [SCIXMLSerialization canonicalDictionaryWithXMLData:documents[0]
+                                                       options:SCIXMLReadingOptionsCanonicalNodeClass
+                                                         error:NULL];
+    @try {
+        [tree[SCIXMLNodeKeyChildren] addObject:@{ SCIXMLNodeKeyType: SCIXMLNodeTypeText, SCIXMLNodeKeyText: @"added" }];
+        [tree[SCIXMLNodeKeyAttributes] setObject:@"added" forKey:@"name"];
+    } @catch (NSException *exception) {
+        SCITestCheck(NO, @"empty containers of canonical nodes are immutable: %@", exception);
+    }
+}
+
+
+#pragma mark - Compaction
+
+// Compacts any document, even one with repeated child elements
+static NSArray<id <SCIXMLCompactingTransform>> *SCITestBuiltinTransforms(void) {
+    return @[
+        SCIXMLCompactingTransform.attributeFlatteningTransform,
+        SCIXMLCompactingTransform.elementTypeFilterTransform,
+        SCIXMLCompactingTransform.textNodeFlatteningTransform,
+        [SCIXMLCompactingTransform attributeParserTransformWithTypeMap:@{}
+                                                              fallback:SCIXMLParserTypeIdentity],
+        [SCIXMLCompactingTransform memberParserTransformWithTypeMap:@{}
+                                                           fallback:SCIXMLParserTypeIdentity],
+    ];
+}
+
+// Node transforms may modify the children of the node in place
+static id <SCIXMLCompactingTransform> SCITestChildMutatingTransform(void) {
+    SCIXMLCompactingTransform *transform = [SCIXMLCompactingTransform new];
+
+    transform.nodeTransform = ^id (id node) {
+        if ([node[SCIXMLNodeKeyType] isEqual:SCIXMLNodeTypeElement]) {
+            [node[SCIXMLNodeKeyChildren] addObject:@{
+                SCIXMLNodeKeyType: SCIXMLNodeTypeText,
+                SCIXMLNodeKeyText: @"appended",
+            }];
+        }
+        return node;
+    };
+
+    return transform;
+}
+
+static NSArray<id <SCIXMLCompactingTransform>> *SCITestCompactingTransforms(void) {
+    return @[
+        [SCIXMLCompactingTransform basicCompactingTransformWithChildFlatteningGroupingMap:nil
+                                                                   attributeParserTypeMap:nil
+                                                                  attributeParserFallback:nil
+                                                                      memberParserTypeMap:@{ @"date": SCIXMLParserTypeDate }
+                                                                     memberParserFallback:nil],
+        [SCIXMLCompactingTransform combineTransforms:SCITestBuiltinTransforms()
+                          conflictResolutionStrategy:SCIXMLTransformCombinationConflictResolutionStrategyCompose],
+        [SCIXMLCompiledCompactingTransform compiledTransformWithTransforms:SCITestBuiltinTransforms()],
+        SCITestChildMutatingTransform(),
+        [SCIXMLCompiledCompactingTransform compiledTransformWithTransforms:@[ SCITestChildMutatingTransform() ]],
+    ];
+}
+
+// Compacting nodes as soon as they are parsed, with every option that affects
+// how, must give the same results as compacting the document tree
+static void SCITestCompaction(NSArray<NSData *> *documents) {
+    SCIXMLReadingOptions options[] = {
+        SCIXMLReadingOptionsNone,
+        SCIXMLReadingOptionsCanonicalNodeClass,
+        SCIXMLReadingOptionsNoCopyStrings,
+        SCIXMLReadingOptionsCanonicalNodeClass | SCIXMLReadingOptionsNoCopyStrings,
+        SCIXMLReadingOptionsUseDocumentTree | SCIXMLReadingOptionsNoCopyStrings,
+        SCIXMLReadingOptionsConcurrentCompaction,
+        SCIXMLReadingOptionsCanonicalNodeClass | SCIXMLReadingOptionsConcurrentCompaction,
+    };
+
+    NSArray<id <SCIXMLCompactingTransform>> *transforms = SCITestCompactingTransforms();
+
+    for (NSData *document in documents) {
+        for (NSUInteger t = 0; t < transforms.count; t++) {
+            @autoreleasepool {
+                NSError *treeError = nil;
+                id tree = [SCIXMLSerialization compactedObjectWithXMLData:document
+                                                      compactingTransform:transforms[t]
+                                                                  options:SCIXMLReadingOptionsUseDocumentTree
+                                                                    error:&treeError];
+
+                for (size_t i = 0; i < sizeof options / sizeof options[0]; i++) {
+                    NSError *error = nil;
+                    id compacted = [SCIXMLSerialization compactedObjectWithXMLData:document
+                                                               compactingTransform:transforms[t]
+                                                                           options:options[i]
+                                                                             error:&error];
+
+                    SCITestCheck(SCITestSameOutcome(compacted, error, tree, treeError),
+                                 @"compacting '%@' with transform #%lu and options %lu differs:\n%@ (%@)\nexpected %@ (%@)",
+                                 SCITestDescription(document), (unsigned long)t, (unsigned long)options[i],
+                                 compacted, error, tree, treeError);
+                }
+            }
+        }
+    }
+}
+
+
+#pragma mark - Compiled Transforms
+
+// A compiled transform must give the same results as the transforms it
+// is made of, nested in closures
+static void SCITestCompiledTransforms(NSArray<NSData *> *documents) {
+    id <SCIXMLCompactingTransform> nested =
+        [SCIXMLCompactingTransform combineTransforms:SCITestBuiltinTransforms()
+                          conflictResolutionStrategy:SCIXMLTransformCombinationConflictResolutionStrategyCompose];
+    id <SCIXMLCompactingTransform> compiled =
+        [SCIXMLCompiledCompactingTransform compiledTransformWithTransforms:SCITestBuiltinTransforms()];
+
+    for (NSData *document in documents) {
+        @autoreleasepool {
+            // Each transform gets a tree of its own, because compacting may modify it
+            NSDictionary *tree = [SCIXMLSerialization canonicalDictionaryWithXMLData:document error:NULL];
+            NSDictionary *copy = [SCIXMLSerialization canonicalDictionaryWithXMLData:document error:NULL];
+
+            if (tree == nil) {
+                continue;
+            }
+
+            NSError *nestedError = nil;
+            NSError *compiledError = nil;
+            id nestedResult = [SCIXMLSerialization compactedObjectWithCanonicalDictionary:copy
+                                                                      compactingTransform:nested
+                                                                       maximumConcurrency:1
+                                                                                    error:&nestedError];
+            id compiledResult = [SCIXMLSerialization compactedObjectWithCanonicalDictionary:tree
+                                                                        compactingTransform:compiled
+                                                                         maximumConcurrency:1
+                                                                                      error:&compiledError];
+
+            SCITestCheck(SCITestSameOutcome(compiledResult, compiledError, nestedResult, nestedError),
+                         @"compiled transform differs on '%@':\n%@ (%@)\nexpected %@ (%@)",
+                         SCITestDescription(document), compiledResult, compiledError, nestedResult, nestedError);
+        }
+    }
+}
+
+
+#pragma mark - No-Copy Strings
+
+// Strings, subtrees and copies taken out of a tree built without copying
+// strings must remain valid after the tree is released
+static void SCITestNoCopyLifetime(NSArray<NSData *> *documents) {
+    SCIXMLReadingOptions options[] = {
+        SCIXMLReadingOptionsNoCopyStrings,
+        SCIXMLReadingOptionsCanonicalNodeClass | SCIXMLReadingOptionsNoCopyStrings,
+        SCIXMLReadingOptionsUseDocumentTree | SCIXMLReadingOptionsNoCopyStrings,
+        SCIXMLReadingOptionsLazyTree,
+        SCIXMLReadingOptionsLazyTree | SCIXMLReadingOptionsNoCopyStrings,
+    };
+
+    for (NSData *document in documents) {
+        NSDictionary *expected = [SCIXMLSerialization canonicalDictionaryWithXMLData:document error:NULL];
+
+        if (expected == nil) {
+            continue;
+        }
+
+        for (size_t i = 0; i < sizeof options / sizeof options[0]; i++) {
+            NSArray *children = nil;
+            NSDictionary *attributes = nil;
+            NSDictionary *shallowCopy = nil;
+            NSMutableDictionary *mutableCopy = nil;
+            NSString *text = nil;
+
+            @autoreleasepool {
+                NSDictionary *tree = [SCIXMLSerialization canonicalDictionaryWithXMLData:document
+                                                                                 options:options[i]
+                                                                                   error:NULL];
+                children = tree[SCIXMLNodeKeyChildren];
+                attributes = tree[SCIXMLNodeKeyAttributes];
+                shallowCopy = [tree copy];
+                mutableCopy = [tree mutableCopy];
+                text = [children.firstObject objectForKey:SCIXMLNodeKeyText];
+                tree = nil;
+            }
+
+            // Overwrite the memory freed if the strings didn't keep it alive
+            [SCIXMLSerialization canonicalDictionaryWithXMLData:document options:options[i] error:NULL];
+
+            SCITestCheck([children isEqual:expected[SCIXMLNodeKeyChildren]]
+                         && [attributes isEqual:expected[SCIXMLNodeKeyAttributes]]
+                         && [shallowCopy isEqual:expected]
+                         && [mutableCopy isEqual:expected]
+                         && (text == nil || [text isEqual:[expected[SCIXMLNodeKeyChildren][0] objectForKey:SCIXMLNodeKeyText]]),
+                         @"parts of '%@' taken out of the tree built with options %lu differ after releasing it",
+                         SCITestDescription(document), (unsigned long)options[i]);
+        }
+    }
+}
+
+
+#pragma mark - Concurrent Compaction
+
+// A document in which the root has several children with subtrees large
+// enough to be compacted concurrently, one of which has large children of
+// its own, and small children in between. Items whose number is in
+// 'failing' get a 'fail' attribute with their number.
+static NSData *SCITestLargeDocument(NSSet<NSNumber *> *failing) {
+    NSMutableString *xml = [NSMutableString stringWithString:@"<root>"];
+    NSUInteger item = 0;
+
+    for (NSUInteger group = 0; group < 8; group++) {
+        [xml appendFormat:@"<small n=\"%lu\"/>text", (unsigned long)group];
+        [xml appendString:@"<group>"];
+
+        for (NSUInteger sub = 0; sub < (group == 3 ? 2 : 1); sub++) {
+            [xml appendString:@"<sub>"];
+
+            // Each item is two nodes, so a sub-group has more than 1024
+            for (NSUInteger i = 0; i < 520; i++, item++) {
+                if ([failing containsObject:@(item)]) {
+                    [xml appendFormat:@"<item fail=\"%lu\">%lu</item>", (unsigned long)item, (unsigned long)item];
+                } else {
+                    [xml appendFormat:@"<item>%lu</item>", (unsigned long)item];
+                }
+            }
+
+            [xml appendString:@"</sub>"];
+        }
+
+        [xml appendString:@"</group>"];
+    }
+
+    [xml appendString:@"<small/></root>"];
+
+    return [xml dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+static id SCITestCompactLarge(NSData *document,
+                              id <SCIXMLCompactingTransform> transform,
+                              NSUInteger concurrency,
+                              NSError **error) {
+    // Compaction modifies the tree, so each call gets a tree of its own
+    NSDictionary *tree = [SCIXMLSerialization canonicalDictionaryWithXMLData:document error:NULL];
+
+    return [SCIXMLSerialization compactedObjectWithCanonicalDictionary:tree
+                                                   compactingTransform:transform
+                                                    maximumConcurrency:concurrency
+                                                                 error:error];
+}
+
+// Compacting large subtrees concurrently, on any number of threads, must give
+// the same result as compacting serially, and if several nodes fail, the
+// error of the first one in document order must be reported
+static void SCITestConcurrentCompaction(void) {
+    NSData *document = SCITestLargeDocument([NSSet set]);
+
+    for (id <SCIXMLCompactingTransform> transform in SCITestCompactingTransforms()) {
+        NSError *serialError = nil;
+        id serial = SCITestCompactLarge(document, transform, 1, &serialError);
+        SCITestCheck(serial != nil, @"serial compaction failed: %@", serialError);
+
+        for (NSUInteger threads = 2; threads <= 16; threads *= 2) {
+            NSError *error = nil;
+            id concurrent = SCITestCompactLarge(document, transform, threads, &error);
+            SCITestCheck([concurrent isEqual:serial],
+                         @"concurrent compaction with %lu threads differs (%@)", (unsigned long)threads, error);
+        }
+    }
+
+    // Fails on the items with a 'fail' attribute. The first one is the last
+    // item of its subtree, and the later ones come early in theirs, which
+    // other threads take, so those threads are likely to fail first.
+    SCIXMLCompactingTransform *failing = [SCIXMLCompactingTransform new];
+
+    failing.nodeTransform = ^id (id node) {
+        NSString *number = node[SCIXMLNodeKeyAttributes][@"fail"];
+
+        if (number) {
+            return [NSError errorWithDomain:@"SCITest" code:0 userInfo:@{ @"item": number }];
+        }
+        return node;
+    };
+
+    NSArray<id <SCIXMLCompactingTransform>> *failingTransforms = @[
+        failing,
+        [SCIXMLCompiledCompactingTransform compiledTransformWithTransforms:@[ failing ]],
+    ];
+
+    document = SCITestLargeDocument([NSSet setWithArray:@[ @1559, @2080, @3120, @3900, @4000 ]]);
+
+    for (id <SCIXMLCompactingTransform> transform in failingTransforms) {
+        for (NSUInteger threads = 1; threads <= 16; threads *= 2) {
+            for (NSUInteger run = 0; run < 4; run++) {
+                NSError *error = nil;
+                id result = SCITestCompactLarge(document, transform, threads, &error);
+
+                SCITestCheck(result == nil && [error.userInfo[@"item"] isEqual:@"1559"],
+                             @"compaction with %lu threads reports %@ instead of the first failure",
+                             (unsigned long)threads, error);
+            }
+        }
+    }
+}
+
+
+#pragma mark - Records
+
+static NSArray *SCITestStreamRecords(NSData *document,
+                                     id <SCIXMLCompactingTransform> transform,
+                                     NSUInteger limit,
+                                     NSError **error) {
+    NSMutableArray *records = [NSMutableArray new];
+    BOOL success = [SCIXMLSerialization enumerateRecordsWithXMLStream:[NSInputStream inputStreamWithData:document]
+                                                           recordPath:@[ @"root", @"record" ]
+                                                  compactingTransform:transform
+                                                           usingBlock:^(id record, BOOL *stop) {
+        [records addObject:record];
+        *stop = records.count == limit;
+    }
+                                                                error:error];
+    return success ? records : nil;
+}
+
+// Streamed records must equal the elements at the record path in the
+// canonical tree, compacted on their own if a transform is given
+static void SCITestRecords(void) {
+    // Larger than a chunk of the stream, so that records span chunks
+    NSMutableString *xml = [NSMutableString stringWithString:@"<root><header>ignored</header>"];
+
+    for (NSUInteger i = 0; xml.length < 256 * 1024; i++) {
+        [xml appendFormat:@"<record id=\"%lu\"><date>2017-04-03T13:37:42</date>"
+                           "<name>record &amp; %lu</name><record>nested</record></record>"
+                           "text<other><record>elsewhere</record></other>",
+                          (unsigned long)i, (unsigned long)i];
+    }
+    [xml appendString:@"<record/></root>"];
+
+    NSData *document = [xml dataUsingEncoding:NSUTF8StringEncoding];
+    NSDictionary *root = [SCIXMLSerialization canonicalDictionaryWithXMLData:document error:NULL];
+
+    NSMutableArray<NSDictionary *> *expected = [NSMutableArray new];
+
+    for (NSDictionary *child in root[SCIXMLNodeKeyChildren]) {
+        if ([child[SCIXMLNodeKeyName] isEqual:@"record"]) {
+            [expected addObject:child];
+        }
+    }
+
+    NSError *error = nil;
+    NSArray *records = SCITestStreamRecords(document, nil, 0, &error);
+    SCITestCheck([records isEqual:expected],
+                 @"streamed records differ: %lu vs. %lu (%@)",
+                 (unsigned long)records.count, (unsigned long)expected.count, error);
+
+    for (id <SCIXMLCompactingTransform> transform in SCITestCompactingTransforms()) {
+        // Compacting modifies the records, so they are streamed again
+        NSMutableArray *compacted = [NSMutableArray new];
+
+        for (NSDictionary *record in SCITestStreamRecords(document, nil, 0, NULL)) {
+            [compacted addObject:[SCIXMLSerialization compactedObjectWithCanonicalDictionary:record
+                                                                         compactingTransform:transform
+                                                                          maximumConcurrency:1
+                                                                                       error:NULL] ?: NSNull.null];
+        }
+
+        error = nil;
+        records = SCITestStreamRecords(document, transform, 0, &error);
+        SCITestCheck([records isEqual:compacted],
+                     @"compacted streamed records differ: %lu vs. %lu (%@)",
+                     (unsigned long)records.count, (unsigned long)compacted.count, error);
+    }
+
+    // Stopping is not an error, and no more records are passed to the block
+    error = nil;
+    records = SCITestStreamRecords(document, nil, 2, &error);
+    SCITestCheck([records isEqual:[expected subarrayWithRange:NSMakeRange(0, 2)]] && error == nil,
+                 @"stopping after two records: %@ (%@)", records, error);
+
+    // Records before a syntax error are still passed to the block
+    __block NSUInteger count = 0;
+    error = nil;
+    BOOL success = [SCIXMLSerialization enumerateRecordsWithXMLStream:[NSInputStream inputStreamWithData:
+                                                                       [@"<root><record/><record>" dataUsingEncoding:NSUTF8StringEncoding]]
+                                                           recordPath:@[ @"root", @"record" ]
+                                                  compactingTransform:nil
+                                                           usingBlock:^(id record, BOOL *stop) {
+        count++;
+    }
+                                                                error:&error];
+    SCITestCheck(success == NO && count == 1 && error.code == SCIXMLErrorCodeMalformedXML,
+                 @"truncated records: %lu (%@)", (unsigned long)count, error);
+}
+
+
+#pragma mark - Writing
+
+static NSData *_Nullable SCITestWriteRecords(NSString *rootName,
+                                             id attributes,
+                                             NSArray *records,
+                                             NSError **error) {
+    NSEnumerator *enumerator = records.objectEnumerator;
+    NSOutputStream *stream = [NSOutputStream outputStreamToMemory];
+    BOOL success = [SCIXMLSerialization writeRecordsToXMLStream:stream
+                                                rootElementName:rootName
+                                                     attributes:attributes
+                                        canonicalizingTransform:nil
+                                                    indentation:nil
+                                                     usingBlock:^id _Nullable {
+        return enumerator.nextObject;
+    }
+                                                          error:error];
+    return success ? [stream propertyForKey:NSStreamDataWrittenToMemoryStreamKey] : nil;
+}
+
+// Writing a canonical tree into a stream, or its children one by one as
+// records, must give the same document as writing it into memory
+static void SCITestWriting(NSArray<NSData *> *documents) {
+    for (NSData *document in documents) {
+        NSDictionary *tree = [SCIXMLSerialization canonicalDictionaryWithXMLData:document error:NULL];
+
+        if (tree == nil) {
+            continue;
+        }
+
+        NSError *error = nil;
+        NSData *expected = [SCIXMLSerialization xmlDataWithCanonicalDictionary:tree indentation:nil error:&error];
+        SCITestCheck(expected != nil, @"could not write '%@': %@", SCITestDescription(document), error);
+
+        NSOutputStream *stream = [NSOutputStream outputStreamToMemory];
+        BOOL success = [SCIXMLSerialization writeCanonicalDictionary:tree
+                                                         toXMLStream:stream
+                                                         indentation:nil
+                                                               error:&error];
+        NSData *streamed = [stream propertyForKey:NSStreamDataWrittenToMemoryStreamKey];
+        SCITestCheck(success && [streamed isEqual:expected],
+                     @"streamed document differs for '%@' (%@)", SCITestDescription(document), error);
+
+        streamed = SCITestWriteRecords(tree[SCIXMLNodeKeyName], tree[SCIXMLNodeKeyAttributes], tree[SCIXMLNodeKeyChildren], &error);
+        SCITestCheck([streamed isEqual:expected],
+                     @"streamed records differ for '%@' (%@)", SCITestDescription(document), error);
+    }
+
+    // The attributes of the root element are checked like those of any other element
+    NSArray *malformedAttributes = @[
+        @{ @"name": @1 },
+        @{ @1: @"value" },
+        @[ @"name", @"value" ],
+    ];
+
+    for (id attributes in malformedAttributes) {
+        NSError *error = nil;
+        NSData *data = SCITestWriteRecords(@"root", attributes, @[], &error);
+        SCITestCheck(data == nil && error.code == SCIXMLErrorCodeMalformedTree,
+                     @"writing records in a root with attributes %@ should fail: %@", attributes, error);
+    }
+}
+
+
+#pragma mark - Direct Writer
+
+static NSDictionary *SCITestElement(NSString *name, NSDictionary *attributes, NSArray *children) {
+    return @{
+        SCIXMLNodeKeyType:       SCIXMLNodeTypeElement,
+        SCIXMLNodeKeyName:       name,
+        SCIXMLNodeKeyAttributes: attributes,
+        SCIXMLNodeKeyChildren:   children,
+    };
+}
+
+static NSDictionary *SCITestNode(NSString *type, NSString *text) {
+    return @{ SCIXMLNodeKeyType: type, SCIXMLNodeKeyText: text };
+}
+
+// The direct writer must write the same bytes as xmlTextWriter, with any
+// indentation, and fail with the same error codes on malformed trees
+static void SCITestDirectWriter(NSArray<NSData *> *documents) {
+    // Everything that needs escaping, including non-ASCII characters in
+    // attribute values, and every node type in every position that affects
+    // indentation
+    NSString *special = @"<a href=\"x\">&amp;\t\r\n é€\U0001F600 ]]> -- \x01";
+
+    NSMutableArray<NSDictionary *> *trees = [NSMutableArray arrayWithObjects:
+        SCITestElement(@"root", @{ @"a": special, @"b": @"" }, @[
+            SCITestElement(@"empty", @{}, @[]),
+            SCITestNode(SCIXMLNodeTypeText, special),
+            SCITestElement(@"text", @{}, @[ SCITestNode(SCIXMLNodeTypeText, @"") ]),
+            SCITestNode(SCIXMLNodeTypeComment, special),
+            SCITestElement(@"nested", @{ @"c": @"d" }, @[
+                SCITestNode(SCIXMLNodeTypeCDATA, special),
+                SCITestElement(@"x", @{}, @[ SCITestNode(SCIXMLNodeTypeComment, @"") ]),
+                @{ SCIXMLNodeKeyType: SCIXMLNodeTypeEntityRef, SCIXMLNodeKeyName: @"amp" },
+            ]),
+            SCITestElement(@"last", @{}, @[ SCITestElement(@"child", @{}, @[]) ]),
+        ]),
+        SCITestNode(SCIXMLNodeTypeText, special),
+
+        // Malformed trees
+        SCITestElement(@"root", @{}, @[ @{ SCIXMLNodeKeyType: SCIXMLNodeTypeText } ]),
+        SCITestElement(@"root", @{ @"a": @1 }, @[]),
+        SCITestElement(@"root", @{}, @[ @"not a node" ]),
+        SCITestElement(@"root", @{}, @[ @{ SCIXMLNodeKeyType: @"unknown" } ]),
+        @{ SCIXMLNodeKeyType: SCIXMLNodeTypeElement, SCIXMLNodeKeyName: @"root" },
+        nil
+    ];
+
+    for (NSData *document in documents) {
+        NSDictionary *tree = [SCIXMLSerialization canonicalDictionaryWithXMLData:document error:NULL];
+
+        if (tree) {
+            [trees addObject:tree];
+        }
+    }
+
+    for (NSDictionary *tree in trees) {
+        for (id indentationOrNull in @[ NSNull.null, @"", @"  ", @"\t" ]) {
+            NSString *indentation = indentationOrNull == NSNull.null ? nil : indentationOrNull;
+            NSError *libxmlError = nil;
+            NSError *directError = nil;
+
+            NSData *libxml = [SCIXMLSerialization xmlDataWithCanonicalDictionary:tree
+                                                                     indentation:indentation
+                                                                         options:SCIXMLWritingOptionsNone
+                                                                           error:&libxmlError];
+            NSData *direct = [SCIXMLSerialization xmlDataWithCanonicalDictionary:tree
+                                                                     indentation:indentation
+                                                                         options:SCIXMLWritingOptionsDirectWriter
+                                                                           error:&directError];
+
+            SCITestCheck(SCITestSameOutcome(direct, directError, libxml, libxmlError),
+                         @"writer outputs differ with indentation '%@':\n%@ (%@)\nexpected %@ (%@)",
+                         indentation,
+                         direct ? [[NSString alloc] initWithData:direct encoding:NSUTF8StringEncoding] : nil,
+                         directError,
+                         libxml ? [[NSString alloc] initWithData:libxml encoding:NSUTF8StringEncoding] : nil,
+                         libxmlError);
+        }
+    }
+}
+
+
+// The natural format of a canonical element: elements containing only text
+// become strings, others an array of single-key dictionaries, with the
+// attributes, if any, under the temporary keys. Other nodes are dropped,
+// and so is text mixed with elements.
+static id SCITestNaturalChild(NSDictionary *element) {
+    NSDictionary *attributes = element[SCIXMLNodeKeyAttributes];
+    NSMutableArray *children = [NSMutableArray new];
+    NSMutableString *text = [NSMutableString new];
+
+    for (NSDictionary *child in element[SCIXMLNodeKeyChildren]) {
+        NSString *type = child[SCIXMLNodeKeyType];
+
+        if ([type isEqualToString:SCIXMLNodeTypeElement]) {
+            [children addObject:@{ child[SCIXMLNodeKeyName]: SCITestNaturalChild(child) }];
+        } else if ([type isEqualToString:SCIXMLNodeTypeText]) {
+            [text appendString:child[SCIXMLNodeKeyText]];
+        }
+    }
+
+    id content = children.count > 0 ? children : text;
+
+    if (attributes.count == 0) {
+        return content;
+    }
+
+    return @{ SCIXMLTempKeyAttrs: attributes, SCIXMLTempKeyChild: content };
+}
+
+// Writing a natural dictionary directly must give the same bytes as
+// canonicalizing it first, including the order of attributes, and fail
+// with the same error codes on malformed dictionaries
+static void SCITestNaturalDirectWriter(NSArray<NSData *> *documents) {
+    NSString *special = @"<a href=\"x\">&amp;\t\r\n \u00e9\u20ac\U0001F600";
+
+    NSMutableArray<NSDictionary *> *trees = [NSMutableArray arrayWithObjects:
+        // Every form of natural dictionary
+        @{
+            @"root": @{
+                SCIXMLTempKeyAttrs: @{ @"a": special, @"b": @"", @"c": @"1", @"d": @"2", @"e": @"3" },
+                @"leaf": special,
+                @"empty": @"",
+                @"nothing": @{},
+                @"array": @[ @{ @"item": @"1" }, @{ @"item": @{ SCIXMLTempKeyAttrs: @{ @"x": @"y" } } }, @{ @"item": @[] } ],
+                @"text": @{ SCIXMLTempKeyAttrs: @{ @"lang": @"en" }, SCIXMLTempKeyChild: special },
+                @"list": @{ SCIXMLTempKeyChild: @[ @{ @"a": @"1" }, @{ @"a": @"2" } ] },
+                @"named": @{ SCIXMLTempKeyChild: @{ @"b": @"1", SCIXMLTempKeyAttrs: @{ @"ignored": @"yes" } } },
+            },
+        },
+
+        // Malformed dictionaries
+        @{},
+        @{ @"a": @"1", @"b": @"2" },
+        @{ @"root": @42 },
+        @{ @"root": @{ @"child": @[ @"not a dictionary" ] } },
+        @{ @"root": @[ @{ @"a": @"1", @"b": @"2" } ] },
+        @{ @"root": @{ SCIXMLTempKeyChild: @42 } },
+        @{ @"root": @{ SCIXMLTempKeyAttrs: @{ @"a": @42 } } },
+        @{ @42: @"root" },
+        @{ @"": @"empty name" },
+        nil
+    ];
+
+    for (NSData *document in documents) {
+        NSDictionary *tree = [SCIXMLSerialization canonicalDictionaryWithXMLData:document error:NULL];
+
+        if ([tree[SCIXMLNodeKeyType] isEqual:SCIXMLNodeTypeElement]) {
+            [trees addObject:@{ tree[SCIXMLNodeKeyName]: SCITestNaturalChild(tree) }];
+        }
+    }
+
+    for (NSDictionary *tree in trees) {
+        for (id indentationOrNull in @[ NSNull.null, @"", @"  " ]) {
+            NSString *indentation = indentationOrNull == NSNull.null ? nil : indentationOrNull;
+            NSError *canonicalError = nil;
+            NSError *directError = nil;
+
+            NSData *canonical = [SCIXMLSerialization xmlDataWithNaturalDictionary:tree
+                                                                      indentation:indentation
+                                                                          options:SCIXMLWritingOptionsNone
+                                                                            error:&canonicalError];
+            NSData *direct = [SCIXMLSerialization xmlDataWithNaturalDictionary:tree
+                                                                   indentation:indentation
+                                                                       options:SCIXMLWritingOptionsDirectWriter
+                                                                         error:&directError];
+
+            SCITestCheck(SCITestSameOutcome(direct, directError, canonical, canonicalError),
+                         @"natural writer outputs differ with indentation '%@':\n%@ (%@)\nexpected %@ (%@)",
+                         indentation,
+                         direct ? [[NSString alloc] initWithData:direct encoding:NSUTF8StringEncoding] : nil,
+                         directError,
+                         canonical ? [[NSString alloc] initWithData:canonical encoding:NSUTF8StringEncoding] : nil,
+                         canonicalError);
+        }
+    }
+}
+
+#pragma mark - Metrics
+
+// Keeps every report, from any thread
+@interface SCITestMetricsCollector : NSObject <SCIXMLMetricsDelegate>
+
+@property (nonatomic, strong) NSMutableArray<SCIXMLMetrics *> *reports;
+
+// Returns the reports received so far, and forgets them
+- (NSArray<SCIXMLMetrics *> *)takeReports;
+
+@end
+
+@implementation SCITestMetricsCollector
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _reports = [NSMutableArray new];
+    }
+    return self;
+}
+
+- (void)serializationDidFinishWithMetrics:(SCIXMLMetrics *)metrics {
+    @synchronized (self) {
+        [_reports addObject:metrics];
+    }
+}
+
+- (NSArray<SCIXMLMetrics *> *)takeReports {
+    @synchronized (self) {
+        NSArray<SCIXMLMetrics *> *reports = [_reports copy];
+        [_reports removeAllObjects];
+        return reports;
+    }
+}
+
+@end
+
+// The document tree and the SAX builder must report the same counts, every
+// byte must be counted, and the phases must fit in the call. Calls made by
+// transforms on the other threads of a concurrent compaction must be reported
+// on their own instead of being added to the compaction.
+static void SCITestMetrics(NSArray<NSData *> *documents) {
+    SCITestMetricsCollector *collector = [SCITestMetricsCollector new];
+    SCIXMLSerialization.metricsDelegate = collector;
+
+    for (NSData *document in documents) {
+        NSMutableArray<SCIXMLMetrics *> *metrics = [NSMutableArray new];
+
+        for (NSNumber *options in @[ @(SCIXMLReadingOptionsUseDocumentTree), @(SCIXMLReadingOptionsNone) ]) {
+            id tree = [SCIXMLSerialization canonicalDictionaryWithXMLData:document
+                                                                  options:options.unsignedIntegerValue
+                                                                    error:NULL];
+            SCIXMLMetrics *last = [collector takeReports].lastObject;
+            NSTimeInterval phases = 0;
+
+            for (SCIXMLMetricsPhase phase = 0; phase < SCIXMLMetricsPhaseCount; phase++) {
+                phases += [last durationOfPhase:phase];
+            }
+
+            SCITestCheck(last != nil && phases <= last.duration && (tree == nil || last.byteCount == document.length),
+                         @"inconsistent metrics for '%@': %@", SCITestDescription(document), last);
+
+            if (tree && last) {
+                [metrics addObject:last];
+            }
+        }
+
+        if (metrics.count == 2) {
+            SCITestCheck(metrics[0].nodeCount == metrics[1].nodeCount
+                      && metrics[0].attributeCount == metrics[1].attributeCount
+                      && metrics[0].maximumDepth == metrics[1].maximumDepth,
+                         @"metrics differ for '%@':\n%@\n%@", SCITestDescription(document), metrics[0], metrics[1]);
+        }
+
+        // Every sub-transform of a compiled transform is named after the one it comes from
+        id compacted = [SCIXMLSerialization compactedObjectWithXMLData:document
+                                                    compactingTransform:[SCIXMLCompiledCompactingTransform compiledTransformWithTransforms:SCITestBuiltinTransforms()]
+                                                                options:SCIXMLReadingOptionsNone
+                                                                  error:NULL];
+
+        if (compacted) {
+            NSSet *names = [NSSet setWithArray:[collector takeReports].lastObject.transformDurations.allKeys];
+            NSSet *expected = [NSSet setWithArray:@[
+                @"attributeFlattening", @"elementTypeFilter", @"textNodeFlattening",
+                @"attributeParser", @"memberParser",
+            ]];
+
+            SCITestCheck([names isSubsetOfSet:expected],
+                         @"unexpected transform names for '%@': %@", SCITestDescription(document), names);
+        }
+
+        [collector takeReports];
+    }
+
+    // Items compacted off the main thread parse a document of their own
+    NSString *nestedDocument = @"<nested/>";
+    __block NSUInteger nestedCalls = 0;
+    SCIXMLCompactingTransform *nesting = [SCIXMLCompactingTransform new];
+
+    nesting.nodeTransform = ^id (id node) {
+        if (NSThread.isMainThread == NO && [node[SCIXMLNodeKeyName] isEqual:@"item"]) {
+            [SCIXMLSerialization canonicalDictionaryWithXMLString:nestedDocument error:NULL];
+
+            @synchronized (collector) {
+                nestedCalls++;
+            }
+        }
+        return node;
+    };
+
+    for (id <SCIXMLCompactingTransform> transform in @[
+        nesting,
+        [SCIXMLCompiledCompactingTransform compiledTransformWithTransforms:@[ nesting ]],
+    ]) {
+        NSDictionary *tree = [SCIXMLSerialization canonicalDictionaryWithXMLData:SCITestLargeDocument([NSSet set]) error:NULL];
+        nestedCalls = 0;
+        [collector takeReports];
+
+        NSError *error = nil;
+        id result = [SCIXMLSerialization compactedObjectWithCanonicalDictionary:tree
+                                                            compactingTransform:transform
+                                                             maximumConcurrency:8
+                                                                          error:&error];
+        SCITestCheck(result != nil, @"concurrent compaction failed: %@", error);
+
+        NSArray<SCIXMLMetrics *> *reports = [collector takeReports];
+        NSUInteger nestedReports = 0;
+
+        for (SCIXMLMetrics *report in reports) {
+            if ([report.operation hasPrefix:@"canonicalDictionaryWithXMLString:"]) {
+                SCITestCheck(report.byteCount == nestedDocument.length && report.nodeCount == 1,
+                             @"nested call on a helper thread recorded %@", report);
+                nestedReports++;
+            }
+        }
+
+        SCITestCheck(nestedReports == nestedCalls && reports.lastObject.byteCount == 0,
+                     @"%lu of %lu nested calls reported on their own, compaction recorded %@",
+                     (unsigned long)nestedReports, (unsigned long)nestedCalls, reports.lastObject);
+    }
+
+    SCIXMLSerialization.metricsDelegate = nil;
+}
+
+#pragma mark - Projections
+
+// Removes what the projection doesn't select from a canonical tree, the slow way
+static NSDictionary *_Nullable SCITestProject(NSDictionary *node,
+                                              NSArray<NSString *> *path,
+                                              SCIXMLProjection *projection,
+                                              BOOL keepsContent) {
+
+    NSString *name = node[SCIXMLNodeKeyName];
+    NSArray<NSString *> *nodePath = [path arrayByAddingObject:name];
+
+    if ([projection.droppedElementNames containsObject:name]) {
+        return nil;
+    }
+
+    for (NSArray<NSString *> *dropped in projection.droppedPaths) {
+        if (nodePath.count >= dropped.count && [[nodePath subarrayWithRange:NSMakeRange(0, dropped.count)] isEqual:dropped]) {
+            return nil;
+        }
+    }
+
+    BOOL leadsToKept = keepsContent;
+    BOOL kept = keepsContent;
+
+    for (NSArray<NSString *> *keptPath in projection.keptPaths) {
+        NSUInteger count = MIN(nodePath.count, keptPath.count);
+        BOOL matches = [[nodePath subarrayWithRange:NSMakeRange(0, count)] isEqual:[keptPath subarrayWithRange:NSMakeRange(0, count)]];
+
+        leadsToKept |= matches;
+        kept |= matches && nodePath.count >= keptPath.count;
+    }
+
+    if (leadsToKept == NO) {
+        return nil;
+    }
+
+    NSMutableDictionary *projected = [node mutableCopy];
+    NSMutableArray *children = [NSMutableArray new];
+
+    for (NSDictionary *child in node[SCIXMLNodeKeyChildren]) {
+        if ([child[SCIXMLNodeKeyType] isEqual:SCIXMLNodeTypeElement] == NO) {
+            if (kept) {
+                [children addObject:child];
+            }
+            continue;
+        }
+
+        NSDictionary *projectedChild = SCITestProject(child, nodePath, projection, kept);
+
+        if (projectedChild) {
+            [children addObject:projectedChild];
+        }
+    }
+
+    projected[SCIXMLNodeKeyChildren] = children;
+
+    return projected;
+}
+
+// Parsing with a projection must give the same tree as removing what it
+// doesn't select from the whole canonical tree
+static void SCITestProjections(NSArray<NSData *> *documents) {
+    NSString *records =
+        @"<root><record id=\"1\"><customer>A</customer><created>x</created><total>3</total>"
+         "<items><item n=\"1\"><label>l</label>t</item><item/></items>"
+         "<level>a<level>deep<level/></level><!-- c --></level></record>"
+         "text<record/><paragraph>p<item/></paragraph></root>";
+
+    NSArray<SCIXMLProjection *> *projections = @[
+        [SCIXMLProjection projectionKeepingPaths:@[ @"root/record/customer", @"root/record/created", @"root/record/total" ]],
+        [SCIXMLProjection projectionKeepingPaths:@[ @"root/child", @"root/c/d", @"r/b" ]],
+        [SCIXMLProjection projectionDroppingPaths:@[ @"root/record/items", @"root/record/level/level" ]],
+        [SCIXMLProjection projectionDroppingElementsNamed:@[ @"paragraph", @"item", @"child" ]],
+        [[SCIXMLProjection alloc] initWithKeptPaths:@[ @"root/record/level", @"root/record/items" ]
+                                       droppedPaths:@[ @"root/record/items/item/label" ]
+                                droppedElementNames:@[ @"customer" ]],
+    ];
+
+    NSArray<NSData *> *inputs = [@[ [records dataUsingEncoding:NSUTF8StringEncoding] ] arrayByAddingObjectsFromArray:documents];
+
+    for (NSData *document in inputs) {
+        NSDictionary *whole = [SCIXMLSerialization canonicalDictionaryWithXMLData:document error:NULL];
+
+        // A projection may skip what makes a document malformed or unsupported
+        if (whole == nil) {
+            continue;
+        }
+
+        for (SCIXMLProjection *projection in projections) {
+            NSDictionary *expected = SCITestProject(whole, @[], projection, projection.keptPaths == nil);
+
+            for (NSNumber *options in @[ @(SCIXMLReadingOptionsNone), @(SCIXMLReadingOptionsCanonicalNodeClass) ]) {
+                NSError *error = nil;
+                NSDictionary *projected = [SCIXMLSerialization canonicalDictionaryWithXMLData:document
+                                                                                   projection:projection
+                                                                                      options:options.unsignedIntegerValue
+                                                                                        error:&error];
+
+                SCITestCheck((expected == nil) == (projected == nil) && (expected == nil || [expected isEqual:projected]),
+                             @"projection %@ of '%@' differs:\n%@ (%@)\nexpected %@",
+                             projection, SCITestDescription(document), projected, error, expected);
+            }
+        }
+    }
+}
+
+#pragma mark - Parser Reuse
+
+// Parsers reused after malformed documents, and parses nested in each other,
+// must give the same results as the document tree
+static void SCITestParserReuse(NSArray<NSData *> *documents) {
+    // A malformed document leaves the reused parser in the middle of a parse
+    NSData *malformed = [@"<root a=\"1\"><child>text</chi" dataUsingEncoding:NSUTF8StringEncoding];
+
+    for (NSData *document in documents) {
+        NSError *domError = nil;
+        id dom = [SCIXMLSerialization canonicalDictionaryWithXMLData:document
+                                                             options:SCIXMLReadingOptionsUseDocumentTree
+                                                               error:&domError];
+
+        id failed = [SCIXMLSerialization canonicalDictionaryWithXMLData:malformed error:NULL];
+        SCITestCheck(failed == nil, @"malformed document parsed: %@", failed);
 
         NSError *error = nil;
-        NSString *xml = [SCIXMLSerialization xmlStringWithNaturalDictionary:root
-                                                                indentation:@"    "
-                                                                      error:&error];
+        id sax = [SCIXMLSerialization canonicalDictionaryWithXMLData:document error:&error];
+
+        SCITestCheck(SCITestSameOutcome(sax, error, dom, domError),
+                     @"parsing '%@' after a malformed document differs:\n%@ (%@)\nexpected %@ (%@)",
+                     SCITestDescription(document), sax, error, dom, domError);
+
+        if (dom == nil) {
+            continue;
+        }
+
+        // Parses nested in another one (here, in a fused compaction)
+        // can't use the parser of the thread, which is still parsing
+        __block id nested = nil;
+        SCIXMLCompactingTransform *nesting = [SCIXMLCompactingTransform new];
+
+        nesting.typeTransform = ^id (id type) {
+            nested = nested ?: [SCIXMLSerialization canonicalDictionaryWithXMLData:document error:NULL];
+            return type;
+        };
+
+        [SCIXMLSerialization compactedObjectWithXMLData:document
+                                    compactingTransform:nesting
+                                                options:SCIXMLReadingOptionsNone
+                                                  error:NULL];
+
+        SCITestCheck([nested isEqual:dom],
+                     @"nested parse of '%@' differs:\n%@\nexpected %@", SCITestDescription(document), nested, dom);
+    }
+}
+
+#pragma mark - Snapshots
+
+// Every kind of value, including numbers that don't fit in a value inline
+static NSDictionary *SCITestSnapshotValues(void) {
+    return @{
+        @"integers": @[ @0, @-1, @(INT64_MIN), @(INT64_MAX), @(UINT64_MAX) ],
+        @"floating": @[ @0.5, @-1e300 ],
+        @"booleans": @[ @YES, @NO ],
+        @"null":     NSNull.null,
+        @"date":     [NSDate dateWithTimeIntervalSince1970:1234567890.5],
+        @"data":     [@"\u00e1rv\u00edzt\u0171r\u0151" dataUsingEncoding:NSUTF8StringEncoding],
+        @"url":      [NSURL URLWithString:@"https://sciapps.io/a?b=c"],
+        @"empty":    @[ @{}, @[], @"" ],
+        @"":         @"empty key",
+    };
+}
+
+// Canonical and compacted trees, and values of every kind, must be loaded as
+// they were written. Snapshots of other XML or another configuration are
+// stale, truncated ones are malformed, and the snapshot-caching compaction
+// method must write a snapshot, load it, and replace it once it's truncated.
+static void SCITestSnapshots(NSArray<NSData *> *documents) {
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:
+                      [NSString stringWithFormat:@"scitest-%d.snapshot", (int)getpid()]];
+    id <SCIXMLCompactingTransform> transform = SCITestCompactingTransforms()[0];
+
+    for (NSData *document in documents) {
+        id canonical = [SCIXMLSerialization canonicalDictionaryWithXMLData:document error:NULL];
+        id compacted = [SCIXMLSerialization compactedObjectWithXMLData:document compactingTransform:transform error:NULL];
+
+        if (canonical == nil || compacted == nil) {
+            continue;
+        }
+
+        for (id tree in @[ canonical, compacted, SCITestSnapshotValues() ]) {
+            NSError *error = nil;
+            BOOL written = [SCIXMLSerialization writeSnapshotOfObject:tree
+                                                              xmlData:document
+                                                        configuration:@"test"
+                                                               toFile:path
+                                                                error:&error];
+            id loaded = [SCIXMLSerialization objectWithSnapshotFile:path xmlData:document configuration:@"test" error:&error];
+            id unchecked = [SCIXMLSerialization objectWithSnapshotFile:path xmlData:nil configuration:@"test" error:NULL];
+
+            SCITestCheck(written && [loaded isEqual:tree] && [unchecked isEqual:tree],
+                         @"snapshot of '%@' differs:\n%@ (%@)\nexpected %@", SCITestDescription(document), loaded, error, tree);
+        }
+
+        // The last snapshot written is the one of the values
+        NSData *otherXML = [document subdataWithRange:NSMakeRange(0, document.length - 1)];
+        NSError *otherXMLError = nil;
+        NSError *otherConfigurationError = nil;
+
+        id otherXMLResult = [SCIXMLSerialization objectWithSnapshotFile:path
+                                                                xmlData:otherXML
+                                                          configuration:@"test"
+                                                                  error:&otherXMLError];
+        id otherConfigurationResult = [SCIXMLSerialization objectWithSnapshotFile:path
+                                                                          xmlData:document
+                                                                    configuration:@"other"
+                                                                            error:&otherConfigurationError];
+
+        SCITestCheck(otherXMLResult == nil && otherXMLError.code == SCIXMLErrorCodeStaleSnapshot
+                  && otherConfigurationResult == nil && otherConfigurationError.code == SCIXMLErrorCodeStaleSnapshot,
+                     @"stale snapshot of '%@' loaded: %@, %@", SCITestDescription(document), otherXMLError, otherConfigurationError);
+
+        // The first call writes the snapshot that the second one loads,
+        // and the third one replaces it after it has been truncated
+        [NSFileManager.defaultManager removeItemAtPath:path error:NULL];
+
+        NSData *snapshot = nil;
+
+        for (NSUInteger i = 0; i < 3; i++) {
+            if (i == 2) {
+                [[snapshot subdataWithRange:NSMakeRange(0, snapshot.length / 2)] writeToFile:path atomically:YES];
+
+                NSError *error = nil;
+                id truncated = [SCIXMLSerialization objectWithSnapshotFile:path xmlData:document configuration:@"test" error:&error];
+
+                SCITestCheck(truncated == nil && error.code == SCIXMLErrorCodeMalformedSnapshot,
+                             @"truncated snapshot of '%@' loaded: %@ (%@)", SCITestDescription(document), truncated, error);
+            }
+
+            NSError *error = nil;
+            id cached = [SCIXMLSerialization compactedObjectWithXMLData:document
+                                                    compactingTransform:transform
+                                                                options:SCIXMLReadingOptionsNone
+                                                           snapshotFile:path
+                                                          configuration:@"test"
+                                                                  error:&error];
+            NSData *written = [NSData dataWithContentsOfFile:path];
+
+            SCITestCheck([cached isEqual:compacted] && written.length > 0 && (snapshot == nil || [written isEqual:snapshot]),
+                         @"cached compaction of '%@' differs:\n%@ (%@)\nexpected %@",
+                         SCITestDescription(document), cached, error, compacted);
+
+            snapshot = snapshot ?: written;
+        }
+
+        [NSFileManager.defaultManager removeItemAtPath:path error:NULL];
+    }
+
+    // Not a snapshot at all
+    [[@"<root/>" dataUsingEncoding:NSUTF8StringEncoding] writeToFile:path atomically:YES];
+
+    NSError *error = nil;
+    id result = [SCIXMLSerialization objectWithSnapshotFile:path xmlData:nil configuration:@"test" error:&error];
+    SCITestCheck(result == nil && error.code == SCIXMLErrorCodeMalformedSnapshot,
+                 @"XML loaded as a snapshot: %@ (%@)", result, error);
+
+    [NSFileManager.defaultManager removeItemAtPath:path error:NULL];
+}
+
+#pragma mark - Escaping
+
+static NSString *SCITestRepeat(NSString *string, NSUInteger count) {
+    NSMutableString *repeated = [NSMutableString stringWithCapacity:string.length * count];
+
+    for (NSUInteger i = 0; i < count; i++) {
+        [repeated appendString:string];
+    }
+
+    return repeated;
+}
+
+// Strings of all lengths made of letters, characters that are escaped,
+// non-ASCII characters and things that look like escape sequences, and
+// long strings with a single special character near the end, so that all
+// of the vectorized, scalar and chunked code paths are taken.
+static NSArray<NSString *> *SCITestEscapeCorpus(void) {
+    NSArray<NSString *> *pieces = @[
+        @"a", @"Z", @"0", @" ", @"\"", @"'", @"\\", @"&", @"<", @">", @";", @"#", @"?",
+        @"\n", @"\r", @"\t", @"\a", @"\x01", @"\x1F", @"\x7F", @"é", @"\u2028", @"\U0001F600",
+        @"&amp;", @"&#65;", @"\\n", @"\\x41", @"\\u00e9",
+    ];
+    NSMutableArray<NSString *> *corpus = [@[ @"" ] mutableCopy];
+
+    srandom(1);
+
+    for (NSUInteger length = 1; length < 1000; length++) {
+        NSMutableString *string = [NSMutableString new];
+
+        for (NSUInteger i = 0; i < length; i++) {
+            // Mostly letters, so that there are clean runs of all lengths
+            [string appendString:random() % 4 ? @"x" : pieces[random() % pieces.count]];
+        }
+
+        [corpus addObject:string];
+    }
+
+    for (NSString *special in @[ @"", @"\"", @"\\", @"&", @"<", @"\n", @"\x7F" ]) {
+        for (NSUInteger offset = 1; offset < 40; offset++) {
+            NSString *padding = SCITestRepeat(@"x", 5000 - offset);
+            [corpus addObject:[NSString stringWithFormat:@"%@%@%@", padding, special, SCITestRepeat(@"y", offset)]];
+        }
+    }
+
+    return corpus;
+}
+
+// Escaped strings and what they unescape to, or NSNull if they are invalid
+static NSDictionary<NSString *, id> *SCITestUnescapeCCases(void) {
+    return @{
+        @"\\a\\b\\f\\n\\r\\t\\v":   @"\a\b\f\n\r\t\v",
+        @"\\\\\\'\\\"\\?":          @"\\'\"?",
+        @"\\1\\101\\1010\\177":     @"\1AA0\177",
+        @"\\x41\\x041\\x7f":        @"AA\177",
+        @"\\u00e9\\U0001F600":      @"é\U0001F600",
+        @"\\xc3\\xa9":              @"é",
+        @"\\":                      NSNull.null,
+        @"\\q":                     NSNull.null,
+        @"\\8":                     NSNull.null,
+        @"\\400":                   NSNull.null,
+        @"\\x":                     NSNull.null,
+        @"\\x100":                  NSNull.null,
+        @"\\xff":                   NSNull.null,
+        @"\\u00e":                  NSNull.null,
+        @"\\ud800":                 NSNull.null,
+        @"\\U00110000":             NSNull.null,
+    };
+}
+
+static NSDictionary<NSString *, id> *SCITestUnescapeXMLCases(void) {
+    return @{
+        @"&lt;&gt;&amp;&quot;&apos;":   @"<>&\"'",
+        @"&amp;lt;":                    @"&lt;",
+        @"&#65;&#x41;&#0065;&#xe9;":    @"AAAé",
+        @"&#x1F600;&#9;&#13;":          @"\U0001F600\t\r",
+        @"&":                           NSNull.null,
+        @"&lt":                         NSNull.null,
+        @"&nbsp;":                      NSNull.null,
+        @"&#X41;":                      NSNull.null,
+        @"&#;":                         NSNull.null,
+        @"&#x;":                        NSNull.null,
+        @"&#0;":                        NSNull.null,
+        @"&#xD800;":                    NSNull.null,
+        @"&#xFFFE;":                    NSNull.null,
+        @"&#x110000;":                  NSNull.null,
+        @"&#99999999999999999999;":     NSNull.null,
+    };
+}
+
+// Escaping and then unescaping must give back the string, XML escaping must
+// escape the same characters as libxml does in text, strings that don't
+// change must not be copied, and escape sequences must unescape as expected
+static void SCITestEscapes(void) {
+    for (NSString *string in SCITestEscapeCorpus()) {
+        @autoreleasepool {
+            id escapedC = SCIStringEscapeC(string);
+            id escapedXML = SCIStringEscapeXML(string);
+            id unescapedC = [escapedC isKindOfClass:NSString.class] ? SCIStringUnescapeC(escapedC) : escapedC;
+            id unescapedXML = [escapedXML isKindOfClass:NSString.class] ? SCIStringUnescapeXML(escapedXML) : escapedXML;
+
+            xmlChar *encoded = xmlEncodeSpecialChars(NULL, (const xmlChar *)string.UTF8String);
+            NSString *expectedXML = @((const char *)encoded);
+            xmlFree(encoded);
+
+            NSArray *results = @[ escapedC, escapedXML, SCIStringUnescapeC(string), SCIStringUnescapeXML(string) ];
+            BOOL copied = NO;
+
+            for (id result in results) {
+                copied = copied || ([result isEqual:string] && result != string);
+            }
+
+            SCITestCheck([unescapedC isEqual:string] && [unescapedXML isEqual:string] && [escapedXML isEqual:expectedXML] && copied == NO,
+                         @"escaping differs for '%@': %@, %@ (expected %@)",
+                         string.length > 100 ? [string substringToIndex:100] : string,
+                         escapedC, escapedXML, expectedXML);
+        }
+    }
+
+    NSString *escapedC = SCIStringEscapeC(@"tab\there \"quoted\" \\ \1\177é");
+    SCITestCheck([escapedC isEqual:@"tab\\there \\\"quoted\\\" \\\\ \\001\\177é"],
+                 @"escaping as C differs: %@", escapedC);
+
+    NSMutableArray<NSArray *> *cases = [NSMutableArray new];
+
+    [SCITestUnescapeCCases() enumerateKeysAndObjectsUsingBlock:^(NSString *string, id expected, BOOL *stop) {
+        [cases addObject:@[ string, expected, SCIStringUnescapeC(string) ]];
+    }];
+
+    [SCITestUnescapeXMLCases() enumerateKeysAndObjectsUsingBlock:^(NSString *string, id expected, BOOL *stop) {
+        [cases addObject:@[ string, expected, SCIStringUnescapeXML(string) ]];
+    }];
+
+    for (NSArray *unescapeCase in cases) {
+        id expected = unescapeCase[1];
+        id result = unescapeCase[2];
+
+        SCITestCheck(expected == NSNull.null ? [result isKindOfClass:NSError.class] : [result isEqual:expected],
+                     @"unescaping differs for '%@': %@ (expected %@)", unescapeCase[0], result, expected);
+    }
+}
+
+#pragma mark - Dates
+
+// Date strings in and around the formats of the Date parser type: valid ones,
+// out-of-range fields, dates before and around the Gregorian calendar reform,
+// all kinds of fractional seconds and UTC offsets, and malformed strings.
+// Always the same strings, so that differences are reproducible.
+static NSArray<NSString *> *SCITestDateStrings(void) {
+    NSMutableArray<NSString *> *strings = [@[
+        @"",
+        @"2026",
+        @"2026-10-17",
+        @"2026-10-17T08:30",
+        @"2026-10-17 08:30:15",
+        @" 2026-10-17T08:30:15",
+        @"2026-10-17T08:30:15 ",
+        @"2026-1-7T8:30:15",
+        @"26-10-17T08:30:15",
+        @"+2026-10-17T08:30:15",
+        @"02026-10-17T08:30:15",
+        @"2026-10-17T08:30:15.",
+        @"2026-10-17T08:30:15.1234",
+        @"2026-10-17T08:30:15.123456789Z",
+        @"2026-10-17T08:30:15z",
+        @"2026-10-17T08:30:15UTC",
+        @"2026-10-17T08:30:15GMT+01:00",
+        @"2026-10-17T08:30:15+01",
+        @"2026-10-17T08:30:15+1:00",
+        @"2026-10-17T08:30:15+01:00:00",
+        @"2026-10-17T08:30:15Zjunk",
+        @"2026-10-17T08:30:15.5 ",
+        @"٢٠٢٦-10-17T08:30:15",
+        @"1582-10-04T00:00:00",
+        @"1582-10-15T00:00:00",
+        @"1583-01-01T00:00:00Z",
+        @"1600-02-29T00:00:00",
+        @"1900-02-29T00:00:00",
+        @"2000-02-29T23:59:59.999-18:00",
+        @"1969-12-31T23:59:59.999Z",
+        @"9999-12-31T23:59:59+14:00",
+    ] mutableCopy];
+
+    NSArray<NSString *> *zones = @[ @"", @"Z", @"+%02u:%02u", @"-%02u:%02u", @"+%02u%02u", @"-%02u%02u", @"+%02u" ];
+    srandom(1);
+
+    for (NSUInteger i = 0; i < 10000; i++) {
+        // Mostly sensible values, with some just out of range
+        unsigned year = i % 10 == 0 ? random() % 10000 : 1500 + random() % 1000;
+        NSMutableString *string = [NSMutableString stringWithFormat:@"%04u-%02u-%02uT%02u:%02u:%02u",
+                                   year,
+                                   (unsigned)(random() % 14),
+                                   (unsigned)(random() % 33),
+                                   (unsigned)(random() % 25),
+                                   (unsigned)(random() % 61),
+                                   (unsigned)(random() % 62)];
+
+        unsigned fractionDigits = random() % 6;
+
+        if (fractionDigits > 0) {
+            [string appendString:@"."];
+
+            for (unsigned digit = 0; digit < fractionDigits; digit++) {
+                [string appendFormat:@"%u", (unsigned)(random() % 10)];
+            }
+        }
+
+        NSString *zone = zones[random() % zones.count];
+        [string appendFormat:zone, (unsigned)(random() % 25), (unsigned)(random() % 61)];
+
+        [strings addObject:string];
+    }
+
+    return strings;
+}
+
+// Parsing dates directly must give exactly the same results as NSDateFormatter
+static void SCITestDates(void) {
+    for (NSString *string in SCITestDateStrings()) {
+        @autoreleasepool {
+            NSDate *date = SCIStringToDate(string);
+            NSDate *expected = SCIStringToDateUsingFormatters(string);
+
+            // Compared exactly, not just to the millisecond
+            SCITestCheck((date == nil) == (expected == nil)
+                         && (date == nil || date.timeIntervalSince1970 == expected.timeIntervalSince1970),
+                         @"date parsing differs for '%@': %@ (expected %@)", string, date, expected);
+        }
+    }
+}
+
+
+#pragma mark - Base-64
+
+// Random bytes, always the same ones
+static NSData *SCITestRandomData(NSUInteger length) {
+    NSMutableData *data = [NSMutableData dataWithLength:length];
+    uint8_t *bytes = data.mutableBytes;
+
+    srandom(1);
+
+    for (NSUInteger i = 0; i < length; i++) {
+        bytes[i] = random();
+    }
+
+    return data;
+}
+
+// Base-64 strings of all lengths, with and without line breaks and other
+// whitespace, then with a character replaced by random ASCII or non-ASCII
+// characters, which mostly makes them invalid or non-canonical.
+static NSArray<NSString *> *SCITestBase64Strings(void) {
+    NSString *attachment = [SCITestRandomData(1024 * 1024) base64EncodedStringWithOptions:NSDataBase64Encoding76CharacterLineLength
+                                                                                           | NSDataBase64EncodingEndLineWithLineFeed];
+
+    NSMutableArray<NSString *> *strings = [@[
+        @"", @" ", @"=", @"==", @"A", @"AA", @"AA=", @"AA==", @"AA==\n", @"AAA=", @"AAAA", @"AB==", @"AAB=",
+        @"AAAA====", @"AA==AA==", @"A A A A", @"\vAAAA", @"AAAA ", @"AAAA AAAA", @"AA\n==",
+        attachment,
+    ] mutableCopy];
+
+    NSData *random = SCITestRandomData(1000);
+    NSArray<NSString *> *whitespace = @[ @" ", @"\t", @"\n", @"\r\n", @"\f", @"\v" ];
+    NSArray<NSString *> *replacements = @[ @"=", @"-", @"_", @"é", @"\U0001F600" ];
+
+    for (NSUInteger length = 0; length < 1000; length++) {
+        NSData *data = [random subdataWithRange:(NSRange){ 0, length }];
+        NSString *plain = [data base64EncodedStringWithOptions:kNilOptions];
+        NSMutableString *spaced = [plain mutableCopy];
+
+        for (NSUInteger i = length % 7; i < spaced.length; i += 1 + random() % 80) {
+            [spaced insertString:whitespace[random() % whitespace.count] atIndex:i];
+        }
+
+        NSMutableString *mutated = [plain mutableCopy];
+
+        if (mutated.length > 0) {
+            NSString *replacement = random() % 2 ? [NSString stringWithFormat:@"%c", (char)(1 + random() % 127)]
+                                                 : replacements[random() % replacements.count];
+
+            [mutated replaceCharactersInRange:(NSRange){ random() % mutated.length, 1 } withString:replacement];
+        }
+
+        [strings addObjectsFromArray:@[ plain, spaced, mutated ]];
+    }
+
+    return strings;
+}
+
+// Decoding Base-64 directly must give the same results as NSData
+static void SCITestBase64(void) {
+    for (NSString *string in SCITestBase64Strings()) {
+        @autoreleasepool {
+            NSData *data = SCIBase64StringToData(string);
+            NSData *expected = SCIBase64StringToDataUsingFoundation(string);
+
+            SCITestCheck((data == nil) == (expected == nil) && (data == nil || [data isEqual:expected]),
+                         @"Base-64 decoding differs for '%@': %@ (expected %@)",
+                         string.length > 100 ? [string substringToIndex:100] : string,
+                         data.length > 100 ? @(data.length) : data,
+                         expected.length > 100 ? @(expected.length) : expected);
+        }
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    @autoreleasepool {
+        NSMutableArray<NSString *> *paths = [NSMutableArray new];
+
+        for (int i = 1; i < argc; i++) {
+            [paths addObject:@(argv[i])];
+        }
+
+        NSArray<NSData *> *documents = SCITestDocumentData(paths);
+
+        SCITestExamples();
+        SCITestParsing(documents);
+        SCITestCompaction(documents);
+        SCITestCompiledTransforms(documents);
+        SCITestNoCopyLifetime(documents);
+        SCITestConcurrentCompaction();
+        SCITestRecords();
+        SCITestWriting(documents);
+        SCITestDirectWriter(documents);
+        SCITestNaturalDirectWriter(documents);
+        SCITestMetrics(documents);
+        SCITestProjections(documents);
+        SCITestParserReuse(documents);
+        SCITestSnapshots(documents);
+        SCITestEscapes();
+        SCITestDates();
+        SCITestBase64();
 
-        NSLog(@"\n\n%@", xml ?: error);
-#endif
+        printf("%lu failures\n", (unsigned long)SCITestFailures);
     }
 
-    return 0;
+    return SCITestFailures == 0 ? 0 : 1;
 }